@@ -0,0 +1,517 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "generator/synthetic_module.h"
+#include "linker/module_merger.h"
+#include "repr/abi_diff_helpers.h"
+#include "repr/ir_dumper.h"
+#include "repr/ir_reader.h"
+#include "repr/ir_representation.h"
+#include "repr/symbol/exported_symbol_set.h"
+#include "repr/symbol/version_script_parser.h"
+#include "utils/header_abi_util.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+
+using namespace header_checker;
+using header_checker::linker::ModuleMerger;
+using header_checker::repr::AbiDiffHelper;
+using header_checker::repr::DiffPolicyOptions;
+using header_checker::repr::ExportedSymbolSet;
+using header_checker::repr::IRDumper;
+using header_checker::repr::IRReader;
+using header_checker::repr::ModuleIR;
+using header_checker::repr::TextFormatIR;
+using header_checker::repr::VersionScriptParser;
+using header_checker::utils::CollectAllExportedHeaders;
+
+
+static llvm::cl::opt<std::string> reference_dumps_dir(
+    "reference-dumps-dir",
+    llvm::cl::desc("The directory of the reference dumps. Default to "
+                   "tests/reference_dumps next to the executable"),
+    llvm::cl::Optional);
+
+
+// The names of the benchmarks are the function and the input, e.g.,
+// "ProtobufIRReader/arm64/libgolden_cpp", so that the results in JSON format
+// can be compared across releases.
+static const char *const kReferenceDumps[] = {
+    "arm64/libgolden_cpp",
+    "arm64/libgolden_cpp_inheritance_type_changed",
+    "arm64/libgolden_cpp_member_diff",
+    "arm64/libreproducability",
+    "x86_64/libgolden_cpp",
+};
+
+// The old and new reference dumps compared by CompareAndDumpTypeDiff.
+static const char *const kReferenceDumpDiffs[][2] = {
+    {"arm64/libgolden_cpp", "arm64/libgolden_cpp_member_diff"},
+    {"arm64/libgolden_cpp", "arm64/libgolden_cpp_inheritance_type_changed"},
+};
+
+static const int kSyntheticScales[] = {1000, 10000};
+
+
+struct BenchmarkInput {
+  std::string name_;
+  std::string protobuf_path_;
+  std::string json_path_;
+  uint64_t protobuf_size_ = 0;
+  uint64_t json_size_ = 0;
+};
+
+
+static std::string temp_dir;
+
+
+// Removes the temporary directory and the files of the benchmarks on every
+// return from main().
+class ScopedTempDir {
+ public:
+  ~ScopedTempDir() {
+    if (!path_.empty()) {
+      llvm::sys::fs::remove_directories(path_);
+    }
+  }
+
+  bool Create(const std::string &prefix) {
+    llvm::SmallString<256> path;
+    if (llvm::sys::fs::createUniqueDirectory(prefix, path)) {
+      return false;
+    }
+    path_ = std::string(path);
+    return true;
+  }
+
+  const std::string &GetPath() const {
+    return path_;
+  }
+
+ private:
+  std::string path_;
+};
+
+
+static std::string GetDefaultReferenceDumpsDir(const char *argv_0) {
+  std::string exe_path = llvm::sys::fs::getMainExecutable(
+      argv_0, (void *)GetDefaultReferenceDumpsDir);
+  llvm::SmallString<256> dir(llvm::sys::path::parent_path(exe_path));
+  llvm::sys::path::append(dir, "tests", "reference_dumps");
+  return std::string(dir);
+}
+
+static uint64_t GetFileSize(const std::string &path) {
+  uint64_t size = 0;
+  llvm::sys::fs::file_size(path, size);
+  return size;
+}
+
+// Returns nullptr on failure.
+static std::unique_ptr<ModuleIR> ReadModule(const std::string &path,
+                                            TextFormatIR format) {
+  std::unique_ptr<IRReader> reader = IRReader::CreateIRReader(format);
+  if (!reader->ReadDump(path)) {
+    llvm::errs() << "Failed to read " << path << "\n";
+    return nullptr;
+  }
+  return reader->TakeModule();
+}
+
+static bool DumpModule(const ModuleIR &module, const std::string &path,
+                       TextFormatIR format) {
+  std::unique_ptr<IRDumper> dumper = IRDumper::CreateIRDumper(format, path);
+  if (!dumper->Dump(module)) {
+    llvm::errs() << "Failed to write " << path << "\n";
+    return false;
+  }
+  return true;
+}
+
+static std::string GetTempPath(const std::string &name,
+                               const std::string &extension) {
+  std::string file_name = name;
+  std::replace(file_name.begin(), file_name.end(), '/', '_');
+  llvm::SmallString<256> path(temp_dir);
+  llvm::sys::path::append(path, file_name + extension);
+  return std::string(path);
+}
+
+// Generates the linked module of a library of num_records records with
+// template instantiations and vtables.
+static std::unique_ptr<ModuleIR> CreateSyntheticModule(int num_records) {
+  generator::SyntheticModuleOptions options;
+  options.num_records_ = num_records;
+  options.template_fan_out_ = 2;
+  options.vtable_size_ = 4;
+  return generator::SyntheticModuleGenerator(options).GenerateLinkedModule();
+}
+
+// Converts the reference dumps to JSON and generates the synthetic dumps.
+// Returns false if any of them cannot be written.
+static bool CreateBenchmarkInputs(const std::string &dumps_dir,
+                                  std::vector<BenchmarkInput> *inputs) {
+  for (const char *name : kReferenceDumps) {
+    BenchmarkInput input;
+    input.name_ = name;
+    input.protobuf_path_ = dumps_dir + "/" + name + ".so.lsdump";
+    if (!llvm::sys::fs::exists(input.protobuf_path_)) {
+      llvm::errs() << "Skipping missing reference dump "
+                   << input.protobuf_path_ << "\n";
+      continue;
+    }
+    input.json_path_ = GetTempPath(name, ".lsdump.json");
+    std::unique_ptr<ModuleIR> module =
+        ReadModule(input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+    if (!module ||
+        !DumpModule(*module, input.json_path_, TextFormatIR::Json)) {
+      return false;
+    }
+    inputs->emplace_back(std::move(input));
+  }
+  for (int scale : kSyntheticScales) {
+    BenchmarkInput input;
+    input.name_ = "synthetic/" + std::to_string(scale);
+    input.protobuf_path_ = GetTempPath(input.name_, ".lsdump");
+    input.json_path_ = GetTempPath(input.name_, ".lsdump.json");
+    std::unique_ptr<ModuleIR> module = CreateSyntheticModule(scale);
+    if (!DumpModule(*module, input.protobuf_path_,
+                    TextFormatIR::ProtobufTextFormat) ||
+        !DumpModule(*module, input.json_path_, TextFormatIR::Json)) {
+      return false;
+    }
+    inputs->emplace_back(std::move(input));
+  }
+  for (auto &&input : *inputs) {
+    input.protobuf_size_ = GetFileSize(input.protobuf_path_);
+    input.json_size_ = GetFileSize(input.json_path_);
+  }
+  return true;
+}
+
+static const BenchmarkInput *FindInput(
+    const std::vector<BenchmarkInput> &inputs, const std::string &name) {
+  for (auto &&input : inputs) {
+    if (input.name_ == name) {
+      return &input;
+    }
+  }
+  return nullptr;
+}
+
+
+static void BM_ProtobufIRReader(benchmark::State &state,
+                                const BenchmarkInput &input) {
+  for (auto _ : state) {
+    std::unique_ptr<ModuleIR> module =
+        ReadModule(input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+    if (!module) {
+      state.SkipWithError("Failed to read the dump");
+      break;
+    }
+    benchmark::DoNotOptimize(module);
+  }
+  state.SetBytesProcessed(state.iterations() * input.protobuf_size_);
+}
+
+static void BM_JsonIRReader(benchmark::State &state,
+                            const BenchmarkInput &input) {
+  for (auto _ : state) {
+    std::unique_ptr<ModuleIR> module =
+        ReadModule(input.json_path_, TextFormatIR::Json);
+    if (!module) {
+      state.SkipWithError("Failed to read the dump");
+      break;
+    }
+    benchmark::DoNotOptimize(module);
+  }
+  state.SetBytesProcessed(state.iterations() * input.json_size_);
+}
+
+static void BM_JsonIRDumper(benchmark::State &state,
+                            const BenchmarkInput &input) {
+  std::unique_ptr<ModuleIR> module =
+      ReadModule(input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+  if (!module) {
+    state.SkipWithError("Failed to read the dump");
+    return;
+  }
+  const std::string output_path = GetTempPath(input.name_, ".out.json");
+  for (auto _ : state) {
+    if (!DumpModule(*module, output_path, TextFormatIR::Json)) {
+      state.SkipWithError("Failed to write the dump");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * input.json_size_);
+  llvm::sys::fs::remove(output_path);
+}
+
+// Merges the module twice, as the linker merges the translation units that
+// define the same types.
+static void BM_MergeGraphs(benchmark::State &state,
+                           const BenchmarkInput &input) {
+  std::unique_ptr<ModuleIR> module =
+      ReadModule(input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+  if (!module) {
+    state.SkipWithError("Failed to read the dump");
+    return;
+  }
+  for (auto _ : state) {
+    ModuleMerger merger(nullptr);
+    merger.MergeGraphs(*module);
+    merger.MergeGraphs(*module);
+    benchmark::DoNotOptimize(merger.GetModule());
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * module->type_graph_.size());
+}
+
+// Compares each type in the old dump with the type of the same id in the new
+// dump.
+static void BM_CompareAndDumpTypeDiff(benchmark::State &state,
+                                      const BenchmarkInput &old_input,
+                                      const BenchmarkInput &new_input) {
+  std::unique_ptr<ModuleIR> old_module =
+      ReadModule(old_input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+  std::unique_ptr<ModuleIR> new_module =
+      ReadModule(new_input.protobuf_path_, TextFormatIR::ProtobufTextFormat);
+  if (!old_module || !new_module) {
+    state.SkipWithError("Failed to read the dumps");
+    return;
+  }
+  std::vector<std::string> type_ids;
+  for (auto &&entry : old_module->type_graph_) {
+    if (new_module->type_graph_.count(entry.first)) {
+      type_ids.emplace_back(entry.first);
+    }
+  }
+  DiffPolicyOptions diff_policy_options(false);
+  for (auto _ : state) {
+    std::set<std::string> type_cache;
+    AbiDiffHelper diff_helper(old_module->type_graph_,
+                              new_module->type_graph_, diff_policy_options,
+                              &type_cache);
+    for (auto &&type_id : type_ids) {
+      benchmark::DoNotOptimize(
+          diff_helper.CompareAndDumpTypeDiff(type_id, type_id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * type_ids.size());
+}
+
+// Returns a version script of num_symbols symbols with tags, and glob
+// patterns and C++ symbols in an extern "C++" block.
+static std::string CreateVersionScript(int num_symbols) {
+  std::ostringstream script;
+  script << "LIBSYNTHETIC {\n  global:\n";
+  for (int i = 0; i < num_symbols; i++) {
+    script << "    function" << i << ";";
+    if (i % 10 == 1) {
+      script << " # introduced=29";
+    } else if (i % 10 == 2) {
+      script << " # var";
+    } else if (i % 10 == 3) {
+      script << " # arm64";
+    }
+    script << "\n";
+  }
+  script << "    prefix_*;\n"
+            "    extern \"C++\" {\n"
+            "      \"synthetic::Class::Method()\";\n"
+            "      synthetic::Namespace::*;\n"
+            "    };\n"
+            "  local:\n"
+            "    *;\n"
+            "};\n";
+  return script.str();
+}
+
+static std::unique_ptr<ExportedSymbolSet> ParseVersionScript(
+    const std::string &script) {
+  VersionScriptParser parser;
+  parser.SetArch("arm64");
+  parser.SetApiLevel(30);
+  std::istringstream stream(script);
+  return parser.Parse(stream);
+}
+
+static void BM_VersionScriptParserParse(benchmark::State &state) {
+  const std::string script = CreateVersionScript(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseVersionScript(script));
+  }
+  state.SetBytesProcessed(state.iterations() * script.size());
+}
+
+// Looks up the exported symbols, the symbols matching the patterns, and the
+// symbols that are not exported.
+static void BM_ExportedSymbolSetHasSymbol(benchmark::State &state) {
+  const int num_symbols = state.range(0);
+  std::unique_ptr<ExportedSymbolSet> symbols =
+      ParseVersionScript(CreateVersionScript(num_symbols));
+  std::vector<std::string> queries;
+  for (int i = 0; i < num_symbols; i++) {
+    queries.emplace_back("function" + std::to_string(i));
+    queries.emplace_back("prefix_" + std::to_string(i));
+    queries.emplace_back("missing" + std::to_string(i));
+  }
+  queries.emplace_back("_ZN9synthetic5Class6MethodEv");
+  queries.emplace_back("_ZN9synthetic9Namespace8FunctionEv");
+  for (auto _ : state) {
+    for (auto &&query : queries) {
+      benchmark::DoNotOptimize(symbols->HasSymbol(query));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+// Walks a tree of num_dirs directories of 50 headers each. The mtimes of the
+// directories are set to an hour ago, so that the cache written by the first
+// iteration is used by the others.
+static void SetOldMtime(const std::string &path) {
+  int fd;
+  if (llvm::sys::fs::openFileForRead(path, fd)) {
+    return;
+  }
+  auto old_time = std::chrono::system_clock::now() - std::chrono::hours(1);
+  llvm::sys::fs::setLastAccessAndModificationTime(
+      fd,
+      llvm::sys::toTimePoint(std::chrono::system_clock::to_time_t(old_time)));
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+}
+
+static void BM_CollectAllExportedHeaders(benchmark::State &state,
+                                         bool use_cache) {
+  const int num_dirs = state.range(0);
+  llvm::SmallString<256> root(temp_dir);
+  llvm::sys::path::append(root, "headers" + std::to_string(num_dirs));
+  const std::string include_dir = std::string(root) + "/include";
+  if (!llvm::sys::fs::exists(include_dir)) {
+    for (int i = 0; i < num_dirs; i++) {
+      const std::string dir = include_dir + "/dir" + std::to_string(i / 10) +
+                              "/sub" + std::to_string(i);
+      llvm::sys::fs::create_directories(dir);
+      for (int j = 0; j < 50; j++) {
+        std::ofstream(dir + "/header" + std::to_string(j) + ".h");
+      }
+    }
+    std::error_code ec;
+    for (llvm::sys::fs::recursive_directory_iterator it(include_dir, ec), end;
+         it != end && !ec; it.increment(ec)) {
+      if (it->type() == llvm::sys::fs::file_type::directory_file) {
+        SetOldMtime(it->path());
+      }
+    }
+    SetOldMtime(include_dir);
+  }
+  const std::string cache_path =
+      use_cache ? std::string(root) + "/exported_headers.cache" : "";
+  size_t num_headers = 0;
+  for (auto _ : state) {
+    num_headers = CollectAllExportedHeaders({include_dir}, std::string(root),
+                                            cache_path).size();
+  }
+  state.SetItemsProcessed(state.iterations() * num_headers);
+}
+
+
+// The JSON reader and the header walker use threads, so the wall time is
+// reported.
+template <typename... Args>
+static benchmark::internal::Benchmark *Register(const std::string &name,
+                                                Args &&... args) {
+  return benchmark::RegisterBenchmark(name.c_str(),
+                                      std::forward<Args>(args)...)
+      ->Unit(benchmark::kMillisecond)
+      ->UseRealTime();
+}
+
+static void RegisterBenchmarks(const std::vector<BenchmarkInput> &inputs) {
+  for (auto &&input : inputs) {
+    Register("ProtobufIRReader/" + input.name_, BM_ProtobufIRReader, input);
+    Register("JsonIRReader/" + input.name_, BM_JsonIRReader, input);
+    Register("JsonIRDumper/" + input.name_, BM_JsonIRDumper, input);
+    Register("MergeGraphs/" + input.name_, BM_MergeGraphs, input);
+  }
+
+  for (auto &&names : kReferenceDumpDiffs) {
+    const BenchmarkInput *old_input = FindInput(inputs, names[0]);
+    const BenchmarkInput *new_input = FindInput(inputs, names[1]);
+    if (old_input && new_input) {
+      Register("CompareAndDumpTypeDiff/" + old_input->name_ + "/" +
+                   llvm::sys::path::filename(new_input->name_).str(),
+               BM_CompareAndDumpTypeDiff, *old_input, *new_input);
+    }
+  }
+  for (int scale : kSyntheticScales) {
+    const BenchmarkInput *input =
+        FindInput(inputs, "synthetic/" + std::to_string(scale));
+    Register("CompareAndDumpTypeDiff/" + input->name_,
+             BM_CompareAndDumpTypeDiff, *input, *input);
+  }
+
+  Register("VersionScriptParserParse", BM_VersionScriptParserParse)
+      ->Arg(1000)->Arg(10000);
+  Register("ExportedSymbolSetHasSymbol", BM_ExportedSymbolSetHasSymbol)
+      ->Arg(1000)->Arg(10000);
+  Register("CollectAllExportedHeaders", BM_CollectAllExportedHeaders, false)
+      ->Arg(100);
+  Register("CollectAllExportedHeaders/cache", BM_CollectAllExportedHeaders,
+           true)->Arg(100);
+}
+
+
+int main(int argc, char **argv) {
+  // The benchmark library removes its own options, e.g., --benchmark_filter
+  // and --benchmark_format=json, before the other options are parsed.
+  benchmark::Initialize(&argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv, "header-checker benchmarks\n");
+
+  ScopedTempDir scoped_temp_dir;
+  if (!scoped_temp_dir.Create("header-checker-benchmarks")) {
+    llvm::errs() << "Failed to create temporary directory\n";
+    return 1;
+  }
+  temp_dir = scoped_temp_dir.GetPath();
+
+  std::string dumps_dir = reference_dumps_dir;
+  if (dumps_dir.empty()) {
+    dumps_dir = GetDefaultReferenceDumpsDir(argv[0]);
+  }
+  std::vector<BenchmarkInput> inputs;
+  if (!CreateBenchmarkInputs(dumps_dir, &inputs)) {
+    return 1;
+  }
+  RegisterBenchmarks(inputs);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -15,7 +15,9 @@
 #include "diff/abi_diff.h"
 
 #include "repr/ir_reader.h"
+#include "repr/module_stats.h"
 #include "utils/header_abi_util.h"
+#include "utils/time_trace.h"
 
 #include <llvm/Support/raw_ostream.h>
 
@@ -33,40 +35,76 @@ namespace diff {
 repr::CompatibilityStatusIR HeaderAbiDiff::GenerateCompatibilityReport() {
   std::unique_ptr<repr::IRReader> old_reader =
       repr::IRReader::CreateIRReader(text_format_old_);
-  if (!old_reader || !old_reader->ReadDump(old_dump_)) {
-    llvm::errs() << "Failed to read old ABI dump: " << old_dump_ << "\n";
-    ::exit(1);
+  {
+    llvm::TimeTraceScope scope("ReadDump", old_dump_);
+    // Only the types reachable from the exported symbols are compared unless
+    // all APIs are checked, so the others need not be loaded.
+    if (old_reader) {
+      old_reader->SetLazyLoading(lazy_loading_ && !check_all_apis_);
+      old_reader->SetThreadPool(reader_thread_pool_);
+    }
+    if (!old_reader || !old_reader->ReadDump(old_dump_)) {
+      llvm::errs() << "Failed to read old ABI dump: " << old_dump_ << "\n";
+      ::exit(1);
+    }
   }
+  repr::AddStatsPhase("ReadDump " + old_dump_);
+  repr::AddStatsModule(old_dump_, old_reader->GetModule());
+  return GenerateCompatibilityReport(old_reader->GetModule());
+}
 
+repr::CompatibilityStatusIR HeaderAbiDiff::GenerateCompatibilityReport(
+    const repr::ModuleIR &old_module) {
   std::unique_ptr<repr::IRReader> new_reader =
       repr::IRReader::CreateIRReader(text_format_new_);
-  if (!new_reader || !new_reader->ReadDump(new_dump_)) {
-    llvm::errs() << "Failed to read new ABI dump: " << new_dump_ << "\n";
-    ::exit(1);
+  {
+    llvm::TimeTraceScope scope("ReadDump", new_dump_);
+    if (new_reader) {
+      new_reader->SetLazyLoading(lazy_loading_ && !check_all_apis_);
+      new_reader->SetThreadPool(reader_thread_pool_);
+    }
+    if (!new_reader || !new_reader->ReadDump(new_dump_)) {
+      llvm::errs() << "Failed to read new ABI dump: " << new_dump_ << "\n";
+      ::exit(1);
+    }
   }
+  repr::AddStatsPhase("ReadDump " + new_dump_);
+  repr::AddStatsModule(new_dump_, new_reader->GetModule());
 
   std::unique_ptr<repr::IRDiffDumper> ir_diff_dumper =
       repr::IRDiffDumper::CreateIRDiffDumper(text_format_diff_, cr_);
+  ir_diff_dumper->SetIncompatibleDiffLimit(max_incompatible_diffs_);
   repr::CompatibilityStatusIR status =
-      CompareTUs(old_reader->GetModule(), new_reader->GetModule(),
+      CompareTUs(old_module, new_reader->GetModule(),
                  ir_diff_dumper.get());
-  if (!ir_diff_dumper->Dump()) {
-    llvm::errs() << "Could not dump diff report\n";
-    ::exit(1);
+  repr::AddStatsPhase("CompareTUs " + arch_);
+  {
+    llvm::TimeTraceScope scope("DumpReport", cr_);
+    if (!ir_diff_dumper->Dump()) {
+      llvm::errs() << "Could not dump diff report\n";
+      ::exit(1);
+    }
   }
+  repr::AddStatsPhase("DumpReport " + cr_);
   return status;
 }
 
 repr::CompatibilityStatusIR HeaderAbiDiff::CompareTUs(
     const repr::ModuleIR &old_tu, const repr::ModuleIR &new_tu,
     repr::IRDiffDumper *ir_diff_dumper) {
+  llvm::TimeTraceScope scope("CompareTUs", arch_);
   // Collect all old and new types in maps, so that we can refer to them by
   // type name / linker_set_key later.
-  const AbiElementMap<const repr::TypeIR *> old_types =
+  const AbiElementMap<const repr::TypeIR *> &old_types =
       old_tu.GetTypeGraph();
-  const AbiElementMap<const repr::TypeIR *> new_types =
+  const AbiElementMap<const repr::TypeIR *> &new_types =
       new_tu.GetTypeGraph();
 
+  if (type_equivalence_cache_) {
+    type_equivalence_checker_ = std::make_unique<repr::TypeEquivalenceChecker>(
+        old_types, new_types, type_equivalence_cache_);
+  }
+
   // CollectDynsymExportables() fills in added, removed, unsafe, and safe function diffs.
   if (!CollectDynsymExportables(old_tu.GetFunctions(), new_tu.GetFunctions(),
                                 old_tu.GetElfFunctions(),
@@ -91,6 +129,18 @@ repr::CompatibilityStatusIR HeaderAbiDiff::CompareTUs(
     ::exit(1);
   }
 
+  if (ir_diff_dumper->IsIncompatibleDiffLimitReached()) {
+    llvm::errs() << "Stopped after " << max_incompatible_diffs_
+                 << " incompatible changes. The report is incomplete.\n";
+  }
+
+  if (type_equivalence_checker_) {
+    utils::AddTimeTraceCounter("Type equivalence cache hits",
+                               type_equivalence_checker_->GetNumHits());
+    utils::AddTimeTraceCounter("Type equivalence cache misses",
+                               type_equivalence_checker_->GetNumMisses());
+  }
+
   repr::CompatibilityStatusIR combined_status =
       ir_diff_dumper->GetCompatibilityStatusIR();
 
@@ -166,11 +216,15 @@ bool HeaderAbiDiff::CollectUserDefinedTypesInternal(
     const AbiElementMap<const repr::TypeIR *> &new_types_map,
     repr::IRDiffDumper *ir_diff_dumper) {
 
-  return (Collect(old_ud_types_map, new_ud_types_map, nullptr, nullptr,
-                  ir_diff_dumper, old_types_map, new_types_map) &&
-          PopulateCommonElements(old_ud_types_map, new_ud_types_map,
-                                 old_types_map, new_types_map, ir_diff_dumper,
-                                 repr::DiffMessageIR::Unreferenced));
+  // User defined types do not have ELF symbols.
+  const AbiElementMap<repr::ElfObjectIR> *no_elf_map = nullptr;
+  return (Collect<T>(old_ud_types_map, new_ud_types_map, no_elf_map,
+                     no_elf_map, ir_diff_dumper, old_types_map,
+                     new_types_map) &&
+          PopulateCommonElements<T>(old_ud_types_map, new_ud_types_map,
+                                    old_types_map, new_types_map,
+                                    ir_diff_dumper,
+                                    repr::DiffMessageIR::Unreferenced));
 }
 
 template <typename T, typename ElfSymbolType>
@@ -182,33 +236,13 @@ bool HeaderAbiDiff::CollectDynsymExportables(
     const AbiElementMap<const repr::TypeIR *> &old_types_map,
     const AbiElementMap<const repr::TypeIR *> &new_types_map,
     repr::IRDiffDumper *ir_diff_dumper) {
-  AbiElementMap<const T *> old_exportables_map;
-  AbiElementMap<const T *> new_exportables_map;
-  AbiElementMap<const repr::ElfSymbolIR *> old_elf_symbol_map;
-  AbiElementMap<const repr::ElfSymbolIR *> new_elf_symbol_map;
-
-  utils::AddToMap(&old_exportables_map, old_exportables,
-                  [](auto e) { return e->first;},
-                  [](auto e) {return &(e->second);});
-  utils::AddToMap(&new_exportables_map, new_exportables,
-                  [](auto e) { return e->first;},
-                  [](auto e) { return &(e->second);});
-
-  utils::AddToMap(&old_elf_symbol_map, old_elf_symbols,
-                  [](auto e) { return e->first;},
-                  [](auto e) {return &(e->second);});
-  utils::AddToMap(&new_elf_symbol_map, new_elf_symbols,
-                  [](auto e) { return e->first;},
-                  [](auto e) {return &(e->second);});
-
-  if (!Collect(old_exportables_map,
-               new_exportables_map, &old_elf_symbol_map, &new_elf_symbol_map,
-               ir_diff_dumper, old_types_map, new_types_map) ||
-      !CollectElfSymbols(old_elf_symbol_map, new_elf_symbol_map,
-                         ir_diff_dumper) ||
-      !PopulateCommonElements(old_exportables_map, new_exportables_map,
-                              old_types_map, new_types_map, ir_diff_dumper,
-                              repr::DiffMessageIR::Referenced)) {
+  if (!Collect<T>(old_exportables, new_exportables, &old_elf_symbols,
+                  &new_elf_symbols, ir_diff_dumper, old_types_map,
+                  new_types_map) ||
+      !CollectElfSymbols(old_elf_symbols, new_elf_symbols, ir_diff_dumper) ||
+      !PopulateCommonElements<T>(old_exportables, new_exportables,
+                                 old_types_map, new_types_map, ir_diff_dumper,
+                                 repr::DiffMessageIR::Referenced)) {
     llvm::errs() << "Diffing dynsym exportables failed\n";
     return false;
   }
@@ -221,19 +255,19 @@ bool HeaderAbiDiff::CollectDynsymExportables(
 // file on target B. Even though Foo() does not have metadata surrounding it
 // when building target A, it doesn't mean that Foo() is not a part of the ABI
 // of the library.
-template <typename T>
+template <typename T, typename ElementMap, typename ElfSymbolMap>
 bool HeaderAbiDiff::Collect(
-    const AbiElementMap<const T*> &old_elements_map,
-    const AbiElementMap<const T*> &new_elements_map,
-    const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-    const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+    const ElementMap &old_elements_map,
+    const ElementMap &new_elements_map,
+    const ElfSymbolMap *old_elf_map,
+    const ElfSymbolMap *new_elf_map,
     repr::IRDiffDumper *ir_diff_dumper,
     const AbiElementMap<const repr::TypeIR *> &old_types_map,
     const AbiElementMap<const repr::TypeIR *> &new_types_map) {
-  if (!PopulateRemovedElements(
+  if (!PopulateRemovedElements<T>(
           old_elements_map, new_elements_map, old_elf_map, new_elf_map,
           ir_diff_dumper, repr::DiffMessageIR::Removed, old_types_map) ||
-      !PopulateRemovedElements(
+      !PopulateRemovedElements<T>(
           new_elements_map, old_elements_map, new_elf_map, old_elf_map,
           ir_diff_dumper, repr::DiffMessageIR::Added, new_types_map)) {
     llvm::errs() << "Populating functions in report failed\n";
@@ -242,15 +276,18 @@ bool HeaderAbiDiff::Collect(
   return true;
 }
 
+template <typename ElfSymbolMap>
 bool HeaderAbiDiff::CollectElfSymbols(
-    const AbiElementMap<const repr::ElfSymbolIR *> &old_symbols,
-    const AbiElementMap<const repr::ElfSymbolIR *> &new_symbols,
+    const ElfSymbolMap &old_symbols,
+    const ElfSymbolMap &new_symbols,
     repr::IRDiffDumper *ir_diff_dumper) {
   std::vector<const repr::ElfSymbolIR *> removed_elements =
-      utils::FindRemovedElements(old_symbols, new_symbols);
+      utils::FindRemovedElementPointers<repr::ElfSymbolIR>(old_symbols,
+                                                           new_symbols);
 
   std::vector<const repr::ElfSymbolIR *> added_elements =
-      utils::FindRemovedElements(new_symbols, old_symbols);
+      utils::FindRemovedElementPointers<repr::ElfSymbolIR>(new_symbols,
+                                                           old_symbols);
 
   return (PopulateElfElements(removed_elements, ir_diff_dumper,
                               repr::IRDiffDumper::DiffKind::Removed) &&
@@ -263,6 +300,9 @@ bool HeaderAbiDiff::PopulateElfElements(
     repr::IRDiffDumper *ir_diff_dumper,
     repr::IRDiffDumper::DiffKind diff_kind) {
   for (auto &&elf_element : elf_elements) {
+    if (ir_diff_dumper->IsIncompatibleDiffLimitReached()) {
+      break;
+    }
     if (allow_adding_removing_weak_symbols_ &&
         elf_element->GetBinding() == repr::ElfSymbolIR::Weak) {
       continue;
@@ -274,17 +314,18 @@ bool HeaderAbiDiff::PopulateElfElements(
   return true;
 }
 
-template <typename T>
+template <typename T, typename ElementMap, typename ElfSymbolMap>
 bool HeaderAbiDiff::PopulateRemovedElements(
-    const AbiElementMap<const T*> &old_elements_map,
-    const AbiElementMap<const T*> &new_elements_map,
-    const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-    const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+    const ElementMap &old_elements_map,
+    const ElementMap &new_elements_map,
+    const ElfSymbolMap *old_elf_map,
+    const ElfSymbolMap *new_elf_map,
     repr::IRDiffDumper *ir_diff_dumper,
     repr::IRDiffDumper::DiffKind diff_kind,
     const AbiElementMap<const repr::TypeIR *> &removed_types_map) {
   std::vector<const T *> removed_elements =
-      utils::FindRemovedElements(old_elements_map, new_elements_map);
+      utils::FindRemovedElementPointers<T>(old_elements_map,
+                                           new_elements_map);
   if (!DumpLoneElements(removed_elements, old_elf_map, new_elf_map,
                         ir_diff_dumper, diff_kind, removed_types_map)) {
     llvm::errs() << "Dumping added or removed element to report failed\n";
@@ -296,16 +337,16 @@ bool HeaderAbiDiff::PopulateRemovedElements(
 // Find the common elements (common records, common enums, common functions etc)
 // Dump the differences (we need type maps for this diff since we'll get
 // reachable types from here)
-template <typename T>
+template <typename T, typename ElementMap>
 bool HeaderAbiDiff::PopulateCommonElements(
-    const AbiElementMap<const T *> &old_elements_map,
-    const AbiElementMap<const T *> &new_elements_map,
+    const ElementMap &old_elements_map,
+    const ElementMap &new_elements_map,
     const AbiElementMap<const repr::TypeIR *> &old_types,
     const AbiElementMap<const repr::TypeIR *> &new_types,
     repr::IRDiffDumper *ir_diff_dumper,
     repr::IRDiffDumper::DiffKind diff_kind) {
   std::vector<std::pair<const T *, const T *>> common_elements =
-      utils::FindCommonElements(old_elements_map, new_elements_map);
+      utils::FindCommonElementPointers<T>(old_elements_map, new_elements_map);
   if (!DumpDiffElements(common_elements, old_types, new_types,
                         ir_diff_dumper, diff_kind)) {
     llvm::errs() << "Dumping difference in common element to report failed\n";
@@ -314,18 +355,19 @@ bool HeaderAbiDiff::PopulateCommonElements(
   return true;
 }
 
-template <typename T>
+template <typename T, typename ElfSymbolMap>
 bool HeaderAbiDiff::DumpLoneElements(
     std::vector<const T *> &elements,
-    const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-    const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+    const ElfSymbolMap *old_elf_map,
+    const ElfSymbolMap *new_elf_map,
     repr::IRDiffDumper *ir_diff_dumper,
     repr::IRDiffDumper::DiffKind diff_kind,
     const AbiElementMap<const repr::TypeIR *> &types_map) {
-  std::smatch source_file_match;
-  std::regex source_file_regex(" at ");
 
   for (auto &&element : elements) {
+    if (ir_diff_dumper->IsIncompatibleDiffLimitReached()) {
+      break;
+    }
     if (IgnoreSymbol<T>(element, ignored_symbols_,
                         [](const T *e) {return e->GetLinkerSetKey();})) {
       continue;
@@ -348,17 +390,18 @@ bool HeaderAbiDiff::DumpLoneElements(
     if (allow_adding_removing_weak_symbols_ && old_elf_map) {
       auto elem_it = old_elf_map->find(element_linker_set_key);
       if (elem_it != old_elf_map->end() &&
-          elem_it->second->GetBinding() == repr::ElfSymbolIR::Weak) {
+          utils::GetElementPointer(elem_it->second)->GetBinding() ==
+              repr::ElfSymbolIR::Weak) {
         continue;
       }
     }
 
     // If the record / enum has source file information, skip it.
-    if (std::regex_search(element_linker_set_key, source_file_match,
-                          source_file_regex)) {
+    if (element_linker_set_key.find(" at ") != std::string::npos) {
       continue;
     }
 
+    // Only the reported elements are copied.
     auto element_copy = *element;
     ReplaceTypeIdsWithTypeNames(types_map, &element_copy);
     if (!ir_diff_dumper->AddLinkableMessageIR(&element_copy, diff_kind)) {
@@ -377,6 +420,9 @@ bool HeaderAbiDiff::DumpDiffElements(
     repr::IRDiffDumper *ir_diff_dumper,
     repr::IRDiffDumper::DiffKind diff_kind) {
   for (auto &&pair : pairs) {
+    if (ir_diff_dumper->IsIncompatibleDiffLimitReached()) {
+      break;
+    }
     const T *old_element = pair.first;
     const T *new_element = pair.second;
 
@@ -385,9 +431,12 @@ bool HeaderAbiDiff::DumpDiffElements(
       continue;
     }
 
+    llvm::TimeTraceScope scope("DiffElement", [&]() {
+      return old_element->GetLinkerSetKey();
+    });
     DiffWrapper<T> diff_wrapper(
         old_element, new_element, ir_diff_dumper, old_types, new_types,
-        diff_policy_options_, &type_cache_);
+        diff_policy_options_, &type_cache_, type_equivalence_checker_.get());
     if (!diff_wrapper.DumpDiff(diff_kind)) {
       llvm::errs() << "Failed to diff elements\n";
       return false;
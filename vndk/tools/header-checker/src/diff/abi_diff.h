@@ -17,7 +17,12 @@
 
 #include "diff/abi_diff_wrappers.h"
 #include "repr/ir_representation.h"
+#include "repr/type_equivalence_cache.h"
 
+#include <llvm/Support/ThreadPool.h>
+
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -40,7 +45,8 @@ class HeaderAbiDiff {
                 const DiffPolicyOptions &diff_policy_options,
                 bool check_all_apis, repr::TextFormatIR text_format_old,
                 repr::TextFormatIR text_format_new,
-                repr::TextFormatIR text_format_diff)
+                repr::TextFormatIR text_format_diff,
+                uint64_t max_incompatible_diffs)
       : lib_name_(lib_name), arch_(arch), old_dump_(old_dump),
         new_dump_(new_dump), cr_(compatibility_report),
         ignored_symbols_(ignored_symbols),
@@ -48,10 +54,33 @@ class HeaderAbiDiff {
         allow_adding_removing_weak_symbols_(allow_adding_removing_weak_symbols),
         check_all_apis_(check_all_apis),
         text_format_old_(text_format_old), text_format_new_(text_format_new),
-        text_format_diff_(text_format_diff) {}
+        text_format_diff_(text_format_diff),
+        max_incompatible_diffs_(max_incompatible_diffs) {}
+
+  // Shares the results of type comparisons with the other HeaderAbiDiff
+  // instances using the same cache, e.g., the diffs of other architectures.
+  void SetTypeEquivalenceCache(repr::TypeEquivalenceCache *cache) {
+    type_equivalence_cache_ = cache;
+  }
+
+  // Loads only the types reachable from the exported symbols if a dump has an
+  // up-to-date index. It has no effect if all APIs are checked.
+  void SetLazyLoading(bool lazy_loading) {
+    lazy_loading_ = lazy_loading;
+  }
+
+  // Parses the sections of large ABI dumps on the thread pool.
+  void SetReaderThreadPool(llvm::ThreadPool *thread_pool) {
+    reader_thread_pool_ = thread_pool;
+  }
 
   repr::CompatibilityStatusIR GenerateCompatibilityReport();
 
+  // Compares against an old ABI dump which has already been read, e.g., by the
+  // reference dump cache of the diff server.
+  repr::CompatibilityStatusIR GenerateCompatibilityReport(
+      const repr::ModuleIR &old_module);
+
  private:
   repr::CompatibilityStatusIR CompareTUs(
       const repr::ModuleIR &old_tu,
@@ -68,19 +97,21 @@ class HeaderAbiDiff {
       const AbiElementMap<const repr::TypeIR *> &new_types_map,
       repr::IRDiffDumper *ir_diff_dumper);
 
-  template <typename T>
+  // The element maps may hold either T or const T *.
+  template <typename T, typename ElementMap, typename ElfSymbolMap>
   bool Collect(
-      const AbiElementMap<const T *> &old_elements_map,
-      const AbiElementMap<const T *> &new_elements_map,
-      const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-      const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+      const ElementMap &old_elements_map,
+      const ElementMap &new_elements_map,
+      const ElfSymbolMap *old_elf_map,
+      const ElfSymbolMap *new_elf_map,
       repr::IRDiffDumper *ir_diff_dumper,
       const AbiElementMap<const repr::TypeIR *> &old_types_map,
       const AbiElementMap<const repr::TypeIR *> &new_types_map);
 
+  template <typename ElfSymbolMap>
   bool CollectElfSymbols(
-      const AbiElementMap<const repr::ElfSymbolIR *> &old_symbols,
-      const AbiElementMap<const repr::ElfSymbolIR *> &new_symbols,
+      const ElfSymbolMap &old_symbols,
+      const ElfSymbolMap &new_symbols,
       repr::IRDiffDumper *ir_diff_dumper);
 
   bool PopulateElfElements(
@@ -88,20 +119,20 @@ class HeaderAbiDiff {
       repr::IRDiffDumper *ir_diff_dumper,
       repr::IRDiffDumper::DiffKind diff_kind);
 
-  template <typename T>
+  template <typename T, typename ElementMap, typename ElfSymbolMap>
   bool PopulateRemovedElements(
-      const AbiElementMap<const T *> &old_elements_map,
-      const AbiElementMap<const T *> &new_elements_map,
-      const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-      const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+      const ElementMap &old_elements_map,
+      const ElementMap &new_elements_map,
+      const ElfSymbolMap *old_elf_map,
+      const ElfSymbolMap *new_elf_map,
       repr::IRDiffDumper *ir_diff_dumper,
       repr::IRDiffDumper::DiffKind diff_kind,
       const AbiElementMap<const repr::TypeIR *> &types_map);
 
-  template <typename T>
+  template <typename T, typename ElementMap>
   bool PopulateCommonElements(
-      const AbiElementMap<const T *> &old_elements_map,
-      const AbiElementMap<const T *> &new_elements_map,
+      const ElementMap &old_elements_map,
+      const ElementMap &new_elements_map,
       const AbiElementMap<const repr::TypeIR *> &old_types,
       const AbiElementMap<const repr::TypeIR *> &new_types,
       repr::IRDiffDumper *ir_diff_dumper,
@@ -115,11 +146,11 @@ class HeaderAbiDiff {
       repr::IRDiffDumper *ir_diff_dumper,
       repr::IRDiffDumper::DiffKind diff_kind);
 
-  template <typename T>
+  template <typename T, typename ElfSymbolMap>
   bool DumpLoneElements(
       std::vector<const T *> &elements,
-      const AbiElementMap<const repr::ElfSymbolIR *> *old_elf_map,
-      const AbiElementMap<const repr::ElfSymbolIR *> *new_elf_map,
+      const ElfSymbolMap *old_elf_map,
+      const ElfSymbolMap *new_elf_map,
       repr::IRDiffDumper *ir_diff_dumper,
       repr::IRDiffDumper::DiffKind diff_kind,
       const AbiElementMap<const repr::TypeIR *> &old_types_map);
@@ -153,10 +184,15 @@ class HeaderAbiDiff {
   const DiffPolicyOptions &diff_policy_options_;
   bool allow_adding_removing_weak_symbols_;
   bool check_all_apis_;
+  bool lazy_loading_ = false;
   std::set<std::string> type_cache_;
   repr::TextFormatIR text_format_old_;
   repr::TextFormatIR text_format_new_;
   repr::TextFormatIR text_format_diff_;
+  uint64_t max_incompatible_diffs_;
+  repr::TypeEquivalenceCache *type_equivalence_cache_ = nullptr;
+  llvm::ThreadPool *reader_thread_pool_ = nullptr;
+  std::unique_ptr<repr::TypeEquivalenceChecker> type_equivalence_checker_;
 };
 
 
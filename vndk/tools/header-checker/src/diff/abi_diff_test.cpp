@@ -0,0 +1,151 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "diff/abi_diff.h"
+
+#include "repr/ir_diff_dumper.h"
+#include "repr/ir_dumper.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+
+
+namespace header_checker {
+namespace diff {
+
+
+class HeaderAbiDiffTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("abi_diff_test", root_));
+    old_dump_ = (root_ + "/old.lsdump").str();
+    new_dump_ = (root_ + "/new.lsdump").str();
+    report_ = (root_ + "/report.txt").str();
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove_directories(root_);
+  }
+
+  // Writes a module that exports `num_functions` functions.
+  void WriteDump(const std::string &path, int num_functions) {
+    repr::ModuleIR module(nullptr);
+    repr::BuiltinTypeIR void_type;
+    void_type.SetName("void");
+    void_type.SetLinkerSetKey("void");
+    void_type.SetSelfType("_ZTIv");
+    void_type.SetReferencedType("_ZTIv");
+    module.AddBuiltinType(std::move(void_type));
+    for (int i = 0; i < num_functions; i++) {
+      std::string name = "f" + std::to_string(i);
+      std::string mangled_name = "_Z2" + name + "v";
+      repr::FunctionIR function;
+      function.SetName(name);
+      function.SetLinkerSetKey(mangled_name);
+      function.SetReturnType("_ZTIv");
+      module.AddFunction(std::move(function));
+      module.AddElfFunction(repr::ElfFunctionIR(
+          mangled_name, repr::ElfSymbolIR::ElfSymbolBinding::Global));
+    }
+    std::unique_ptr<repr::IRDumper> dumper =
+        repr::IRDumper::CreateIRDumper(repr::TextFormatIR::Json, path);
+    ASSERT_TRUE(dumper->Dump(module));
+  }
+
+  repr::CompatibilityStatusIR Diff(uint64_t max_incompatible_diffs) {
+    // HeaderAbiDiff holds references to the arguments.
+    const std::string lib_name = "libtest";
+    const std::string arch = "arm64";
+    const std::set<std::string> ignored_symbols;
+    const repr::DiffPolicyOptions diff_policy_options(false);
+    HeaderAbiDiff judge(lib_name, arch, old_dump_, new_dump_, report_,
+                        ignored_symbols, false, diff_policy_options, false,
+                        repr::TextFormatIR::Json, repr::TextFormatIR::Json,
+                        repr::TextFormatIR::ProtobufTextFormat,
+                        max_incompatible_diffs);
+    return judge.GenerateCompatibilityReport();
+  }
+
+  std::string ReadReport() {
+    std::ifstream input(report_);
+    return std::string(std::istreambuf_iterator<char>(input),
+                       std::istreambuf_iterator<char>());
+  }
+
+  static size_t Count(const std::string &text, const std::string &pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+      count++;
+    }
+    return count;
+  }
+
+  llvm::SmallString<256> root_;
+  std::string old_dump_;
+  std::string new_dump_;
+  std::string report_;
+};
+
+
+TEST_F(HeaderAbiDiffTest, IncompatibleDiffLimit) {
+  ASSERT_NO_FATAL_FAILURE(WriteDump(old_dump_, 5));
+  ASSERT_NO_FATAL_FAILURE(WriteDump(new_dump_, 0));
+
+  EXPECT_TRUE(Diff(0) & repr::CompatibilityStatusIR::Incompatible);
+  EXPECT_EQ(5u, Count(ReadReport(), "functions_removed {"));
+
+  // The report stops after the limit but is still complete at the final path.
+  EXPECT_TRUE(Diff(2) & repr::CompatibilityStatusIR::Incompatible);
+  std::string report = ReadReport();
+  EXPECT_EQ(2u, Count(report, "functions_removed {"));
+  EXPECT_EQ(1u, Count(report, "lib_name: \"libtest\""));
+}
+
+
+TEST_F(HeaderAbiDiffTest, ReportIsWrittenByDump) {
+  {
+    std::unique_ptr<repr::IRDiffDumper> dumper = repr::IRDiffDumper::
+        CreateIRDiffDumper(repr::TextFormatIR::ProtobufTextFormat, report_);
+    repr::ElfFunctionIR elf_function(
+        "_Z1fv", repr::ElfSymbolIR::ElfSymbolBinding::Global);
+    ASSERT_TRUE(dumper->AddElfSymbolMessageIR(
+        &elf_function, repr::IRDiffDumper::DiffKind::Removed));
+    // A run which fails before Dump() leaves neither the report nor the
+    // temporary file.
+  }
+  EXPECT_FALSE(llvm::sys::fs::exists(report_));
+  std::error_code ec;
+  EXPECT_EQ(llvm::sys::fs::directory_iterator(),
+            llvm::sys::fs::directory_iterator(root_, ec));
+
+  std::unique_ptr<repr::IRDiffDumper> dumper = repr::IRDiffDumper::
+      CreateIRDiffDumper(repr::TextFormatIR::ProtobufTextFormat, report_);
+  dumper->AddLibNameIR("libtest");
+  EXPECT_FALSE(llvm::sys::fs::exists(report_));
+  ASSERT_TRUE(dumper->Dump());
+  EXPECT_EQ("lib_name: \"libtest\"\n", ReadReport());
+}
+
+
+}  // namespace diff
+}  // namespace header_checker
@@ -43,9 +43,10 @@ class DiffWrapper : public AbiDiffHelper {
               const AbiElementMap<const repr::TypeIR *> &old_types,
               const AbiElementMap<const repr::TypeIR *> &new_types,
               const repr::DiffPolicyOptions &diff_policy_options,
-              std::set<std::string> *type_cache)
+              std::set<std::string> *type_cache,
+              repr::TypeEquivalenceChecker *type_equivalence_checker = nullptr)
       : AbiDiffHelper(old_types, new_types, diff_policy_options, type_cache,
-                      ir_diff_dumper),
+                      ir_diff_dumper, type_equivalence_checker),
         oldp_(oldp), newp_(newp) {}
 
   bool DumpDiff(repr::IRDiffDumper::DiffKind diff_kind);
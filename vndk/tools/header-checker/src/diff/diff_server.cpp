@@ -0,0 +1,361 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "diff/diff_server.h"
+
+#include "repr/ir_reader.h"
+#include "utils/header_abi_util.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+namespace header_checker {
+namespace diff {
+
+
+// A request consists of the working directory of the client followed by its
+// argument vector, each terminated by '\0'. The client shuts down its end of
+// the connection after the request. The response consists of the diagnostics,
+// a '\0', and the exit status in decimal.
+static const char kFieldSeparator = '\0';
+
+
+const repr::ModuleIR *ReferenceDumpCache::GetModule(
+    const std::string &dump_path, repr::TextFormatIR text_format) {
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(dump_path, status)) {
+    llvm::errs() << "Failed to stat ABI dump: " << dump_path << "\n";
+    return nullptr;
+  }
+  llvm::sys::TimePoint<> mtime = status.getLastModificationTime();
+
+  auto it = entries_.find(dump_path);
+  bool is_cached = (it != entries_.end() &&
+                    it->second.text_format_ == text_format);
+  if (is_cached && it->second.mtime_ == mtime) {
+    return it->second.module_.get();
+  }
+
+  llvm::ErrorOr<llvm::MD5::MD5Result> hash =
+      llvm::sys::fs::md5_contents(dump_path);
+  if (!hash) {
+    llvm::errs() << "Failed to hash ABI dump: " << dump_path << "\n";
+    return nullptr;
+  }
+  if (is_cached && it->second.hash_ == *hash) {
+    // The file was touched but its content is unchanged.
+    it->second.mtime_ = mtime;
+    return it->second.module_.get();
+  }
+
+  std::unique_ptr<repr::IRReader> reader =
+      repr::IRReader::CreateIRReader(text_format);
+  if (!reader || !reader->ReadDump(dump_path)) {
+    llvm::errs() << "Failed to read ABI dump: " << dump_path << "\n";
+    return nullptr;
+  }
+
+  Entry &entry = entries_[dump_path];
+  entry.text_format_ = text_format;
+  entry.mtime_ = mtime;
+  entry.hash_ = *hash;
+  entry.module_ = reader->TakeModule();
+  return entry.module_.get();
+}
+
+
+static bool WriteAll(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+static bool ReadAll(int fd, std::string *output) {
+  char buffer[4096];
+  while (true) {
+    ssize_t bytes_read = ::read(fd, buffer, sizeof(buffer));
+    if (bytes_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (bytes_read == 0) {
+      return true;
+    }
+    output->append(buffer, bytes_read);
+  }
+}
+
+static std::vector<std::string> SplitFields(const std::string &message) {
+  std::vector<std::string> fields;
+  size_t field_start = 0;
+  for (size_t index = 0; index < message.size(); index++) {
+    if (message[index] == kFieldSeparator) {
+      fields.emplace_back(message, field_start, index - field_start);
+      field_start = index + 1;
+    }
+  }
+  return fields;
+}
+
+static bool FillSocketAddress(const std::string &socket_path,
+                              sockaddr_un *addr) {
+  ::memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr->sun_path)) {
+    llvm::errs() << "Socket path is too long: " << socket_path << "\n";
+    return false;
+  }
+  ::strncpy(addr->sun_path, socket_path.c_str(), sizeof(addr->sun_path) - 1);
+  return true;
+}
+
+static void SendStatus(int fd, int status) {
+  std::string trailer(1, kFieldSeparator);
+  trailer += std::to_string(status);
+  WriteAll(fd, trailer.data(), trailer.size());
+}
+
+static void ServeRequest(int conn_fd, int listen_fd,
+                         DiffRequestHandler *handler) {
+  std::string request;
+  if (!ReadAll(conn_fd, &request)) {
+    return;
+  }
+  std::vector<std::string> fields = SplitFields(request);
+  if (fields.size() < 2) {
+    static const char kMalformed[] = "Malformed request\n";
+    WriteAll(conn_fd, kMalformed, sizeof(kMalformed) - 1);
+    SendStatus(conn_fd, 1);
+    return;
+  }
+
+  // Relative paths in the arguments are resolved against the working
+  // directory of the client.
+  if (::chdir(fields[0].c_str()) != 0) {
+    std::string message = "Failed to change directory to " + fields[0] + "\n";
+    WriteAll(conn_fd, message.data(), message.size());
+    SendStatus(conn_fd, 1);
+    return;
+  }
+  std::vector<std::string> args(fields.begin() + 1, fields.end());
+
+  // Diagnostics from Prepare() and Run() are sent to the client.
+  int saved_stderr = ::dup(STDERR_FILENO);
+  ::dup2(conn_fd, STDERR_FILENO);
+  bool prepared = handler->Prepare(args);
+  ::dup2(saved_stderr, STDERR_FILENO);
+  ::close(saved_stderr);
+  if (!prepared) {
+    SendStatus(conn_fd, 1);
+    return;
+  }
+
+  // The server returns to the accept loop as soon as the request is forked.
+  // The child waits for the diff in a grandchild, so that it can report the
+  // status even if Run() calls exit() or crashes.
+  pid_t pid = ::fork();
+  if (pid < 0) {
+    static const char kForkFailed[] = "Failed to fork\n";
+    WriteAll(conn_fd, kForkFailed, sizeof(kForkFailed) - 1);
+    SendStatus(conn_fd, 1);
+    return;
+  }
+  if (pid == 0) {
+    ::close(listen_fd);
+    ::signal(SIGCHLD, SIG_DFL);
+    ::dup2(conn_fd, STDERR_FILENO);
+    pid_t run_pid = ::fork();
+    if (run_pid == 0) {
+      ::exit(handler->Run());
+    }
+    int wait_status = 0;
+    if (run_pid < 0) {
+      static const char kForkFailed[] = "Failed to fork\n";
+      WriteAll(conn_fd, kForkFailed, sizeof(kForkFailed) - 1);
+    } else {
+      while (::waitpid(run_pid, &wait_status, 0) < 0 && errno == EINTR) {
+      }
+    }
+    SendStatus(conn_fd, (run_pid > 0 && WIFEXITED(wait_status))
+                            ? WEXITSTATUS(wait_status)
+                            : 1);
+    ::_exit(0);
+  }
+}
+
+static void ReapChildren(int) {
+  int saved_errno = errno;
+  while (::waitpid(-1, nullptr, WNOHANG) > 0) {
+  }
+  errno = saved_errno;
+}
+
+// Removes the socket left by a server that is no longer running. Returns false
+// if the path is not a socket or another server is listening on it.
+static bool RemoveStaleSocket(const std::string &socket_path,
+                              const sockaddr_un &addr) {
+  struct stat st;
+  if (::lstat(socket_path.c_str(), &st) != 0) {
+    return errno == ENOENT;
+  }
+  if (!S_ISSOCK(st.st_mode)) {
+    llvm::errs() << socket_path << " exists and is not a socket\n";
+    return false;
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    llvm::errs() << "Failed to create socket: " << ::strerror(errno) << "\n";
+    return false;
+  }
+  bool is_listening =
+      (::connect(fd, reinterpret_cast<const sockaddr *>(&addr),
+                 sizeof(addr)) == 0);
+  ::close(fd);
+  if (is_listening) {
+    llvm::errs() << "Another server is listening on " << socket_path << "\n";
+    return false;
+  }
+  if (::unlink(socket_path.c_str()) != 0) {
+    llvm::errs() << "Failed to remove " << socket_path << ": "
+                 << ::strerror(errno) << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool RunDiffServer(const std::string &socket_path,
+                   DiffRequestHandler *handler) {
+  sockaddr_un addr;
+  if (!FillSocketAddress(socket_path, &addr)) {
+    return false;
+  }
+
+  int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    llvm::errs() << "Failed to create socket: " << ::strerror(errno) << "\n";
+    return false;
+  }
+  if (!RemoveStaleSocket(socket_path, addr)) {
+    ::close(listen_fd);
+    return false;
+  }
+  // The server reads and writes files with the permissions of its user on
+  // behalf of the clients, so only that user may connect to the socket.
+  mode_t saved_umask = ::umask(0077);
+  int bind_result =
+      ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  ::umask(saved_umask);
+  if (bind_result || ::listen(listen_fd, SOMAXCONN)) {
+    llvm::errs() << "Failed to listen on " << socket_path << ": "
+                 << ::strerror(errno) << "\n";
+    ::close(listen_fd);
+    return false;
+  }
+
+  // A client that disconnects early must not terminate the server.
+  ::signal(SIGPIPE, SIG_IGN);
+
+  // The children serving the requests are reaped as they exit.
+  struct sigaction action = {};
+  action.sa_handler = ReapChildren;
+  action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  ::sigemptyset(&action.sa_mask);
+  ::sigaction(SIGCHLD, &action, nullptr);
+
+  while (true) {
+    int conn_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (conn_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      llvm::errs() << "Failed to accept connection: " << ::strerror(errno)
+                   << "\n";
+      ::close(listen_fd);
+      return false;
+    }
+    ServeRequest(conn_fd, listen_fd, handler);
+    ::close(conn_fd);
+  }
+}
+
+bool RequestDiffFromServer(const std::string &socket_path,
+                           const std::vector<std::string> &args, int *status) {
+  sockaddr_un addr;
+  if (!FillSocketAddress(socket_path, &addr)) {
+    return false;
+  }
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+    ::close(fd);
+    return false;
+  }
+
+  std::string request = utils::GetCwd();
+  request += kFieldSeparator;
+  for (auto &&arg : args) {
+    request += arg;
+    request += kFieldSeparator;
+  }
+
+  std::string response;
+  bool ok = (WriteAll(fd, request.data(), request.size()) &&
+             ::shutdown(fd, SHUT_WR) == 0 && ReadAll(fd, &response));
+  ::close(fd);
+  if (!ok) {
+    return false;
+  }
+
+  // A response without a status means that the server died while handling
+  // the request.
+  size_t separator = response.rfind(kFieldSeparator);
+  if (separator == std::string::npos) {
+    return false;
+  }
+  llvm::errs() << llvm::StringRef(response.data(), separator);
+  *status = ::atoi(response.c_str() + separator + 1);
+  return true;
+}
+
+
+}  // namespace diff
+}  // namespace header_checker
@@ -0,0 +1,89 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DIFF_SERVER_H_
+#define DIFF_SERVER_H_
+
+#include "repr/ir_representation.h"
+
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/MD5.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace diff {
+
+
+// This class keeps parsed reference ABI dumps in memory. A dump is re-read
+// only if both its modification time and its content hash have changed since
+// it was last loaded.
+class ReferenceDumpCache {
+ public:
+  // Returns nullptr if the dump cannot be read.
+  const repr::ModuleIR *GetModule(const std::string &dump_path,
+                                  repr::TextFormatIR text_format);
+
+ private:
+  struct Entry {
+    repr::TextFormatIR text_format_;
+    llvm::sys::TimePoint<> mtime_;
+    llvm::MD5::MD5Result hash_;
+    std::unique_ptr<repr::ModuleIR> module_;
+  };
+
+  std::map<std::string, Entry> entries_;
+};
+
+
+// The server calls Prepare() in the server process and Run() in a forked
+// child process for each request. Prepare() is called for one request at a
+// time, whereas the Run() calls of several requests may overlap. Anything
+// loaded by Prepare() outlives the request, whereas Run() is free to call
+// exit().
+class DiffRequestHandler {
+ public:
+  virtual ~DiffRequestHandler() {}
+
+  // `args` is the argument vector of the client, including argv[0].
+  virtual bool Prepare(const std::vector<std::string> &args) = 0;
+
+  // Returns the exit status of the request.
+  virtual int Run() = 0;
+};
+
+
+// Serves requests on a Unix domain socket until the process is killed. The
+// socket is accessible to the user of the server only. Returns false if the
+// socket cannot be set up, e.g., if `socket_path` is not a socket or another
+// server is listening on it.
+bool RunDiffServer(const std::string &socket_path,
+                   DiffRequestHandler *handler);
+
+// Forwards `args` to the server listening on `socket_path` and copies the
+// diagnostics of the server to stderr. Returns false if the server cannot be
+// reached, in which case the caller is expected to run the diff locally.
+bool RequestDiffFromServer(const std::string &socket_path,
+                           const std::vector<std::string> &args, int *status);
+
+
+}  // namespace diff
+}  // namespace header_checker
+
+
+#endif  // DIFF_SERVER_H_
@@ -0,0 +1,271 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "diff/diff_server.h"
+
+#include "repr/ir_dumper.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+
+namespace header_checker {
+namespace diff {
+
+
+static bool WaitForFile(const std::string &path) {
+  for (int i = 0; i < 1000; i++) {
+    if (llvm::sys::fs::exists(path)) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+
+// The arguments of a request are a command followed by a path.
+class TestRequestHandler : public DiffRequestHandler {
+ public:
+  bool Prepare(const std::vector<std::string> &args) override {
+    args_ = args;
+    return args_.size() == 3 && args_[1] != "reject";
+  }
+
+  int Run() override {
+    const std::string &command = args_[1];
+    const std::string &path = args_[2];
+    if (command == "wait") {
+      std::ofstream(path + ".started");
+      return WaitForFile(path) ? 0 : 2;
+    }
+    if (command == "signal") {
+      std::ofstream{path};
+      return 0;
+    }
+    llvm::errs() << "message from " << path << "\n";
+    return 3;
+  }
+
+ private:
+  std::vector<std::string> args_;
+};
+
+
+class DiffServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("diff_server_test", root_));
+    socket_path_ = (root_ + "/server.sock").str();
+  }
+
+  void TearDown() override {
+    StopServer();
+    llvm::sys::fs::remove_directories(root_);
+  }
+
+  void StartServer() {
+    server_pid_ = ::fork();
+    ASSERT_GE(server_pid_, 0);
+    if (server_pid_ == 0) {
+      TestRequestHandler handler;
+      RunDiffServer(socket_path_, &handler);
+      ::_exit(1);
+    }
+    ASSERT_TRUE(WaitForFile(socket_path_));
+  }
+
+  void StopServer() {
+    if (server_pid_ > 0) {
+      ::kill(server_pid_, SIGKILL);
+      ::waitpid(server_pid_, nullptr, 0);
+      server_pid_ = -1;
+    }
+  }
+
+  // Retries until the server starts accepting connections.
+  bool Request(const std::string &command, const std::string &path,
+               int *status) {
+    for (int i = 0; i < 100; i++) {
+      if (RequestDiffFromServer(socket_path_, {"test", command, path},
+                                status)) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+
+  llvm::SmallString<256> root_;
+  std::string socket_path_;
+  pid_t server_pid_ = -1;
+};
+
+
+TEST_F(DiffServerTest, Request) {
+  ASSERT_NO_FATAL_FAILURE(StartServer());
+
+  int status = 0;
+  testing::internal::CaptureStderr();
+  bool ok = Request("message", "client", &status);
+  std::string diagnostics = testing::internal::GetCapturedStderr();
+  ASSERT_TRUE(ok);
+  EXPECT_EQ(3, status);
+  EXPECT_EQ("message from client\n", diagnostics);
+
+  ASSERT_TRUE(Request("reject", "client", &status));
+  EXPECT_EQ(1, status);
+
+  struct stat st;
+  ASSERT_EQ(0, ::stat(socket_path_.c_str(), &st));
+  EXPECT_EQ(0u, st.st_mode & 0077);
+}
+
+TEST_F(DiffServerTest, ConcurrentRequests) {
+  ASSERT_NO_FATAL_FAILURE(StartServer());
+
+  // The first request does not finish until the second request is served.
+  std::string flag_path = (root_ + "/flag").str();
+  std::future<int> wait_status = std::async(std::launch::async, [&]() {
+    int status = -1;
+    return Request("wait", flag_path, &status) ? status : -1;
+  });
+  ASSERT_TRUE(WaitForFile(flag_path + ".started"));
+
+  int status = -1;
+  ASSERT_TRUE(Request("signal", flag_path, &status));
+  EXPECT_EQ(0, status);
+  EXPECT_EQ(0, wait_status.get());
+}
+
+TEST_F(DiffServerTest, ReplaceStaleSocket) {
+  ASSERT_NO_FATAL_FAILURE(StartServer());
+
+  // The socket is in use.
+  TestRequestHandler handler;
+  EXPECT_FALSE(RunDiffServer(socket_path_, &handler));
+
+  // The socket of the killed server is replaced.
+  StopServer();
+  ASSERT_TRUE(llvm::sys::fs::exists(socket_path_));
+  ASSERT_NO_FATAL_FAILURE(StartServer());
+  int status = 0;
+  ASSERT_TRUE(Request("signal", (root_ + "/flag").str(), &status));
+  EXPECT_EQ(0, status);
+}
+
+TEST_F(DiffServerTest, RefuseNonSocket) {
+  std::ofstream(socket_path_) << "not a socket";
+  TestRequestHandler handler;
+  EXPECT_FALSE(RunDiffServer(socket_path_, &handler));
+
+  std::ifstream input(socket_path_);
+  std::string content;
+  std::getline(input, content);
+  EXPECT_EQ("not a socket", content);
+}
+
+
+static bool SetMtime(const std::string &path, time_t time) {
+  int fd;
+  if (llvm::sys::fs::openFileForRead(path, fd)) {
+    return false;
+  }
+  std::error_code ec = llvm::sys::fs::setLastAccessAndModificationTime(
+      fd, llvm::sys::toTimePoint(time));
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  return !ec;
+}
+
+
+class ReferenceDumpCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    llvm::SmallString<256> path;
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("reference_dump_cache_test",
+                                                    "json", path));
+    path_ = std::string(path);
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove(path_);
+  }
+
+  void WriteDump(const std::vector<std::string> &record_names, time_t mtime) {
+    repr::ModuleIR module(nullptr);
+    for (auto &&name : record_names) {
+      repr::RecordTypeIR record;
+      record.SetName(name);
+      record.SetLinkerSetKey("_ZTI" + name);
+      record.SetSelfType("_ZTI" + name);
+      record.SetReferencedType("_ZTI" + name);
+      record.SetRecordKind(repr::RecordTypeIR::struct_kind);
+      module.AddRecordType(std::move(record));
+    }
+    std::unique_ptr<repr::IRDumper> dumper =
+        repr::IRDumper::CreateIRDumper(repr::TextFormatIR::Json, path_);
+    ASSERT_TRUE(dumper->Dump(module));
+    ASSERT_TRUE(SetMtime(path_, mtime));
+  }
+
+  const repr::ModuleIR *GetModule() {
+    return cache_.GetModule(path_, repr::TextFormatIR::Json);
+  }
+
+  std::string path_;
+  ReferenceDumpCache cache_;
+};
+
+
+TEST_F(ReferenceDumpCacheTest, Reload) {
+  ASSERT_NO_FATAL_FAILURE(WriteDump({"A"}, 1000));
+  const repr::ModuleIR *module = GetModule();
+  ASSERT_NE(nullptr, module);
+  EXPECT_EQ(1u, module->GetRecordTypes().size());
+  EXPECT_EQ(module, GetModule());
+
+  // The dump is touched without changing the content.
+  ASSERT_NO_FATAL_FAILURE(WriteDump({"A"}, 2000));
+  EXPECT_EQ(module, GetModule());
+
+  // The dump is changed.
+  ASSERT_NO_FATAL_FAILURE(WriteDump({"A", "B"}, 3000));
+  module = GetModule();
+  ASSERT_NE(nullptr, module);
+  EXPECT_EQ(2u, module->GetRecordTypes().size());
+
+  ASSERT_FALSE(llvm::sys::fs::remove(path_));
+  EXPECT_EQ(nullptr, GetModule());
+}
+
+
+}  // namespace diff
+}  // namespace header_checker
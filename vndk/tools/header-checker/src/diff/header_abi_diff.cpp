@@ -13,49 +13,69 @@
 // limitations under the License.
 
 #include "diff/abi_diff.h"
+#include "diff/diff_server.h"
 
+#include "repr/module_stats.h"
 #include "utils/config_file.h"
 #include "utils/string_utils.h"
+#include "utils/time_trace.h"
 
 #include <llvm/ADT/SmallString.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 
+using header_checker::diff::DiffRequestHandler;
 using header_checker::diff::HeaderAbiDiff;
+using header_checker::diff::ReferenceDumpCache;
+using header_checker::diff::RequestDiffFromServer;
+using header_checker::diff::RunDiffServer;
 using header_checker::repr::CompatibilityStatusIR;
 using header_checker::repr::DiffPolicyOptions;
+using header_checker::repr::InitStats;
+using header_checker::repr::ModuleIR;
 using header_checker::repr::TextFormatIR;
+using header_checker::repr::TypeEquivalenceCache;
+using header_checker::repr::WriteStats;
 using header_checker::utils::ConfigFile;
 using header_checker::utils::ConfigParser;
+using header_checker::utils::InitTimeTrace;
 using header_checker::utils::ParseBool;
+using header_checker::utils::Split;
+using header_checker::utils::WriteTimeTrace;
 
 
 static llvm::cl::OptionCategory header_checker_category(
     "header-abi-diff options");
 
 static llvm::cl::opt<std::string> compatibility_report(
-    "o", llvm::cl::desc("<compatibility report>"), llvm::cl::Required,
+    "o", llvm::cl::desc("<compatibility report>"),
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::opt<std::string> lib_name(
-    "lib", llvm::cl::desc("<lib name>"), llvm::cl::Required,
+    "lib", llvm::cl::desc("<lib name>"),
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::opt<std::string> arch(
-    "arch", llvm::cl::desc("<arch>"), llvm::cl::Required,
+    "arch", llvm::cl::desc("<arch>"),
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::opt<std::string> new_dump(
-    "new", llvm::cl::desc("<new dump>"), llvm::cl::Required,
+    "new", llvm::cl::desc("<new dump>"),
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::opt<std::string> old_dump(
-    "old", llvm::cl::desc("<old dump>"), llvm::cl::Required,
+    "old", llvm::cl::desc("<old dump>"),
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::opt<std::string> ignore_symbol_list(
@@ -78,6 +98,13 @@ static llvm::cl::opt<bool> check_all_apis(
                    " the dynsym table of a shared library are checked"),
     llvm::cl::Optional, llvm::cl::cat(header_checker_category));
 
+static llvm::cl::opt<bool> use_index(
+    "use-index",
+    llvm::cl::desc("Load only the types reachable from the exported symbols "
+                   "if a dump has an up-to-date index. Ignored with "
+                   "-check-all-apis"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
 static llvm::cl::opt<bool> allow_extensions(
     "allow-extensions",
     llvm::cl::desc("Do not return a non zero status on extensions"),
@@ -132,6 +159,63 @@ static llvm::cl::opt<bool> allow_adding_removing_weak_symbols(
     llvm::cl::init(false), llvm::cl::Optional,
     llvm::cl::cat(header_checker_category));
 
+static llvm::cl::opt<uint64_t> max_incompatible_diffs(
+    "max-incompatible-diffs",
+    llvm::cl::desc("Stop after finding this many incompatible changes. "
+                   "0 means no limit"),
+    llvm::cl::init(0), llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> server_socket(
+    "server",
+    llvm::cl::desc("Keep the old ABI dumps in memory and serve requests from "
+                   "header-abi-diff -connect on the given Unix domain socket"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> connect_socket(
+    "connect",
+    llvm::cl::desc("Send this request to the header-abi-diff -server listening "
+                   "on the given Unix domain socket. Diff locally if the "
+                   "server cannot be reached"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::list<std::string> arch_diffs(
+    "arch-diff",
+    llvm::cl::desc("Diff another architecture in the same run. The value is "
+                   "<arch>,<old dump>,<new dump>,<compatibility report>. The "
+                   "architectures share the results of type comparisons"),
+    llvm::cl::ZeroOrMore, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> time_trace(
+    "time-trace", llvm::cl::value_desc("trace_file"), llvm::cl::Optional,
+    llvm::cl::desc("Write the time spent in each phase to the file in Chrome "
+                   "trace event format"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<unsigned> time_trace_granularity(
+    "time-trace-granularity",
+    llvm::cl::desc("Minimum duration in microseconds of the spans recorded by "
+                   "-time-trace"),
+    llvm::cl::init(500), llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<bool> module_stats(
+    "module-stats",
+    llvm::cl::desc("Print the sizes of the modules in memory and the peak "
+                   "resident set size after each phase"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<bool> module_stats_json(
+    "module-stats-json",
+    llvm::cl::desc("Print the statistics of -module-stats in JSON format"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> module_stats_file(
+    "module-stats-file", llvm::cl::value_desc("stats_file"),
+    llvm::cl::desc("Write the statistics of -module-stats to the file instead "
+                   "of stderr"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
 static std::set<std::string> LoadIgnoredSymbols(std::string &symbol_list_path) {
   std::ifstream symbol_ifstream(symbol_list_path);
   std::set<std::string> ignored_symbols;
@@ -153,65 +237,127 @@ static std::string GetConfigFilePath(const std::string &dump_file_path) {
   return std::string(config_file_path);
 }
 
-static void ReadConfigFile(const std::string &config_file_path) {
+// The options which the config file next to an old dump may override.
+struct DiffPolicy {
+  bool allow_adding_removing_weak_symbols_;
+  bool advice_only_;
+  bool elf_unreferenced_symbol_errors_;
+  bool check_all_apis_;
+  bool allow_extensions_;
+  bool allow_unreferenced_elf_symbol_changes_;
+  bool allow_unreferenced_changes_;
+  bool consider_opaque_types_different_;
+
+  auto Tie() const {
+    return std::tie(allow_adding_removing_weak_symbols_, advice_only_,
+                    elf_unreferenced_symbol_errors_, check_all_apis_,
+                    allow_extensions_, allow_unreferenced_elf_symbol_changes_,
+                    allow_unreferenced_changes_,
+                    consider_opaque_types_different_);
+  }
+
+  bool operator<(const DiffPolicy &other) const {
+    return Tie() < other.Tie();
+  }
+};
+
+static DiffPolicy GetCommandLinePolicy() {
+  return {allow_adding_removing_weak_symbols,
+          advice_only,
+          elf_unreferenced_symbol_errors,
+          check_all_apis,
+          allow_extensions,
+          allow_unreferenced_elf_symbol_changes,
+          allow_unreferenced_changes,
+          consider_opaque_types_different};
+}
+
+// Returns the command line options overridden by the config file.
+static DiffPolicy ReadConfigFile(const std::string &config_file_path) {
+  DiffPolicy policy = GetCommandLinePolicy();
   ConfigFile cfg = ConfigParser::ParseFile(config_file_path);
   if (cfg.HasSection("global")) {
     for (auto &&p : cfg.GetSection("global")) {
       auto &&key = p.first;
       bool value_bool = ParseBool(p.second);
       if (key == "allow_adding_removing_weak_symbols") {
-        allow_adding_removing_weak_symbols = value_bool;
+        policy.allow_adding_removing_weak_symbols_ = value_bool;
       } else if (key == "advice_only") {
-        advice_only = value_bool;
+        policy.advice_only_ = value_bool;
       } else if (key == "elf_unreferenced_symbol_errors") {
-        elf_unreferenced_symbol_errors = value_bool;
+        policy.elf_unreferenced_symbol_errors_ = value_bool;
       } else if (key == "check_all_apis") {
-        check_all_apis = value_bool;
+        policy.check_all_apis_ = value_bool;
       } else if (key == "allow_extensions") {
-        allow_extensions = value_bool;
+        policy.allow_extensions_ = value_bool;
       } else if (key == "allow_unreferenced_elf_symbol_changes") {
-        allow_unreferenced_elf_symbol_changes = value_bool;
+        policy.allow_unreferenced_elf_symbol_changes_ = value_bool;
       } else if (key == "allow_unreferenced_changes") {
-        allow_unreferenced_changes = value_bool;
+        policy.allow_unreferenced_changes_ = value_bool;
       } else if (key == "consider_opaque_types_different") {
-        consider_opaque_types_different = value_bool;
+        policy.consider_opaque_types_different_ = value_bool;
       }
     }
   }
+  return policy;
 }
 
 static const char kWarn[] = "\033[36;1mwarning: \033[0m";
 static const char kError[] = "\033[31;1merror: \033[0m";
 
-bool ShouldEmitWarningMessage(CompatibilityStatusIR status) {
-  return ((!allow_extensions &&
+static bool ShouldEmitWarningMessage(CompatibilityStatusIR status,
+                                     const DiffPolicy &policy) {
+  return ((!policy.allow_extensions_ &&
            (status & CompatibilityStatusIR::Extension)) ||
-          (!allow_unreferenced_changes &&
+          (!policy.allow_unreferenced_changes_ &&
            (status & CompatibilityStatusIR::UnreferencedChanges)) ||
-          (!allow_unreferenced_elf_symbol_changes &&
+          (!policy.allow_unreferenced_elf_symbol_changes_ &&
            (status & CompatibilityStatusIR::ElfIncompatible)) ||
           (status & CompatibilityStatusIR::Incompatible));
 }
 
-int main(int argc, const char **argv) {
-  llvm::cl::ParseCommandLineOptions(argc, argv, "header-checker");
-
-  ReadConfigFile(GetConfigFilePath(old_dump));
-
-  std::set<std::string> ignored_symbols;
-  if (llvm::sys::fs::exists(ignore_symbol_list)) {
-    ignored_symbols = LoadIgnoredSymbols(ignore_symbol_list);
+static bool CheckRequiredOptions() {
+  const llvm::cl::opt<std::string> *required_options[] = {
+    &compatibility_report, &lib_name, &arch, &new_dump, &old_dump,
+  };
+  for (auto &&option : required_options) {
+    if (option->empty()) {
+      llvm::errs() << "header-abi-diff: -" << option->ArgStr
+                   << " must be specified\n";
+      return false;
+    }
   }
+  return true;
+}
 
-  DiffPolicyOptions diff_policy_options(consider_opaque_types_different);
-
-  HeaderAbiDiff judge(lib_name, arch, old_dump, new_dump, compatibility_report,
-                      ignored_symbols, allow_adding_removing_weak_symbols,
-                      diff_policy_options, check_all_apis, text_format_old,
-                      text_format_new, text_format_diff);
-
-  CompatibilityStatusIR status = judge.GenerateCompatibilityReport();
+struct ArchDiff {
+  std::string arch_;
+  std::string old_dump_;
+  std::string new_dump_;
+  std::string compatibility_report_;
+};
+
+// The first element is specified by -arch, -old, -new, and -o.
+static bool CollectArchDiffs(std::vector<ArchDiff> *result) {
+  result->push_back({arch, old_dump, new_dump, compatibility_report});
+  for (auto &&arch_diff : arch_diffs) {
+    std::vector<std::string_view> fields = Split(arch_diff, ",");
+    if (fields.size() != 4) {
+      llvm::errs() << "header-abi-diff: -arch-diff expects "
+                   << "<arch>,<old dump>,<new dump>,<compatibility report>: "
+                   << arch_diff << "\n";
+      return false;
+    }
+    result->push_back({std::string(fields[0]), std::string(fields[1]),
+                       std::string(fields[2]), std::string(fields[3])});
+  }
+  return true;
+}
 
+// Prints the warning message and returns the exit status for one report.
+static int ReportCompatibilityStatus(
+    CompatibilityStatusIR status, const std::string &compatibility_report,
+    const DiffPolicy &policy) {
   std::string status_str = "";
   std::string unreferenced_change_str = "";
   std::string error_or_warning_str = kWarn;
@@ -222,7 +368,7 @@ int main(int argc, const char **argv) {
       status_str = "INCOMPATIBLE CHANGES";
       break;
     case CompatibilityStatusIR::ElfIncompatible:
-      if (elf_unreferenced_symbol_errors) {
+      if (policy.elf_unreferenced_symbol_errors_) {
         error_or_warning_str = kError;
       }
       status_str = "ELF Symbols not referenced by exported headers removed";
@@ -231,7 +377,7 @@ int main(int argc, const char **argv) {
       break;
   }
   if (status & CompatibilityStatusIR::Extension) {
-    if (!allow_extensions) {
+    if (!policy.allow_extensions_) {
       error_or_warning_str = kError;
     }
     status_str = "EXTENDING CHANGES";
@@ -243,7 +389,7 @@ int main(int argc, const char **argv) {
     unreferenced_change_str += " internal typecasts.";
   }
 
-  bool should_emit_warning_message = ShouldEmitWarningMessage(status);
+  bool should_emit_warning_message = ShouldEmitWarningMessage(status, policy);
 
   if (should_emit_warning_message) {
     llvm::errs() << "******************************************************\n"
@@ -258,9 +404,121 @@ int main(int argc, const char **argv) {
                  << "******************************************************\n";
   }
 
-  if (!advice_only && should_emit_warning_message) {
+  if (!policy.advice_only_ && should_emit_warning_message) {
     return status;
   }
 
   return CompatibilityStatusIR::Compatible;
 }
+
+// If old_module is not nullptr, it is used instead of reading old_dump.
+static int RunDiff(const ModuleIR *old_module) {
+  std::vector<ArchDiff> arch_diff_list;
+  if (!CollectArchDiffs(&arch_diff_list)) {
+    return 1;
+  }
+
+  // The diff server records a trace for each request.
+  InitTimeTrace(time_trace, time_trace_granularity, "header-abi-diff");
+  InitStats(module_stats, module_stats_json, module_stats_file);
+
+  std::set<std::string> ignored_symbols;
+  if (llvm::sys::fs::exists(ignore_symbol_list)) {
+    ignored_symbols = LoadIgnoredSymbols(ignore_symbol_list);
+  }
+
+  // Most types have the same layout on all architectures, so they need to be
+  // compared only once. The architectures whose config files set different
+  // policies do not share the results.
+  std::map<DiffPolicy, TypeEquivalenceCache> type_equivalence_caches;
+
+  // The dumps are read one at a time, so their sections share one pool.
+  llvm::ThreadPool reader_thread_pool;
+
+  int exit_status = CompatibilityStatusIR::Compatible;
+  for (auto &&arch_diff : arch_diff_list) {
+    // Each architecture is diffed with the config file next to its old dump.
+    DiffPolicy policy =
+        ReadConfigFile(GetConfigFilePath(arch_diff.old_dump_));
+    DiffPolicyOptions diff_policy_options(
+        policy.consider_opaque_types_different_);
+    HeaderAbiDiff judge(lib_name, arch_diff.arch_, arch_diff.old_dump_,
+                        arch_diff.new_dump_, arch_diff.compatibility_report_,
+                        ignored_symbols,
+                        policy.allow_adding_removing_weak_symbols_,
+                        diff_policy_options, policy.check_all_apis_,
+                        text_format_old, text_format_new, text_format_diff,
+                        max_incompatible_diffs);
+    if (arch_diff_list.size() > 1) {
+      judge.SetTypeEquivalenceCache(&type_equivalence_caches[policy]);
+    }
+    judge.SetLazyLoading(use_index);
+    judge.SetReaderThreadPool(&reader_thread_pool);
+
+    CompatibilityStatusIR status =
+        (old_module && &arch_diff == &arch_diff_list.front()) ?
+        judge.GenerateCompatibilityReport(*old_module) :
+        judge.GenerateCompatibilityReport();
+
+    exit_status |= ReportCompatibilityStatus(
+        status, arch_diff.compatibility_report_, policy);
+  }
+
+  if (!WriteTimeTrace() || !WriteStats()) {
+    return 1;
+  }
+  return exit_status;
+}
+
+// Each request re-parses the command line of the client, so the options keep
+// their usual meaning. Only the old ABI dumps persist across requests.
+class DiffServerRequestHandler : public DiffRequestHandler {
+ public:
+  bool Prepare(const std::vector<std::string> &args) override {
+    std::vector<const char *> argv;
+    for (auto &&arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    llvm::cl::ResetAllOptionOccurrences();
+    if (!llvm::cl::ParseCommandLineOptions(argv.size(), argv.data(),
+                                           "header-checker", &llvm::errs()) ||
+        !CheckRequiredOptions()) {
+      return false;
+    }
+    llvm::SmallString<256> old_dump_path(old_dump);
+    llvm::sys::fs::make_absolute(old_dump_path);
+    old_module_ = cache_.GetModule(std::string(old_dump_path), text_format_old);
+    return old_module_ != nullptr;
+  }
+
+  int Run() override {
+    return RunDiff(old_module_);
+  }
+
+ private:
+  ReferenceDumpCache cache_;
+  const ModuleIR *old_module_ = nullptr;
+};
+
+int main(int argc, const char **argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "header-checker");
+
+  if (!server_socket.empty()) {
+    DiffServerRequestHandler handler;
+    return RunDiffServer(server_socket, &handler) ? 0 : 1;
+  }
+
+  if (!CheckRequiredOptions()) {
+    return 1;
+  }
+
+  if (!connect_socket.empty()) {
+    std::vector<std::string> args(argv, argv + argc);
+    int status = 0;
+    if (RequestDiffFromServer(connect_socket, args, &status)) {
+      return status;
+    }
+  }
+
+  return RunDiff(nullptr);
+}
@@ -0,0 +1,543 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dumper/abi_fragment_cache.h"
+
+#include "repr/ir_dumper.h"
+#include "repr/ir_representation_internal.h"
+#include "utils/hash_utils.h"
+#include "utils/header_abi_util.h"
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/DeclCXX.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Sema/Sema.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+// Bump the version whenever the content of the fragments changes.
+static const char kFragmentFormatVersion[] = "abi-fragment-1";
+
+
+// Writes a file to a temporary path and renames it, so that the concurrent
+// dumpers never read a partially written file.
+static bool WriteFileAtomically(
+    const std::string &path,
+    const std::function<bool(const std::string &)> &write) {
+  llvm::SmallString<256> temp_path;
+  llvm::sys::fs::createUniquePath(path + "-%%%%%%", temp_path,
+                                  /* MakeAbsolute */ false);
+  std::string temp_path_str(temp_path);
+  if (!write(temp_path_str)) {
+    llvm::sys::fs::remove(temp_path_str);
+    return false;
+  }
+  if (llvm::sys::fs::rename(temp_path_str, path)) {
+    llvm::errs() << "Failed to rename \"" << temp_path_str << "\" to \""
+                 << path << "\"\n";
+    llvm::sys::fs::remove(temp_path_str);
+    return false;
+  }
+  return true;
+}
+
+static bool WriteLines(const std::string &path,
+                       const std::vector<std::string> &lines) {
+  std::error_code ec;
+  llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    llvm::errs() << "Failed to open \"" << path << "\": " << ec.message()
+                 << "\n";
+    return false;
+  }
+  for (auto &&line : lines) {
+    out << line << "\n";
+  }
+  out.close();
+  return !out.has_error();
+}
+
+static bool ReadLines(const std::string &path, std::set<std::string> *lines) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    llvm::errs() << "Failed to read \"" << path << "\"\n";
+    return false;
+  }
+  llvm::SmallVector<llvm::StringRef, 64> split_lines;
+  (*buffer)->getBuffer().split(split_lines, '\n', -1, false);
+  for (auto &&line : split_lines) {
+    lines->emplace(line.str());
+  }
+  return true;
+}
+
+// Collects the files defining the records and enums which the type refers to
+// through pointers, references, qualifiers, arrays, and function types. The
+// referencing types take the source file of the decl that creates them, so
+// they are not the files the type depends on.
+static void CollectDefiningFiles(
+    const std::string &type_id,
+    const repr::AbiElementMap<const repr::TypeIR *> &type_graph,
+    std::set<std::string> *visited_types, std::set<std::string> *files) {
+  if (!visited_types->insert(type_id).second) {
+    return;
+  }
+  auto it = type_graph.find(type_id);
+  if (it == type_graph.end()) {
+    return;
+  }
+  const repr::TypeIR *type = it->second;
+  switch (type->GetKind()) {
+    case repr::RecordTypeKind:
+    case repr::EnumTypeKind:
+      if (!type->GetSourceFile().empty()) {
+        files->insert(type->GetSourceFile());
+      }
+      return;
+    case repr::BuiltinTypeKind:
+      return;
+    case repr::FunctionTypeKind: {
+      auto function_type = static_cast<const repr::FunctionTypeIR *>(type);
+      CollectDefiningFiles(function_type->GetReturnType(), type_graph,
+                           visited_types, files);
+      for (auto &&parameter : function_type->GetParameters()) {
+        CollectDefiningFiles(parameter.GetReferencedType(), type_graph,
+                             visited_types, files);
+      }
+      return;
+    }
+    default:
+      CollectDefiningFiles(type->GetReferencedType(), type_graph,
+                           visited_types, files);
+      return;
+  }
+}
+
+static std::vector<std::string> GetDependentTypeIds(
+    const repr::TypeIR *type) {
+  std::vector<std::string> type_ids;
+  if (type->GetKind() == repr::EnumTypeKind) {
+    type_ids.push_back(
+        static_cast<const repr::EnumTypeIR *>(type)->GetUnderlyingType());
+    return type_ids;
+  }
+  auto record = static_cast<const repr::RecordTypeIR *>(type);
+  for (auto &&field : record->GetFields()) {
+    type_ids.push_back(field.GetReferencedType());
+  }
+  for (auto &&base : record->GetBases()) {
+    type_ids.push_back(base.GetReferencedType());
+  }
+  return type_ids;
+}
+
+// Template instantiations depend on the translation units that instantiate
+// them. They stay in the translation unit dumps.
+static bool IsCacheableType(const repr::TypeIR *type) {
+  if (type->GetName().find('<') != std::string::npos ||
+      type->GetLinkerSetKey().find('<') != std::string::npos) {
+    return false;
+  }
+  if (type->GetKind() == repr::RecordTypeKind) {
+    return static_cast<const repr::RecordTypeIR *>(type)
+        ->GetTemplateElements().empty();
+  }
+  return type->GetKind() == repr::EnumTypeKind;
+}
+
+// Removes the types in `self_types` from the module. If `fragment` is not
+// nullptr, the types are moved to it.
+template <typename T>
+static void ExtractTypes(repr::AbiElementMap<T> *types,
+                         const std::set<std::string> &self_types,
+                         repr::ModuleIR *module, repr::ModuleIR *fragment,
+                         void (repr::ModuleIR::*add_type)(T &&)) {
+  for (auto it = types->begin(); it != types->end();) {
+    if (self_types.find(it->second.GetSelfType()) == self_types.end()) {
+      ++it;
+      continue;
+    }
+    module->type_graph_.erase(it->second.GetSelfType());
+    module->odr_list_map_.erase(repr::GetODRListMapKey(&it->second));
+    if (fragment) {
+      (fragment->*add_type)(std::move(it->second));
+    }
+    it = types->erase(it);
+  }
+}
+
+
+AbiFragmentCache::AbiFragmentCache(const clang::CompilerInstance &ci,
+                                   const HeaderCheckerOptions &options)
+    : ci_(ci), sm_(ci.getSourceManager()), pp_(ci.getPreprocessor()),
+      options_(options) {
+  const clang::TargetOptions &target = ci.getTargetOpts();
+  const clang::LangOptions &lang = ci.getLangOpts();
+  llvm::raw_string_ostream key(options_key_);
+  key << target.Triple << ";" << target.CPU << ";" << target.ABI << ";";
+  for (auto &&feature : target.FeaturesAsWritten) {
+    key << feature << ",";
+  }
+  key << ";" << static_cast<unsigned>(lang.LangStd) << ";"
+      << static_cast<unsigned>(lang.CPlusPlus) << ";"
+      << static_cast<unsigned>(lang.ObjC) << ";"
+      << static_cast<unsigned>(lang.CharIsSigned) << ";"
+      << static_cast<unsigned>(lang.WCharIsSigned) << ";"
+      << static_cast<unsigned>(lang.WCharSize) << ";"
+      << static_cast<unsigned>(lang.ShortEnums) << ";"
+      << static_cast<unsigned>(lang.MSBitfields) << ";"
+      << static_cast<unsigned>(lang.PackStruct) << ";"
+      << static_cast<unsigned>(lang.MaxTypeAlign) << ";"
+      << options.root_dir_ << ";"
+      << static_cast<unsigned>(options.text_format_) << ";"
+      << options.dump_function_declarations_ << ";"
+      << options.suppress_errors_;
+  key.flush();
+}
+
+void AbiFragmentCache::FileChanged(clang::SourceLocation loc,
+                                   FileChangeReason reason,
+                                   clang::SrcMgr::CharacteristicKind file_type,
+                                   clang::FileID prev_file_id) {
+  // Inserting to files_ invalidates last_record_.
+  last_file_id_ = clang::FileID();
+  last_record_ = nullptr;
+  if (reason != EnterFile) {
+    return;
+  }
+  clang::FileID file_id = sm_.getFileID(loc);
+  const clang::FileEntry *file_entry = sm_.getFileEntryForID(file_id);
+  if (!file_entry) {
+    return;
+  }
+  FileRecord &record = files_[file_entry];
+  if (record.include_states_.empty()) {
+    record.file_id_ = file_id;
+  }
+  record.include_states_.push_back(GetIncludeState());
+}
+
+std::string AbiFragmentCache::GetIncludeState() const {
+  // The parser handles the pragmas before it reads the next token, so the
+  // state is up to date when the preprocessor enters the included file.
+  if (!ci_.hasSema()) {
+    return "";
+  }
+  clang::Sema &sema = ci_.getSema();
+  std::string state;
+  llvm::raw_string_ostream os(state);
+  const clang::Sema::AlignPackInfo &align_pack =
+      sema.AlignPackStack.CurrentValue;
+  os << static_cast<unsigned>(align_pack.getAlignMode()) << ";"
+     << align_pack.getPackNumber() << ";"
+     << static_cast<unsigned>(sema.MSStructPragmaOn);
+  for (const clang::DeclContext *context = sema.CurContext;
+       context && !context->isTranslationUnit();
+       context = context->getParent()) {
+    os << ";" << context->getDeclKindName();
+    const clang::Decl *decl = clang::Decl::castFromDeclContext(context);
+    if (auto linkage_spec = llvm::dyn_cast<clang::LinkageSpecDecl>(decl)) {
+      os << " " << static_cast<unsigned>(linkage_spec->getLanguage());
+    } else if (auto named_decl = llvm::dyn_cast<clang::NamedDecl>(decl)) {
+      os << " " << named_decl->getName();
+    }
+  }
+  os.flush();
+  return state;
+}
+
+void AbiFragmentCache::MacroExpands(
+    const clang::Token &macro_name,
+    const clang::MacroDefinition &macro_definition, clang::SourceRange range,
+    const clang::MacroArgs *args) {
+  AddMacroReference(range.getBegin(), macro_name, macro_definition);
+}
+
+void AbiFragmentCache::Defined(const clang::Token &macro_name,
+                               const clang::MacroDefinition &macro_definition,
+                               clang::SourceRange range) {
+  AddMacroReference(range.getBegin(), macro_name, macro_definition);
+}
+
+void AbiFragmentCache::Ifdef(clang::SourceLocation loc,
+                             const clang::Token &macro_name,
+                             const clang::MacroDefinition &macro_definition) {
+  AddMacroReference(loc, macro_name, macro_definition);
+}
+
+void AbiFragmentCache::Ifndef(clang::SourceLocation loc,
+                              const clang::Token &macro_name,
+                              const clang::MacroDefinition &macro_definition) {
+  AddMacroReference(loc, macro_name, macro_definition);
+}
+
+void AbiFragmentCache::AddMacroReference(
+    clang::SourceLocation loc, const clang::Token &macro_name,
+    const clang::MacroDefinition &macro_definition) {
+  clang::FileID file_id = sm_.getFileID(sm_.getExpansionLoc(loc));
+  if (file_id != last_file_id_) {
+    last_file_id_ = file_id;
+    const clang::FileEntry *file_entry = sm_.getFileEntryForID(file_id);
+    auto it = file_entry ? files_.find(file_entry) : files_.end();
+    last_record_ = (it != files_.end() ? &it->second : nullptr);
+  }
+  if (last_record_) {
+    last_record_->macro_references_.insert(std::make_pair(
+        macro_name.getIdentifierInfo(), macro_definition.getMacroInfo()));
+  }
+}
+
+const std::string &AbiFragmentCache::GetMacroDefinition(
+    const clang::MacroInfo *macro_info) {
+  auto it = macro_definitions_.find(macro_info);
+  if (it != macro_definitions_.end()) {
+    return it->second;
+  }
+  std::string definition;
+  if (!macro_info) {
+    definition = "!";
+  } else {
+    definition = "=";
+    if (macro_info->isFunctionLike()) {
+      definition += "(";
+      for (const clang::IdentifierInfo *param : macro_info->params()) {
+        definition += param->getName().str();
+        definition += ",";
+      }
+      definition += macro_info->isVariadic() ? "...)" : ")";
+    }
+    for (const clang::Token &token : macro_info->tokens()) {
+      definition += " ";
+      definition += pp_.getSpelling(token);
+    }
+  }
+  return macro_definitions_[macro_info] = std::move(definition);
+}
+
+const std::string &AbiFragmentCache::GetContentHash(FileRecord *record) {
+  if (record->content_hash_.empty()) {
+    llvm::Optional<llvm::MemoryBufferRef> buffer =
+        sm_.getBufferOrNone(record->file_id_);
+    if (buffer) {
+      utils::HashBuilder hasher;
+      hasher.Add(buffer->getBuffer());
+      record->content_hash_ = hasher.Finish();
+    }
+  }
+  return record->content_hash_;
+}
+
+std::string AbiFragmentCache::ComputeFragmentKey(
+    const std::string &header,
+    const std::map<std::string, FileRecord *> &path_to_record,
+    const std::map<std::string, std::set<std::string>> &dependencies) {
+  // The fragment depends on the header and the files defining the types that
+  // the header's types depend on.
+  std::set<std::string> closure;
+  std::vector<const std::string *> worklist;
+  closure.insert(header);
+  worklist.push_back(&header);
+  while (!worklist.empty()) {
+    const std::string *file = worklist.back();
+    worklist.pop_back();
+    auto it = dependencies.find(*file);
+    if (it == dependencies.end()) {
+      continue;
+    }
+    for (auto &&dependency : it->second) {
+      if (closure.insert(dependency).second) {
+        worklist.push_back(&dependency);
+      }
+    }
+  }
+
+  utils::HashBuilder hasher;
+  hasher.Add(kFragmentFormatVersion);
+  hasher.Add(options_key_);
+  hasher.Add(header);
+  for (auto &&file : closure) {
+    auto it = path_to_record.find(file);
+    if (it == path_to_record.end()) {
+      return "";
+    }
+    FileRecord *record = it->second;
+    const std::string &content_hash = GetContentHash(record);
+    if (content_hash.empty()) {
+      return "";
+    }
+    hasher.Add(file);
+    hasher.Add(std::to_string(record->include_states_.size()));
+    for (auto &&include_state : record->include_states_) {
+      hasher.Add(include_state);
+    }
+    hasher.Add(content_hash);
+
+    std::vector<std::string> macro_references;
+    for (auto &&reference : record->macro_references_) {
+      macro_references.push_back(reference.first->getName().str() +
+                                 GetMacroDefinition(reference.second));
+    }
+    std::sort(macro_references.begin(), macro_references.end());
+    for (auto &&reference : macro_references) {
+      hasher.Add(reference);
+    }
+  }
+  return hasher.Finish();
+}
+
+bool AbiFragmentCache::MoveTypesToFragments(repr::ModuleIR *module,
+                                            const ASTCaches &ast_caches) {
+  std::map<std::string, FileRecord *> path_to_record;
+  for (auto &&file : files_) {
+    std::string path = utils::NormalizePath(
+        sm_.getFilename(sm_.getLocForStartOfFile(file.second.file_id_)).str(),
+        options_.root_dir_);
+    path_to_record.emplace(std::move(path), &file.second);
+  }
+
+  // Group the cacheable types by the headers, and find the files each header
+  // depends on.
+  std::map<std::string, std::set<std::string>> header_to_types;
+  std::map<std::string, std::set<std::string>> dependencies;
+  for (auto &&item : module->GetTypeGraph()) {
+    const repr::TypeIR *type = item.second;
+    if (type->GetKind() != repr::RecordTypeKind &&
+        type->GetKind() != repr::EnumTypeKind) {
+      continue;
+    }
+    const std::string &source_file = type->GetSourceFile();
+    if (source_file.empty()) {
+      continue;
+    }
+    std::set<std::string> &files = dependencies[source_file];
+    std::set<std::string> visited_types;
+    for (auto &&type_id : GetDependentTypeIds(type)) {
+      CollectDefiningFiles(type_id, module->GetTypeGraph(), &visited_types,
+                           &files);
+    }
+    files.erase(source_file);
+    if (source_file != ast_caches.translation_unit_source_ &&
+        IsCacheableType(type) &&
+        (!ast_caches.exported_headers_ ||
+         ast_caches.exported_headers_->count(source_file))) {
+      header_to_types[source_file].insert(type->GetSelfType());
+    }
+  }
+
+  // Compute all keys before the module is modified.
+  std::vector<std::pair<std::string, const std::set<std::string> *>> keys;
+  for (auto &&item : header_to_types) {
+    std::string key =
+        ComputeFragmentKey(item.first, path_to_record, dependencies);
+    if (!key.empty()) {
+      keys.emplace_back(std::move(key), &item.second);
+    }
+  }
+
+  llvm::SmallString<256> cache_dir(options_.abi_fragment_cache_dir_);
+  if (llvm::sys::fs::make_absolute(cache_dir) ||
+      llvm::sys::fs::create_directories(cache_dir)) {
+    llvm::errs() << "Failed to create ABI fragment cache directory \""
+                 << cache_dir << "\"\n";
+    return false;
+  }
+
+  std::vector<std::string> fragment_paths;
+  for (auto &&key : keys) {
+    llvm::SmallString<256> fragment_base(cache_dir);
+    llvm::sys::path::append(fragment_base, key.first);
+    std::string fragment_path = std::string(fragment_base) + ".sdump";
+    std::string keys_path = std::string(fragment_base) + ".keys";
+
+    // The .keys file is written after the fragment. If it exists, the
+    // fragment is complete.
+    if (llvm::sys::fs::exists(keys_path)) {
+      std::set<std::string> cached_types;
+      if (!ReadLines(keys_path, &cached_types)) {
+        return false;
+      }
+      std::set<std::string> self_types;
+      std::set_intersection(key.second->begin(), key.second->end(),
+                            cached_types.begin(), cached_types.end(),
+                            std::inserter(self_types, self_types.end()));
+      if (self_types.empty()) {
+        continue;
+      }
+      ExtractTypes(&module->record_types_, self_types, module, nullptr,
+                   &repr::ModuleIR::AddRecordType);
+      ExtractTypes(&module->enum_types_, self_types, module, nullptr,
+                   &repr::ModuleIR::AddEnumType);
+      fragment_paths.push_back(std::move(fragment_path));
+      continue;
+    }
+
+    repr::ModuleIR fragment(nullptr);
+    ExtractTypes(&module->record_types_, *key.second, module, &fragment,
+                 &repr::ModuleIR::AddRecordType);
+    ExtractTypes(&module->enum_types_, *key.second, module, &fragment,
+                 &repr::ModuleIR::AddEnumType);
+    // The linker requires the underlying types of the enums in the same dump.
+    for (auto &&enum_type : fragment.GetEnumTypes()) {
+      auto it = module->GetTypeGraph().find(
+          enum_type.second.GetUnderlyingType());
+      if (it != module->GetTypeGraph().end() &&
+          it->second->GetKind() == repr::BuiltinTypeKind) {
+        fragment.AddBuiltinType(repr::BuiltinTypeIR(
+            *static_cast<const repr::BuiltinTypeIR *>(it->second)));
+      }
+    }
+    bool ok = WriteFileAtomically(
+        fragment_path, [&](const std::string &path) {
+          std::unique_ptr<repr::IRDumper> ir_dumper =
+              repr::IRDumper::CreateIRDumper(options_.text_format_, path);
+          return ir_dumper->Dump(fragment);
+        });
+    ok = ok && WriteFileAtomically(
+        keys_path, [&](const std::string &path) {
+          return WriteLines(path, std::vector<std::string>(
+              key.second->begin(), key.second->end()));
+        });
+    if (!ok) {
+      llvm::errs() << "Failed to write ABI fragment \"" << fragment_path
+                   << "\"\n";
+      return false;
+    }
+    fragment_paths.push_back(std::move(fragment_path));
+  }
+
+  // The dumper has removed the list left by a previous run.
+  if (fragment_paths.empty()) {
+    return true;
+  }
+  return WriteLines(options_.dump_name_ + ".fragments", fragment_paths);
+}
+
+
+}  // namespace dumper
+}  // namespace header_checker
@@ -0,0 +1,136 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ABI_FRAGMENT_CACHE_H_
+#define ABI_FRAGMENT_CACHE_H_
+
+#include "dumper/ast_util.h"
+#include "dumper/header_checker.h"
+#include "repr/ir_representation.h"
+
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Lex/MacroInfo.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+// This class moves the record and enum types defined in the headers to the ABI
+// fragment cache directory. A fragment is keyed by the contents of the header,
+// the macros referenced by the header, the state at the #include directives
+// that affects the types, e.g., #pragma pack, the contents of the files
+// defining the types the header's types depend on, and the target and language
+// options.
+// The translation units sharing a fragment write a reference to it, i.e., a
+// line in <dump>.fragments, instead of the types.
+//
+// The PPCallbacks methods record the files and the macro references while the
+// translation unit is preprocessed. The instance is owned by the Preprocessor.
+class AbiFragmentCache : public clang::PPCallbacks {
+ public:
+  AbiFragmentCache(const clang::CompilerInstance &ci,
+                   const HeaderCheckerOptions &options);
+
+  void FileChanged(clang::SourceLocation loc, FileChangeReason reason,
+                   clang::SrcMgr::CharacteristicKind file_type,
+                   clang::FileID prev_file_id) override;
+
+  void MacroExpands(const clang::Token &macro_name,
+                    const clang::MacroDefinition &macro_definition,
+                    clang::SourceRange range,
+                    const clang::MacroArgs *args) override;
+
+  void Defined(const clang::Token &macro_name,
+               const clang::MacroDefinition &macro_definition,
+               clang::SourceRange range) override;
+
+  void Ifdef(clang::SourceLocation loc, const clang::Token &macro_name,
+             const clang::MacroDefinition &macro_definition) override;
+
+  void Ifndef(clang::SourceLocation loc, const clang::Token &macro_name,
+              const clang::MacroDefinition &macro_definition) override;
+
+  // Removes the cacheable types from the module, writes the fragments that
+  // are not in the cache, and writes the list of the fragments to
+  // <dump>.fragments.
+  bool MoveTypesToFragments(repr::ModuleIR *module,
+                            const ASTCaches &ast_caches);
+
+ private:
+  struct FileRecord {
+    clang::FileID file_id_;
+    // The include state at each entry. A header without include guards may be
+    // entered more than once.
+    std::vector<std::string> include_states_;
+    // The macros referenced in the file and their definitions at the time.
+    // A null MacroInfo denotes an undefined macro.
+    llvm::DenseSet<std::pair<const clang::IdentifierInfo *,
+                             const clang::MacroInfo *>> macro_references_;
+    // MD5 of the content, computed on demand.
+    std::string content_hash_;
+  };
+
+  void AddMacroReference(clang::SourceLocation loc,
+                         const clang::Token &macro_name,
+                         const clang::MacroDefinition &macro_definition);
+
+  // Returns the alignment set by #pragma pack and #pragma options align,
+  // #pragma ms_struct, and the namespaces and linkage specifications enclosing
+  // the #include directive.
+  std::string GetIncludeState() const;
+
+  const std::string &GetMacroDefinition(const clang::MacroInfo *macro_info);
+
+  const std::string &GetContentHash(FileRecord *record);
+
+  // Returns an empty string if the fragment cannot be keyed.
+  std::string ComputeFragmentKey(
+      const std::string &header,
+      const std::map<std::string, FileRecord *> &path_to_record,
+      const std::map<std::string, std::set<std::string>> &dependencies);
+
+ private:
+  const clang::CompilerInstance &ci_;
+  const clang::SourceManager &sm_;
+  const clang::Preprocessor &pp_;
+  const HeaderCheckerOptions &options_;
+  // The target and language options that affect the layout of the types.
+  std::string options_key_;
+
+  llvm::DenseMap<const clang::FileEntry *, FileRecord> files_;
+  llvm::DenseMap<const clang::MacroInfo *, std::string> macro_definitions_;
+
+  // The file of the last macro reference. Macro references come in runs from
+  // the same file.
+  clang::FileID last_file_id_;
+  FileRecord *last_record_ = nullptr;
+};
+
+
+}  // namespace dumper
+}  // namespace header_checker
+
+
+#endif  // ABI_FRAGMENT_CACHE_H_
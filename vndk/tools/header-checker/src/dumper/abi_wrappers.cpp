@@ -59,12 +59,12 @@ ABIWrapper::ABIWrapper(
     clang::MangleContext *mangle_contextp,
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *cip,
-    repr::ModuleIR *module,
+    IRSink *sink,
     ASTCaches *ast_caches)
     : cip_(cip),
       mangle_contextp_(mangle_contextp),
       ast_contextp_(ast_contextp),
-      module_(module),
+      sink_(sink),
       ast_caches_(ast_caches) {}
 
 std::string ABIWrapper::GetDeclSourceFile(const clang::Decl *decl,
@@ -83,14 +83,50 @@ std::string ABIWrapper::GetDeclSourceFile(const clang::Decl *decl,
                               root_dir);
 }
 
+static SourceFileInfo CreateSourceFileInfo(std::string path,
+                                           const ASTCaches *ast_caches) {
+  SourceFileInfo info;
+  info.is_translation_unit_source_ =
+      (path == ast_caches->translation_unit_source_);
+  info.is_exported_ =
+      (!ast_caches->exported_headers_ || info.is_translation_unit_source_ ||
+       ast_caches->exported_headers_->find(path) !=
+           ast_caches->exported_headers_->end());
+  info.path_ = std::move(path);
+  return info;
+}
+
+const SourceFileInfo &ABIWrapper::GetCachedSourceFileInfo(
+    const clang::Decl *decl, const clang::CompilerInstance *cip,
+    ASTCaches *ast_caches) {
+  clang::SourceManager &sm = cip->getSourceManager();
+  clang::FileID file_id =
+      sm.getFileID(sm.getExpansionLoc(decl->getLocation()));
+  if (file_id.isInvalid()) {
+    // DenseMap reserves the invalid FileID as its empty key.
+    if (!ast_caches->invalid_file_id_source_file_) {
+      ast_caches->invalid_file_id_source_file_ =
+          std::make_unique<SourceFileInfo>(CreateSourceFileInfo(
+              GetDeclSourceFile(decl, cip, ast_caches->root_dir_),
+              ast_caches));
+    }
+    return *ast_caches->invalid_file_id_source_file_;
+  }
+  auto result = ast_caches->file_id_to_source_file_cache_.find(file_id);
+  if (result != ast_caches->file_id_to_source_file_cache_.end()) {
+    ast_caches->source_file_cache_hits_++;
+    return result->second;
+  }
+  return ast_caches->file_id_to_source_file_cache_.insert(std::make_pair(
+      file_id, CreateSourceFileInfo(
+          GetDeclSourceFile(decl, cip, ast_caches->root_dir_),
+          ast_caches))).first->second;
+}
+
 std::string ABIWrapper::GetCachedDeclSourceFile(
     const clang::Decl *decl, const clang::CompilerInstance *cip) {
   assert(decl != nullptr);
-  auto result = ast_caches_->decl_to_source_file_cache_.find(decl);
-  if (result == ast_caches_->decl_to_source_file_cache_.end()) {
-    return GetDeclSourceFile(decl, cip, ast_caches_->root_dir_);
-  }
-  return result->second;
+  return GetCachedSourceFileInfo(decl, cip, ast_caches_).path_;
 }
 
 std::string ABIWrapper::GetMangledNameDecl(
@@ -207,7 +243,7 @@ static clang::QualType GetReferencedType(const clang::QualType qual_type) {
 
 bool ABIWrapper::CreateAnonymousRecord(const clang::RecordDecl *record_decl) {
   RecordDeclWrapper record_decl_wrapper(mangle_contextp_, ast_contextp_, cip_,
-                                        record_decl, module_, ast_caches_);
+                                        record_decl, sink_, ast_caches_);
   return record_decl_wrapper.GetRecordDecl();
 }
 
@@ -221,6 +257,7 @@ bool ABIWrapper::CreateExtendedType(clang::QualType qual_type,
 // A mangled anonymous enum name ends with $_<number> or Ut<number>_ where the
 // number may be inconsistent between translation units. This function replaces
 // the name with $ followed by the lexicographically smallest field name.
+// Returns an empty string if the name cannot be parsed.
 static std::string GetAnonymousEnumUniqueId(llvm::StringRef mangled_name,
                                             const clang::EnumDecl *enum_decl) {
   // Get the type name from the mangled name.
@@ -236,7 +273,7 @@ static std::string GetAnonymousEnumUniqueId(llvm::StringRef mangled_name,
     if (!mangled_name.endswith(old_suffix)) {
       llvm::errs() << "Unexpected length of anonymous enum type name: "
                    << mangled_name << "\n";
-      ::exit(1);
+      return "";
     }
   } else if (std::regex_search(mangled_name_str, match_result,
                                std::regex(R"(Ut\d*_(E?)$)"))) {
@@ -245,7 +282,7 @@ static std::string GetAnonymousEnumUniqueId(llvm::StringRef mangled_name,
   } else {
     llvm::errs() << "Cannot parse anonymous enum name: " << mangled_name
                  << "\n";
-    ::exit(1);
+    return "";
   }
 
   // Find the smallest enumerator name.
@@ -267,15 +304,30 @@ std::string ABIWrapper::GetTypeUniqueId(clang::QualType qual_type) {
   const clang::Type *canonical_type = qual_type.getCanonicalType().getTypePtr();
   assert(canonical_type != nullptr);
 
+  // The same types are referred to by many fields, parameters, and template
+  // arguments, so they are mangled once per translation unit.
+  auto cached = ast_caches_->type_unique_ids_.find(qual_type);
+  if (cached != ast_caches_->type_unique_ids_.end()) {
+    ast_caches_->type_unique_id_cache_hits_++;
+    return cached->second;
+  }
+
   llvm::SmallString<256> uid;
   llvm::raw_svector_ostream out(uid);
   mangle_contextp_->mangleCXXRTTI(qual_type, out);
 
+  std::string unique_id;
   if (const clang::EnumDecl *enum_decl = GetAnonymousEnum(qual_type)) {
-    return GetAnonymousEnumUniqueId(uid.str(), enum_decl);
+    unique_id = GetAnonymousEnumUniqueId(uid.str(), enum_decl);
+    if (unique_id.empty()) {
+      ast_caches_->has_invalid_type_id_ = true;
+    }
+  } else {
+    unique_id = std::string(uid);
   }
 
-  return std::string(uid);
+  ast_caches_->type_unique_ids_.insert(std::make_pair(qual_type, unique_id));
+  return unique_id;
 }
 
 // CreateBasicNamedAndTypedDecl creates a BasicNamedAndTypedDecl which will
@@ -326,8 +378,10 @@ bool ABIWrapper::CreateBasicNamedAndTypedDecl(clang::QualType qual_type,
       IsReferencingType(canonical_type) || is_builtin ||
       base_type->isFunctionType() ||
       (GetAnonymousRecord(canonical_type) != nullptr);
+  // The types which differ only in sugar, e.g., typedefs, share the canonical
+  // type and the IR. Skip them before building any name or IR object.
   if (!should_continue_with_recursive_type_creation ||
-      !ast_caches_->converted_qual_types_.insert(qual_type).second) {
+      !ast_caches_->converted_qual_types_.insert(canonical_type).second) {
     return true;
   }
 
@@ -335,7 +389,7 @@ bool ABIWrapper::CreateBasicNamedAndTypedDecl(clang::QualType qual_type,
   // extending Type and return a pointer to that and pass it to CreateBasic...
   // CreateBasic...(qualtype, Type *) fills in size, alignemnt etc.
   auto type_and_status = SetTypeKind(canonical_type, source_file);
-  std::unique_ptr<repr::TypeIR> typep = std::move(type_and_status.typep_);
+  repr::TypeIRPtr typep = std::move(type_and_status.typep_);
   if (!base_type->isVoidType() && type_and_status.should_create_type_ &&
       !typep) {
     llvm::errs() << "nullptr with valid type while creating basic type\n";
@@ -348,12 +402,13 @@ bool ABIWrapper::CreateBasicNamedAndTypedDecl(clang::QualType qual_type,
 
   return (CreateBasicNamedAndTypedDecl(
               canonical_type, typep.get(), source_file) &&
-          module_->AddLinkableMessage(*typep));
+          sink_->AddLinkableMessage(*typep));
 }
 
 // This method returns a TypeAndCreationStatus object. This object contains a
 // type and information to tell the clients of this method whether the caller
-// should continue creating the type.
+// should continue creating the type. A status without a type that is to be
+// created denotes a failure.
 TypeAndCreationStatus ABIWrapper::SetTypeKind(
     const clang::QualType canonical_type, const std::string &source_file) {
   if (canonical_type.hasLocalQualifiers()) {
@@ -400,11 +455,11 @@ TypeAndCreationStatus ABIWrapper::SetTypeKind(
   if (auto &&func_type_ptr =
           llvm::dyn_cast<const clang::FunctionType>(type_ptr)) {
     FunctionTypeWrapper function_type_wrapper(mangle_contextp_, ast_contextp_,
-                                              cip_, func_type_ptr, module_,
+                                              cip_, func_type_ptr, sink_,
                                               ast_caches_, source_file);
     if (!function_type_wrapper.GetFunctionType()) {
       llvm::errs() << "FunctionType could not be created\n";
-      ::exit(1);
+      return TypeAndCreationStatus(nullptr);
     }
   }
   if (type_ptr->isRecordType()) {
@@ -415,7 +470,7 @@ TypeAndCreationStatus ABIWrapper::SetTypeKind(
     if (anon_record && !anon_record->isInvalidDecl() &&
         !CreateAnonymousRecord(anon_record)) {
       llvm::errs() << "Anonymous record could not be created\n";
-      ::exit(1);
+      return TypeAndCreationStatus(nullptr);
     }
   }
   return TypeAndCreationStatus(nullptr, false);
@@ -440,9 +495,9 @@ std::string ABIWrapper::QualTypeToString(const clang::QualType &sweet_qt) {
 FunctionTypeWrapper::FunctionTypeWrapper(
     clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
-    const clang::FunctionType *function_type, repr::ModuleIR *module,
+    const clang::FunctionType *function_type, IRSink *sink,
     ASTCaches *ast_caches, const std::string &source_file)
-    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, module,
+    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, sink,
                  ast_caches),
       function_type_(function_type),
       source_file_(source_file) {}
@@ -476,7 +531,7 @@ bool FunctionTypeWrapper::GetFunctionType() {
     return false;
   }
   return SetupFunctionType(abi_decl.get()) &&
-      module_->AddLinkableMessage(*abi_decl);
+      sink_->AddLinkableMessage(*abi_decl);
 }
 
 
@@ -489,9 +544,9 @@ FunctionDeclWrapper::FunctionDeclWrapper(
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
     const clang::FunctionDecl *decl,
-    repr::ModuleIR *module,
+    IRSink *sink,
     ASTCaches *ast_caches)
-    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, module,
+    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, sink,
                  ast_caches),
       function_decl_(decl) {}
 
@@ -584,9 +639,9 @@ RecordDeclWrapper::RecordDeclWrapper(
     clang::MangleContext *mangle_contextp,
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
-    const clang::RecordDecl *decl, repr::ModuleIR *module,
+    const clang::RecordDecl *decl, IRSink *sink,
     ASTCaches *ast_caches)
-    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, module,
+    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, sink,
                  ast_caches),
       record_decl_(decl) {}
 
@@ -846,7 +901,7 @@ bool RecordDeclWrapper::GetRecordDecl() {
     // cached, don't add the record.
     return true;
   }
-  return module_->AddLinkableMessage(*abi_decl);
+  return sink_->AddLinkableMessage(*abi_decl);
 }
 
 std::string RecordDeclWrapper::GetMangledRTTI(
@@ -868,9 +923,9 @@ EnumDeclWrapper::EnumDeclWrapper(
     clang::MangleContext *mangle_contextp,
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
-    const clang::EnumDecl *decl, repr::ModuleIR *module,
+    const clang::EnumDecl *decl, IRSink *sink,
     ASTCaches *ast_caches)
-    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, module,
+    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, sink,
                  ast_caches),
       enum_decl_(decl) {}
 
@@ -910,7 +965,7 @@ bool EnumDeclWrapper::GetEnumDecl() {
     llvm::errs() << "Setting up Enum failed\n";
     return false;
   }
-  return module_->AddLinkableMessage(*abi_decl);
+  return sink_->AddLinkableMessage(*abi_decl);
 }
 
 
@@ -922,9 +977,9 @@ GlobalVarDeclWrapper::GlobalVarDeclWrapper(
     clang::MangleContext *mangle_contextp,
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
-    const clang::VarDecl *decl, repr::ModuleIR *module,
+    const clang::VarDecl *decl, IRSink *sink,
     ASTCaches *ast_caches)
-    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, module,
+    : ABIWrapper(mangle_contextp, ast_contextp, compiler_instance_p, sink,
                  ast_caches),
       global_var_decl_(decl) {}
 
@@ -949,7 +1004,7 @@ bool GlobalVarDeclWrapper::GetGlobalVarDecl() {
   auto abi_decl = std::make_unique<repr::GlobalVarIR>();
   std::string source_file = GetCachedDeclSourceFile(global_var_decl_, cip_);
   return SetupGlobalVar(abi_decl.get(), source_file) &&
-      module_->AddLinkableMessage(*abi_decl);
+      sink_->AddLinkableMessage(*abi_decl);
 }
 
 
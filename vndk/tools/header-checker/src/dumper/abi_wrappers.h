@@ -16,6 +16,7 @@
 #define ABI_WRAPPERS_H_
 
 #include "dumper/ast_util.h"
+#include "dumper/ir_sink.h"
 #include "repr/ir_representation.h"
 
 #include <clang/AST/AST.h>
@@ -30,9 +31,9 @@ namespace dumper {
 
 
 struct TypeAndCreationStatus {
-  std::unique_ptr<repr::TypeIR> typep_;
+  repr::TypeIRPtr typep_;
   bool should_create_type_;  // Whether the type is to be created.
-  TypeAndCreationStatus(std::unique_ptr<repr::TypeIR> &&typep,
+  TypeAndCreationStatus(repr::TypeIRPtr &&typep,
                         bool should_create_type = true)
       : typep_(std::move(typep)), should_create_type_(should_create_type) {}
 };
@@ -43,7 +44,7 @@ class ABIWrapper {
   ABIWrapper(clang::MangleContext *mangle_contextp,
              clang::ASTContext *ast_contextp,
              const clang::CompilerInstance *cip,
-             repr::ModuleIR *module,
+             IRSink *sink,
              ASTCaches *ast_caches);
 
  public:
@@ -51,6 +52,12 @@ class ABIWrapper {
                                        const clang::CompilerInstance *cip,
                                        const std::string &root_dir);
 
+  // Returns the source file of the decl, which is computed once per FileID.
+  // The reference is invalidated by the next call.
+  static const SourceFileInfo &GetCachedSourceFileInfo(
+      const clang::Decl *decl, const clang::CompilerInstance *cip,
+      ASTCaches *ast_caches);
+
  protected:
   std::string GetCachedDeclSourceFile(const clang::Decl *decl,
                                       const clang::CompilerInstance *cip);
@@ -99,7 +106,7 @@ class ABIWrapper {
   const clang::CompilerInstance *cip_;
   clang::MangleContext *mangle_contextp_;
   clang::ASTContext *ast_contextp_;
-  repr::ModuleIR *module_;
+  IRSink *sink_;
   ASTCaches *ast_caches_;
 };
 
@@ -109,7 +116,7 @@ class RecordDeclWrapper : public ABIWrapper {
   RecordDeclWrapper(
       clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
       const clang::CompilerInstance *compiler_instance_p,
-      const clang::RecordDecl *record_decl, repr::ModuleIR *module,
+      const clang::RecordDecl *record_decl, IRSink *sink,
       ASTCaches *ast_caches);
 
   bool GetRecordDecl();
@@ -150,7 +157,7 @@ class FunctionDeclWrapper : public ABIWrapper {
   FunctionDeclWrapper(
       clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
       const clang::CompilerInstance *compiler_instance_p,
-      const clang::FunctionDecl *decl, repr::ModuleIR *module,
+      const clang::FunctionDecl *decl, IRSink *sink,
       ASTCaches *ast_caches);
 
   std::unique_ptr<repr::FunctionIR> GetFunctionDecl();
@@ -181,7 +188,7 @@ class FunctionTypeWrapper : public ABIWrapper {
   FunctionTypeWrapper(
       clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
       const clang::CompilerInstance *compiler_instance_p,
-      const clang::FunctionType *function_type, repr::ModuleIR *module,
+      const clang::FunctionType *function_type, IRSink *sink,
       ASTCaches *ast_caches, const std::string &source_file);
 
   bool GetFunctionType();
@@ -197,7 +204,7 @@ class EnumDeclWrapper : public ABIWrapper {
   EnumDeclWrapper(
       clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
       const clang::CompilerInstance *compiler_instance_p,
-      const clang::EnumDecl *decl, repr::ModuleIR *module,
+      const clang::EnumDecl *decl, IRSink *sink,
       ASTCaches *ast_caches);
 
   bool GetEnumDecl();
@@ -218,7 +225,7 @@ class GlobalVarDeclWrapper : public ABIWrapper {
   GlobalVarDeclWrapper(
       clang::MangleContext *mangle_contextp, clang::ASTContext *ast_contextp,
       const clang::CompilerInstance *compiler_instance_p,
-      const clang::VarDecl *decl, repr::ModuleIR *module,
+      const clang::VarDecl *decl, IRSink *sink,
       ASTCaches *ast_caches);
 
   bool GetGlobalVarDecl();
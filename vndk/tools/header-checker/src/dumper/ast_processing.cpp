@@ -17,6 +17,7 @@
 #include "dumper/abi_wrappers.h"
 #include "repr/ir_dumper.h"
 #include "utils/header_abi_util.h"
+#include "utils/time_trace.h"
 
 #include <clang/AST/PrettyPrinter.h>
 #include <clang/AST/QualTypeNames.h>
@@ -47,11 +48,11 @@ HeaderASTVisitor::HeaderASTVisitor(
     const HeaderCheckerOptions &options, clang::MangleContext *mangle_contextp,
     clang::ASTContext *ast_contextp,
     const clang::CompilerInstance *compiler_instance_p,
-    const clang::Decl *tu_decl, repr::ModuleIR *module,
+    const clang::Decl *tu_decl, IRSink *sink,
     ASTCaches *ast_caches)
     : options_(options), mangle_contextp_(mangle_contextp),
       ast_contextp_(ast_contextp), cip_(compiler_instance_p), tu_decl_(tu_decl),
-      module_(module), ast_caches_(ast_caches) {}
+      sink_(sink), ast_caches_(ast_caches) {}
 
 bool HeaderASTVisitor::VisitRecordDecl(const clang::RecordDecl *decl) {
   // Avoid segmentation fault in getASTRecordLayout.
@@ -67,8 +68,11 @@ bool HeaderASTVisitor::VisitRecordDecl(const clang::RecordDecl *decl) {
       !decl->isExternallyVisible()) {
     return true;
   }
+  llvm::TimeTraceScope scope("RecordDeclWrapper", [decl]() {
+    return decl->getQualifiedNameAsString();
+  });
   RecordDeclWrapper record_decl_wrapper(
-      mangle_contextp_, ast_contextp_, cip_, decl, module_, ast_caches_);
+      mangle_contextp_, ast_contextp_, cip_, decl, sink_, ast_caches_);
   return record_decl_wrapper.GetRecordDecl();
 }
 
@@ -77,25 +81,28 @@ bool HeaderASTVisitor::VisitEnumDecl(const clang::EnumDecl *decl) {
       decl->getTypeForDecl()->isDependentType()) {
     return true;
   }
+  llvm::TimeTraceScope scope("EnumDeclWrapper", [decl]() {
+    return decl->getQualifiedNameAsString();
+  });
   EnumDeclWrapper enum_decl_wrapper(
-      mangle_contextp_, ast_contextp_, cip_, decl, module_, ast_caches_);
+      mangle_contextp_, ast_contextp_, cip_, decl, sink_, ast_caches_);
   return enum_decl_wrapper.GetEnumDecl();
 }
 
 static bool MutateFunctionWithLinkageName(const repr::FunctionIR *function,
-                                          repr::ModuleIR *module,
+                                          IRSink *sink,
                                           std::string &linkage_name) {
   auto added_function = std::make_unique<repr::FunctionIR>();
   *added_function = *function;
   added_function->SetLinkerSetKey(linkage_name);
-  return module->AddLinkableMessage(*added_function);
+  return sink->AddLinkableMessage(*added_function);
 }
 
 static bool AddMangledFunctions(const repr::FunctionIR *function,
-                                repr:: ModuleIR *module,
+                                IRSink *sink,
                                 std::vector<std::string> &manglings) {
   for (auto &&mangling : manglings) {
-    if (!MutateFunctionWithLinkageName(function, module, mangling)) {
+    if (!MutateFunctionWithLinkageName(function, sink, mangling)) {
       return false;
     }
   }
@@ -106,7 +113,8 @@ bool HeaderASTVisitor::ShouldSkipFunctionDecl(const clang::FunctionDecl *decl) {
   if (!decl->getDefinition()) {
     if (!options_.dump_function_declarations_ ||
         options_.source_file_ !=
-            ABIWrapper::GetDeclSourceFile(decl, cip_, options_.root_dir_)) {
+            ABIWrapper::GetCachedSourceFileInfo(decl, cip_, ast_caches_)
+                .path_) {
       return true;
     }
   }
@@ -144,19 +152,22 @@ bool HeaderASTVisitor::VisitFunctionDecl(const clang::FunctionDecl *decl) {
   if (ShouldSkipFunctionDecl(decl)) {
     return true;
   }
+  llvm::TimeTraceScope scope("FunctionDeclWrapper", [decl]() {
+    return decl->getQualifiedNameAsString();
+  });
   FunctionDeclWrapper function_decl_wrapper(
-      mangle_contextp_, ast_contextp_, cip_, decl, module_, ast_caches_);
+      mangle_contextp_, ast_contextp_, cip_, decl, sink_, ast_caches_);
   auto function_wrapper = function_decl_wrapper.GetFunctionDecl();
   // Destructors and Constructors can have more than 1 symbol generated from the
   // same Decl.
   clang::ASTNameGenerator cg(*ast_contextp_);
   std::vector<std::string> manglings = cg.getAllManglings(decl);
   if (!manglings.empty()) {
-    return AddMangledFunctions(function_wrapper.get(), module_, manglings);
+    return AddMangledFunctions(function_wrapper.get(), sink_, manglings);
   }
   std::string linkage_name =
       ABIWrapper::GetMangledNameDecl(decl, mangle_contextp_);
-  return MutateFunctionWithLinkageName(function_wrapper.get(), module_,
+  return MutateFunctionWithLinkageName(function_wrapper.get(), sink_,
                                        linkage_name);
 }
 
@@ -166,8 +177,11 @@ bool HeaderASTVisitor::VisitVarDecl(const clang::VarDecl *decl) {
     // Non global / static variable declarations don't need to be dumped.
     return true;
   }
+  llvm::TimeTraceScope scope("GlobalVarDeclWrapper", [decl]() {
+    return decl->getQualifiedNameAsString();
+  });
   GlobalVarDeclWrapper global_var_decl_wrapper(
-      mangle_contextp_, ast_contextp_, cip_, decl, module_, ast_caches_);
+      mangle_contextp_, ast_contextp_, cip_, decl, sink_, ast_caches_);
   return global_var_decl_wrapper.GetGlobalVarDecl();
 }
 
@@ -176,30 +190,41 @@ bool HeaderASTVisitor::TraverseDecl(clang::Decl *decl) {
   if (!decl) {
     return true;
   }
-  std::string source_file =
-      ABIWrapper::GetDeclSourceFile(decl, cip_, options_.root_dir_);
-  ast_caches_->decl_to_source_file_cache_.insert(
-      std::make_pair(decl, source_file));
+  // The decls in a file which is not exported are rejected by one lookup.
+  const SourceFileInfo &source_file =
+      ABIWrapper::GetCachedSourceFileInfo(decl, cip_, ast_caches_);
   // If no exported headers are specified we assume the whole AST is exported.
-  const auto &exported_headers = options_.exported_headers_;
-  if ((decl != tu_decl_) && options_.dump_exported_only_ &&
-      source_file != ast_caches_->translation_unit_source_ &&
-      (exported_headers.find(source_file) == exported_headers.end())) {
+  if ((decl != tu_decl_) && !source_file.is_exported_) {
     return true;
   }
   // If at all we're looking at the source file's AST decl node, it should be a
   // function decl node.
-  if ((decl != tu_decl_) &&
-      (source_file == ast_caches_->translation_unit_source_) &&
+  if ((decl != tu_decl_) && source_file.is_translation_unit_source_ &&
       !decl->isFunctionOrFunctionTemplate()) {
     return true;
   }
   return RecursiveASTVisitor<HeaderASTVisitor>::TraverseDecl(decl);
 }
 
+static void AddCacheCounters(const ASTCaches &ast_caches) {
+  if (!utils::IsTimeTraceEnabled()) {
+    return;
+  }
+  utils::AddTimeTraceCounter("Source file cache hits",
+                             ast_caches.source_file_cache_hits_);
+  utils::AddTimeTraceCounter("Source file cache misses",
+                             ast_caches.file_id_to_source_file_cache_.size());
+  utils::AddTimeTraceCounter("Type unique id cache hits",
+                             ast_caches.type_unique_id_cache_hits_);
+  utils::AddTimeTraceCounter("Type unique id cache misses",
+                             ast_caches.type_unique_ids_.size());
+}
+
 HeaderASTConsumer::HeaderASTConsumer(
-    clang::CompilerInstance *compiler_instancep, HeaderCheckerOptions &options)
-    : cip_(compiler_instancep), options_(options) {}
+    clang::CompilerInstance *compiler_instancep, HeaderCheckerOptions &options,
+    AbiFragmentCache *abi_fragment_cache)
+    : cip_(compiler_instancep), options_(options),
+      abi_fragment_cache_(abi_fragment_cache) {}
 
 void HeaderASTConsumer::HandleTranslationUnit(clang::ASTContext &ctx) {
   clang::PrintingPolicy old_policy(ctx.getPrintingPolicy());
@@ -211,32 +236,82 @@ void HeaderASTConsumer::HandleTranslationUnit(clang::ASTContext &ctx) {
   PrintNormalizedPath callbacks(options_.root_dir_);
   policy.Callbacks = &callbacks;
   ctx.setPrintingPolicy(policy);
+  // The translation units are dumped on the worker threads, so a failure is
+  // returned through the options instead of terminating the process.
+  if (!ExtractAndDump(ctx)) {
+    options_.failed_ = true;
+  }
+  ctx.setPrintingPolicy(old_policy);
+}
+
+bool HeaderASTConsumer::ExtractAndDump(clang::ASTContext &ctx) {
   clang::TranslationUnitDecl *translation_unit = ctx.getTranslationUnitDecl();
   std::unique_ptr<clang::MangleContext> mangle_contextp(
       ctx.createMangleContext());
   ASTCaches ast_caches(
       ABIWrapper::GetDeclSourceFile(translation_unit, cip_, options_.root_dir_),
-      options_.root_dir_);
+      options_.root_dir_,
+      options_.dump_exported_only_ ? &options_.exported_headers_ : nullptr);
 
-  std::unique_ptr<repr::ModuleIR> module(
-      new repr::ModuleIR(nullptr /*FIXME*/));
+  std::unique_ptr<repr::IRDumper> ir_dumper =
+      repr::IRDumper::CreateIRDumper(options_.text_format_,
+                                     options_.dump_name_);
+  ir_dumper->SetCompression(options_.compression_);
+  ir_dumper->SetWriteIndex(options_.write_index_);
+  std::unique_ptr<repr::ModuleIR> module;
+  std::unique_ptr<IRSink> sink;
+  if (options_.stream_output_) {
+    if (!ir_dumper->BeginStream()) {
+      llvm::errs() << "Serialization failed\n";
+      return false;
+    }
+    sink.reset(new StreamingIRSink(ir_dumper.get()));
+  } else {
+    module.reset(new repr::ModuleIR(nullptr /*FIXME*/));
+    // The linker tells the definitions of a type in different translation
+    // units apart by the compilation unit paths, which are recorded as the
+    // types are added.
+    module->SetCompilationUnitPath(options_.dump_name_);
+    sink.reset(new ModuleIRSink(module.get()));
+  }
 
   HeaderASTVisitor v(options_, mangle_contextp.get(), &ctx, cip_,
-                     translation_unit, module.get(), &ast_caches);
-  if (!v.TraverseDecl(translation_unit)) {
-    llvm::errs() << "ABI extraction failed\n";
-    ::exit(1);
+                     translation_unit, sink.get(), &ast_caches);
+  {
+    llvm::TimeTraceScope scope("TraverseAST", options_.source_file_);
+    if (!v.TraverseDecl(translation_unit) ||
+        ast_caches.has_invalid_type_id_) {
+      llvm::errs() << "ABI extraction failed\n";
+      return false;
+    }
+  }
+  AddCacheCounters(ast_caches);
+
+  if (!module) {
+    if (!ir_dumper->EndStream()) {
+      llvm::errs() << "Serialization failed\n";
+      return false;
+    }
+    return true;
+  }
+
+  if (options_.output_module_) {
+    *options_.output_module_ = std::move(module);
+    return true;
+  }
+
+  llvm::TimeTraceScope scope("Serialize", options_.dump_name_);
+  if (abi_fragment_cache_ &&
+      !abi_fragment_cache_->MoveTypesToFragments(module.get(), ast_caches)) {
+    llvm::errs() << "Failed to write ABI fragments\n";
+    return false;
   }
 
-  std::unique_ptr<repr::IRDumper> ir_dumper =
-      repr::IRDumper::CreateIRDumper(options_.text_format_,
-                                     options_.dump_name_);
   if (!ir_dumper->Dump(*module)) {
     llvm::errs() << "Serialization failed\n";
-    ::exit(1);
+    return false;
   }
-
-  ctx.setPrintingPolicy(old_policy);
+  return true;
 }
 
 
@@ -15,8 +15,10 @@
 #ifndef AST_PROCESSING_H_
 #define AST_PROCESSING_H_
 
+#include "dumper/abi_fragment_cache.h"
 #include "dumper/ast_util.h"
 #include "dumper/header_checker.h"
+#include "dumper/ir_sink.h"
 
 #include <clang/AST/AST.h>
 #include <clang/AST/ASTConsumer.h>
@@ -40,7 +42,7 @@ class HeaderASTVisitor
                    clang::ASTContext *ast_contextp,
                    const clang::CompilerInstance *compiler_instance_p,
                    const clang::Decl *tu_decl,
-                   repr::ModuleIR *module,
+                   IRSink *sink,
                    ASTCaches *ast_caches);
 
   bool VisitRecordDecl(const clang::RecordDecl *decl);
@@ -65,7 +67,7 @@ class HeaderASTVisitor
   const clang::CompilerInstance *cip_;
   // To optimize recursion into only exported abi.
   const clang::Decl *tu_decl_;
-  repr::ModuleIR *module_;
+  IRSink *sink_;
   // We cache the source file an AST node corresponds to, to avoid repeated
   // calls to "realpath".
   ASTCaches *ast_caches_;
@@ -74,14 +76,20 @@ class HeaderASTVisitor
 
 class HeaderASTConsumer : public clang::ASTConsumer {
  public:
+  // abi_fragment_cache is nullptr if the fragment cache is disabled.
   HeaderASTConsumer(clang::CompilerInstance *compiler_instancep,
-                    HeaderCheckerOptions &options);
+                    HeaderCheckerOptions &options,
+                    AbiFragmentCache *abi_fragment_cache);
 
   void HandleTranslationUnit(clang::ASTContext &ctx) override;
 
+ private:
+  bool ExtractAndDump(clang::ASTContext &ctx);
+
  private:
   clang::CompilerInstance *cip_;
   HeaderCheckerOptions &options_;
+  AbiFragmentCache *abi_fragment_cache_;
 };
 
 
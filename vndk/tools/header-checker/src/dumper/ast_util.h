@@ -17,10 +17,14 @@
 
 #include <clang/AST/AST.h>
 #include <clang/AST/Type.h>
+#include <clang/Basic/SourceLocation.h>
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/DenseSet.h>
 
-#include <map>
+#include <cstdint>
+#include <memory>
+#include <set>
 #include <string>
 
 
@@ -28,17 +32,42 @@ namespace header_checker {
 namespace dumper {
 
 
+struct SourceFileInfo {
+  // The normalized path of the file.
+  std::string path_;
+  bool is_translation_unit_source_;
+  // Whether the decls in the file are dumped.
+  bool is_exported_;
+};
+
 struct ASTCaches {
+  // If exported_headers is nullptr, all decls are dumped.
   ASTCaches(const std::string &translation_unit_source,
-            const std::string &root_dir)
-      : translation_unit_source_(translation_unit_source), root_dir_(root_dir) {
+            const std::string &root_dir,
+            const std::set<std::string> *exported_headers)
+      : translation_unit_source_(translation_unit_source), root_dir_(root_dir),
+        exported_headers_(exported_headers) {
   }
 
   std::string translation_unit_source_;
   const std::string root_dir_;
-  std::map<const clang::Decl *, std::string> decl_to_source_file_cache_;
+  const std::set<std::string> *exported_headers_;
+
+  // Path normalization is expensive, so the source files are cached by FileID.
+  // The decls without a valid FileID share one entry.
+  llvm::DenseMap<clang::FileID, SourceFileInfo> file_id_to_source_file_cache_;
+  std::unique_ptr<SourceFileInfo> invalid_file_id_source_file_;
+  uint64_t source_file_cache_hits_ = 0;
 
+  // ASTContext uniques the canonical types, so a canonical type is a compact
+  // key of the kind, the referenced type, the qualifiers, and the size of a
+  // pointer, reference, qualified, or array type.
   llvm::DenseSet<clang::QualType> converted_qual_types_;
+  // Maps the types to the mangled RTTI names returned by GetTypeUniqueId.
+  llvm::DenseMap<clang::QualType, std::string> type_unique_ids_;
+  uint64_t type_unique_id_cache_hits_ = 0;
+  // Set if GetTypeUniqueId fails. The translation unit is not dumped.
+  bool has_invalid_type_id_ = false;
 };
 
 
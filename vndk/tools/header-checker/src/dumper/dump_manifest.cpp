@@ -0,0 +1,147 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dumper/dump_manifest.h"
+
+#include <clang/Frontend/CompilerInstance.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+static const char kManifestHeader[] = "header-abi-dumper-manifest-1";
+// A truncated manifest must not be mistaken for one with fewer dependencies.
+static const char kManifestFooter[] = "end";
+
+
+static bool IsFileUnchanged(llvm::StringRef path, llvm::StringRef hash) {
+  llvm::ErrorOr<llvm::MD5::MD5Result> result =
+      llvm::sys::fs::md5_contents(path);
+  return result && result->digest() == hash;
+}
+
+// The fragments are never modified, but the cache may have been cleaned.
+static bool AreFragmentsPresent(const std::string &dump_path) {
+  std::string fragment_list = dump_path + ".fragments";
+  if (!llvm::sys::fs::exists(fragment_list)) {
+    return true;
+  }
+  auto buffer = llvm::MemoryBuffer::getFile(fragment_list);
+  if (!buffer) {
+    return false;
+  }
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  for (auto &&line : lines) {
+    if (!llvm::sys::fs::exists(line)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+std::string GetDumpManifestPath(const std::string &dump_path) {
+  return dump_path + ".manifest";
+}
+
+bool IsDumpUpToDate(const std::string &dump_path,
+                    const std::string &flags_hash) {
+  if (!llvm::sys::fs::exists(dump_path)) {
+    return false;
+  }
+  auto buffer = llvm::MemoryBuffer::getFile(GetDumpManifestPath(dump_path));
+  if (!buffer) {
+    return false;
+  }
+  llvm::SmallVector<llvm::StringRef, 256> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  if (lines.size() < 3 || lines[0] != kManifestHeader ||
+      lines[1] != flags_hash || lines.back() != kManifestFooter) {
+    return false;
+  }
+  for (size_t i = 2; i + 1 < lines.size(); i++) {
+    // Each line consists of the hash and the path.
+    std::pair<llvm::StringRef, llvm::StringRef> hash_and_path =
+        lines[i].split(' ');
+    if (!IsFileUnchanged(hash_and_path.second, hash_and_path.first)) {
+      return false;
+    }
+  }
+  return AreFragmentsPresent(dump_path);
+}
+
+bool WriteDumpManifest(const std::string &dump_path,
+                       const std::string &flags_hash,
+                       const DumpDependencies &dependencies) {
+  std::string manifest_path = GetDumpManifestPath(dump_path);
+  if (!dependencies.complete_) {
+    // Remove the manifest of a previous run, so that the dump is regenerated.
+    llvm::sys::fs::remove(manifest_path);
+    return true;
+  }
+  std::error_code ec;
+  llvm::raw_fd_ostream out(manifest_path, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    llvm::errs() << "Failed to open \"" << manifest_path << "\": "
+                 << ec.message() << "\n";
+    return false;
+  }
+  out << kManifestHeader << "\n" << flags_hash << "\n";
+  for (auto &&file : dependencies.file_hashes_) {
+    out << file.second << " " << file.first << "\n";
+  }
+  out << kManifestFooter << "\n";
+  out.close();
+  if (out.has_error()) {
+    out.clear_error();
+    llvm::sys::fs::remove(manifest_path);
+    return false;
+  }
+  return true;
+}
+
+void CollectDependencies(clang::CompilerInstance &ci,
+                         DumpDependencies *dependencies) {
+  // Every file the compiler has read has an entry in the SourceManager.
+  clang::SourceManager &sm = ci.getSourceManager();
+  for (auto it = sm.fileinfo_begin(); it != sm.fileinfo_end(); ++it) {
+    const clang::FileEntry *file_entry = it->first;
+    llvm::Optional<llvm::MemoryBufferRef> buffer =
+        sm.getMemoryBufferForFileOrNone(file_entry);
+    if (!buffer) {
+      dependencies->complete_ = false;
+      continue;
+    }
+    llvm::SmallString<256> path(file_entry->getName());
+    ci.getFileManager().makeAbsolutePath(path);
+    llvm::MD5 hasher;
+    hasher.update(buffer->getBuffer());
+    llvm::MD5::MD5Result hash;
+    hasher.final(hash);
+    dependencies->file_hashes_[std::string(path)] = std::string(hash.digest());
+  }
+}
+
+
+}  // namespace dumper
+}  // namespace header_checker
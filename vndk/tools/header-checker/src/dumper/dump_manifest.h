@@ -0,0 +1,64 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DUMP_MANIFEST_H_
+#define DUMP_MANIFEST_H_
+
+#include <map>
+#include <string>
+
+
+namespace clang {
+  class CompilerInstance;
+}  // namespace clang
+
+
+namespace header_checker {
+namespace dumper {
+
+
+// The files read by the compiler while a source file was dumped.
+struct DumpDependencies {
+  // Maps the absolute paths to the MD5 of the contents.
+  std::map<std::string, std::string> file_hashes_;
+  // False if the content of any file could not be hashed.
+  bool complete_ = true;
+};
+
+
+// The manifest is written to <dump>.manifest after a successful dump. It
+// records the hash of the normalized flags and the dependencies, so that the
+// next run can skip parsing if none of them changed.
+std::string GetDumpManifestPath(const std::string &dump_path);
+
+// Returns true if the dump and its manifest exist, the flags hash matches, and
+// the contents of all dependencies and ABI fragments are unchanged.
+bool IsDumpUpToDate(const std::string &dump_path,
+                    const std::string &flags_hash);
+
+bool WriteDumpManifest(const std::string &dump_path,
+                       const std::string &flags_hash,
+                       const DumpDependencies &dependencies);
+
+// Hashes the files read by the compiler instance. This is called at the end
+// of the source file action.
+void CollectDependencies(clang::CompilerInstance &ci,
+                         DumpDependencies *dependencies);
+
+
+}  // namespace dumper
+}  // namespace header_checker
+
+
+#endif  // DUMP_MANIFEST_H_
@@ -14,6 +14,7 @@
 
 #include "dumper/frontend_action.h"
 
+#include "dumper/abi_fragment_cache.h"
 #include "dumper/ast_processing.h"
 #include "dumper/diagnostic_consumer.h"
 #include "dumper/fake_decl_source.h"
@@ -23,6 +24,7 @@
 #include <clang/AST/ASTConsumer.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Lex/Preprocessor.h>
+#include <llvm/Support/TimeProfiler.h>
 
 #include <utility>
 
@@ -38,8 +40,17 @@ HeaderCheckerFrontendAction::HeaderCheckerFrontendAction(
 std::unique_ptr<clang::ASTConsumer>
 HeaderCheckerFrontendAction::CreateASTConsumer(clang::CompilerInstance &ci,
                                                llvm::StringRef header_file) {
+  // The preprocessor owns the callbacks, which live until the AST consumer
+  // has handled the translation unit.
+  AbiFragmentCache *abi_fragment_cache = nullptr;
+  if (!options_.abi_fragment_cache_dir_.empty()) {
+    auto callbacks = std::make_unique<AbiFragmentCache>(ci, options_);
+    abi_fragment_cache = callbacks.get();
+    ci.getPreprocessor().addPPCallbacks(std::move(callbacks));
+  }
   // Create AST consumers.
-  return std::make_unique<HeaderASTConsumer>(&ci, options_);
+  return std::make_unique<HeaderASTConsumer>(&ci, options_,
+                                             abi_fragment_cache);
 }
 
 bool HeaderCheckerFrontendAction::BeginInvocation(clang::CompilerInstance &ci) {
@@ -62,6 +73,18 @@ bool HeaderCheckerFrontendAction::BeginSourceFileAction(
   return true;
 }
 
+void HeaderCheckerFrontendAction::ExecuteAction() {
+  // The span includes the AST traversal, which runs at the end of ParseAST.
+  llvm::TimeTraceScope scope("ParseAST", options_.source_file_);
+  clang::ASTFrontendAction::ExecuteAction();
+}
+
+void HeaderCheckerFrontendAction::EndSourceFileAction() {
+  if (options_.dependencies_) {
+    CollectDependencies(getCompilerInstance(), options_.dependencies_);
+  }
+}
+
 
 }  // dumper
 }  // header_checker
@@ -49,6 +49,8 @@ class HeaderCheckerFrontendAction : public clang::ASTFrontendAction {
 
   bool BeginInvocation(clang::CompilerInstance &ci) override;
   bool BeginSourceFileAction(clang::CompilerInstance &ci) override;
+  void ExecuteAction() override;
+  void EndSourceFileAction() override;
 };
 
 
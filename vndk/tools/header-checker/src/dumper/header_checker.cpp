@@ -14,49 +14,99 @@
 
 #include "dumper/header_checker.h"
 
+#include "dumper/dump_manifest.h"
 #include "dumper/fixed_argv.h"
 #include "dumper/frontend_action_factory.h"
+#include "dumper/prelude_pch.h"
+#include "linker/module_linker.h"
+#include "linker/module_merger.h"
+#include "repr/ir_dumper.h"
 #include "utils/command_line_utils.h"
+#include "utils/hash_utils.h"
 #include "utils/header_abi_util.h"
+#include "utils/time_trace.h"
 
 #include <clang/Driver/Driver.h>
 #include <clang/Frontend/FrontendActions.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/JSONCompilationDatabase.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <atomic>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 #include <stdlib.h>
 
 
+using header_checker::dumper::DumpDependencies;
 using header_checker::dumper::FixedArgv;
 using header_checker::dumper::FixedArgvAccess;
 using header_checker::dumper::FixedArgvRegistry;
+using header_checker::dumper::GetDumpManifestPath;
 using header_checker::dumper::HeaderCheckerFrontendActionFactory;
 using header_checker::dumper::HeaderCheckerOptions;
+using header_checker::dumper::IsDumpUpToDate;
+using header_checker::dumper::WriteDumpManifest;
+using header_checker::linker::ModuleLinker;
+using header_checker::linker::ModuleMerger;
+using header_checker::repr::IRDumper;
+using header_checker::repr::ModuleIR;
 using header_checker::repr::TextFormatIR;
 using header_checker::utils::CollectAllExportedHeaders;
+using header_checker::utils::CompressionFormat;
 using header_checker::utils::GetCwd;
 using header_checker::utils::HideIrrelevantCommandLineOptions;
+using header_checker::utils::InitTimeTrace;
 using header_checker::utils::NormalizePath;
+using header_checker::utils::TimeTraceThread;
+using header_checker::utils::WriteTimeTrace;
 
 
 static llvm::cl::OptionCategory header_checker_category(
     "header-checker options");
 
-static llvm::cl::opt<std::string> header_file(
-    llvm::cl::Positional, llvm::cl::desc("<source.cpp>"), llvm::cl::Optional,
+static llvm::cl::list<std::string> source_files(
+    llvm::cl::Positional, llvm::cl::desc("<source.cpp>..."),
+    llvm::cl::ZeroOrMore, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::list<std::string> out_dumps(
+    "o", llvm::cl::value_desc("out_dump"), llvm::cl::ZeroOrMore,
+    llvm::cl::desc("Specify the reference dump file name. Specify one for "
+                   "each source file"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> output_dir(
+    "output-dir", llvm::cl::value_desc("output_dir"), llvm::cl::Optional,
+    llvm::cl::desc("Write the dump of each source file to "
+                   "<output_dir>/<source file relative to root dir>.sdump "
+                   "instead of -o"),
     llvm::cl::cat(header_checker_category));
 
-static llvm::cl::opt<std::string> out_dump(
-    "o", llvm::cl::value_desc("out_dump"), llvm::cl::Optional,
-    llvm::cl::desc("Specify the reference dump file name"),
+static llvm::cl::opt<std::string> compile_commands(
+    "compile-commands", llvm::cl::value_desc("compile_commands.json"),
+    llvm::cl::Optional,
+    llvm::cl::desc("Read the compiler flags from a compilation database "
+                   "instead of the arguments after \"--\". Dump all source "
+                   "files in the database if no source file is specified"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<unsigned> jobs(
+    "j", llvm::cl::desc("Number of source files to dump in parallel. Default "
+                        "to the number of CPUs"),
+    llvm::cl::init(0), llvm::cl::Optional,
     llvm::cl::cat(header_checker_category));
 
 static llvm::cl::list<std::string> exported_header_dirs(
@@ -69,6 +119,12 @@ static llvm::cl::opt<std::string> root_dir(
                    "relative to. Default to current working directory"),
     llvm::cl::Optional, llvm::cl::cat(header_checker_category));
 
+static llvm::cl::opt<std::string> exported_headers_cache(
+    "exported-headers-cache", llvm::cl::value_desc("cache_file"),
+    llvm::cl::desc("Cache the listings of the exported header directories in "
+                   "the file, which may be shared by several processes"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
 static llvm::cl::opt<bool> no_filter(
     "no-filter", llvm::cl::desc("Do not filter any abi"), llvm::cl::Optional,
     llvm::cl::cat(header_checker_category));
@@ -84,6 +140,99 @@ static llvm::cl::opt<bool> dump_function_declarations(
                    "file"),
     llvm::cl::Optional, llvm::cl::cat(header_checker_category));
 
+static llvm::cl::opt<std::string> abi_fragment_cache(
+    "abi-fragment-cache", llvm::cl::value_desc("cache_dir"),
+    llvm::cl::Optional,
+    llvm::cl::desc("Share the types defined in the headers among the dumps "
+                   "through the ABI fragments in this directory. The list of "
+                   "the fragments is written to <out_dump>.fragments"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<bool> incremental(
+    "incremental",
+    llvm::cl::desc("Record the flags and the files read by the compiler in "
+                   "<out_dump>.manifest. Skip the source file if they are "
+                   "unchanged since the last run"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<bool> stream_output(
+    "stream-output",
+    llvm::cl::desc("Write the ABI elements as soon as they are created instead "
+                   "of collecting them in memory. The elements are not sorted"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<CompressionFormat> compress(
+    "compress", llvm::cl::desc("Compress the output dumps"),
+    llvm::cl::values(clEnumValN(CompressionFormat::None, "none", "none"),
+                     clEnumValN(CompressionFormat::Gzip, "gzip", "gzip"),
+                     clEnumValN(CompressionFormat::Zstd, "zstd", "zstd")),
+    llvm::cl::init(CompressionFormat::None),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<bool> write_index(
+    "write-index",
+    llvm::cl::desc("Write <out_dump>.index, which lets header-abi-diff "
+                   "-use-index load only the types reachable from the "
+                   "exported symbols"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> prelude(
+    "prelude", llvm::cl::value_desc("prelude_header"), llvm::cl::Optional,
+    llvm::cl::desc("Precompile this header, which includes the headers common "
+                   "to the source files, and include the PCH in each source "
+                   "file"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> prelude_pch_dir(
+    "prelude-pch-dir", llvm::cl::value_desc("cache_dir"), llvm::cl::Optional,
+    llvm::cl::desc("Keep the PCH of -prelude in this directory, keyed by the "
+                   "compiler flags and the content of the prelude"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> linked_dump(
+    "linked-dump", llvm::cl::value_desc("linked_dump"), llvm::cl::Optional,
+    llvm::cl::desc("Merge the ABI of the source files in memory and write the "
+                   "dump filtered by -so or -v, instead of one dump for each "
+                   "source file"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> version_script(
+    "v", llvm::cl::desc("<version_script> for -linked-dump"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> so_file(
+    "so", llvm::cl::desc("<path to so file> for -linked-dump"),
+    llvm::cl::Optional, llvm::cl::cat(header_checker_category));
+
+static llvm::cl::list<std::string> excluded_symbol_versions(
+    "exclude-symbol-version", llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::list<std::string> excluded_symbol_tags(
+    "exclude-symbol-tag", llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> api(
+    "api", llvm::cl::desc("<api>"), llvm::cl::Optional,
+    llvm::cl::init("current"), llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> arch(
+    "arch", llvm::cl::desc("<arch>"), llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<std::string> time_trace(
+    "time-trace", llvm::cl::value_desc("trace_file"), llvm::cl::Optional,
+    llvm::cl::desc("Write the time spent in each phase to the file in Chrome "
+                   "trace event format"),
+    llvm::cl::cat(header_checker_category));
+
+static llvm::cl::opt<unsigned> time_trace_granularity(
+    "time-trace-granularity",
+    llvm::cl::desc("Minimum duration in microseconds of the spans recorded by "
+                   "-time-trace"),
+    llvm::cl::init(500), llvm::cl::Optional,
+    llvm::cl::cat(header_checker_category));
+
 static llvm::cl::opt<TextFormatIR> output_format(
     "output-format", llvm::cl::desc("Specify format of output dump file"),
     llvm::cl::values(clEnumValN(TextFormatIR::ProtobufTextFormat,
@@ -97,6 +246,37 @@ static llvm::cl::opt<bool> print_resource_dir(
     llvm::cl::desc("Print real path to default resource directory"),
     llvm::cl::Optional, llvm::cl::cat(header_checker_category));
 
+// Merges the modules of the source files as header-abi-linker merges the dumps,
+// and writes the linked dump.
+static int LinkModules(std::vector<std::unique_ptr<ModuleIR>> *modules,
+                       const std::set<std::string> &exported_headers,
+                       ModuleLinker *module_linker) {
+  ModuleMerger merger(&exported_headers);
+  for (auto &&module : *modules) {
+    llvm::TimeTraceScope scope("MergeGraphs");
+    merger.MergeGraphs(*module);
+    module.reset();
+  }
+
+  std::unique_ptr<ModuleIR> linked_module =
+      module_linker->Link(merger.TakeModule());
+  if (!linked_module) {
+    llvm::errs() << "ERROR: Failed to link the source files\n";
+    return 1;
+  }
+
+  llvm::TimeTraceScope scope("Dump", linked_dump);
+  std::unique_ptr<IRDumper> ir_dumper =
+      IRDumper::CreateIRDumper(output_format, linked_dump);
+  ir_dumper->SetCompression(compress);
+  ir_dumper->SetWriteIndex(write_index);
+  if (!ir_dumper->Dump(*linked_module)) {
+    llvm::errs() << "ERROR: Failed to write \"" << linked_dump << "\"\n";
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, const char **argv);
 
 static bool PrintResourceDir(const char *argv_0) {
@@ -110,6 +290,142 @@ static bool PrintResourceDir(const char *argv_0) {
   return true;
 }
 
+static std::string GetDumpPathInOutputDir(const std::string &source_file,
+                                          const std::string &root_dir) {
+  std::string relative_path = NormalizePath(source_file, root_dir);
+  llvm::SmallString<256> dump_path(output_dir);
+  llvm::sys::path::append(dump_path,
+                          llvm::sys::path::relative_path(relative_path));
+  dump_path += ".sdump";
+  return std::string(dump_path);
+}
+
+// Hashes the options that affect all dumps, including the dumper itself.
+static std::string ComputeOptionsHash(
+    const char *argv_0, const std::set<std::string> &exported_headers,
+    const std::string &root_dir, bool dump_exported_only) {
+  utils::HashBuilder hasher;
+  std::string program_path =
+      llvm::sys::fs::getMainExecutable(argv_0, (void *)main);
+  llvm::sys::fs::file_status status;
+  if (!program_path.empty() && !llvm::sys::fs::status(program_path, status)) {
+    hasher.Add(program_path);
+    hasher.Add(std::to_string(status.getSize()));
+    hasher.Add(std::to_string(
+        status.getLastModificationTime().time_since_epoch().count()));
+  }
+  for (auto &&header : exported_headers) {
+    hasher.Add(header);
+  }
+  hasher.Add(root_dir);
+  hasher.Add(std::to_string(dump_exported_only));
+  hasher.Add(std::to_string(dump_function_declarations));
+  hasher.Add(std::to_string(suppress_errors));
+  hasher.Add(std::to_string(static_cast<int>(output_format.getValue())));
+  hasher.Add(abi_fragment_cache);
+  hasher.Add(std::to_string(stream_output));
+  hasher.Add(std::to_string(static_cast<int>(compress.getValue())));
+  hasher.Add(std::to_string(write_index));
+  hasher.Add(prelude);
+  return hasher.Finish();
+}
+
+// Hashes the compile commands of the source file. The output and dependency
+// file arguments, which ClangTool removes as well, are excluded.
+static std::string ComputeFlagsHash(
+    const clang::tooling::CompilationDatabase &compilations,
+    const std::string &source_file, const std::string &options_hash) {
+  clang::tooling::ArgumentsAdjuster adjuster =
+      clang::tooling::combineAdjusters(
+          clang::tooling::getClangStripOutputAdjuster(),
+          clang::tooling::getClangStripDependencyFileAdjuster());
+  utils::HashBuilder hasher;
+  hasher.Add(options_hash);
+  for (auto &&command : compilations.getCompileCommands(source_file)) {
+    hasher.Add(command.Directory);
+    hasher.Add(command.Filename);
+    for (auto &&arg : adjuster(command.CommandLine, command.Filename)) {
+      hasher.Add(arg);
+    }
+  }
+  return hasher.Finish();
+}
+
+static int DumpSourceFile(
+    const clang::tooling::CompilationDatabase &compilations,
+    const std::string &source_file, const std::string &dump_path,
+    const std::set<std::string> &exported_headers,
+    const std::string &root_dir, bool dump_exported_only,
+    const std::string &options_hash, PreludePCHCache *prelude_pch,
+    std::unique_ptr<ModuleIR> *module) {
+  llvm::TimeTraceScope scope("DumpSourceFile", source_file);
+  // With -linked-dump, dump_path only names the module.
+  llvm::StringRef dump_dir =
+      module ? "" : llvm::sys::path::parent_path(dump_path);
+  if (!dump_dir.empty() && llvm::sys::fs::create_directories(dump_dir)) {
+    llvm::errs() << "ERROR: Failed to create directory \"" << dump_dir
+                 << "\"\n";
+    return 1;
+  }
+
+  HeaderCheckerOptions options(
+      NormalizePath(source_file, root_dir), dump_path, exported_headers,
+      root_dir, output_format, dump_exported_only, dump_function_declarations,
+      suppress_errors, abi_fragment_cache);
+  options.stream_output_ = stream_output;
+  options.compression_ = compress;
+  options.write_index_ = write_index;
+  options.output_module_ = module;
+
+  std::string flags_hash;
+  DumpDependencies dependencies;
+  if (incremental) {
+    flags_hash = ComputeFlagsHash(compilations, source_file, options_hash);
+    if (IsDumpUpToDate(dump_path, flags_hash)) {
+      return 0;
+    }
+    // The manifest is rewritten only if the dump succeeds.
+    llvm::sys::fs::remove(GetDumpManifestPath(dump_path));
+    options.dependencies_ = &dependencies;
+  }
+
+  // The linker reads the fragments in <dump>.fragments in addition to the
+  // dump. Remove the list left by a previous run, which may have used
+  // -abi-fragment-cache, before the dump is replaced.
+  if (!module) {
+    llvm::sys::fs::remove(dump_path + ".fragments");
+  }
+
+  // ClangTool changes the working directory of its file system. Give each tool
+  // a file system of its own, so that the threads do not interfere.
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> file_system(
+      llvm::vfs::createPhysicalFileSystem().release());
+  clang::tooling::ClangTool tool(
+      compilations, {source_file},
+      std::make_shared<clang::PCHContainerOperations>(), file_system);
+  if (prelude_pch) {
+    std::vector<std::string> pch_args;
+    if (!prelude_pch->GetIncludePCHArgs(compilations, source_file,
+                                        &pch_args)) {
+      return 1;
+    }
+    tool.appendArgumentsAdjuster(clang::tooling::getInsertArgumentAdjuster(
+        pch_args, clang::tooling::ArgumentInsertPosition::BEGIN));
+  }
+  HeaderCheckerFrontendActionFactory factory(options);
+  int result = tool.run(&factory);
+  if (result == 0 && options.failed_) {
+    result = 1;
+  }
+  if (incremental && result == 0 &&
+      !WriteDumpManifest(dump_path, flags_hash, dependencies)) {
+    llvm::errs() << "ERROR: Failed to write the manifest of \"" << dump_path
+                 << "\"\n";
+    return 1;
+  }
+  return result;
+}
+
 int main(int argc, const char **argv) {
   HideIrrelevantCommandLineOptions(header_checker_category);
 
@@ -140,19 +456,11 @@ int main(int argc, const char **argv) {
     ::exit(ok ? 0 : 1);
   }
 
-  // Check required arguments after handling -print-resource-dir.
-  if (header_file.empty()) {
-    llvm::errs() << "ERROR: Expect exactly one positional argument\n";
-    is_command_valid = false;
-  } else if (!llvm::sys::fs::exists(header_file)) {
-    llvm::errs() << "ERROR: Source file \"" << header_file
-                 << "\" is not found\n";
-    is_command_valid = false;
-  }
-
-  if (out_dump.empty()) {
-    llvm::errs() << "ERROR: Expect exactly one -o=<out_dump>\n";
-    is_command_valid = false;
+  if (!compile_commands.empty()) {
+    cmdline_error_msg.clear();
+    compilations = clang::tooling::JSONCompilationDatabase::loadFromFile(
+        compile_commands, cmdline_error_msg,
+        clang::tooling::JSONCommandLineSyntax::AutoDetect);
   }
 
   // Print an error message if we failed to create the compilation database
@@ -168,25 +476,163 @@ int main(int argc, const char **argv) {
     is_command_valid = false;
   }
 
+  std::vector<std::string> sources(source_files.begin(), source_files.end());
+  if (sources.empty() && compilations && !compile_commands.empty()) {
+    sources = compilations->getAllFiles();
+  }
+
+  // Check required arguments after handling -print-resource-dir.
+  if (sources.empty()) {
+    llvm::errs() << "ERROR: Expect at least one positional argument\n";
+    is_command_valid = false;
+  }
+  for (auto &&source : sources) {
+    if (!llvm::sys::fs::exists(source)) {
+      llvm::errs() << "ERROR: Source file \"" << source << "\" is not found\n";
+      is_command_valid = false;
+    }
+  }
+
+  if (!linked_dump.empty()) {
+    if (!out_dumps.empty() || !output_dir.empty()) {
+      llvm::errs() << "ERROR: -linked-dump cannot be used with -o or "
+                   << "-output-dir\n";
+      is_command_valid = false;
+    }
+    if (so_file.empty() && version_script.empty()) {
+      llvm::errs() << "ERROR: One of -so or -v needs to be specified with "
+                   << "-linked-dump\n";
+      is_command_valid = false;
+    }
+    // These options are about the dump of each source file.
+    if (!abi_fragment_cache.empty() || incremental || stream_output) {
+      llvm::errs() << "ERROR: -linked-dump cannot be used with "
+                   << "-abi-fragment-cache, -incremental, or -stream-output\n";
+      is_command_valid = false;
+    }
+  } else if (!output_dir.empty()) {
+    if (!out_dumps.empty()) {
+      llvm::errs() << "ERROR: -o and -output-dir are mutually exclusive\n";
+      is_command_valid = false;
+    }
+  } else if (out_dumps.size() != sources.size()) {
+    llvm::errs() << "ERROR: Expect exactly one -o=<out_dump> for each source "
+                 << "file\n";
+    is_command_valid = false;
+  }
+
+  // The ABI fragments are split from the ModuleIR after the traversal.
+  if (stream_output && !abi_fragment_cache.empty()) {
+    llvm::errs() << "ERROR: -stream-output and -abi-fragment-cache are "
+                 << "mutually exclusive\n";
+    is_command_valid = false;
+  }
+  // The index is built from the sorted elements of a ModuleIR.
+  if (stream_output && write_index) {
+    llvm::errs() << "ERROR: -stream-output and -write-index are mutually "
+                 << "exclusive\n";
+    is_command_valid = false;
+  }
+
+  if (prelude.empty() != prelude_pch_dir.empty()) {
+    llvm::errs() << "ERROR: -prelude and -prelude-pch-dir need to be specified "
+                 << "together\n";
+    is_command_valid = false;
+  }
+  // The dependencies and the headers in the PCH are not visible to the
+  // preprocessor callbacks that collect them.
+  if (!prelude.empty() && (!abi_fragment_cache.empty() || incremental)) {
+    llvm::errs() << "ERROR: -prelude cannot be used with -abi-fragment-cache "
+                 << "or -incremental\n";
+    is_command_valid = false;
+  }
+
   if (!is_command_valid) {
     ::exit(1);
   }
 
   const std::string root_dir_or_cwd = (root_dir.empty() ? GetCwd() : root_dir);
 
+  // The exported headers are collected once for all source files.
   bool dump_exported_only = (!no_filter && !exported_header_dirs.empty());
-  std::set<std::string> exported_headers =
-      CollectAllExportedHeaders(exported_header_dirs, root_dir_or_cwd);
+  const std::set<std::string> exported_headers =
+      CollectAllExportedHeaders(exported_header_dirs, root_dir_or_cwd,
+                                exported_headers_cache);
+
+  std::string options_hash;
+  if (incremental || !prelude.empty()) {
+    options_hash = ComputeOptionsHash(fixed_argv.GetArgv()[0],
+                                      exported_headers, root_dir_or_cwd,
+                                      dump_exported_only);
+  }
 
-  // Initialize clang tools and run front-end action.
-  std::vector<std::string> header_files{ header_file };
-  HeaderCheckerOptions options(
-      NormalizePath(header_file, root_dir_or_cwd), out_dump,
-      std::move(exported_headers), root_dir_or_cwd, output_format,
-      dump_exported_only, dump_function_declarations, suppress_errors);
-
-  clang::tooling::ClangTool tool(*compilations, header_files);
-  std::unique_ptr<clang::tooling::FrontendActionFactory> factory(
-      new HeaderCheckerFrontendActionFactory(options));
-  return tool.run(factory.get());
+  // With -linked-dump, the modules are kept in memory instead of being dumped.
+  std::vector<std::string> dump_paths(sources.size());
+  std::vector<std::unique_ptr<ModuleIR>> modules;
+  if (linked_dump.empty()) {
+    for (size_t i = 0; i < sources.size(); i++) {
+      dump_paths[i] = (output_dir.empty() ?
+                       out_dumps[i] :
+                       GetDumpPathInOutputDir(sources[i], root_dir_or_cwd));
+    }
+  } else {
+    modules.resize(sources.size());
+    // The modules are merged as if they were read from the dumps of the source
+    // files, which name the ODR violations.
+    for (size_t i = 0; i < sources.size(); i++) {
+      dump_paths[i] = NormalizePath(sources[i], root_dir_or_cwd) + ".sdump";
+    }
+  }
+
+  // Read the exported symbols before spending time on parsing.
+  const std::set<std::string> no_headers;
+  const std::set<std::string> &link_headers =
+      (dump_exported_only ? exported_headers : no_headers);
+  ModuleLinker module_linker(link_headers, version_script, so_file, arch, api,
+                             excluded_symbol_versions, excluded_symbol_tags);
+  if (!linked_dump.empty() && !module_linker.ReadExportedSymbols()) {
+    return 1;
+  }
+
+  std::unique_ptr<PreludePCHCache> prelude_pch;
+  if (!prelude.empty()) {
+    llvm::SmallString<256> prelude_path(prelude);
+    llvm::sys::fs::make_absolute(prelude_path);
+    prelude_pch = std::make_unique<PreludePCHCache>(
+        std::string(prelude_path), prelude_pch_dir, options_hash);
+  }
+
+  InitTimeTrace(time_trace, time_trace_granularity, fixed_argv.GetArgv()[0]);
+
+  auto dump_source_file = [&](size_t i) {
+    return DumpSourceFile(*compilations, sources[i], dump_paths[i],
+                          exported_headers, root_dir_or_cwd,
+                          dump_exported_only, options_hash, prelude_pch.get(),
+                          modules.empty() ? nullptr : &modules[i]);
+  };
+
+  // Each task runs its own ClangTool, which creates a CompilerInstance for the
+  // source file.
+  std::atomic<int> result(0);
+  if (sources.size() == 1) {
+    result = dump_source_file(0);
+  } else {
+    llvm::ThreadPool thread_pool(llvm::heavyweight_hardware_concurrency(jobs));
+    for (size_t i = 0; i < sources.size(); i++) {
+      thread_pool.async([&, i]() {
+        TimeTraceThread time_trace_thread;
+        if (dump_source_file(i)) {
+          result = 1;
+        }
+      });
+    }
+    thread_pool.wait();
+  }
+  if (result == 0 && !modules.empty()) {
+    result = LinkModules(&modules, link_headers, &module_linker);
+  }
+  if (!WriteTimeTrace()) {
+    result = 1;
+  }
+  return result;
 }
@@ -15,8 +15,11 @@
 #ifndef HEADER_CHECKER_H_
 #define HEADER_CHECKER_H_
 
+#include "dumper/dump_manifest.h"
 #include "repr/ir_representation.h"
+#include "utils/compressed_file.h"
 
+#include <memory>
 #include <set>
 #include <string>
 
@@ -29,25 +32,44 @@ class HeaderCheckerOptions {
  public:
   std::string source_file_;
   std::string dump_name_;
-  const std::set<std::string> exported_headers_;
+  // The exported headers are shared by the sources dumped in one invocation.
+  const std::set<std::string> &exported_headers_;
   const std::string root_dir_;
   repr::TextFormatIR text_format_;
   const bool dump_exported_only_;
   bool dump_function_declarations_;
   bool suppress_errors_;
+  // If not empty, the types defined in the headers are written to ABI
+  // fragments in this directory.
+  std::string abi_fragment_cache_dir_;
+  // Whether the elements are written as soon as they are created instead of
+  // being collected in a ModuleIR.
+  bool stream_output_ = false;
+  utils::CompressionFormat compression_ = utils::CompressionFormat::None;
+  // Whether <dump>.index is written with the dump.
+  bool write_index_ = false;
+  // If not nullptr, the files read by the compiler are recorded.
+  DumpDependencies *dependencies_ = nullptr;
+  // If not nullptr, the module is moved here instead of being dumped.
+  std::unique_ptr<repr::ModuleIR> *output_module_ = nullptr;
+  // Set if the ABI cannot be extracted or written. The compiler does not
+  // report the failure, so the caller checks it after running the tool.
+  bool failed_ = false;
 
  public:
   HeaderCheckerOptions(std::string source_file, std::string dump_name,
-                       std::set<std::string> exported_headers,
+                       const std::set<std::string> &exported_headers,
                        std::string root_dir, repr::TextFormatIR text_format,
                        bool dump_exported_only,
-                       bool dump_function_declarations, bool suppress_errors)
+                       bool dump_function_declarations, bool suppress_errors,
+                       std::string abi_fragment_cache_dir)
       : source_file_(std::move(source_file)), dump_name_(std::move(dump_name)),
-        exported_headers_(std::move(exported_headers)),
+        exported_headers_(exported_headers),
         root_dir_(std::move(root_dir)), text_format_(text_format),
         dump_exported_only_(dump_exported_only),
         dump_function_declarations_(dump_function_declarations),
-        suppress_errors_(suppress_errors) {}
+        suppress_errors_(suppress_errors),
+        abi_fragment_cache_dir_(std::move(abi_fragment_cache_dir)) {}
 };
 
 
@@ -0,0 +1,44 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dumper/ir_sink.h"
+
+
+namespace header_checker {
+namespace dumper {
+
+
+bool StreamingIRSink::AddLinkableMessage(const repr::LinkableMessageIR &lm) {
+  bool is_new;
+  switch (lm.GetKind()) {
+    case repr::FunctionKind:
+      is_new = function_keys_.insert(lm.GetLinkerSetKey()).second;
+      break;
+    case repr::GlobalVarKind:
+      is_new = global_var_keys_.insert(lm.GetLinkerSetKey()).second;
+      break;
+    default:
+      is_new = type_ids_.insert(
+          static_cast<const repr::TypeIR &>(lm).GetSelfType()).second;
+      break;
+  }
+  if (!is_new) {
+    return true;
+  }
+  return ir_dumper_->StreamLinkableMessage(lm);
+}
+
+
+}  // namespace dumper
+}  // namespace header_checker
@@ -0,0 +1,73 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IR_SINK_H_
+#define IR_SINK_H_
+
+#include "repr/ir_dumper.h"
+#include "repr/ir_representation.h"
+
+#include <llvm/ADT/StringSet.h>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+// The ABI wrappers add the elements they create to an IRSink.
+class IRSink {
+ public:
+  virtual ~IRSink() {}
+
+  virtual bool AddLinkableMessage(const repr::LinkableMessageIR &lm) = 0;
+};
+
+
+// This class collects the elements in a ModuleIR, which is dumped after the
+// whole translation unit is traversed.
+class ModuleIRSink : public IRSink {
+ public:
+  ModuleIRSink(repr::ModuleIR *module) : module_(module) {}
+
+  bool AddLinkableMessage(const repr::LinkableMessageIR &lm) override {
+    return module_->AddLinkableMessage(lm);
+  }
+
+ private:
+  repr::ModuleIR *module_;
+};
+
+
+// This class writes each element to the IRDumper as soon as it is created.
+// As in ModuleIR, the first element with a type id or a linker set key wins.
+class StreamingIRSink : public IRSink {
+ public:
+  // The caller calls BeginStream() and EndStream() on the dumper.
+  StreamingIRSink(repr::IRDumper *ir_dumper) : ir_dumper_(ir_dumper) {}
+
+  bool AddLinkableMessage(const repr::LinkableMessageIR &lm) override;
+
+ private:
+  repr::IRDumper *ir_dumper_;
+  llvm::StringSet<> type_ids_;
+  llvm::StringSet<> function_keys_;
+  llvm::StringSet<> global_var_keys_;
+};
+
+
+}  // namespace dumper
+}  // namespace header_checker
+
+
+#endif  // IR_SINK_H_
@@ -0,0 +1,206 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dumper/prelude_pch.h"
+
+#include "dumper/dump_manifest.h"
+#include "utils/hash_utils.h"
+
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
+#include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+namespace {
+
+
+// GeneratePCHAction writes the PCH to the output file of the compiler
+// instance, which ClangTool strips from the arguments.
+class PreludePCHAction : public clang::GeneratePCHAction {
+ public:
+  PreludePCHAction(const std::string &pch_path, DumpDependencies *dependencies)
+      : pch_path_(pch_path), dependencies_(dependencies) {}
+
+ protected:
+  bool BeginInvocation(clang::CompilerInstance &ci) override {
+    ci.getFrontendOpts().OutputFile = pch_path_;
+    return clang::GeneratePCHAction::BeginInvocation(ci);
+  }
+
+  void EndSourceFileAction() override {
+    clang::GeneratePCHAction::EndSourceFileAction();
+    CollectDependencies(getCompilerInstance(), dependencies_);
+  }
+
+ private:
+  const std::string &pch_path_;
+  DumpDependencies *dependencies_;
+};
+
+
+class PreludePCHActionFactory : public clang::tooling::FrontendActionFactory {
+ public:
+  PreludePCHActionFactory(const std::string &pch_path,
+                          DumpDependencies *dependencies)
+      : pch_path_(pch_path), dependencies_(dependencies) {}
+
+  std::unique_ptr<clang::FrontendAction> create() override {
+    return std::make_unique<PreludePCHAction>(pch_path_, dependencies_);
+  }
+
+ private:
+  const std::string &pch_path_;
+  DumpDependencies *dependencies_;
+};
+
+
+}  // namespace
+
+
+static std::string MakeAbsolute(const std::string &path,
+                                const std::string &directory) {
+  llvm::SmallString<256> absolute_path(path);
+  llvm::sys::fs::make_absolute(directory, absolute_path);
+  llvm::sys::path::remove_dots(absolute_path, true);
+  return std::string(absolute_path);
+}
+
+// Returns the compiler flags of the command without the program name, the
+// source file, and the output arguments.
+static std::vector<std::string> GetPreludeFlags(
+    const clang::tooling::CompileCommand &command) {
+  clang::tooling::ArgumentsAdjuster adjuster =
+      clang::tooling::combineAdjusters(
+          clang::tooling::getClangStripOutputAdjuster(),
+          clang::tooling::getClangStripDependencyFileAdjuster());
+  clang::tooling::CommandLineArguments args =
+      adjuster(command.CommandLine, command.Filename);
+  const std::string source_path =
+      MakeAbsolute(command.Filename, command.Directory);
+  std::vector<std::string> flags;
+  // The prelude is a header in the language of the source file.
+  flags.emplace_back("-x");
+  flags.emplace_back(llvm::sys::path::extension(command.Filename) == ".c" ?
+                     "c-header" : "c++-header");
+  for (size_t i = 1; i < args.size(); i++) {
+    if (args[i] == "--") {
+      break;
+    }
+    if (MakeAbsolute(args[i], command.Directory) == source_path) {
+      continue;
+    }
+    flags.emplace_back(args[i]);
+  }
+  return flags;
+}
+
+
+bool PreludePCHCache::GetIncludePCHArgs(
+    const clang::tooling::CompilationDatabase &compilations,
+    const std::string &source_file, std::vector<std::string> *args) {
+  std::vector<clang::tooling::CompileCommand> commands =
+      compilations.getCompileCommands(source_file);
+  if (commands.empty()) {
+    llvm::errs() << "ERROR: No compile command for \"" << source_file
+                 << "\"\n";
+    return false;
+  }
+  const clang::tooling::CompileCommand &command = commands.front();
+  std::vector<std::string> flags = GetPreludeFlags(command);
+
+  auto prelude_content = llvm::sys::fs::md5_contents(prelude_);
+  if (!prelude_content) {
+    llvm::errs() << "ERROR: Failed to read \"" << prelude_ << "\"\n";
+    return false;
+  }
+  utils::HashBuilder hasher;
+  hasher.Add(tool_hash_);
+  hasher.Add(command.Directory);
+  for (auto &&flag : flags) {
+    hasher.Add(flag);
+  }
+  hasher.Add(prelude_);
+  hasher.Add(prelude_content->digest());
+  std::string key = hasher.Finish();
+
+  llvm::SmallString<256> pch_path(cache_dir_);
+  llvm::sys::path::append(pch_path, key + ".pch");
+
+  {
+    std::lock_guard<std::mutex> lock(build_mutex_);
+    auto it = build_results_.find(key);
+    if (it == build_results_.end()) {
+      bool ok = IsDumpUpToDate(std::string(pch_path), key) ||
+                BuildPCH(command, flags, std::string(pch_path), key);
+      it = build_results_.emplace(key, ok).first;
+    }
+    if (!it->second) {
+      return false;
+    }
+  }
+
+  args->assign({"-include-pch", std::string(pch_path),
+                "-fpch-validate-input-files-content"});
+  return true;
+}
+
+bool PreludePCHCache::BuildPCH(const clang::tooling::CompileCommand &command,
+                               const std::vector<std::string> &flags,
+                               const std::string &pch_path,
+                               const std::string &key) {
+  llvm::TimeTraceScope scope("BuildPreludePCH", prelude_);
+  if (llvm::sys::fs::create_directories(cache_dir_)) {
+    llvm::errs() << "ERROR: Failed to create directory \"" << cache_dir_
+                 << "\"\n";
+    return false;
+  }
+  // The manifest is rewritten only if the PCH is built.
+  llvm::sys::fs::remove(GetDumpManifestPath(pch_path));
+
+  clang::tooling::FixedCompilationDatabase compilations(command.Directory,
+                                                        flags);
+  llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> file_system(
+      llvm::vfs::createPhysicalFileSystem().release());
+  clang::tooling::ClangTool tool(
+      compilations, {MakeAbsolute(prelude_, command.Directory)},
+      std::make_shared<clang::PCHContainerOperations>(), file_system);
+  DumpDependencies dependencies;
+  PreludePCHActionFactory factory(pch_path, &dependencies);
+  if (tool.run(&factory) != 0) {
+    llvm::errs() << "ERROR: Failed to precompile \"" << prelude_ << "\"\n";
+    return false;
+  }
+  if (!WriteDumpManifest(pch_path, key, dependencies)) {
+    llvm::errs() << "ERROR: Failed to write the manifest of \"" << pch_path
+                 << "\"\n";
+    return false;
+  }
+  return true;
+}
+
+
+}  // namespace dumper
+}  // namespace header_checker
@@ -0,0 +1,69 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PRELUDE_PCH_H_
+#define PRELUDE_PCH_H_
+
+#include <clang/Tooling/CompilationDatabase.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace dumper {
+
+
+// This class precompiles a prelude header, which includes the headers common
+// to the source files, with the compiler flags of each source file. The PCH is
+// written to <cache_dir>/<key>.pch, where the key is the hash of the tool,
+// the flags, and the path and the content of the prelude. The contents of all
+// headers read by the PCH are recorded in <key>.pch.manifest, so that a PCH
+// is rebuilt when any of them changes.
+class PreludePCHCache {
+ public:
+  // tool_hash identifies the dumper executable and its options.
+  PreludePCHCache(const std::string &prelude, const std::string &cache_dir,
+                  const std::string &tool_hash)
+      : prelude_(prelude), cache_dir_(cache_dir), tool_hash_(tool_hash) {}
+
+  // Returns the compiler arguments that include the PCH for the source file.
+  // The PCH is built if it is not in the cache. Returns false on failure.
+  bool GetIncludePCHArgs(
+      const clang::tooling::CompilationDatabase &compilations,
+      const std::string &source_file, std::vector<std::string> *args);
+
+ private:
+  bool BuildPCH(const clang::tooling::CompileCommand &command,
+                const std::vector<std::string> &flags,
+                const std::string &pch_path, const std::string &key);
+
+ private:
+  const std::string prelude_;
+  const std::string cache_dir_;
+  const std::string tool_hash_;
+  // The source files with the same flags share a PCH, which is built or
+  // validated once. The mutex is held while the PCH is being built.
+  std::mutex build_mutex_;
+  std::map<std::string, bool> build_results_;
+};
+
+
+}  // namespace dumper
+}  // namespace header_checker
+
+
+#endif  // PRELUDE_PCH_H_
@@ -0,0 +1,193 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "generator/synthetic_module.h"
+#include "repr/ir_dumper.h"
+#include "repr/ir_representation.h"
+#include "utils/command_line_utils.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+
+using namespace header_checker;
+using header_checker::generator::SyntheticModuleGenerator;
+using header_checker::generator::SyntheticModuleOptions;
+using header_checker::repr::IRDumper;
+using header_checker::repr::TextFormatIR;
+using header_checker::utils::HideIrrelevantCommandLineOptions;
+
+
+static llvm::cl::OptionCategory header_generator_category(
+    "header-abi-dump-generator options");
+
+static llvm::cl::opt<std::string> output_dir(
+    "o", llvm::cl::desc("Write the dumps of the translation units to "
+                        "<dir>/tu<index>.sdump"),
+    llvm::cl::value_desc("dir"), llvm::cl::Optional,
+    llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<std::string> linked_dump(
+    "linked-dump", llvm::cl::desc("Write the dump of the library"),
+    llvm::cl::value_desc("file"), llvm::cl::Optional,
+    llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<std::string> version_script(
+    "version-script",
+    llvm::cl::desc("Write a version script that exports the symbols of the "
+                   "library"),
+    llvm::cl::value_desc("file"), llvm::cl::Optional,
+    llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<TextFormatIR> output_format(
+    "output-format", llvm::cl::desc("Specify format of output dump files"),
+    llvm::cl::values(clEnumValN(TextFormatIR::ProtobufTextFormat,
+                                "ProtobufTextFormat", "ProtobufTextFormat"),
+                     clEnumValN(TextFormatIR::Json, "Json", "JSON")),
+    llvm::cl::init(TextFormatIR::Json),
+    llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint64_t> seed(
+    "seed", llvm::cl::desc("The seed of the pseudo-random choices"),
+    llvm::cl::init(1), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> num_translation_units(
+    "num-translation-units",
+    llvm::cl::desc("The number of translation units"), llvm::cl::init(10),
+    llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> num_records(
+    "num-records",
+    llvm::cl::desc("The number of records, excluding the template "
+                   "instantiations"),
+    llvm::cl::init(1000), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> records_per_header(
+    "records-per-header", llvm::cl::desc("The number of records in a header"),
+    llvm::cl::init(50), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> headers_per_translation_unit(
+    "headers-per-translation-unit",
+    llvm::cl::desc("The number of headers that a translation unit includes "
+                   "in addition to its own"),
+    llvm::cl::init(5), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> record_depth(
+    "record-depth",
+    llvm::cl::desc("The maximum depth of the records nested by value"),
+    llvm::cl::init(3), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> template_fan_out(
+    "template-fan-out",
+    llvm::cl::desc("The number of instantiations of every 8th record, which "
+                   "is a class template"),
+    llvm::cl::init(0), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<uint32_t> vtable_size(
+    "vtable-size",
+    llvm::cl::desc("The number of virtual functions of every 4th record"),
+    llvm::cl::init(0), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<double> odr_duplicate_ratio(
+    "odr-duplicate-ratio",
+    llvm::cl::desc("The ratio of the records that are defined differently in "
+                   "the odd translation units"),
+    llvm::cl::init(0.0), llvm::cl::cat(header_generator_category));
+
+static llvm::cl::opt<double> mutation_rate(
+    "mutation-rate",
+    llvm::cl::desc("The ratio of the records that have an ABI-breaking "
+                   "change"),
+    llvm::cl::init(0.0), llvm::cl::cat(header_generator_category));
+
+
+static bool DumpModule(const repr::ModuleIR &module, const std::string &path) {
+  std::unique_ptr<IRDumper> dumper =
+      IRDumper::CreateIRDumper(output_format, path);
+  if (!dumper || !dumper->Dump(module)) {
+    llvm::errs() << "Failed to write " << path << "\n";
+    return false;
+  }
+  return true;
+}
+
+
+int main(int argc, const char **argv) {
+  HideIrrelevantCommandLineOptions(header_generator_category);
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv, "header-abi-dump-generator\n\n"
+      "Generates the dumps of a synthetic library for load testing "
+      "header-abi-linker and header-abi-diff.\n");
+
+  if (output_dir.empty() && linked_dump.empty() && version_script.empty()) {
+    llvm::errs() << "One of -o, -linked-dump, or -version-script needs to be "
+                    "specified\n";
+    return -1;
+  }
+
+  SyntheticModuleOptions options;
+  options.seed_ = seed;
+  options.num_records_ = num_records;
+  options.records_per_header_ = records_per_header;
+  options.num_translation_units_ = num_translation_units;
+  options.headers_per_translation_unit_ = headers_per_translation_unit;
+  options.record_depth_ = record_depth;
+  options.template_fan_out_ = template_fan_out;
+  options.vtable_size_ = vtable_size;
+  options.odr_duplicate_ratio_ = odr_duplicate_ratio;
+  options.mutation_rate_ = mutation_rate;
+  SyntheticModuleGenerator generator(options);
+
+  if (!output_dir.empty()) {
+    if (std::error_code ec = llvm::sys::fs::create_directories(output_dir)) {
+      llvm::errs() << "Failed to create " << output_dir << ": "
+                   << ec.message() << "\n";
+      return -1;
+    }
+    for (uint32_t i = 0; i < num_translation_units; i++) {
+      llvm::SmallString<256> path(output_dir);
+      llvm::sys::path::append(path, "tu" + std::to_string(i) + ".sdump");
+      if (!DumpModule(*generator.GenerateTranslationUnit(i),
+                      std::string(path))) {
+        return -1;
+      }
+    }
+  }
+
+  if (!linked_dump.empty() &&
+      !DumpModule(*generator.GenerateLinkedModule(), linked_dump)) {
+    return -1;
+  }
+
+  if (!version_script.empty()) {
+    std::ofstream output(version_script);
+    output << generator.GenerateVersionScript();
+    if (!output.flush()) {
+      llvm::errs() << "Failed to write " << version_script << "\n";
+      return -1;
+    }
+  }
+
+  llvm::outs() << "Generated " << generator.GetNumRecords() << " records, "
+               << generator.GetNumOdrVariants() << " ODR variants, and "
+               << generator.GetNumMutations() << " mutations\n";
+  return 0;
+}
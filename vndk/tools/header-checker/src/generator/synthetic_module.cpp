@@ -0,0 +1,578 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "generator/synthetic_module.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+
+namespace header_checker {
+namespace generator {
+
+
+static const char kIntTypeId[] = "_ZTIi";
+static const char kLongTypeId[] = "_ZTIl";
+
+static const uint32_t kTemplateInterval = 8;
+static const uint32_t kDynamicInterval = 4;
+
+
+// SplitMix64. std::mt19937_64 would do, but the distributions in <random> are
+// implementation-defined, and the dumps must not depend on the host.
+class Random {
+ public:
+  Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // Returns a number in [0, bound).
+  uint32_t Uniform(uint32_t bound) {
+    return bound == 0 ? 0 : static_cast<uint32_t>(Next() % bound);
+  }
+
+  // Returns a number in [0, 1).
+  double NextDouble() {
+    return (Next() >> 11) / static_cast<double>(1ULL << 53);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+
+enum class Mutation {
+  None,
+  // Appends a field.
+  AddField,
+  // Changes the type of the first int field to long.
+  ChangeFieldType,
+  // Removes the last virtual function, or appends a field if the record is
+  // not dynamic.
+  RemoveVirtualFunction,
+  // Removes the function whose parameter is the record, and its symbol.
+  RemoveFunction,
+};
+
+static const uint32_t kNumMutations = 4;
+
+
+struct SyntheticRecord {
+  std::string name_;
+  // The name in the Itanium mangling, e.g., "7Record3" or "7Record7I7Record3E".
+  std::string mangled_name_;
+  uint32_t header_ = 0;
+  uint32_t level_ = 0;
+  uint32_t num_int_fields_ = 0;
+  // The records that are the fields of this record by value.
+  std::vector<uint32_t> record_fields_;
+  // The records that the pointer fields point to.
+  std::vector<uint32_t> pointer_fields_;
+  // The argument of a class template instantiation.
+  bool is_template_instance_ = false;
+  uint32_t template_argument_ = 0;
+  bool is_dynamic_ = false;
+  bool is_odr_variant_ = false;
+  Mutation mutation_ = Mutation::None;
+  // The size and the alignment of the definition without ODR variation or
+  // mutation, in bytes.
+  uint64_t size_ = 0;
+  uint32_t alignment_ = 0;
+
+  std::string GetTypeId() const {
+    return "_ZTI" + mangled_name_;
+  }
+
+  std::string GetPointerTypeId() const {
+    return "_ZTIP" + mangled_name_;
+  }
+
+  std::string GetVTableSymbol() const {
+    return "_ZTV" + mangled_name_;
+  }
+
+  std::string GetVirtualFunctionSymbol(uint32_t index) const {
+    std::string name = "Virtual" + std::to_string(index);
+    return "_ZN" + mangled_name_ + std::to_string(name.size()) + name + "Ev";
+  }
+
+  std::string GetFunctionName() const {
+    return "Use" + name_;
+  }
+
+  std::string GetFunctionSymbol() const {
+    std::string name = GetFunctionName();
+    // Template arguments in a function name are substitutions in the real
+    // mangling. The symbols only need to be unique.
+    std::string mangled_name = std::to_string(name.size()) + name;
+    std::replace(mangled_name.begin(), mangled_name.end(), '<', '_');
+    std::replace(mangled_name.begin(), mangled_name.end(), '>', '_');
+    return "_Z" + mangled_name + "P" + mangled_name_;
+  }
+};
+
+
+static std::string MangleName(const std::string &name) {
+  return std::to_string(name.size()) + name;
+}
+
+static uint64_t AlignTo(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Lays out the fields of the record and returns them. The offsets are in bits
+// and the size is in bytes, as in the dumps. The records that contain an ODR
+// variant or a mutated record by value keep their layout, so the differences
+// are confined to the chosen records.
+static std::vector<repr::RecordFieldIR> LayoutRecord(
+    const std::vector<SyntheticRecord> &records, const SyntheticRecord &record,
+    bool odr_variant, bool apply_mutation, uint64_t *size,
+    uint32_t *alignment) {
+  std::vector<repr::RecordFieldIR> fields;
+  uint64_t offset = 0;
+  uint32_t max_alignment = 1;
+  auto add_field = [&](const std::string &name, const std::string &type,
+                       uint64_t field_size, uint32_t field_alignment) {
+    offset = AlignTo(offset, field_alignment * 8);
+    fields.emplace_back(name, type, offset,
+                        repr::AccessSpecifierIR::PublicAccess);
+    offset += field_size * 8;
+    max_alignment = std::max(max_alignment, field_alignment);
+  };
+
+  if (record.is_dynamic_) {
+    // The vtable pointer.
+    offset = 64;
+    max_alignment = 8;
+  }
+  const Mutation mutation = apply_mutation ? record.mutation_ : Mutation::None;
+  for (uint32_t i = 0; i < record.num_int_fields_; i++) {
+    if (i == 0 && mutation == Mutation::ChangeFieldType) {
+      add_field("int_field0", kLongTypeId, 8, 8);
+    } else {
+      add_field("int_field" + std::to_string(i), kIntTypeId, 4, 4);
+    }
+  }
+  for (size_t i = 0; i < record.record_fields_.size(); i++) {
+    const SyntheticRecord &field_record = records[record.record_fields_[i]];
+    add_field("record_field" + std::to_string(i), field_record.GetTypeId(),
+              field_record.size_, field_record.alignment_);
+  }
+  for (size_t i = 0; i < record.pointer_fields_.size(); i++) {
+    const SyntheticRecord &pointee = records[record.pointer_fields_[i]];
+    add_field("pointer_field" + std::to_string(i), pointee.GetPointerTypeId(),
+              8, 8);
+  }
+  if (odr_variant) {
+    add_field("odr_field", kIntTypeId, 4, 4);
+  }
+  if (mutation == Mutation::AddField) {
+    add_field("added_field", kIntTypeId, 4, 4);
+  }
+
+  *alignment = max_alignment;
+  *size = std::max<uint64_t>(AlignTo(offset, max_alignment * 8) / 8, 1);
+  return fields;
+}
+
+
+SyntheticModuleGenerator::SyntheticModuleGenerator(
+    const SyntheticModuleOptions &options)
+    : options_(options) {
+  PlanRecords();
+}
+
+
+SyntheticModuleGenerator::~SyntheticModuleGenerator() {}
+
+
+uint32_t SyntheticModuleGenerator::GetNumRecords() const {
+  return records_.size();
+}
+
+
+void SyntheticModuleGenerator::PlanRecords() {
+  Random random(options_.seed_);
+  // The mutations are drawn from another sequence, so that the same records
+  // are generated with any mutation rate.
+  Random mutation_random(options_.seed_ ^ 0x5deece66dULL);
+  const uint32_t records_per_header =
+      std::max<uint32_t>(options_.records_per_header_, 1);
+  num_headers_ =
+      (options_.num_records_ + records_per_header - 1) / records_per_header;
+
+  std::vector<std::vector<uint32_t>> records_by_level(
+      options_.record_depth_ + 1);
+
+  auto finish_record = [&](SyntheticRecord &&record) {
+    record.is_odr_variant_ =
+        random.NextDouble() < options_.odr_duplicate_ratio_;
+    if (record.is_odr_variant_) {
+      num_odr_variants_++;
+    }
+    bool mutated = mutation_random.NextDouble() < options_.mutation_rate_;
+    Mutation mutation = static_cast<Mutation>(
+        1 + mutation_random.Uniform(kNumMutations));
+    if (mutation == Mutation::RemoveVirtualFunction && !record.is_dynamic_) {
+      mutation = Mutation::AddField;
+    }
+    if (mutated) {
+      record.mutation_ = mutation;
+      num_mutations_++;
+    }
+    LayoutRecord(records_, record, false, false, &record.size_,
+                 &record.alignment_);
+    records_by_level[record.level_].push_back(records_.size());
+    records_.emplace_back(std::move(record));
+  };
+
+  for (uint32_t i = 0; i < options_.num_records_; i++) {
+    const std::string name = "Record" + std::to_string(i);
+    const uint32_t header = i / records_per_header;
+    const bool is_dynamic =
+        options_.vtable_size_ > 0 && i % kDynamicInterval == 0;
+
+    if (options_.template_fan_out_ > 0 && i % kTemplateInterval == 0 &&
+        !records_.empty()) {
+      // The instantiations point to their arguments and have no records by
+      // value.
+      for (uint32_t j = 0; j < options_.template_fan_out_; j++) {
+        SyntheticRecord record;
+        record.template_argument_ = random.Uniform(records_.size());
+        const SyntheticRecord &argument = records_[record.template_argument_];
+        record.name_ = name + "<" + argument.name_ + ">";
+        record.mangled_name_ =
+            MangleName(name) + "I" + argument.mangled_name_ + "E";
+        record.header_ = header;
+        record.is_template_instance_ = true;
+        record.is_dynamic_ = is_dynamic;
+        record.num_int_fields_ = 1 + random.Uniform(2);
+        record.pointer_fields_.push_back(record.template_argument_);
+        finish_record(std::move(record));
+      }
+      continue;
+    }
+
+    SyntheticRecord record;
+    record.name_ = name;
+    record.mangled_name_ = MangleName(name);
+    record.header_ = header;
+    record.is_dynamic_ = is_dynamic;
+    // A record can only contain the records at the lower level, so the level
+    // is lowered until there are such records.
+    uint32_t level = random.Uniform(options_.record_depth_ + 1);
+    while (level > 0 && records_by_level[level - 1].empty()) {
+      level--;
+    }
+    record.level_ = level;
+    record.num_int_fields_ = 1 + random.Uniform(3);
+    if (level > 0) {
+      const std::vector<uint32_t> &candidates = records_by_level[level - 1];
+      uint32_t num_record_fields = 1 + random.Uniform(2);
+      for (uint32_t j = 0; j < num_record_fields; j++) {
+        record.record_fields_.push_back(
+            candidates[random.Uniform(candidates.size())]);
+      }
+    }
+    uint32_t num_pointer_fields = random.Uniform(3);
+    for (uint32_t j = 0; j < num_pointer_fields && !records_.empty(); j++) {
+      record.pointer_fields_.push_back(random.Uniform(records_.size()));
+    }
+    finish_record(std::move(record));
+  }
+}
+
+
+std::vector<uint32_t> SyntheticModuleGenerator::GetReachableRecords(
+    const std::vector<uint32_t> &records) {
+  std::vector<bool> visited(records_.size(), false);
+  std::vector<uint32_t> stack;
+  auto visit = [&](uint32_t index) {
+    if (!visited[index]) {
+      visited[index] = true;
+      stack.push_back(index);
+    }
+  };
+  for (uint32_t index : records) {
+    visit(index);
+  }
+  while (!stack.empty()) {
+    const SyntheticRecord &record = records_[stack.back()];
+    stack.pop_back();
+    for (uint32_t field : record.record_fields_) {
+      visit(field);
+    }
+    for (uint32_t pointee : record.pointer_fields_) {
+      visit(pointee);
+    }
+  }
+
+  std::vector<uint32_t> result;
+  for (uint32_t i = 0; i < visited.size(); i++) {
+    if (visited[i]) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+
+void SyntheticModuleGenerator::AddBuiltinTypes(repr::ModuleIR *module) {
+  auto add_builtin_type = [module](const std::string &name,
+                                   const std::string &id, uint64_t size) {
+    repr::BuiltinTypeIR builtin_type;
+    builtin_type.SetName(name);
+    builtin_type.SetSelfType(id);
+    builtin_type.SetReferencedType(id);
+    builtin_type.SetLinkerSetKey(id);
+    builtin_type.SetSize(size);
+    builtin_type.SetAlignment(size);
+    builtin_type.SetSignedness(false);
+    builtin_type.SetIntegralType(true);
+    module->AddBuiltinType(std::move(builtin_type));
+  };
+  add_builtin_type("int", kIntTypeId, 4);
+  add_builtin_type("long", kLongTypeId, 8);
+}
+
+
+static std::string GetHeaderPath(uint32_t header) {
+  return "include/header" + std::to_string(header) + ".h";
+}
+
+
+static uint32_t GetNumVirtualFunctions(const SyntheticRecord &record,
+                                       uint32_t vtable_size) {
+  if (!record.is_dynamic_) {
+    return 0;
+  }
+  if (record.mutation_ == Mutation::RemoveVirtualFunction) {
+    return vtable_size - 1;
+  }
+  return vtable_size;
+}
+
+
+void SyntheticModuleGenerator::AddRecord(repr::ModuleIR *module,
+                                         uint32_t index, bool odr_variant) {
+  const SyntheticRecord &record = records_[index];
+  const std::string type_id = record.GetTypeId();
+  const std::string source_file = GetHeaderPath(record.header_);
+  const uint32_t num_virtual_functions =
+      GetNumVirtualFunctions(record, options_.vtable_size_);
+
+  repr::RecordTypeIR record_type;
+  uint64_t size = 0;
+  uint32_t alignment = 0;
+  record_type.SetRecordFields(
+      LayoutRecord(records_, record, odr_variant, true, &size, &alignment));
+  record_type.SetName(record.name_);
+  record_type.SetSelfType(type_id);
+  record_type.SetReferencedType(type_id);
+  record_type.SetLinkerSetKey(type_id);
+  record_type.SetSourceFile(source_file);
+  record_type.SetSize(size);
+  record_type.SetAlignment(alignment);
+  record_type.SetRecordKind(record.is_dynamic_
+                                ? repr::RecordTypeIR::class_kind
+                                : repr::RecordTypeIR::struct_kind);
+  if (record.is_template_instance_) {
+    repr::TemplateInfoIR template_info;
+    template_info.AddTemplateElement(repr::TemplateElementIR(
+        records_[record.template_argument_].GetTypeId()));
+    record_type.SetTemplateInfo(std::move(template_info));
+  }
+  if (record.is_dynamic_) {
+    repr::VTableLayoutIR vtable_layout;
+    vtable_layout.AddVTableComponent(repr::VTableComponentIR(
+        "", repr::VTableComponentIR::OffsetToTop, 0, false));
+    vtable_layout.AddVTableComponent(repr::VTableComponentIR(
+        type_id, repr::VTableComponentIR::RTTI, 0, false));
+    for (uint32_t i = 0; i < num_virtual_functions; i++) {
+      vtable_layout.AddVTableComponent(repr::VTableComponentIR(
+          record.GetVirtualFunctionSymbol(i),
+          repr::VTableComponentIR::FunctionPointer, 0, false));
+    }
+    record_type.SetVTableLayout(std::move(vtable_layout));
+  }
+  module->AddRecordType(std::move(record_type));
+
+  repr::PointerTypeIR pointer_type;
+  pointer_type.SetName(record.name_ + " *");
+  pointer_type.SetSelfType(record.GetPointerTypeId());
+  pointer_type.SetReferencedType(type_id);
+  pointer_type.SetLinkerSetKey(record.GetPointerTypeId());
+  pointer_type.SetSourceFile(source_file);
+  pointer_type.SetSize(8);
+  pointer_type.SetAlignment(8);
+  module->AddPointerType(std::move(pointer_type));
+}
+
+
+void SyntheticModuleGenerator::AddFunctions(repr::ModuleIR *module,
+                                            uint32_t index) {
+  const SyntheticRecord &record = records_[index];
+  if (record.mutation_ == Mutation::RemoveFunction) {
+    return;
+  }
+  repr::FunctionIR function;
+  function.SetName(record.GetFunctionName());
+  function.SetLinkerSetKey(record.GetFunctionSymbol());
+  function.SetSourceFile(GetHeaderPath(record.header_));
+  function.SetReturnType(kIntTypeId);
+  function.AddParameter(
+      repr::ParamIR(record.GetPointerTypeId(), false, false));
+  module->AddFunction(std::move(function));
+}
+
+
+void SyntheticModuleGenerator::AddGlobalVariable(repr::ModuleIR *module,
+                                                 uint32_t header) {
+  // The records are in the order of the headers, and each header has at least
+  // one record.
+  auto it = std::partition_point(
+      records_.begin(), records_.end(),
+      [header](const SyntheticRecord &record) {
+        return record.header_ < header;
+      });
+  if (it == records_.end()) {
+    return;
+  }
+  const std::string name = "g_header" + std::to_string(header);
+  repr::GlobalVarIR global_var;
+  global_var.SetName(name);
+  global_var.SetLinkerSetKey(name);
+  global_var.SetSourceFile(GetHeaderPath(header));
+  global_var.SetReferencedType(it->GetPointerTypeId());
+  module->AddGlobalVariable(std::move(global_var));
+}
+
+
+std::vector<std::string> SyntheticModuleGenerator::GetExportedSymbols(
+    uint32_t index) {
+  const SyntheticRecord &record = records_[index];
+  std::vector<std::string> symbols;
+  if (record.mutation_ != Mutation::RemoveFunction) {
+    symbols.push_back(record.GetFunctionSymbol());
+  }
+  uint32_t num_virtual_functions =
+      GetNumVirtualFunctions(record, options_.vtable_size_);
+  for (uint32_t i = 0; i < num_virtual_functions; i++) {
+    symbols.push_back(record.GetVirtualFunctionSymbol(i));
+  }
+  return symbols;
+}
+
+
+std::unique_ptr<repr::ModuleIR>
+SyntheticModuleGenerator::GenerateTranslationUnit(uint32_t index) {
+  const uint32_t num_translation_units =
+      std::max<uint32_t>(options_.num_translation_units_, 1);
+  // The headers are assigned to the translation units in turn, and each
+  // translation unit includes some other headers.
+  Random random(options_.seed_ + 1 + index);
+  std::set<uint32_t> headers;
+  for (uint32_t header = index; header < num_headers_;
+       header += num_translation_units) {
+    headers.insert(header);
+  }
+  for (uint32_t i = 0; i < options_.headers_per_translation_unit_; i++) {
+    headers.insert(random.Uniform(num_headers_));
+  }
+
+  std::vector<uint32_t> roots;
+  for (uint32_t i = 0; i < records_.size(); i++) {
+    if (headers.count(records_[i].header_)) {
+      roots.push_back(i);
+    }
+  }
+
+  auto module = std::make_unique<repr::ModuleIR>(nullptr);
+  module->SetCompilationUnitPath("tu" + std::to_string(index) + ".sdump");
+  AddBuiltinTypes(module.get());
+  const bool odr_variant = (index % 2 == 1);
+  for (uint32_t record : GetReachableRecords(roots)) {
+    AddRecord(module.get(), record,
+              odr_variant && records_[record].is_odr_variant_);
+  }
+  for (uint32_t record : roots) {
+    AddFunctions(module.get(), record);
+  }
+  for (uint32_t header : headers) {
+    AddGlobalVariable(module.get(), header);
+  }
+  return module;
+}
+
+
+std::unique_ptr<repr::ModuleIR>
+SyntheticModuleGenerator::GenerateLinkedModule() {
+  auto module = std::make_unique<repr::ModuleIR>(nullptr);
+  AddBuiltinTypes(module.get());
+  for (uint32_t i = 0; i < records_.size(); i++) {
+    const SyntheticRecord &record = records_[i];
+    AddRecord(module.get(), i, false);
+    AddFunctions(module.get(), i);
+    for (const std::string &symbol : GetExportedSymbols(i)) {
+      module->AddElfFunction(repr::ElfFunctionIR(
+          symbol, repr::ElfSymbolIR::ElfSymbolBinding::Global));
+    }
+    if (record.is_dynamic_) {
+      module->AddElfObject(repr::ElfObjectIR(
+          record.GetVTableSymbol(), repr::ElfSymbolIR::ElfSymbolBinding::Weak));
+      module->AddElfObject(repr::ElfObjectIR(
+          record.GetTypeId(), repr::ElfSymbolIR::ElfSymbolBinding::Weak));
+    }
+  }
+  for (uint32_t header = 0; header < num_headers_; header++) {
+    AddGlobalVariable(module.get(), header);
+    module->AddElfObject(repr::ElfObjectIR(
+        "g_header" + std::to_string(header),
+        repr::ElfSymbolIR::ElfSymbolBinding::Global));
+  }
+  return module;
+}
+
+
+std::string SyntheticModuleGenerator::GenerateVersionScript() {
+  std::string script = "LIBSYNTHETIC {\n  global:\n";
+  auto add_symbol = [&script](const std::string &symbol) {
+    script += "    " + symbol + ";\n";
+  };
+  for (uint32_t i = 0; i < records_.size(); i++) {
+    const SyntheticRecord &record = records_[i];
+    for (const std::string &symbol : GetExportedSymbols(i)) {
+      add_symbol(symbol);
+    }
+    if (record.is_dynamic_) {
+      add_symbol(record.GetVTableSymbol());
+      add_symbol(record.GetTypeId());
+    }
+  }
+  for (uint32_t header = 0; header < num_headers_; header++) {
+    add_symbol("g_header" + std::to_string(header));
+  }
+  script += "  local:\n    *;\n};\n";
+  return script;
+}
+
+
+}  // namespace generator
+}  // namespace header_checker
@@ -0,0 +1,128 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SYNTHETIC_MODULE_H_
+#define SYNTHETIC_MODULE_H_
+
+#include "repr/ir_representation.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace generator {
+
+
+struct SyntheticModuleOptions {
+  // The same options and seed always generate the same modules.
+  uint64_t seed_ = 1;
+
+  uint32_t num_records_ = 1000;
+  uint32_t records_per_header_ = 50;
+  uint32_t num_translation_units_ = 10;
+  // Each translation unit includes the headers whose functions it defines and
+  // this many other headers.
+  uint32_t headers_per_translation_unit_ = 5;
+
+  // The maximum nesting depth of the records. A record at level N has fields
+  // of the records at level N - 1.
+  uint32_t record_depth_ = 3;
+
+  // Every 8th record is a class template with this many instantiations.
+  uint32_t template_fan_out_ = 0;
+
+  // Every 4th record is dynamic and has this many virtual functions.
+  uint32_t vtable_size_ = 0;
+
+  // The ratio of the records that have a different definition in half of the
+  // translation units, which the linker reports as ODR violations.
+  double odr_duplicate_ratio_ = 0.0;
+
+  // The ratio of the records that have an ABI-breaking change. The mutated
+  // records are chosen independently of the other options, so the modules
+  // generated with and without mutations can be diffed.
+  double mutation_rate_ = 0.0;
+};
+
+
+struct SyntheticRecord;
+
+
+// Generates the ABI of a library of records, pointers, builtin types,
+// functions, global variables, and ELF symbols. The records are distributed
+// in headers, and each translation unit contains the types reachable from the
+// headers it includes.
+class SyntheticModuleGenerator {
+ public:
+  SyntheticModuleGenerator(const SyntheticModuleOptions &options);
+
+  ~SyntheticModuleGenerator();
+
+  // Returns the module of a translation unit, which has no ELF symbols.
+  std::unique_ptr<repr::ModuleIR> GenerateTranslationUnit(uint32_t index);
+
+  // Returns the module of the library, which has the ELF symbols and the
+  // types of all translation units.
+  std::unique_ptr<repr::ModuleIR> GenerateLinkedModule();
+
+  // Returns a version script that exports the functions, the global
+  // variables, the vtables, and the type info.
+  std::string GenerateVersionScript();
+
+  // Returns the number of records including the template instantiations.
+  uint32_t GetNumRecords() const;
+
+  uint32_t GetNumOdrVariants() const {
+    return num_odr_variants_;
+  }
+
+  uint32_t GetNumMutations() const {
+    return num_mutations_;
+  }
+
+ private:
+  void PlanRecords();
+
+  // Returns the indexes of the records that the records refer to, including
+  // themselves, in ascending order.
+  std::vector<uint32_t> GetReachableRecords(
+      const std::vector<uint32_t> &records);
+
+  void AddBuiltinTypes(repr::ModuleIR *module);
+
+  void AddRecord(repr::ModuleIR *module, uint32_t index, bool odr_variant);
+
+  void AddFunctions(repr::ModuleIR *module, uint32_t index);
+
+  void AddGlobalVariable(repr::ModuleIR *module, uint32_t header);
+
+  std::vector<std::string> GetExportedSymbols(uint32_t index);
+
+ private:
+  const SyntheticModuleOptions options_;
+  std::vector<SyntheticRecord> records_;
+  uint32_t num_headers_ = 0;
+  uint32_t num_odr_variants_ = 0;
+  uint32_t num_mutations_ = 0;
+};
+
+
+}  // namespace generator
+}  // namespace header_checker
+
+
+#endif  // SYNTHETIC_MODULE_H_
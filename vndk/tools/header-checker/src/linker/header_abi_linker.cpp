@@ -12,21 +12,23 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "linker/module_linker.h"
 #include "linker/module_merger.h"
 #include "repr/ir_dumper.h"
 #include "repr/ir_reader.h"
 #include "repr/ir_representation.h"
-#include "repr/symbol/so_file_parser.h"
-#include "repr/symbol/version_script_parser.h"
+#include "repr/module_stats.h"
 #include "utils/command_line_utils.h"
 #include "utils/header_abi_util.h"
+#include "utils/time_trace.h"
 
-#include <llvm/ADT/Optional.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/raw_ostream.h>
 
-#include <fstream>
-#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -37,10 +39,17 @@
 
 
 using namespace header_checker;
+using header_checker::repr::AddStatsModule;
+using header_checker::repr::AddStatsPhase;
+using header_checker::repr::InitStats;
 using header_checker::repr::TextFormatIR;
+using header_checker::repr::WriteStats;
 using header_checker::utils::CollectAllExportedHeaders;
+using header_checker::utils::CompressionFormat;
 using header_checker::utils::GetCwd;
 using header_checker::utils::HideIrrelevantCommandLineOptions;
+using header_checker::utils::InitTimeTrace;
+using header_checker::utils::WriteTimeTrace;
 
 
 static llvm::cl::OptionCategory header_linker_category(
@@ -64,6 +73,12 @@ static llvm::cl::opt<std::string> root_dir(
                    "relative to. Default to current working directory"),
     llvm::cl::Optional, llvm::cl::cat(header_linker_category));
 
+static llvm::cl::opt<std::string> exported_headers_cache(
+    "exported-headers-cache", llvm::cl::value_desc("cache_file"),
+    llvm::cl::desc("Cache the listings of the exported header directories in "
+                   "the file, which may be shared by several processes"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
 static llvm::cl::opt<std::string> version_script(
     "v", llvm::cl::desc("<version_script>"), llvm::cl::Optional,
     llvm::cl::cat(header_linker_category));
@@ -109,6 +124,64 @@ static llvm::cl::opt<TextFormatIR> output_format(
     llvm::cl::init(TextFormatIR::Json),
     llvm::cl::cat(header_linker_category));
 
+static llvm::cl::opt<CompressionFormat> compress(
+    "compress", llvm::cl::desc("Compress the output dump file"),
+    llvm::cl::values(clEnumValN(CompressionFormat::None, "none", "none"),
+                     clEnumValN(CompressionFormat::Gzip, "gzip", "gzip"),
+                     clEnumValN(CompressionFormat::Zstd, "zstd", "zstd")),
+    llvm::cl::init(CompressionFormat::None),
+    llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<bool> prune_unreachable(
+    "prune-unreachable",
+    llvm::cl::desc("Drop the types that are unreachable from the exported "
+                   "functions, variables, vtables, and type info, and print "
+                   "the number of dropped types"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<bool> read_abi_fragments(
+    "read-abi-fragments",
+    llvm::cl::desc("Read the ABI fragments listed in <input_dump>.fragments, "
+                   "which header-abi-dumper -abi-fragment-cache writes"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<bool> write_index(
+    "write-index",
+    llvm::cl::desc("Write <output_file>.index, which lets header-abi-diff "
+                   "-use-index load only the types reachable from the "
+                   "exported symbols"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<std::string> time_trace(
+    "time-trace", llvm::cl::value_desc("trace_file"), llvm::cl::Optional,
+    llvm::cl::desc("Write the time spent in each phase to the file in Chrome "
+                   "trace event format"),
+    llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<unsigned> time_trace_granularity(
+    "time-trace-granularity",
+    llvm::cl::desc("Minimum duration in microseconds of the spans recorded by "
+                   "-time-trace"),
+    llvm::cl::init(500), llvm::cl::Optional,
+    llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<bool> module_stats(
+    "module-stats",
+    llvm::cl::desc("Print the sizes of the modules in memory and the peak "
+                   "resident set size after each phase"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<bool> module_stats_json(
+    "module-stats-json",
+    llvm::cl::desc("Print the statistics of -module-stats in JSON format"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
+static llvm::cl::opt<std::string> module_stats_file(
+    "module-stats-file", llvm::cl::value_desc("stats_file"),
+    llvm::cl::desc("Write the statistics of -module-stats to the file instead "
+                   "of stderr"),
+    llvm::cl::Optional, llvm::cl::cat(header_linker_category));
+
 static llvm::cl::opt<std::size_t> sources_per_thread(
     "sources-per-thread",
     llvm::cl::desc("Specify number of input dump files each thread parses, for "
@@ -128,66 +201,31 @@ class HeaderAbiLinker {
       const std::vector<std::string> &excluded_symbol_versions,
       const std::vector<std::string> &excluded_symbol_tags)
       : dump_files_(dump_files), exported_header_dirs_(exported_header_dirs),
-        version_script_(version_script), so_file_(so_file),
-        out_dump_name_(linked_dump), arch_(arch), api_(api),
-        excluded_symbol_versions_(excluded_symbol_versions),
-        excluded_symbol_tags_(excluded_symbol_tags) {}
+        out_dump_name_(linked_dump),
+        module_linker_(exported_headers_, version_script, so_file, arch, api,
+                       excluded_symbol_versions, excluded_symbol_tags) {
+    module_linker_.SetPruneUnreachable(prune_unreachable);
+  }
 
   bool LinkAndDump();
 
  private:
-  template <typename T>
-  bool LinkDecl(repr::ModuleIR *dst,
-                const repr::AbiElementMap<T> &src,
-                const std::function<bool(const std::string &)> &symbol_filter);
+  // Appends the ABI fragments referenced by the dumps to the input files.
+  bool AddAbiFragments();
 
   std::unique_ptr<linker::ModuleMerger> ReadInputDumpFiles();
 
-  bool ReadExportedSymbols();
-
-  bool ReadExportedSymbolsFromVersionScript();
-
-  bool ReadExportedSymbolsFromSharedObjectFile();
-
-  bool LinkTypes(const repr::ModuleIR &module, repr::ModuleIR *linked_module);
-
-  bool LinkFunctions(const repr::ModuleIR &module,
-                     repr::ModuleIR *linked_module);
-
-  bool LinkGlobalVars(const repr::ModuleIR &module,
-                      repr::ModuleIR *linked_module);
-
-  bool LinkExportedSymbols(repr::ModuleIR *linked_module);
-
-  bool LinkExportedSymbols(repr::ModuleIR *linked_module,
-                           const repr::ExportedSymbolSet &exported_symbols);
-
-  template <typename SymbolMap>
-  bool LinkExportedSymbols(repr::ModuleIR *linked_module,
-                           const SymbolMap &symbols);
-
-  // Check whether a symbol name is considered as exported.  If both
-  // `shared_object_symbols_` and `version_script_symbols_` exists, the symbol
-  // name must pass the `HasSymbol()` test in both cases.
-  bool IsSymbolExported(const std::string &name) const;
-
  private:
   const std::vector<std::string> &dump_files_;
   const std::vector<std::string> &exported_header_dirs_;
-  const std::string &version_script_;
-  const std::string &so_file_;
   const std::string &out_dump_name_;
-  const std::string &arch_;
-  const std::string &api_;
-  const std::vector<std::string> &excluded_symbol_versions_;
-  const std::vector<std::string> &excluded_symbol_tags_;
 
-  std::set<std::string> exported_headers_;
+  // The dump files and the ABI fragments they reference.
+  std::vector<std::string> input_dump_files_;
 
-  // Exported symbols
-  std::unique_ptr<repr::ExportedSymbolSet> shared_object_symbols_;
+  std::set<std::string> exported_headers_;
 
-  std::unique_ptr<repr::ExportedSymbolSet> version_script_symbols_;
+  linker::ModuleLinker module_linker_;
 };
 
 static void DeDuplicateAbiElementsThread(
@@ -195,24 +233,87 @@ static void DeDuplicateAbiElementsThread(
     std::vector<std::string>::const_iterator dump_files_end,
     const std::set<std::string> *exported_headers,
     linker::ModuleMerger *merger) {
+  utils::TimeTraceThread time_trace_thread;
   for (auto it = dump_files_begin; it != dump_files_end; it++) {
     std::unique_ptr<repr::IRReader> reader =
         repr::IRReader::CreateIRReader(input_format, exported_headers);
     assert(reader != nullptr);
-    if (!reader->ReadDump(*it)) {
-      llvm::errs() << "ReadDump failed\n";
-      ::exit(1);
+    {
+      llvm::TimeTraceScope scope("ReadDump", *it);
+      if (!reader->ReadDump(*it)) {
+        llvm::errs() << "ReadDump failed\n";
+        ::exit(1);
+      }
     }
+    utils::AddTimeTraceCounter("Input types",
+                               reader->GetModule().GetTypeGraph().size());
+    llvm::TimeTraceScope scope("MergeGraphs", *it);
     merger->MergeGraphs(reader->GetModule());
   }
 }
 
+// A user-defined type has more than one definition in the ODR list if its
+// definitions in the translation units differ.
+static void AddMergeCounters(const repr::ModuleIR &module) {
+  uint64_t odr_violations = 0;
+  for (auto &&odr_list : module.GetODRListMap()) {
+    if (odr_list.second.size() > 1) {
+      odr_violations++;
+    }
+  }
+  utils::AddTimeTraceCounter("Merged types", module.GetTypeGraph().size());
+  utils::AddTimeTraceCounter("ODR violations", odr_violations);
+}
+
+static void PrintPruneStats(const linker::PruneStats &stats) {
+  uint64_t total_kept = 0;
+  uint64_t total_pruned = 0;
+  for (auto &&item : stats.num_kept_types_) {
+    total_kept += item.second;
+  }
+  for (auto &&item : stats.num_pruned_types_) {
+    llvm::errs() << "Pruned " << item.first << ": " << item.second << "\n";
+    total_pruned += item.second;
+  }
+  llvm::errs() << "Pruned " << total_pruned << " of "
+               << total_kept + total_pruned << " types\n";
+  utils::AddTimeTraceCounter("Pruned types", total_pruned);
+}
+
+bool HeaderAbiLinker::AddAbiFragments() {
+  input_dump_files_ = dump_files_;
+  if (!read_abi_fragments) {
+    return true;
+  }
+  // The translation units including the same header share the fragment.
+  std::set<std::string> fragments;
+  for (auto &&dump_file : dump_files_) {
+    std::string fragment_list = dump_file + ".fragments";
+    if (!llvm::sys::fs::exists(fragment_list)) {
+      continue;
+    }
+    auto buffer = llvm::MemoryBuffer::getFile(fragment_list);
+    if (!buffer) {
+      llvm::errs() << "Failed to read " << fragment_list << "\n";
+      return false;
+    }
+    llvm::SmallVector<llvm::StringRef, 16> lines;
+    (*buffer)->getBuffer().split(lines, '\n', -1, false);
+    for (auto &&line : lines) {
+      if (fragments.insert(line.str()).second) {
+        input_dump_files_.push_back(line.str());
+      }
+    }
+  }
+  return true;
+}
+
 std::unique_ptr<linker::ModuleMerger> HeaderAbiLinker::ReadInputDumpFiles() {
   std::unique_ptr<linker::ModuleMerger> merger(
       new linker::ModuleMerger(&exported_headers_));
   std::size_t max_threads = std::thread::hardware_concurrency();
   std::size_t num_threads = std::max<std::size_t>(
-      std::min(dump_files_.size() / sources_per_thread, max_threads), 1);
+      std::min(input_dump_files_.size() / sources_per_thread, max_threads), 1);
   std::vector<std::thread> threads;
   std::vector<linker::ModuleMerger> thread_mergers;
   thread_mergers.reserve(num_threads - 1);
@@ -220,27 +321,29 @@ std::unique_ptr<linker::ModuleMerger> HeaderAbiLinker::ReadInputDumpFiles() {
   std::size_t dump_files_index = 0;
   std::size_t first_end_index = 0;
   for (std::size_t i = 0; i < num_threads; i++) {
-    std::size_t cnt = dump_files_.size() / num_threads +
-                      (i < dump_files_.size() % num_threads ? 1 : 0);
+    std::size_t cnt = input_dump_files_.size() / num_threads +
+                      (i < input_dump_files_.size() % num_threads ? 1 : 0);
     if (i == 0) {
       first_end_index = cnt;
     } else {
       thread_mergers.emplace_back(&exported_headers_);
       threads.emplace_back(DeDuplicateAbiElementsThread,
-                           dump_files_.begin() + dump_files_index,
-                           dump_files_.begin() + dump_files_index + cnt,
+                           input_dump_files_.begin() + dump_files_index,
+                           input_dump_files_.begin() + dump_files_index +
+                               cnt,
                            &exported_headers_, &thread_mergers.back());
     }
     dump_files_index += cnt;
   }
-  assert(dump_files_index == dump_files_.size());
+  assert(dump_files_index == input_dump_files_.size());
 
-  DeDuplicateAbiElementsThread(dump_files_.begin(),
-                               dump_files_.begin() + first_end_index,
+  DeDuplicateAbiElementsThread(input_dump_files_.begin(),
+                               input_dump_files_.begin() + first_end_index,
                                &exported_headers_, merger.get());
 
   for (std::size_t i = 0; i < threads.size(); i++) {
     threads[i].join();
+    llvm::TimeTraceScope scope("MergeGraphs", "thread " + std::to_string(i));
     merger->MergeGraphs(thread_mergers[i].GetModule());
   }
 
@@ -250,214 +353,55 @@ std::unique_ptr<linker::ModuleMerger> HeaderAbiLinker::ReadInputDumpFiles() {
 bool HeaderAbiLinker::LinkAndDump() {
   // Extract exported functions and variables from a shared lib or a version
   // script.
-  if (!ReadExportedSymbols()) {
+  if (!module_linker_.ReadExportedSymbols()) {
     return false;
   }
+  AddStatsPhase("ReadExportedSymbols");
 
   // Construct the list of exported headers for source location filtering.
   exported_headers_ = CollectAllExportedHeaders(
-      exported_header_dirs_, root_dir.empty() ? GetCwd() : root_dir);
+      exported_header_dirs_, root_dir.empty() ? GetCwd() : root_dir,
+      exported_headers_cache);
 
-  // Read all input ABI dumps.
-  auto merger = ReadInputDumpFiles();
-
-  const repr::ModuleIR &module = merger->GetModule();
-
-  // Link input ABI dumps.
-  std::unique_ptr<repr::ModuleIR> linked_module(
-      new repr::ModuleIR(&exported_headers_));
-
-  if (!LinkExportedSymbols(linked_module.get())) {
+  if (!AddAbiFragments()) {
     return false;
   }
+  AddStatsPhase("CollectAllExportedHeaders");
 
-  if (!LinkTypes(module, linked_module.get()) ||
-      !LinkFunctions(module, linked_module.get()) ||
-      !LinkGlobalVars(module, linked_module.get())) {
-    llvm::errs() << "Failed to link elements\n";
-    return false;
-  }
-
-  // Dump the linked module.
-  std::unique_ptr<repr::IRDumper> ir_dumper =
-      repr::IRDumper::CreateIRDumper(output_format, out_dump_name_);
-  assert(ir_dumper != nullptr);
-  if (!ir_dumper->Dump(*linked_module)) {
-    llvm::errs() << "Failed to serialize the linked output to ostream\n";
-    return false;
-  }
-
-  return true;
-}
-
-template <typename T>
-bool HeaderAbiLinker::LinkDecl(
-    repr::ModuleIR *dst, const repr::AbiElementMap<T> &src,
-    const std::function<bool(const std::string &)> &symbol_filter) {
-  assert(dst != nullptr);
-  for (auto &&element : src) {
-    // If we are not using a version script and exported headers are available,
-    // filter out unexported abi.
-    std::string source_file = element.second.GetSourceFile();
-    // Builtin types will not have source file information.
-    if (!exported_headers_.empty() && !source_file.empty() &&
-        exported_headers_.find(source_file) == exported_headers_.end()) {
-      continue;
-    }
-    // Check for the existence of the element in version script / symbol file.
-    if (!symbol_filter(element.first)) {
-      continue;
-    }
-    if (!dst->AddLinkableMessage(element.second)) {
-      llvm::errs() << "Failed to add element to linked dump\n";
-      return false;
-    }
-  }
-  return true;
-}
-
-bool HeaderAbiLinker::LinkTypes(const repr::ModuleIR &module,
-                                repr::ModuleIR *linked_module) {
-  auto no_filter = [](const std::string &symbol) { return true; };
-  return LinkDecl(linked_module, module.GetRecordTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetEnumTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetFunctionTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetBuiltinTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetPointerTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetRvalueReferenceTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetLvalueReferenceTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetArrayTypes(), no_filter) &&
-         LinkDecl(linked_module, module.GetQualifiedTypes(), no_filter);
-}
-
-bool HeaderAbiLinker::IsSymbolExported(const std::string &name) const {
-  if (shared_object_symbols_ && !shared_object_symbols_->HasSymbol(name)) {
-    return false;
-  }
-  if (version_script_symbols_ && !version_script_symbols_->HasSymbol(name)) {
-    return false;
-  }
-  return true;
-}
-
-bool HeaderAbiLinker::LinkFunctions(const repr::ModuleIR &module,
-                                    repr::ModuleIR *linked_module) {
-  auto symbol_filter = [this](const std::string &linker_set_key) {
-    return IsSymbolExported(linker_set_key);
-  };
-  return LinkDecl(linked_module, module.GetFunctions(), symbol_filter);
-}
-
-bool HeaderAbiLinker::LinkGlobalVars(const repr::ModuleIR &module,
-                                     repr::ModuleIR *linked_module) {
-  auto symbol_filter = [this](const std::string &linker_set_key) {
-    return IsSymbolExported(linker_set_key);
-  };
-  return LinkDecl(linked_module, module.GetGlobalVariables(), symbol_filter);
-}
-
-template <typename SymbolMap>
-bool HeaderAbiLinker::LinkExportedSymbols(repr::ModuleIR *dst,
-                                          const SymbolMap &symbols) {
-  for (auto &&symbol : symbols) {
-    if (!IsSymbolExported(symbol.first)) {
-      continue;
-    }
-    if (!dst->AddElfSymbol(symbol.second)) {
-      return false;
-    }
-  }
-  return true;
-}
-
-bool HeaderAbiLinker::LinkExportedSymbols(
-    repr::ModuleIR *linked_module,
-    const repr::ExportedSymbolSet &exported_symbols) {
-  return (LinkExportedSymbols(linked_module, exported_symbols.GetFunctions()) &&
-          LinkExportedSymbols(linked_module, exported_symbols.GetVars()));
-}
-
-bool HeaderAbiLinker::LinkExportedSymbols(repr::ModuleIR *linked_module) {
-  if (shared_object_symbols_) {
-    return LinkExportedSymbols(linked_module, *shared_object_symbols_);
-  }
-
-  if (version_script_symbols_) {
-    return LinkExportedSymbols(linked_module, *version_script_symbols_);
+  // Read all input ABI dumps.
+  auto merger = ReadInputDumpFiles();
+  if (utils::IsTimeTraceEnabled()) {
+    AddMergeCounters(merger->GetModule());
   }
+  AddStatsPhase("ReadAndMergeDumps");
+  AddStatsModule("merged", merger->GetModule());
 
-  return false;
-}
-
-bool HeaderAbiLinker::ReadExportedSymbols() {
-  if (so_file_.empty() && version_script_.empty()) {
-    llvm::errs() << "Either shared lib or version script must be specified.\n";
+  // Link input ABI dumps.
+  std::unique_ptr<repr::ModuleIR> linked_module =
+      module_linker_.Link(merger->TakeModule());
+  if (!linked_module) {
     return false;
   }
-
-  if (!so_file_.empty()) {
-    if (!ReadExportedSymbolsFromSharedObjectFile()) {
-      llvm::errs() << "Failed to parse the shared library (.so file): "
-                   << so_file_ << "\n";
-      return false;
-    }
+  if (prune_unreachable) {
+    PrintPruneStats(module_linker_.GetPruneStats());
   }
+  AddStatsPhase("Link");
+  AddStatsModule("linked", *linked_module);
 
-  if (!version_script_.empty()) {
-    if (!ReadExportedSymbolsFromVersionScript()) {
-      llvm::errs() << "Failed to parse the version script: " << version_script_
-                   << "\n";
+  // Dump the linked module.
+  {
+    llvm::TimeTraceScope scope("Dump", out_dump_name_);
+    std::unique_ptr<repr::IRDumper> ir_dumper =
+        repr::IRDumper::CreateIRDumper(output_format, out_dump_name_);
+    assert(ir_dumper != nullptr);
+    ir_dumper->SetCompression(compress);
+    ir_dumper->SetWriteIndex(write_index);
+    if (!ir_dumper->Dump(*linked_module)) {
+      llvm::errs() << "Failed to serialize the linked output to ostream\n";
       return false;
     }
   }
-
-  return true;
-}
-
-bool HeaderAbiLinker::ReadExportedSymbolsFromVersionScript() {
-  llvm::Optional<utils::ApiLevel> api_level = utils::ParseApiLevel(api_);
-  if (!api_level) {
-    llvm::errs() << "-api must be either \"current\" or an integer (e.g. 21)\n";
-    return false;
-  }
-
-  std::ifstream stream(version_script_, std::ios_base::in);
-  if (!stream) {
-    llvm::errs() << "Failed to open version script file\n";
-    return false;
-  }
-
-  repr::VersionScriptParser parser;
-  parser.SetArch(arch_);
-  parser.SetApiLevel(api_level.getValue());
-  for (auto &&version : excluded_symbol_versions_) {
-    parser.AddExcludedSymbolVersion(version);
-  }
-  for (auto &&tag : excluded_symbol_tags_) {
-    parser.AddExcludedSymbolTag(tag);
-  }
-
-  version_script_symbols_ = parser.Parse(stream);
-  if (!version_script_symbols_) {
-    llvm::errs() << "Failed to parse version script file\n";
-    return false;
-  }
-
-  return true;
-}
-
-bool HeaderAbiLinker::ReadExportedSymbolsFromSharedObjectFile() {
-  std::unique_ptr<repr::SoFileParser> so_parser =
-      repr::SoFileParser::Create(so_file_);
-  if (!so_parser) {
-    return false;
-  }
-
-  shared_object_symbols_ = so_parser->Parse();
-  if (!shared_object_symbols_) {
-    llvm::errs() << "Failed to parse shared object file\n";
-    return false;
-  }
+  AddStatsPhase("Dump");
 
   return true;
 }
@@ -466,6 +410,9 @@ int main(int argc, const char **argv) {
   HideIrrelevantCommandLineOptions(header_linker_category);
   llvm::cl::ParseCommandLineOptions(argc, argv, "header-linker");
 
+  InitTimeTrace(time_trace, time_trace_granularity, argv[0]);
+  InitStats(module_stats, module_stats_json, module_stats_file);
+
   if (so_file.empty() && version_script.empty()) {
     llvm::errs() << "One of -so or -v needs to be specified\n";
     return -1;
@@ -485,5 +432,9 @@ int main(int argc, const char **argv) {
     return -1;
   }
 
+  if (!WriteTimeTrace() || !WriteStats()) {
+    return -1;
+  }
+
   return 0;
 }
@@ -0,0 +1,329 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linker/module_linker.h"
+
+#include "repr/abi_index.h"
+#include "repr/symbol/so_file_parser.h"
+#include "repr/symbol/version_script_parser.h"
+#include "utils/api_level.h"
+#include "utils/time_trace.h"
+
+#include <llvm/ADT/Optional.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <deque>
+#include <fstream>
+
+
+namespace header_checker {
+namespace linker {
+
+
+std::unique_ptr<repr::ModuleIR> ModuleLinker::Link(
+    std::unique_ptr<repr::ModuleIR> module) {
+  llvm::TimeTraceScope scope("Link");
+  std::unique_ptr<repr::ModuleIR> linked_module(
+      new repr::ModuleIR(&exported_headers_));
+
+  if (!LinkExportedSymbols(linked_module.get())) {
+    return nullptr;
+  }
+
+  std::set<std::string> reachable_types;
+  if (prune_unreachable_) {
+    llvm::TimeTraceScope scope("CollectReachableTypes");
+    CollectReachableTypes(*module, *linked_module, &reachable_types);
+  }
+
+  // The type graph and the ODR list map point to the elements that are moved.
+  module->type_graph_.clear();
+  module->odr_list_map_.clear();
+
+  LinkTypes(module.get(), linked_module.get(),
+            prune_unreachable_ ? &reachable_types : nullptr);
+  LinkFunctions(module.get(), linked_module.get());
+  LinkGlobalVars(module.get(), linked_module.get());
+
+  return linked_module;
+}
+
+bool ModuleLinker::IsInExportedHeaders(
+    const repr::LinkableMessageIR &lm) const {
+  // Builtin types will not have source file information.
+  const std::string &source_file = lm.GetSourceFile();
+  return exported_headers_.empty() || source_file.empty() ||
+         exported_headers_.find(source_file) != exported_headers_.end();
+}
+
+template <typename T>
+void ModuleLinker::LinkDecl(
+    repr::ModuleIR *dst, void (repr::ModuleIR::*add)(T &&),
+    repr::AbiElementMap<T> *src,
+    const std::function<bool(const repr::LinkableMessageIR &)> &filter) {
+  assert(dst != nullptr);
+  // Each element is erased as soon as it is moved, so that the merged and the
+  // linked modules do not coexist in memory.
+  for (auto it = src->begin(); it != src->end(); it = src->erase(it)) {
+    // If we are not using a version script and exported headers are available,
+    // filter out unexported abi.
+    if (!IsInExportedHeaders(it->second)) {
+      continue;
+    }
+    // Check for the existence of the element in version script / symbol file.
+    if (!filter(it->second)) {
+      continue;
+    }
+    (dst->*add)(std::move(it->second));
+  }
+}
+
+// Returns the type info symbol of the record if the symbol is a vtable, a VTT,
+// a type info, or a type info name.
+static std::string GetTypeInfoSymbol(const std::string &symbol) {
+  static const char *const kRecordSymbolPrefixes[] = {
+      "_ZTV", "_ZTT", "_ZTI", "_ZTS"};
+  for (const char *prefix : kRecordSymbolPrefixes) {
+    if (symbol.size() > 4 && symbol.compare(0, 4, prefix) == 0) {
+      return "_ZTI" + symbol.substr(4);
+    }
+  }
+  return "";
+}
+
+void ModuleLinker::CollectReachableTypes(
+    const repr::ModuleIR &module, const repr::ModuleIR &linked_module,
+    std::set<std::string> *reachable_types) const {
+  std::vector<std::string> referenced_types;
+  for (auto &&function : module.GetFunctions()) {
+    if (IsInExportedHeaders(function.second) &&
+        IsSymbolExported(function.first)) {
+      repr::CollectReferencedTypes(function.second, &referenced_types);
+    }
+  }
+  for (auto &&global_var : module.GetGlobalVariables()) {
+    if (IsInExportedHeaders(global_var.second) &&
+        IsSymbolExported(global_var.first)) {
+      repr::CollectReferencedTypes(global_var.second, &referenced_types);
+    }
+  }
+  // The linker set key of a record is the type info symbol.
+  std::set<std::string> type_info_symbols;
+  for (auto &&elf_object : linked_module.GetElfObjects()) {
+    std::string type_info_symbol = GetTypeInfoSymbol(elf_object.first);
+    if (!type_info_symbol.empty()) {
+      type_info_symbols.insert(std::move(type_info_symbol));
+    }
+  }
+  for (auto &&record_type : module.GetRecordTypes()) {
+    if (type_info_symbols.count(record_type.second.GetLinkerSetKey())) {
+      referenced_types.emplace_back(record_type.second.GetSelfType());
+    }
+  }
+
+  const repr::AbiElementMap<const repr::TypeIR *> &type_graph =
+      module.GetTypeGraph();
+  std::deque<std::string> queue(referenced_types.begin(),
+                                referenced_types.end());
+  while (!queue.empty()) {
+    std::string type_id = std::move(queue.front());
+    queue.pop_front();
+    auto it = type_graph.find(type_id);
+    if (it == type_graph.end() ||
+        !reachable_types->insert(std::move(type_id)).second) {
+      continue;
+    }
+    referenced_types.clear();
+    repr::CollectReferencedTypes(*it->second, &referenced_types);
+    queue.insert(queue.end(), referenced_types.begin(),
+                 referenced_types.end());
+  }
+}
+
+void ModuleLinker::LinkTypes(repr::ModuleIR *module,
+                             repr::ModuleIR *linked_module,
+                             const std::set<std::string> *reachable_types) {
+  auto type_filter = [this, reachable_types](
+                         const repr::LinkableMessageIR &lm) {
+    if (!reachable_types) {
+      return true;
+    }
+    const char *key = repr::GetAbiIndexKey(lm.GetKind());
+    if (!reachable_types->count(
+            static_cast<const repr::TypeIR &>(lm).GetSelfType())) {
+      prune_stats_.num_pruned_types_[key]++;
+      return false;
+    }
+    prune_stats_.num_kept_types_[key]++;
+    return true;
+  };
+  using repr::ModuleIR;
+  LinkDecl(linked_module, &ModuleIR::AddRecordType,
+           &module->record_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddEnumType,
+           &module->enum_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddFunctionType,
+           &module->function_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddBuiltinType,
+           &module->builtin_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddPointerType,
+           &module->pointer_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddRvalueReferenceType,
+           &module->rvalue_reference_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddLvalueReferenceType,
+           &module->lvalue_reference_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddArrayType,
+           &module->array_types_, type_filter);
+  LinkDecl(linked_module, &ModuleIR::AddQualifiedType,
+           &module->qualified_types_, type_filter);
+}
+
+bool ModuleLinker::IsSymbolExported(const std::string &name) const {
+  if (shared_object_symbols_ && !shared_object_symbols_->HasSymbol(name)) {
+    return false;
+  }
+  if (version_script_symbols_ && !version_script_symbols_->HasSymbol(name)) {
+    return false;
+  }
+  return true;
+}
+
+void ModuleLinker::LinkFunctions(repr::ModuleIR *module,
+                                 repr::ModuleIR *linked_module) {
+  auto symbol_filter = [this](const repr::LinkableMessageIR &lm) {
+    return IsSymbolExported(lm.GetLinkerSetKey());
+  };
+  LinkDecl(linked_module, &repr::ModuleIR::AddFunction, &module->functions_,
+           symbol_filter);
+}
+
+void ModuleLinker::LinkGlobalVars(repr::ModuleIR *module,
+                                  repr::ModuleIR *linked_module) {
+  auto symbol_filter = [this](const repr::LinkableMessageIR &lm) {
+    return IsSymbolExported(lm.GetLinkerSetKey());
+  };
+  LinkDecl(linked_module, &repr::ModuleIR::AddGlobalVariable,
+           &module->global_variables_, symbol_filter);
+}
+
+template <typename SymbolMap>
+bool ModuleLinker::LinkExportedSymbols(repr::ModuleIR *dst,
+                                          const SymbolMap &symbols) {
+  for (auto &&symbol : symbols) {
+    if (!IsSymbolExported(symbol.first)) {
+      continue;
+    }
+    if (!dst->AddElfSymbol(symbol.second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ModuleLinker::LinkExportedSymbols(
+    repr::ModuleIR *linked_module,
+    const repr::ExportedSymbolSet &exported_symbols) {
+  return (LinkExportedSymbols(linked_module, exported_symbols.GetFunctions()) &&
+          LinkExportedSymbols(linked_module, exported_symbols.GetVars()));
+}
+
+bool ModuleLinker::LinkExportedSymbols(repr::ModuleIR *linked_module) {
+  if (shared_object_symbols_) {
+    return LinkExportedSymbols(linked_module, *shared_object_symbols_);
+  }
+
+  if (version_script_symbols_) {
+    return LinkExportedSymbols(linked_module, *version_script_symbols_);
+  }
+
+  return false;
+}
+
+bool ModuleLinker::ReadExportedSymbols() {
+  llvm::TimeTraceScope scope("ReadExportedSymbols");
+  if (so_file_.empty() && version_script_.empty()) {
+    llvm::errs() << "Either shared lib or version script must be specified.\n";
+    return false;
+  }
+
+  if (!so_file_.empty()) {
+    if (!ReadExportedSymbolsFromSharedObjectFile()) {
+      llvm::errs() << "Failed to parse the shared library (.so file): "
+                   << so_file_ << "\n";
+      return false;
+    }
+  }
+
+  if (!version_script_.empty()) {
+    if (!ReadExportedSymbolsFromVersionScript()) {
+      llvm::errs() << "Failed to parse the version script: " << version_script_
+                   << "\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ModuleLinker::ReadExportedSymbolsFromVersionScript() {
+  llvm::Optional<utils::ApiLevel> api_level = utils::ParseApiLevel(api_);
+  if (!api_level) {
+    llvm::errs() << "-api must be either \"current\" or an integer (e.g. 21)\n";
+    return false;
+  }
+
+  std::ifstream stream(version_script_, std::ios_base::in);
+  if (!stream) {
+    llvm::errs() << "Failed to open version script file\n";
+    return false;
+  }
+
+  repr::VersionScriptParser parser;
+  parser.SetArch(arch_);
+  parser.SetApiLevel(api_level.getValue());
+  for (auto &&version : excluded_symbol_versions_) {
+    parser.AddExcludedSymbolVersion(version);
+  }
+  for (auto &&tag : excluded_symbol_tags_) {
+    parser.AddExcludedSymbolTag(tag);
+  }
+
+  version_script_symbols_ = parser.Parse(stream);
+  if (!version_script_symbols_) {
+    llvm::errs() << "Failed to parse version script file\n";
+    return false;
+  }
+
+  return true;
+}
+
+bool ModuleLinker::ReadExportedSymbolsFromSharedObjectFile() {
+  std::unique_ptr<repr::SoFileParser> so_parser =
+      repr::SoFileParser::Create(so_file_);
+  if (!so_parser) {
+    return false;
+  }
+
+  shared_object_symbols_ = so_parser->Parse();
+  if (!shared_object_symbols_) {
+    llvm::errs() << "Failed to parse shared object file\n";
+    return false;
+  }
+
+  return true;
+}
+
+
+}  // namespace linker
+}  // namespace header_checker
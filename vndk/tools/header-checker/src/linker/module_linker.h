@@ -0,0 +1,147 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MODULE_LINKER_H_
+#define MODULE_LINKER_H_
+
+#include "repr/ir_representation.h"
+#include "repr/symbol/exported_symbol_set.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace linker {
+
+
+// The numbers of the types from the exported headers that are kept or pruned
+// by ModuleLinker::SetPruneUnreachable, keyed by the names of the arrays in
+// the dumps, e.g., "record_types".
+struct PruneStats {
+  std::map<std::string, uint64_t> num_kept_types_;
+  std::map<std::string, uint64_t> num_pruned_types_;
+};
+
+
+// This class filters a merged module by the exported headers and by the
+// symbols exported by a shared library or a version script. It is shared by
+// header-abi-linker and the fused dump-and-link mode of header-abi-dumper.
+class ModuleLinker {
+ public:
+  // The references must outlive the ModuleLinker. exported_headers may be
+  // filled after construction; if it is empty, types are not filtered.
+  ModuleLinker(const std::set<std::string> &exported_headers,
+               const std::string &version_script,
+               const std::string &so_file,
+               const std::string &arch,
+               const std::string &api,
+               const std::vector<std::string> &excluded_symbol_versions,
+               const std::vector<std::string> &excluded_symbol_tags)
+      : exported_headers_(exported_headers), version_script_(version_script),
+        so_file_(so_file), arch_(arch), api_(api),
+        excluded_symbol_versions_(excluded_symbol_versions),
+        excluded_symbol_tags_(excluded_symbol_tags) {}
+
+  // If set, only the types reachable from the exported functions, the
+  // exported variables, and the records whose vtables or type info are
+  // exported are linked.
+  void SetPruneUnreachable(bool prune_unreachable) {
+    prune_unreachable_ = prune_unreachable;
+  }
+
+  const PruneStats &GetPruneStats() const {
+    return prune_stats_;
+  }
+
+  // Extract exported functions and variables from a shared lib or a version
+  // script.
+  bool ReadExportedSymbols();
+
+  // Moves the elements that pass the filters from the merged module to the
+  // linked module, so that the elements are never copied. Returns nullptr on
+  // failure.
+  std::unique_ptr<repr::ModuleIR> Link(std::unique_ptr<repr::ModuleIR> module);
+
+ private:
+  // Moves the elements that pass the filter from src to dst and erases all
+  // elements from src.
+  template <typename T>
+  void LinkDecl(
+      repr::ModuleIR *dst, void (repr::ModuleIR::*add)(T &&),
+      repr::AbiElementMap<T> *src,
+      const std::function<bool(const repr::LinkableMessageIR &)> &filter);
+
+  bool IsInExportedHeaders(const repr::LinkableMessageIR &lm) const;
+
+  bool ReadExportedSymbolsFromVersionScript();
+
+  bool ReadExportedSymbolsFromSharedObjectFile();
+
+  // Collects the ids of the types in the module reachable from the exported
+  // functions, variables, and ELF objects in linked_module.
+  void CollectReachableTypes(const repr::ModuleIR &module,
+                             const repr::ModuleIR &linked_module,
+                             std::set<std::string> *reachable_types) const;
+
+  // If reachable_types is not nullptr, the other types are pruned.
+  void LinkTypes(repr::ModuleIR *module, repr::ModuleIR *linked_module,
+                 const std::set<std::string> *reachable_types);
+
+  void LinkFunctions(repr::ModuleIR *module, repr::ModuleIR *linked_module);
+
+  void LinkGlobalVars(repr::ModuleIR *module, repr::ModuleIR *linked_module);
+
+  bool LinkExportedSymbols(repr::ModuleIR *linked_module);
+
+  bool LinkExportedSymbols(repr::ModuleIR *linked_module,
+                           const repr::ExportedSymbolSet &exported_symbols);
+
+  template <typename SymbolMap>
+  bool LinkExportedSymbols(repr::ModuleIR *linked_module,
+                           const SymbolMap &symbols);
+
+  // Check whether a symbol name is considered as exported.  If both
+  // `shared_object_symbols_` and `version_script_symbols_` exists, the symbol
+  // name must pass the `HasSymbol()` test in both cases.
+  bool IsSymbolExported(const std::string &name) const;
+
+ private:
+  const std::set<std::string> &exported_headers_;
+  const std::string &version_script_;
+  const std::string &so_file_;
+  const std::string &arch_;
+  const std::string &api_;
+  const std::vector<std::string> &excluded_symbol_versions_;
+  const std::vector<std::string> &excluded_symbol_tags_;
+
+  // Exported symbols
+  std::unique_ptr<repr::ExportedSymbolSet> shared_object_symbols_;
+
+  std::unique_ptr<repr::ExportedSymbolSet> version_script_symbols_;
+
+  bool prune_unreachable_ = false;
+  PruneStats prune_stats_;
+};
+
+
+}  // namespace linker
+}  // namespace header_checker
+
+
+#endif  // MODULE_LINKER_H_
@@ -90,25 +90,12 @@ MergeStatus ModuleMerger::LookupType(
     const repr::TypeIR *addend_node, const repr::ModuleIR &addend,
     repr::AbiElementMap<MergeStatus> *local_to_global_type_id_map) {
   std::string unique_type_id;
-  switch (addend_node->GetKind()) {
-    case repr::RecordTypeKind:
-      unique_type_id = repr::GetODRListMapKey(
-          static_cast<const repr::RecordTypeIR *>(addend_node));
-      break;
-    case repr::EnumTypeKind:
-      unique_type_id = repr::GetODRListMapKey(
-          static_cast<const repr::EnumTypeIR *>(addend_node));
-      break;
-    case repr::FunctionTypeKind:
-      unique_type_id = repr::GetODRListMapKey(
-          static_cast<const repr::FunctionTypeIR *>(addend_node));
-      break;
-    default:
-      // Other kinds (e.g. PointerTypeKind, QualifiedTypeKind, ArrayTypeKind,
-      // LvalueReferenceTypeKind, RvalueReferenceTypeKind, or BuiltinTypeKind)
-      // should be proactively added by returning MergeStatus with
-      // was_newly_added_ = true.
-      return MergeStatus(true, "type-hidden");
+  if (!repr::GetODRListMapKey(addend_node, &unique_type_id)) {
+    // Other kinds (e.g. PointerTypeKind, QualifiedTypeKind, ArrayTypeKind,
+    // LvalueReferenceTypeKind, RvalueReferenceTypeKind, or BuiltinTypeKind)
+    // should be proactively added by returning MergeStatus with
+    // was_newly_added_ = true.
+    return MergeStatus(true, "type-hidden");
   }
 
   return LookupUserDefinedType(
@@ -436,27 +423,35 @@ MergeStatus ModuleMerger::MergeReferencingType(
 MergeStatus ModuleMerger::MergeTypeInternal(
     const repr::TypeIR *addend_node, const repr::ModuleIR &addend,
     repr::AbiElementMap<MergeStatus> *local_to_global_type_id_map) {
-  switch (addend_node->GetKind()) {
-    case repr::BuiltinTypeKind:
-      return MergeBuiltinType(
-          static_cast<const repr::BuiltinTypeIR *>(addend_node), addend,
-          local_to_global_type_id_map);
-    case repr::RecordTypeKind:
-      return MergeRecordAndDependencies(
-          static_cast<const repr::RecordTypeIR *>(addend_node), addend,
-          local_to_global_type_id_map);
-    case repr::EnumTypeKind:
-      return MergeEnumType(static_cast<const repr::EnumTypeIR *>(addend_node),
-                           addend, local_to_global_type_id_map);
-    case repr::FunctionTypeKind:
-      return MergeFunctionType(
-          static_cast<const repr::FunctionTypeIR *>(addend_node), addend,
-          local_to_global_type_id_map);
-    default:
-      return MergeReferencingType(addend, addend_node,
-                                  local_to_global_type_id_map);
-  }
-  assert(0);
+  struct TypeMerger {
+    ModuleMerger *merger_;
+    const repr::ModuleIR &addend_;
+    repr::AbiElementMap<MergeStatus> *local_to_global_type_id_map_;
+
+    MergeStatus operator()(const repr::BuiltinTypeIR &type) const {
+      return merger_->MergeBuiltinType(&type, addend_,
+                                       local_to_global_type_id_map_);
+    }
+    MergeStatus operator()(const repr::RecordTypeIR &type) const {
+      return merger_->MergeRecordAndDependencies(&type, addend_,
+                                                 local_to_global_type_id_map_);
+    }
+    MergeStatus operator()(const repr::EnumTypeIR &type) const {
+      return merger_->MergeEnumType(&type, addend_,
+                                    local_to_global_type_id_map_);
+    }
+    MergeStatus operator()(const repr::FunctionTypeIR &type) const {
+      return merger_->MergeFunctionType(&type, addend_,
+                                        local_to_global_type_id_map_);
+    }
+    // The referencing types.
+    MergeStatus operator()(const repr::TypeIR &type) const {
+      return merger_->MergeReferencingType(addend_, &type,
+                                           local_to_global_type_id_map_);
+    }
+  };
+  return repr::VisitType(
+      *addend_node, TypeMerger{this, addend, local_to_global_type_id_map});
 }
 
 
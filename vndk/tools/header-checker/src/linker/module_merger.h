@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef MODULE_MERGER_H_
+#define MODULE_MERGER_H_
+
 #include "repr/ir_representation.h"
 
 
@@ -47,6 +50,11 @@ public:
     return *module_;
   }
 
+  // The merger cannot be used after the module is taken.
+  std::unique_ptr<repr::ModuleIR> TakeModule() {
+    return std::move(module_);
+  }
+
   void MergeGraphs(const repr::ModuleIR &addend);
 
 private:
@@ -154,3 +162,6 @@ private:
 
 }  // namespace linker
 }  // namespace header_checker
+
+
+#endif  // MODULE_MERGER_H_
@@ -18,6 +18,8 @@
 
 #include <llvm/Support/raw_ostream.h>
 
+#include <algorithm>
+
 
 namespace header_checker {
 namespace repr {
@@ -215,12 +217,13 @@ DiffStatus AbiDiffHelper::CompareEnumTypes(
   }
   CompareEnumFields(old_type->GetFields(), new_type->GetFields(),
                     enum_type_diff_ir.get());
-  if ((enum_type_diff_ir->IsExtended() ||
-       enum_type_diff_ir->IsIncompatible()) &&
-      (ir_diff_dumper_ && !ir_diff_dumper_->AddDiffMessageIR(
-          enum_type_diff_ir.get(), Unwind(type_queue), diff_kind))) {
-    llvm::errs() << "AddDiffMessage on EnumTypeDiffIR failed\n";
-    ::exit(1);
+  if (enum_type_diff_ir->IsExtended() || enum_type_diff_ir->IsIncompatible()) {
+    uncacheable_events_++;
+    if (ir_diff_dumper_ && !ir_diff_dumper_->AddDiffMessageIR(
+            enum_type_diff_ir.get(), Unwind(type_queue), diff_kind)) {
+      llvm::errs() << "AddDiffMessage on EnumTypeDiffIR failed\n";
+      ::exit(1);
+    }
   }
   return DiffStatus::no_diff;
 }
@@ -244,6 +247,7 @@ bool AbiDiffHelper::CompareVTableComponents(
   if (old_component.GetName() != new_component.GetName()) {
     if (RemoveThunkInfoFromMangledName(old_component.GetName()) ==
         RemoveThunkInfoFromMangledName(new_component.GetName())) {
+      uncacheable_events_++;
       llvm::errs() << "WARNING: Ignore difference between "
                    << old_component.GetName() << " and "
                    << new_component.GetName() << "\n";
@@ -312,6 +316,53 @@ AbiDiffHelper::CompareCommonRecordFields(
 }
 
 
+// Returns the fields sorted by `less`. If several fields are equivalent, only
+// the first one in declaration order is kept.
+template <typename Less, typename Equal>
+static std::vector<const RecordFieldIR *> SortAndUniqueFields(
+    const std::vector<RecordFieldIR> &fields, Less less, Equal equal) {
+  std::vector<const RecordFieldIR *> sorted_fields;
+  sorted_fields.reserve(fields.size());
+  for (auto &&field : fields) {
+    sorted_fields.push_back(&field);
+  }
+  std::stable_sort(sorted_fields.begin(), sorted_fields.end(), less);
+  sorted_fields.erase(
+      std::unique(sorted_fields.begin(), sorted_fields.end(), equal),
+      sorted_fields.end());
+  return sorted_fields;
+}
+
+static bool FieldNameLess(const RecordFieldIR *f, const RecordFieldIR *s) {
+  return f->GetName() < s->GetName();
+}
+
+static bool FieldNameEqual(const RecordFieldIR *f, const RecordFieldIR *s) {
+  return f->GetName() == s->GetName();
+}
+
+static bool FieldOffsetLess(const RecordFieldIR *f, const RecordFieldIR *s) {
+  return f->GetOffset() < s->GetOffset();
+}
+
+static bool FieldOffsetEqual(const RecordFieldIR *f, const RecordFieldIR *s) {
+  return f->GetOffset() == s->GetOffset();
+}
+
+static const RecordFieldIR *FindFieldAtOffset(
+    const std::vector<const RecordFieldIR *> &fields_by_offset,
+    uint64_t offset) {
+  auto it = std::lower_bound(
+      fields_by_offset.begin(), fields_by_offset.end(), offset,
+      [](const RecordFieldIR *f, uint64_t offset) {
+        return f->GetOffset() < offset;
+      });
+  if (it == fields_by_offset.end() || (*it)->GetOffset() != offset) {
+    return nullptr;
+  }
+  return *it;
+}
+
 GenericFieldDiffInfo<RecordFieldIR, RecordFieldDiffIR>
 AbiDiffHelper::CompareRecordFields(
     const std::vector<RecordFieldIR> &old_fields,
@@ -320,72 +371,77 @@ AbiDiffHelper::CompareRecordFields(
     DiffMessageIR::DiffKind diff_kind) {
   GenericFieldDiffInfo<RecordFieldIR, RecordFieldDiffIR>
       diffed_removed_added_fields;
-  AbiElementMap<const RecordFieldIR *> old_fields_map;
-  AbiElementMap<const RecordFieldIR *> new_fields_map;
-  std::map<uint64_t, const RecordFieldIR *> old_fields_offset_map;
-  std::map<uint64_t, const RecordFieldIR *> new_fields_offset_map;
-
-  utils::AddToMap(
-      &old_fields_map, old_fields,
-      [](const RecordFieldIR *f) {return f->GetName();},
-      [](const RecordFieldIR *f) {return f;});
-  utils::AddToMap(
-      &new_fields_map, new_fields,
-      [](const RecordFieldIR *f) {return f->GetName();},
-      [](const RecordFieldIR *f) {return f;});
-  utils::AddToMap(
-      &old_fields_offset_map, old_fields,
-      [](const RecordFieldIR *f) {return f->GetOffset();},
-      [](const RecordFieldIR *f) {return f;});
-  utils::AddToMap(
-      &new_fields_offset_map, new_fields,
-      [](const RecordFieldIR *f) {return f->GetOffset();},
-      [](const RecordFieldIR *f) {return f;});
-  // If a field is removed from the map field_name -> offset see if another
-  // field is present at the same offset and compare the size and type etc,
-  // remove it from the removed fields if they're compatible.
-  DiffStatus final_diff_status = DiffStatus::no_diff;
-  std::vector<const RecordFieldIR *> removed_fields =
-      utils::FindRemovedElements(old_fields_map, new_fields_map);
-
-  std::vector<const RecordFieldIR *> added_fields =
-      utils::FindRemovedElements(new_fields_map, old_fields_map);
+  std::vector<const RecordFieldIR *> old_fields_by_name =
+      SortAndUniqueFields(old_fields, FieldNameLess, FieldNameEqual);
+  std::vector<const RecordFieldIR *> new_fields_by_name =
+      SortAndUniqueFields(new_fields, FieldNameLess, FieldNameEqual);
+
+  // Merge the fields by name.
+  std::vector<const RecordFieldIR *> removed_fields;
+  std::vector<const RecordFieldIR *> added_fields;
+  std::vector<std::pair<const RecordFieldIR *, const RecordFieldIR *>> cf;
+  auto old_it = old_fields_by_name.begin();
+  auto new_it = new_fields_by_name.begin();
+  while (old_it != old_fields_by_name.end() ||
+         new_it != new_fields_by_name.end()) {
+    if (new_it == new_fields_by_name.end() ||
+        (old_it != old_fields_by_name.end() &&
+         FieldNameLess(*old_it, *new_it))) {
+      removed_fields.push_back(*old_it++);
+    } else if (old_it == old_fields_by_name.end() ||
+               FieldNameLess(*new_it, *old_it)) {
+      added_fields.push_back(*new_it++);
+    } else {
+      cf.emplace_back(*old_it++, *new_it++);
+    }
+  }
 
-  auto predicate =
-      [&](const RecordFieldIR *removed_field,
-          std::map<uint64_t, const RecordFieldIR *> &field_off_map) {
-        uint64_t old_field_offset = removed_field->GetOffset();
-        auto corresponding_field_at_same_offset =
-            field_off_map.find(old_field_offset);
-        // Correctly reported as removed, so do not remove.
-        if (corresponding_field_at_same_offset == field_off_map.end()) {
-          return false;
-        }
-
-        auto comparison_result = CompareCommonRecordFields(
-            removed_field, corresponding_field_at_same_offset->second,
-            type_queue, diff_kind);
-        // No actual diff, so remove it.
-        return (comparison_result.second == nullptr);
-      };
-
-  removed_fields.erase(
-      std::remove_if(
-          removed_fields.begin(), removed_fields.end(),
-          std::bind(predicate, std::placeholders::_1, new_fields_offset_map)),
-      removed_fields.end());
-  added_fields.erase(
-      std::remove_if(
-          added_fields.begin(), added_fields.end(),
-          std::bind(predicate, std::placeholders::_1, old_fields_offset_map)),
-      added_fields.end());
+  // If a field is removed or added, see if another field is present at the
+  // same offset and compare the size and type etc. Neither of them is
+  // reported if they're compatible.
+  DiffStatus final_diff_status = DiffStatus::no_diff;
+  if (!removed_fields.empty() || !added_fields.empty()) {
+    std::vector<const RecordFieldIR *> old_fields_by_offset =
+        SortAndUniqueFields(old_fields, FieldOffsetLess, FieldOffsetEqual);
+    std::vector<const RecordFieldIR *> new_fields_by_offset =
+        SortAndUniqueFields(new_fields, FieldOffsetLess, FieldOffsetEqual);
+    // Like a removed field, an added field is the first argument of the
+    // comparison with the field at the same offset.
+    auto is_compatible_with_field_at_same_offset =
+        [&](const RecordFieldIR *field,
+            const std::vector<const RecordFieldIR *> &fields_by_offset) {
+          const RecordFieldIR *field_at_same_offset =
+              FindFieldAtOffset(fields_by_offset, field->GetOffset());
+          // Correctly reported as removed or added.
+          if (field_at_same_offset == nullptr) {
+            return false;
+          }
+          return CompareCommonRecordFields(field, field_at_same_offset,
+                                           type_queue, diff_kind).second ==
+                 nullptr;
+        };
+
+    removed_fields.erase(
+        std::remove_if(
+            removed_fields.begin(), removed_fields.end(),
+            [&](const RecordFieldIR *removed_field) {
+              return is_compatible_with_field_at_same_offset(
+                  removed_field, new_fields_by_offset);
+            }),
+        removed_fields.end());
+    added_fields.erase(
+        std::remove_if(
+            added_fields.begin(), added_fields.end(),
+            [&](const RecordFieldIR *added_field) {
+              return is_compatible_with_field_at_same_offset(
+                  added_field, old_fields_by_offset);
+            }),
+        added_fields.end());
+  }
 
   diffed_removed_added_fields.removed_fields_ = std::move(removed_fields);
   diffed_removed_added_fields.added_fields_ = std::move(added_fields);
 
-  std::vector<std::pair<
-      const RecordFieldIR *, const RecordFieldIR *>> cf =
-      utils::FindCommonElements(old_fields_map, new_fields_map);
   bool common_field_diff_exists = false;
   for (auto &&common_fields : cf) {
     auto diffed_field_ptr = CompareCommonRecordFields(
@@ -397,7 +453,7 @@ AbiDiffHelper::CompareRecordFields(
     }
     if (diffed_field_ptr.second != nullptr) {
       diffed_removed_added_fields.diffed_fields_.emplace_back(
-          std::move(*(diffed_field_ptr.second.release())));
+          std::move(*diffed_field_ptr.second));
     }
   }
   if (diffed_removed_added_fields.diffed_fields_.size() != 0 ||
@@ -619,11 +675,13 @@ DiffStatus AbiDiffHelper::CompareRecordTypes(
     record_type_diff_ir->SetFieldsRemoved(std::move(fields_removed_fixed));
     record_type_diff_ir->SetFieldsAdded(std::move(fields_added_fixed));
 
-    if (record_type_diff_ir->DiffExists() &&
-        !ir_diff_dumper_->AddDiffMessageIR(record_type_diff_ir.get(),
-                                           Unwind(type_queue), diff_kind)) {
-      llvm::errs() << "AddDiffMessage on record type failed\n";
-      ::exit(1);
+    if (record_type_diff_ir->DiffExists()) {
+      uncacheable_events_++;
+      if (!ir_diff_dumper_->AddDiffMessageIR(record_type_diff_ir.get(),
+                                             Unwind(type_queue), diff_kind)) {
+        llvm::errs() << "AddDiffMessage on record type failed\n";
+        ::exit(1);
+      }
     }
   }
 
@@ -730,63 +788,60 @@ DiffStatus AbiDiffHelper::CompareFunctionParameters(
 
 DiffStatus AbiDiffHelper::CompareAndDumpTypeDiff(
     const TypeIR *old_type, const TypeIR *new_type,
-    LinkableMessageKind kind, std::deque<std::string> *type_queue,
+    std::deque<std::string> *type_queue,
     DiffMessageIR::DiffKind diff_kind) {
-  if (kind == LinkableMessageKind::BuiltinTypeKind) {
-    return CompareBuiltinTypes(
-        static_cast<const BuiltinTypeIR *>(old_type),
-        static_cast<const BuiltinTypeIR *>(new_type));
-  }
-
-  if (kind == LinkableMessageKind::QualifiedTypeKind) {
-    return CompareQualifiedTypes(
-        static_cast<const QualifiedTypeIR *>(old_type),
-        static_cast<const QualifiedTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::EnumTypeKind) {
-    return CompareEnumTypes(
-        static_cast<const EnumTypeIR *>(old_type),
-        static_cast<const EnumTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::LvalueReferenceTypeKind) {
-    return CompareLvalueReferenceTypes(
-        static_cast<const LvalueReferenceTypeIR *>(old_type),
-        static_cast<const LvalueReferenceTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::RvalueReferenceTypeKind) {
-    return CompareRvalueReferenceTypes(
-        static_cast<const RvalueReferenceTypeIR *>(old_type),
-        static_cast<const RvalueReferenceTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::PointerTypeKind) {
-    return ComparePointerTypes(
-        static_cast<const PointerTypeIR *>(old_type),
-        static_cast<const PointerTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::RecordTypeKind) {
-    return CompareRecordTypes(
-        static_cast<const RecordTypeIR *>(old_type),
-        static_cast<const RecordTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-
-  if (kind == LinkableMessageKind::FunctionTypeKind) {
-    return CompareFunctionTypes(
-        static_cast<const FunctionTypeIR *>(old_type),
-        static_cast<const FunctionTypeIR *>(new_type),
-        type_queue, diff_kind);
-  }
-  return DiffStatus::no_diff;
+  // Compares the visited old type with the new type of the same kind.
+  struct TypeComparator {
+    AbiDiffHelper *helper_;
+    const TypeIR *new_type_;
+    std::deque<std::string> *type_queue_;
+    DiffMessageIR::DiffKind diff_kind_;
+
+    DiffStatus operator()(const BuiltinTypeIR &old_type) const {
+      return helper_->CompareBuiltinTypes(
+          &old_type, static_cast<const BuiltinTypeIR *>(new_type_));
+    }
+    DiffStatus operator()(const QualifiedTypeIR &old_type) const {
+      return helper_->CompareQualifiedTypes(
+          &old_type, static_cast<const QualifiedTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const EnumTypeIR &old_type) const {
+      return helper_->CompareEnumTypes(
+          &old_type, static_cast<const EnumTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const LvalueReferenceTypeIR &old_type) const {
+      return helper_->CompareLvalueReferenceTypes(
+          &old_type, static_cast<const LvalueReferenceTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const RvalueReferenceTypeIR &old_type) const {
+      return helper_->CompareRvalueReferenceTypes(
+          &old_type, static_cast<const RvalueReferenceTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const PointerTypeIR &old_type) const {
+      return helper_->ComparePointerTypes(
+          &old_type, static_cast<const PointerTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const RecordTypeIR &old_type) const {
+      return helper_->CompareRecordTypes(
+          &old_type, static_cast<const RecordTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const FunctionTypeIR &old_type) const {
+      return helper_->CompareFunctionTypes(
+          &old_type, static_cast<const FunctionTypeIR *>(new_type_),
+          type_queue_, diff_kind_);
+    }
+    DiffStatus operator()(const ArrayTypeIR &) const {
+      return DiffStatus::no_diff;
+    }
+  };
+  return VisitType(*old_type,
+                   TypeComparator{this, new_type, type_queue, diff_kind});
 }
 
 static DiffStatus CompareDistinctKindMessages(
@@ -804,9 +859,35 @@ DiffStatus AbiDiffHelper::CompareAndDumpTypeDiff(
   // Check the map for type ids which have already been compared
   // These types have already been diffed, return without further comparison.
   if (!type_cache_->insert(old_type_id + new_type_id).second) {
+    uncacheable_events_++;
+    return DiffStatus::no_diff;
+  }
+
+  std::pair<const std::string *, const std::string *> fingerprints(nullptr,
+                                                                   nullptr);
+  if (type_equivalence_checker_ &&
+      type_equivalence_checker_->IsEquivalent(old_type_id, new_type_id,
+                                              &fingerprints)) {
     return DiffStatus::no_diff;
   }
 
+  // The result is cached only if the whole comparison is independent of the
+  // types compared earlier and reports nothing.
+  uint64_t uncacheable_events = uncacheable_events_;
+  DiffStatus diff_status = CompareTypeIds(old_type_id, new_type_id,
+                                          type_queue, diff_kind);
+  if (diff_status != DiffStatus::no_diff) {
+    uncacheable_events_++;
+  } else if (fingerprints.first && uncacheable_events == uncacheable_events_) {
+    type_equivalence_checker_->AddEquivalent(fingerprints);
+  }
+  return diff_status;
+}
+
+DiffStatus AbiDiffHelper::CompareTypeIds(
+    const std::string &old_type_id, const std::string &new_type_id,
+    std::deque<std::string> *type_queue,
+    DiffMessageIR::DiffKind diff_kind) {
   TypeQueueCheckAndPushBack(
       type_queue, ConvertTypeIdToString(old_types_,old_type_id));
 
@@ -830,8 +911,8 @@ DiffStatus AbiDiffHelper::CompareAndDumpTypeDiff(
   if (old_kind != new_kind) {
     diff_status = CompareDistinctKindMessages(old_it->second, new_it->second);
   } else {
-    diff_status = CompareAndDumpTypeDiff(old_it->second , new_it->second ,
-                                         old_kind, type_queue, diff_kind);
+    diff_status = CompareAndDumpTypeDiff(old_it->second, new_it->second,
+                                         type_queue, diff_kind);
   }
 
   TypeQueueCheckAndPop(type_queue);
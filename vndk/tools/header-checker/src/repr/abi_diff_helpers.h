@@ -18,6 +18,7 @@
 #include "repr/ir_diff_dumper.h"
 #include "repr/ir_diff_representation.h"
 #include "repr/ir_representation.h"
+#include "repr/type_equivalence_cache.h"
 
 #include <deque>
 
@@ -80,10 +81,12 @@ class AbiDiffHelper {
       const AbiElementMap<const TypeIR *> &new_types,
       const DiffPolicyOptions &diff_policy_options,
       std::set<std::string> *type_cache,
-      IRDiffDumper *ir_diff_dumper = nullptr)
+      IRDiffDumper *ir_diff_dumper = nullptr,
+      TypeEquivalenceChecker *type_equivalence_checker = nullptr)
       : old_types_(old_types), new_types_(new_types),
         diff_policy_options_(diff_policy_options), type_cache_(type_cache),
-        ir_diff_dumper_(ir_diff_dumper) {}
+        ir_diff_dumper_(ir_diff_dumper),
+        type_equivalence_checker_(type_equivalence_checker) {}
 
   DiffStatus CompareAndDumpTypeDiff(
       const std::string &old_type_str, const std::string &new_type_str,
@@ -92,7 +95,6 @@ class AbiDiffHelper {
 
   DiffStatus CompareAndDumpTypeDiff(
       const TypeIR *old_type, const TypeIR *new_type,
-      LinkableMessageKind kind,
       std::deque<std::string> *type_queue = nullptr,
       IRDiffDumper::DiffKind diff_kind = DiffMessageIR::Unreferenced);
 
@@ -126,6 +128,11 @@ class AbiDiffHelper {
 
 
  private:
+  DiffStatus CompareTypeIds(
+      const std::string &old_type_id, const std::string &new_type_id,
+      std::deque<std::string> *type_queue,
+      IRDiffDumper::DiffKind diff_kind);
+
   DiffStatus CompareQualifiedTypes(const QualifiedTypeIR *old_type,
                                    const QualifiedTypeIR *new_type,
                                    std::deque<std::string> *type_queue,
@@ -209,6 +216,10 @@ class AbiDiffHelper {
   const DiffPolicyOptions &diff_policy_options_;
   std::set<std::string> *type_cache_;
   IRDiffDumper *ir_diff_dumper_;
+  TypeEquivalenceChecker *type_equivalence_checker_;
+  // Counts the diffs, warnings, and type cache hits, which make the result of
+  // a comparison unsuitable for the type equivalence cache.
+  uint64_t uncacheable_events_ = 0;
 };
 
 void ReplaceTypeIdsWithTypeNames(
@@ -0,0 +1,296 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "repr/abi_index.h"
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+
+namespace header_checker {
+namespace repr {
+
+
+static const char kIndexHeader[] = "header-abi-index-2";
+// A truncated index must not be mistaken for one with fewer elements.
+static const char kIndexFooter[] = "end";
+static const char kFieldSeparator = '\t';
+
+
+static bool IsTypeKey(llvm::StringRef key) {
+  return key != "functions" && key != "global_vars" &&
+         key != "elf_functions" && key != "elf_objects";
+}
+
+
+static std::string HashDump(llvm::StringRef dump) {
+  llvm::MD5 md5;
+  md5.update(dump);
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  return std::string(result.digest());
+}
+
+
+std::string AbiIndex::GetIndexPath(const std::string &dump_path) {
+  return dump_path + ".index";
+}
+
+void AbiIndex::SetDump(llvm::StringRef dump) {
+  dump_size_ = dump.size();
+  dump_hash_ = HashDump(dump);
+}
+
+bool AbiIndex::IsIndexOf(llvm::StringRef dump) const {
+  return dump.size() == dump_size_ && HashDump(dump) == dump_hash_;
+}
+
+void AbiIndex::AddLinkableMessage(const std::string &key,
+                                  const LinkableMessageIR &lm, uint64_t offset,
+                                  uint64_t length) {
+  AbiIndexEntry entry;
+  entry.key_ = key;
+  switch (lm.GetKind()) {
+    case FunctionKind:
+    case GlobalVarKind:
+      entry.id_ = lm.GetLinkerSetKey();
+      break;
+    default:
+      entry.id_ = static_cast<const TypeIR &>(lm).GetSelfType();
+      break;
+  }
+  entry.offset_ = offset;
+  entry.length_ = length;
+  CollectReferencedTypes(lm, &entry.referenced_types_);
+  entries_.emplace_back(std::move(entry));
+}
+
+void AbiIndex::AddElfSymbol(const std::string &key,
+                            const ElfSymbolIR &elf_symbol, uint64_t offset,
+                            uint64_t length) {
+  AbiIndexEntry entry;
+  entry.key_ = key;
+  entry.id_ = elf_symbol.GetName();
+  entry.offset_ = offset;
+  entry.length_ = length;
+  entries_.emplace_back(std::move(entry));
+}
+
+void AbiIndex::RelocateEntries(const std::string &key, uint64_t offset) {
+  for (auto &&entry : entries_) {
+    if (entry.key_ == key) {
+      entry.offset_ += offset;
+    }
+  }
+}
+
+bool AbiIndex::Write(const std::string &index_path) const {
+  std::error_code ec;
+  llvm::raw_fd_ostream out(index_path, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    llvm::errs() << "Failed to open " << index_path << ": " << ec.message()
+                 << "\n";
+    return false;
+  }
+  out << kIndexHeader << "\n" << dump_size_ << "\n" << dump_hash_ << "\n";
+  for (auto &&entry : entries_) {
+    out << entry.key_ << kFieldSeparator << entry.id_ << kFieldSeparator
+        << entry.offset_ << kFieldSeparator << entry.length_;
+    for (auto &&type_id : entry.referenced_types_) {
+      out << kFieldSeparator << type_id;
+    }
+    out << "\n";
+  }
+  out << kIndexFooter << "\n";
+  out.close();
+  if (out.has_error()) {
+    out.clear_error();
+    llvm::sys::fs::remove(index_path);
+    return false;
+  }
+  return true;
+}
+
+bool AbiIndex::Read(const std::string &index_path) {
+  auto buffer = llvm::MemoryBuffer::getFile(index_path);
+  if (!buffer) {
+    return false;
+  }
+  llvm::SmallVector<llvm::StringRef, 0> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  if (lines.size() < 4 || lines[0] != kIndexHeader ||
+      lines.back() != kIndexFooter ||
+      lines[1].getAsInteger(10, dump_size_)) {
+    return false;
+  }
+  dump_hash_ = lines[2].str();
+  entries_.clear();
+  entries_.reserve(lines.size() - 4);
+  llvm::SmallVector<llvm::StringRef, 16> fields;
+  for (size_t i = 3; i + 1 < lines.size(); i++) {
+    fields.clear();
+    lines[i].split(fields, kFieldSeparator);
+    AbiIndexEntry entry;
+    if (fields.size() < 4 || fields[2].getAsInteger(10, entry.offset_) ||
+        fields[3].getAsInteger(10, entry.length_)) {
+      return false;
+    }
+    entry.key_ = fields[0].str();
+    entry.id_ = fields[1].str();
+    for (size_t j = 4; j < fields.size(); j++) {
+      entry.referenced_types_.emplace_back(fields[j].str());
+    }
+    entries_.emplace_back(std::move(entry));
+  }
+  return true;
+}
+
+std::vector<const AbiIndexEntry *> AbiIndex::GetReachableEntries() const {
+  std::vector<const AbiIndexEntry *> result;
+  std::multimap<llvm::StringRef, const AbiIndexEntry *> types;
+  std::deque<llvm::StringRef> queue;
+  for (auto &&entry : entries_) {
+    if (IsTypeKey(entry.key_)) {
+      types.emplace(entry.id_, &entry);
+      continue;
+    }
+    result.emplace_back(&entry);
+    queue.insert(queue.end(), entry.referenced_types_.begin(),
+                 entry.referenced_types_.end());
+  }
+  // Each type is visited once, as it is removed from the map.
+  while (!queue.empty()) {
+    auto range = types.equal_range(queue.front());
+    queue.pop_front();
+    for (auto it = range.first; it != range.second; ++it) {
+      result.emplace_back(it->second);
+      queue.insert(queue.end(), it->second->referenced_types_.begin(),
+                   it->second->referenced_types_.end());
+    }
+    types.erase(range.first, range.second);
+  }
+  std::sort(result.begin(), result.end(),
+            [](const AbiIndexEntry *lhs, const AbiIndexEntry *rhs) {
+              return lhs->offset_ < rhs->offset_;
+            });
+  return result;
+}
+
+
+static void AddTemplateElements(const TemplatedArtifactIR &templated,
+                                std::vector<std::string> *type_ids) {
+  for (auto &&element : templated.GetTemplateElements()) {
+    type_ids->emplace_back(element.GetReferencedType());
+  }
+}
+
+static void AddReturnTypeAndParameters(const CFunctionLikeIR &function,
+                                       std::vector<std::string> *type_ids) {
+  type_ids->emplace_back(function.GetReturnType());
+  for (auto &&parameter : function.GetParameters()) {
+    type_ids->emplace_back(parameter.GetReferencedType());
+  }
+}
+
+void CollectReferencedTypes(const LinkableMessageIR &lm,
+                            std::vector<std::string> *type_ids) {
+  switch (lm.GetKind()) {
+    case FunctionKind: {
+      auto &&function = static_cast<const FunctionIR &>(lm);
+      AddReturnTypeAndParameters(function, type_ids);
+      AddTemplateElements(function, type_ids);
+      return;
+    }
+    case GlobalVarKind:
+      type_ids->emplace_back(
+          static_cast<const GlobalVarIR &>(lm).GetReferencedType());
+      return;
+    default:
+      break;
+  }
+  auto &&type = static_cast<const TypeIR &>(lm);
+  type_ids->emplace_back(type.GetReferencedType());
+  switch (type.GetKind()) {
+    case RecordTypeKind: {
+      auto &&record = static_cast<const RecordTypeIR &>(type);
+      for (auto &&field : record.GetFields()) {
+        type_ids->emplace_back(field.GetReferencedType());
+      }
+      for (auto &&base : record.GetBases()) {
+        type_ids->emplace_back(base.GetReferencedType());
+      }
+      AddTemplateElements(record, type_ids);
+      break;
+    }
+    case EnumTypeKind:
+      type_ids->emplace_back(
+          static_cast<const EnumTypeIR &>(type).GetUnderlyingType());
+      break;
+    case FunctionTypeKind:
+      AddReturnTypeAndParameters(static_cast<const FunctionTypeIR &>(type),
+                                 type_ids);
+      break;
+    default:
+      break;
+  }
+}
+
+const char *GetAbiIndexKey(LinkableMessageKind kind) {
+  switch (kind) {
+    case RecordTypeKind:
+      return "record_types";
+    case EnumTypeKind:
+      return "enum_types";
+    case PointerTypeKind:
+      return "pointer_types";
+    case QualifiedTypeKind:
+      return "qualified_types";
+    case ArrayTypeKind:
+      return "array_types";
+    case LvalueReferenceTypeKind:
+      return "lvalue_reference_types";
+    case RvalueReferenceTypeKind:
+      return "rvalue_reference_types";
+    case BuiltinTypeKind:
+      return "builtin_types";
+    case FunctionTypeKind:
+      return "function_types";
+    case FunctionKind:
+      return "functions";
+    case GlobalVarKind:
+      return "global_vars";
+  }
+  return "";
+}
+
+const char *GetAbiIndexKey(ElfSymbolIR::ElfSymbolKind kind) {
+  switch (kind) {
+    case ElfSymbolIR::ElfFunctionKind:
+      return "elf_functions";
+    case ElfSymbolIR::ElfObjectKind:
+      return "elf_objects";
+  }
+  return "";
+}
+
+
+}  // namespace repr
+}  // namespace header_checker
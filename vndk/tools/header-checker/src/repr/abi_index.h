@@ -0,0 +1,104 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HEADER_CHECKER_REPR_ABI_INDEX_H_
+#define HEADER_CHECKER_REPR_ABI_INDEX_H_
+
+#include "repr/ir_representation.h"
+
+#include <llvm/ADT/StringRef.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace repr {
+
+
+// An element of a dump in the index.
+struct AbiIndexEntry {
+  // The name of the array or the repeated field, e.g., "record_types".
+  std::string key_;
+  // The self type of a type, the linker set key of a function or a variable,
+  // or the name of an ELF symbol.
+  std::string id_;
+  // The byte range of the element in the uncompressed dump.
+  uint64_t offset_;
+  uint64_t length_;
+  // The ids of the types that the element refers to.
+  std::vector<std::string> referenced_types_;
+};
+
+
+// The index of a dump is written to <dump>.index. It allows a reader to load
+// the functions, the global variables, the ELF symbols, and only the types
+// reachable from them, without parsing the other types.
+class AbiIndex {
+ public:
+  static std::string GetIndexPath(const std::string &dump_path);
+
+  // Records the size and the MD5 hash of the uncompressed dump.
+  void SetDump(llvm::StringRef dump);
+
+  // Returns whether the index was written for this uncompressed dump. The
+  // index of an earlier dump at the same path does not match.
+  bool IsIndexOf(llvm::StringRef dump) const;
+
+  const std::vector<AbiIndexEntry> &GetEntries() const {
+    return entries_;
+  }
+
+  void AddLinkableMessage(const std::string &key, const LinkableMessageIR &lm,
+                          uint64_t offset, uint64_t length);
+
+  void AddElfSymbol(const std::string &key, const ElfSymbolIR &elf_symbol,
+                    uint64_t offset, uint64_t length);
+
+  // Adds the offset to the entries of the array. The JSON dumper records the
+  // offsets in each array before the arrays are written.
+  void RelocateEntries(const std::string &key, uint64_t offset);
+
+  bool Write(const std::string &index_path) const;
+
+  // Returns false if the index does not exist or is malformed.
+  bool Read(const std::string &index_path);
+
+  // Returns the entries of the functions, the global variables, the ELF
+  // symbols, and the types reachable from them, in the order of the offsets.
+  std::vector<const AbiIndexEntry *> GetReachableEntries() const;
+
+ private:
+  uint64_t dump_size_ = 0;
+  std::string dump_hash_;
+  std::vector<AbiIndexEntry> entries_;
+};
+
+
+// Appends the ids of the types that the element directly refers to.
+void CollectReferencedTypes(const LinkableMessageIR &lm,
+                            std::vector<std::string> *type_ids);
+
+// Returns the name of the array of the element kind in the dumps.
+const char *GetAbiIndexKey(LinkableMessageKind kind);
+
+const char *GetAbiIndexKey(ElfSymbolIR::ElfSymbolKind kind);
+
+
+}  // namespace repr
+}  // namespace header_checker
+
+
+#endif  // HEADER_CHECKER_REPR_ABI_INDEX_H_
@@ -17,6 +17,7 @@
 
 #include "repr/ir_diff_representation.h"
 
+#include <cstdint>
 #include <string>
 
 
@@ -56,8 +57,21 @@ class IRDiffDumper {
   static std::unique_ptr<IRDiffDumper> CreateIRDiffDumper(
       TextFormatIR, const std::string &dump_path);
 
+  // The caller is expected to stop adding diffs once this many incompatible
+  // diffs have been added. 0 means no limit.
+  void SetIncompatibleDiffLimit(uint64_t limit) {
+    incompatible_diff_limit_ = limit;
+  }
+
+  bool IsIncompatibleDiffLimitReached() const {
+    return incompatible_diff_limit_ != 0 &&
+        incompatible_diff_count_ >= incompatible_diff_limit_;
+  }
+
  protected:
   const std::string &dump_path_;
+  uint64_t incompatible_diff_limit_ = 0;
+  uint64_t incompatible_diff_count_ = 0;
 };
 
 
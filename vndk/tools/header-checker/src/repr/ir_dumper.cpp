@@ -16,8 +16,11 @@
 
 #include "repr/json/api.h"
 #include "repr/protobuf/api.h"
+#include "utils/compressed_file.h"
 
 #include <algorithm>
+#include <cassert>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <vector>
@@ -63,49 +66,82 @@ static std::vector<const T *> SortAbiElements(const AbiElementMap<T> &m) {
 }
 
 
-bool IRDumper::DumpModule(const ModuleIR &module) {
-  for (auto &&item : SortAbiElements(module.GetFunctions())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetGlobalVariables())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetRecordTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetFunctionTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetEnumTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetLvalueReferenceTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetRvalueReferenceTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetQualifiedTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetArrayTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetPointerTypes())) {
-    AddLinkableMessageIR(item);
-  }
-  for (auto &&item : SortAbiElements(module.GetBuiltinTypes())) {
-    AddLinkableMessageIR(item);
-  }
+// The elements are visited in the order of the fields of the protobuf
+// TranslationUnit, so that a streamed protobuf dump is identical to the
+// output of Dump().
+template <typename LinkableMessageCallback, typename ElfSymbolCallback>
+static bool ForEachSortedElement(const ModuleIR &module,
+                                 LinkableMessageCallback lm_callback,
+                                 ElfSymbolCallback elf_callback) {
+  bool ok = true;
+  auto &&visit_all = [&](auto &&elements) {
+    for (auto &&item : SortAbiElements(elements)) {
+      ok = lm_callback(*item) && ok;
+    }
+  };
+  visit_all(module.GetRecordTypes());
+  visit_all(module.GetEnumTypes());
+  visit_all(module.GetPointerTypes());
+  visit_all(module.GetLvalueReferenceTypes());
+  visit_all(module.GetRvalueReferenceTypes());
+  visit_all(module.GetBuiltinTypes());
+  visit_all(module.GetQualifiedTypes());
+  visit_all(module.GetArrayTypes());
+  visit_all(module.GetFunctions());
+  visit_all(module.GetGlobalVariables());
   for (auto &&item : module.GetElfFunctions()) {
-    AddElfSymbolMessageIR(&item.second);
+    ok = elf_callback(item.second) && ok;
   }
   for (auto &&item : module.GetElfObjects()) {
-    AddElfSymbolMessageIR(&item.second);
+    ok = elf_callback(item.second) && ok;
   }
+  visit_all(module.GetFunctionTypes());
+  return ok;
+}
+
+
+bool IRDumper::DumpModule(const ModuleIR &module) {
+  ForEachSortedElement(
+      module,
+      [this](const LinkableMessageIR &lm) {
+        return AddLinkableMessageIR(&lm);
+      },
+      [this](const ElfSymbolIR &elf_symbol) {
+        return AddElfSymbolMessageIR(&elf_symbol);
+      });
   return true;
 }
 
 
+bool IRDumper::DumpModuleWithIndex(const ModuleIR &module) {
+  assert(index_ != nullptr);
+  index_ = std::make_unique<AbiIndex>();
+  if (!BeginStream()) {
+    return false;
+  }
+  bool ok = ForEachSortedElement(
+      module,
+      [this](const LinkableMessageIR &lm) {
+        return StreamLinkableMessage(lm);
+      },
+      [this](const ElfSymbolIR &elf_symbol) {
+        return StreamElfSymbol(elf_symbol);
+      });
+  if (!EndStream() || !ok) {
+    return false;
+  }
+  // The reader verifies the index against the content of the dump.
+  utils::InputFileStream input(dump_path_);
+  std::string dump((std::istreambuf_iterator<char>(input)),
+                   std::istreambuf_iterator<char>());
+  if (!input.IsOpen() || input.HasError()) {
+    llvm::errs() << "Failed to read " << dump_path_ << "\n";
+    return false;
+  }
+  index_->SetDump(dump);
+  return index_->Write(AbiIndex::GetIndexPath(dump_path_));
+}
+
+
 }  // namespace repr
 }  // header_checker
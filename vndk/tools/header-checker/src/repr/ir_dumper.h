@@ -15,8 +15,11 @@
 #ifndef HEADER_CHECKER_REPR_IR_DUMPER_H_
 #define HEADER_CHECKER_REPR_IR_DUMPER_H_
 
+#include "repr/abi_index.h"
 #include "repr/ir_representation.h"
+#include "utils/compressed_file.h"
 
+#include <memory>
 #include <string>
 
 
@@ -33,17 +36,49 @@ class IRDumper {
   static std::unique_ptr<IRDumper> CreateIRDumper(
       TextFormatIR text_format, const std::string &dump_path);
 
+  void SetCompression(utils::CompressionFormat compression) {
+    compression_ = compression;
+  }
+
+  // Dump() also writes <dump>.index, which lets a reader skip the types that
+  // are unreachable from the functions and the global variables.
+  void SetWriteIndex(bool write_index) {
+    if (write_index) {
+      index_ = std::make_unique<AbiIndex>();
+    } else {
+      index_.reset();
+    }
+  }
+
   virtual bool Dump(const ModuleIR &module) = 0;
 
+  // The streaming interface writes the elements as they are added, without a
+  // ModuleIR. The elements are not sorted or deduplicated, so the output is
+  // equivalent to that of Dump() after sorting if the caller adds each
+  // element once.
+  virtual bool BeginStream() = 0;
+
+  virtual bool StreamLinkableMessage(const LinkableMessageIR &lm) = 0;
+
+  virtual bool StreamElfSymbol(const ElfSymbolIR &elf_symbol) = 0;
+
+  virtual bool EndStream() = 0;
+
  protected:
   bool DumpModule(const ModuleIR &module);
 
+  // Streams the sorted elements of the module and writes the index. The
+  // subclasses record the byte range of each element in index_.
+  bool DumpModuleWithIndex(const ModuleIR &module);
+
   virtual bool AddLinkableMessageIR(const LinkableMessageIR *) = 0;
 
   virtual bool AddElfSymbolMessageIR(const ElfSymbolIR *) = 0;
 
  protected:
   const std::string &dump_path_;
+  utils::CompressionFormat compression_ = utils::CompressionFormat::None;
+  std::unique_ptr<AbiIndex> index_;
 };
 
 
@@ -17,12 +17,16 @@
 #include "repr/ir_representation.h"
 #include "repr/json/api.h"
 #include "repr/protobuf/api.h"
+#include "utils/compressed_file.h"
 
+#include <iterator>
 #include <list>
 #include <memory>
 #include <set>
+#include <sstream>
 #include <string>
 
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/raw_ostream.h>
 
 
@@ -45,9 +49,67 @@ IRReader::CreateIRReader(
 }
 
 
+bool IRReader::AssembleReachableElements(const std::string &dump_file,
+                                         std::string *reachable_elements) {
+  AbiIndex index;
+  if (!index.Read(AbiIndex::GetIndexPath(dump_file))) {
+    return false;
+  }
+  // An uncompressed dump is mapped rather than copied.
+  auto buffer = llvm::MemoryBuffer::getFile(dump_file, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    return false;
+  }
+  llvm::StringRef dump = (*buffer)->getBuffer();
+  std::string decompressed;
+  if (utils::DetectCompressionFormat(dump.data(), dump.size()) !=
+      utils::CompressionFormat::None) {
+    buffer->reset();
+    utils::InputFileStream input(dump_file);
+    decompressed.assign(std::istreambuf_iterator<char>(input),
+                        std::istreambuf_iterator<char>());
+    if (input.HasError()) {
+      return false;
+    }
+    dump = decompressed;
+  }
+  // The index may belong to an earlier dump at the same path, even if the
+  // index is newer or the sizes are equal.
+  if (!index.IsIndexOf(dump)) {
+    return false;
+  }
+  std::vector<const AbiIndexEntry *> entries = index.GetReachableEntries();
+  for (auto &&entry : entries) {
+    if (entry->offset_ > dump.size() ||
+        entry->length_ > dump.size() - entry->offset_) {
+      return false;
+    }
+  }
+  *reachable_elements = AssembleDump(dump, entries);
+  return true;
+}
+
+
 bool IRReader::ReadDump(const std::string &dump_file) {
   module_->SetCompilationUnitPath(dump_file);
-  return ReadDumpImpl(dump_file);
+  std::string reachable_elements;
+  if (lazy_loading_ &&
+      AssembleReachableElements(dump_file, &reachable_elements)) {
+    std::istringstream input(std::move(reachable_elements));
+    return ReadDumpImpl(input);
+  }
+  utils::InputFileStream input(dump_file);
+  if (!input.IsOpen()) {
+    llvm::errs() << "Failed to open " << dump_file << "\n";
+    return false;
+  }
+  bool ok = ReadDumpImpl(input);
+  if (input.HasError()) {
+    llvm::errs() << "Failed to decompress " << dump_file << "\n";
+    return false;
+  }
+  return ok;
 }
 
 
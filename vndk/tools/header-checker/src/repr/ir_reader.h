@@ -15,11 +15,21 @@
 #ifndef HEADER_CHECKER_REPR_IR_READER_H_
 #define HEADER_CHECKER_REPR_IR_READER_H_
 
+#include "repr/abi_index.h"
 #include "repr/ir_representation.h"
 
+#include <llvm/ADT/StringRef.h>
+
+#include <istream>
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
+
+
+namespace llvm {
+class ThreadPool;
+}  // namespace llvm
 
 
 namespace header_checker {
@@ -37,6 +47,20 @@ class IRReader {
 
   virtual ~IRReader() {}
 
+  // If the dump has a valid index, ReadDump() loads only the functions, the
+  // global variables, the ELF symbols, and the types reachable from them.
+  void SetLazyLoading(bool lazy_loading) {
+    lazy_loading_ = lazy_loading;
+  }
+
+  // If a thread pool is set, the sections of a large dump are parsed on the
+  // pool. ReadDump() must not be called on a thread of the pool. Without a
+  // pool, the dump is parsed on the calling thread.
+  void SetThreadPool(llvm::ThreadPool *thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
+  // The dump may be compressed with gzip or zstd.
   bool ReadDump(const std::string &dump_file);
 
   ModuleIR &GetModule() {
@@ -48,10 +72,23 @@ class IRReader {
   }
 
  private:
-  virtual bool ReadDumpImpl(const std::string &dump_file) = 0;
+  virtual bool ReadDumpImpl(std::istream &input) = 0;
+
+  // Returns a dump that consists of the elements. The elements are in the
+  // order of the offsets.
+  virtual std::string AssembleDump(
+      llvm::StringRef dump,
+      const std::vector<const AbiIndexEntry *> &entries) = 0;
+
+  // Returns false if the dump cannot be read with the index. The caller
+  // falls back to reading the whole dump.
+  bool AssembleReachableElements(const std::string &dump_file,
+                                 std::string *reachable_elements);
 
  protected:
   std::unique_ptr<ModuleIR> module_;
+  bool lazy_loading_ = false;
+  llvm::ThreadPool *thread_pool_ = nullptr;
 };
 
 
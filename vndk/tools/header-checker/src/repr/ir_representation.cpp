@@ -24,64 +24,68 @@ namespace header_checker {
 namespace repr {
 
 
-template <typename T, typename U>
-static inline T CreateTemp(const U &lm) {
-  // Cast source const reference to destination const reference and then create
-  // a temporary copy.
-  return static_cast<const T &>(lm);
+void TypeIRDeleter::operator()(TypeIR *type) const {
+  VisitType(*type, [](const auto &derived) { delete &derived; });
 }
 
 
 bool ModuleIR::AddLinkableMessage(const LinkableMessageIR &lm) {
-  switch (lm.GetKind()) {
-    case RecordTypeKind:
-      AddRecordType(CreateTemp<RecordTypeIR>(lm));
-      return true;
-    case EnumTypeKind:
-      AddEnumType(CreateTemp<EnumTypeIR>(lm));
-      return true;
-    case PointerTypeKind:
-      AddPointerType(CreateTemp<PointerTypeIR>(lm));
-      return true;
-    case QualifiedTypeKind:
-      AddQualifiedType(CreateTemp<QualifiedTypeIR>(lm));
-      return true;
-    case ArrayTypeKind:
-      AddArrayType(CreateTemp<ArrayTypeIR>(lm));
-      return true;
-    case LvalueReferenceTypeKind:
-      AddLvalueReferenceType(CreateTemp<LvalueReferenceTypeIR>(lm));
-      return true;
-    case RvalueReferenceTypeKind:
-      AddRvalueReferenceType(CreateTemp<RvalueReferenceTypeIR>(lm));
-      return true;
-    case BuiltinTypeKind:
-      AddBuiltinType(CreateTemp<BuiltinTypeIR>(lm));
-      return true;
-    case FunctionTypeKind:
-      AddFunctionType(CreateTemp<FunctionTypeIR>(lm));
-      return true;
-    case GlobalVarKind:
-      AddGlobalVariable(CreateTemp<GlobalVarIR>(lm));
-      return true;
-    case FunctionKind:
-      AddFunction(CreateTemp<FunctionIR>(lm));
-      return true;
-  }
-  return false;
+  // Adds a temporary copy of the message.
+  struct Adder {
+    ModuleIR *module_;
+
+    void operator()(const RecordTypeIR &type) const {
+      module_->AddRecordType(RecordTypeIR(type));
+    }
+    void operator()(const EnumTypeIR &type) const {
+      module_->AddEnumType(EnumTypeIR(type));
+    }
+    void operator()(const PointerTypeIR &type) const {
+      module_->AddPointerType(PointerTypeIR(type));
+    }
+    void operator()(const QualifiedTypeIR &type) const {
+      module_->AddQualifiedType(QualifiedTypeIR(type));
+    }
+    void operator()(const ArrayTypeIR &type) const {
+      module_->AddArrayType(ArrayTypeIR(type));
+    }
+    void operator()(const LvalueReferenceTypeIR &type) const {
+      module_->AddLvalueReferenceType(LvalueReferenceTypeIR(type));
+    }
+    void operator()(const RvalueReferenceTypeIR &type) const {
+      module_->AddRvalueReferenceType(RvalueReferenceTypeIR(type));
+    }
+    void operator()(const BuiltinTypeIR &type) const {
+      module_->AddBuiltinType(BuiltinTypeIR(type));
+    }
+    void operator()(const FunctionTypeIR &type) const {
+      module_->AddFunctionType(FunctionTypeIR(type));
+    }
+    void operator()(const GlobalVarIR &global_var) const {
+      module_->AddGlobalVariable(GlobalVarIR(global_var));
+    }
+    void operator()(const FunctionIR &function) const {
+      module_->AddFunction(FunctionIR(function));
+    }
+  };
+  VisitLinkableMessage(lm, Adder{this});
+  return true;
 }
 
 
 bool ModuleIR::AddElfSymbol(const ElfSymbolIR &elf_symbol) {
-  switch (elf_symbol.GetKind()) {
-    case ElfSymbolIR::ElfFunctionKind:
-      AddElfFunction(CreateTemp<ElfFunctionIR>(elf_symbol));
-      return true;
-    case ElfSymbolIR::ElfObjectKind:
-      AddElfObject(CreateTemp<ElfObjectIR>(elf_symbol));
-      return true;
-  }
-  return false;
+  struct Adder {
+    ModuleIR *module_;
+
+    void operator()(const ElfFunctionIR &elf_function) const {
+      module_->AddElfFunction(ElfFunctionIR(elf_function));
+    }
+    void operator()(const ElfObjectIR &elf_object) const {
+      module_->AddElfObject(ElfObjectIR(elf_object));
+    }
+  };
+  VisitElfSymbol(elf_symbol, Adder{this});
+  return true;
 }
 
 
@@ -199,18 +203,8 @@ void ModuleIR::AddElfObject(ElfObjectIR &&elf_object) {
 
 std::string ModuleIR::GetCompilationUnitPath(const TypeIR *type_ir) const {
   std::string key;
-  switch (type_ir->GetKind()) {
-    case RecordTypeKind:
-      key = GetODRListMapKey(static_cast<const RecordTypeIR *>(type_ir));
-      break;
-    case EnumTypeKind:
-      key = GetODRListMapKey(static_cast<const EnumTypeIR *>(type_ir));
-      break;
-    case FunctionTypeKind:
-      key = GetODRListMapKey(static_cast<const FunctionTypeIR *>(type_ir));
-      break;
-    default:
-      return "";
+  if (!GetODRListMapKey(type_ir, &key)) {
+    return "";
   }
   auto it = odr_list_map_.find(key);
   if (it == odr_list_map_.end()) {
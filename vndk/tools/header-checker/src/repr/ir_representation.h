@@ -93,10 +93,11 @@ std::map<V, K> CreateInverseMap(const std::map<K, V> &m) {
   return inverse_map;
 }
 
+// The kind of a message is stored in the message rather than returned by a
+// virtual method, so that the classes have no vtables and the callers can
+// dispatch on the kind with VisitLinkableMessage() and VisitType().
 class LinkableMessageIR {
  public:
-  virtual ~LinkableMessageIR() {}
-
   const std::string &GetLinkerSetKey() const {
     return linker_set_key_;
   }
@@ -113,9 +114,18 @@ class LinkableMessageIR {
     return source_file_;
   }
 
-  virtual LinkableMessageKind GetKind() const = 0;
+  LinkableMessageKind GetKind() const {
+    return kind_;
+  }
 
  protected:
+  LinkableMessageIR(LinkableMessageKind kind) : kind_(kind) {}
+
+  // The messages are never deleted through a pointer to the base class.
+  ~LinkableMessageIR() {}
+
+ protected:
+  LinkableMessageKind kind_;
   // The source file where this message comes from. This will be an empty string
   // for built-in types.
   std::string source_file_;
@@ -147,8 +157,6 @@ class ReferencesOtherType {
 // TODO: Break this up into types with sizes and those without types?
 class TypeIR : public LinkableMessageIR, public ReferencesOtherType {
  public:
-  virtual ~TypeIR() {}
-
   void SetSelfType(const std::string &self_type) {
     self_type_ = self_type;
   }
@@ -181,6 +189,11 @@ class TypeIR : public LinkableMessageIR, public ReferencesOtherType {
     return alignment_;
   }
 
+ protected:
+  TypeIR(LinkableMessageKind kind) : LinkableMessageIR(kind) {}
+
+  ~TypeIR() {}
+
  protected:
   std::string name_;
   std::string self_type_;
@@ -345,6 +358,8 @@ class RecordFieldIR : public ReferencesOtherType {
 
 class RecordTypeIR : public TypeIR, public TemplatedArtifactIR {
  public:
+  RecordTypeIR() : TypeIR(LinkableMessageKind::RecordTypeKind) {}
+
   enum RecordKind {
     struct_kind,
     class_kind,
@@ -397,10 +412,6 @@ class RecordTypeIR : public TypeIR, public TemplatedArtifactIR {
     return fields_;
   }
 
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::RecordTypeKind;
-  }
-
   uint64_t GetVTableNumEntries() const {
     return vtable_layout_.GetVTableNumEntries();
   }
@@ -450,6 +461,8 @@ class EnumFieldIR {
 
 class EnumTypeIR : public TypeIR {
  public:
+  EnumTypeIR() : TypeIR(LinkableMessageKind::EnumTypeKind) {}
+
   // Add Methods to get information from the IR.
   void AddEnumField(EnumFieldIR &&field) {
     fields_.emplace_back(std::move(field));
@@ -457,9 +470,6 @@ class EnumTypeIR : public TypeIR {
 
   void SetAccess(AccessSpecifierIR access) { access_ = access;}
 
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::EnumTypeKind;
-  }
 
   AccessSpecifierIR GetAccess() const {
     return access_;
@@ -493,20 +503,18 @@ class EnumTypeIR : public TypeIR {
 
 class ArrayTypeIR : public TypeIR {
  public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::ArrayTypeKind;
-  }
+  ArrayTypeIR() : TypeIR(LinkableMessageKind::ArrayTypeKind) {}
 };
 
 class PointerTypeIR : public TypeIR {
  public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::PointerTypeKind;
-  }
+  PointerTypeIR() : TypeIR(LinkableMessageKind::PointerTypeKind) {}
 };
 
 class BuiltinTypeIR : public TypeIR {
  public:
+  BuiltinTypeIR() : TypeIR(LinkableMessageKind::BuiltinTypeKind) {}
+
   void SetSignedness(bool is_unsigned) {
     is_unsigned_ = is_unsigned;
   }
@@ -523,11 +531,6 @@ class BuiltinTypeIR : public TypeIR {
     return is_integral_type_;
   }
 
- public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::BuiltinTypeKind;
-  }
-
  protected:
   bool is_unsigned_ = false;
   bool is_integral_type_ = false;
@@ -535,20 +538,20 @@ class BuiltinTypeIR : public TypeIR {
 
 class LvalueReferenceTypeIR : public TypeIR {
  public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::LvalueReferenceTypeKind;
-  }
+  LvalueReferenceTypeIR()
+      : TypeIR(LinkableMessageKind::LvalueReferenceTypeKind) {}
 };
 
 class RvalueReferenceTypeIR : public TypeIR {
  public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::RvalueReferenceTypeKind;
-  }
+  RvalueReferenceTypeIR()
+      : TypeIR(LinkableMessageKind::RvalueReferenceTypeKind) {}
 };
 
 class QualifiedTypeIR : public TypeIR {
  public:
+  QualifiedTypeIR() : TypeIR(LinkableMessageKind::QualifiedTypeKind) {}
+
   void SetConstness(bool is_const) {
     is_const_ = is_const;
   }
@@ -573,11 +576,6 @@ class QualifiedTypeIR : public TypeIR {
     return is_volatile_;
   }
 
- public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::QualifiedTypeKind;
-  }
-
  protected:
   bool is_const_;
   bool is_restricted_;
@@ -586,6 +584,8 @@ class QualifiedTypeIR : public TypeIR {
 
 class GlobalVarIR : public LinkableMessageIR , public ReferencesOtherType {
  public:
+  GlobalVarIR() : LinkableMessageIR(LinkableMessageKind::GlobalVarKind) {}
+
   // Add Methods to get information from the IR.
   void SetName(std::string &&name) {
     name_ = std::move(name);
@@ -607,10 +607,6 @@ class GlobalVarIR : public LinkableMessageIR , public ReferencesOtherType {
     return access_;
   }
 
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::GlobalVarKind;
-  }
-
  protected:
   std::string name_;
   AccessSpecifierIR access_ = AccessSpecifierIR::PublicAccess;
@@ -664,14 +660,14 @@ class CFunctionLikeIR {
 
 class FunctionTypeIR : public TypeIR, public CFunctionLikeIR {
  public:
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::FunctionTypeKind;
-  }
+  FunctionTypeIR() : TypeIR(LinkableMessageKind::FunctionTypeKind) {}
 };
 
 class FunctionIR : public LinkableMessageIR, public TemplatedArtifactIR,
                    public CFunctionLikeIR {
  public:
+  FunctionIR() : LinkableMessageIR(LinkableMessageKind::FunctionKind) {}
+
   void SetAccess(AccessSpecifierIR access) {
     access_ = access;
   }
@@ -680,10 +676,6 @@ class FunctionIR : public LinkableMessageIR, public TemplatedArtifactIR,
     return access_;
   }
 
-  LinkableMessageKind GetKind() const override {
-    return LinkableMessageKind::FunctionKind;
-  }
-
   void SetName(const std::string &name) {
     name_ = name;
   }
@@ -716,11 +708,6 @@ class ElfSymbolIR {
   };
 
  public:
-  ElfSymbolIR(const std::string &name, ElfSymbolBinding binding)
-      : name_(name), binding_(binding) {}
-
-  virtual ~ElfSymbolIR() {}
-
   const std::string GetName() const {
     return name_;
   }
@@ -729,9 +716,19 @@ class ElfSymbolIR {
     return binding_;
   }
 
-  virtual ElfSymbolKind GetKind() const = 0;
+  ElfSymbolKind GetKind() const {
+    return kind_;
+  }
+
+ protected:
+  ElfSymbolIR(ElfSymbolKind kind, const std::string &name,
+              ElfSymbolBinding binding)
+      : kind_(kind), name_(name), binding_(binding) {}
+
+  ~ElfSymbolIR() {}
 
  protected:
+  ElfSymbolKind kind_;
   std::string name_;
   ElfSymbolBinding binding_;
 };
@@ -739,23 +736,103 @@ class ElfSymbolIR {
 class ElfFunctionIR : public ElfSymbolIR {
  public:
   ElfFunctionIR(const std::string &name, ElfSymbolBinding binding)
-      : ElfSymbolIR(name, binding) {}
-
-  ElfSymbolKind GetKind() const override {
-    return ElfFunctionKind;
-  }
+      : ElfSymbolIR(ElfFunctionKind, name, binding) {}
 };
 
 class ElfObjectIR : public ElfSymbolIR {
  public:
   ElfObjectIR(const std::string &name, ElfSymbolBinding binding)
-      : ElfSymbolIR(name, binding) {}
+      : ElfSymbolIR(ElfObjectKind, name, binding) {}
+};
+
+// Calls the visitor with the message cast to the class of its kind. All calls
+// of the visitor must return the same type.
+template <typename Visitor>
+inline decltype(auto) VisitLinkableMessage(const LinkableMessageIR &lm,
+                                           Visitor &&visitor) {
+  switch (lm.GetKind()) {
+    case RecordTypeKind:
+      return visitor(static_cast<const RecordTypeIR &>(lm));
+    case EnumTypeKind:
+      return visitor(static_cast<const EnumTypeIR &>(lm));
+    case PointerTypeKind:
+      return visitor(static_cast<const PointerTypeIR &>(lm));
+    case QualifiedTypeKind:
+      return visitor(static_cast<const QualifiedTypeIR &>(lm));
+    case ArrayTypeKind:
+      return visitor(static_cast<const ArrayTypeIR &>(lm));
+    case LvalueReferenceTypeKind:
+      return visitor(static_cast<const LvalueReferenceTypeIR &>(lm));
+    case RvalueReferenceTypeKind:
+      return visitor(static_cast<const RvalueReferenceTypeIR &>(lm));
+    case BuiltinTypeKind:
+      return visitor(static_cast<const BuiltinTypeIR &>(lm));
+    case FunctionTypeKind:
+      return visitor(static_cast<const FunctionTypeIR &>(lm));
+    case GlobalVarKind:
+      return visitor(static_cast<const GlobalVarIR &>(lm));
+    case FunctionKind:
+      break;
+  }
+  return visitor(static_cast<const FunctionIR &>(lm));
+}
 
-  ElfSymbolKind GetKind() const override {
-    return ElfObjectKind;
+// Same as VisitLinkableMessage() except that the visitor is called only with
+// the classes derived from TypeIR.
+template <typename Visitor>
+inline decltype(auto) VisitType(const TypeIR &type, Visitor &&visitor) {
+  switch (type.GetKind()) {
+    case RecordTypeKind:
+      return visitor(static_cast<const RecordTypeIR &>(type));
+    case EnumTypeKind:
+      return visitor(static_cast<const EnumTypeIR &>(type));
+    case PointerTypeKind:
+      return visitor(static_cast<const PointerTypeIR &>(type));
+    case QualifiedTypeKind:
+      return visitor(static_cast<const QualifiedTypeIR &>(type));
+    case ArrayTypeKind:
+      return visitor(static_cast<const ArrayTypeIR &>(type));
+    case LvalueReferenceTypeKind:
+      return visitor(static_cast<const LvalueReferenceTypeIR &>(type));
+    case RvalueReferenceTypeKind:
+      return visitor(static_cast<const RvalueReferenceTypeIR &>(type));
+    case BuiltinTypeKind:
+      return visitor(static_cast<const BuiltinTypeIR &>(type));
+    case FunctionTypeKind:
+    // A TypeIR is never a GlobalVarIR or a FunctionIR.
+    case GlobalVarKind:
+    case FunctionKind:
+      break;
+  }
+  return visitor(static_cast<const FunctionTypeIR &>(type));
+}
+
+template <typename Visitor>
+inline decltype(auto) VisitElfSymbol(const ElfSymbolIR &elf_symbol,
+                                     Visitor &&visitor) {
+  switch (elf_symbol.GetKind()) {
+    case ElfSymbolIR::ElfFunctionKind:
+      return visitor(static_cast<const ElfFunctionIR &>(elf_symbol));
+    case ElfSymbolIR::ElfObjectKind:
+      break;
   }
+  return visitor(static_cast<const ElfObjectIR &>(elf_symbol));
+}
+
+// Deletes a type by its kind, as TypeIR has no virtual destructor. This
+// converts from the default deleters, so that a std::unique_ptr of a derived
+// class can be moved to TypeIRPtr.
+struct TypeIRDeleter {
+  TypeIRDeleter() = default;
+
+  template <typename T>
+  TypeIRDeleter(const std::default_delete<T> &) {}
+
+  void operator()(TypeIR *type) const;
 };
 
+using TypeIRPtr = std::unique_ptr<TypeIR, TypeIRDeleter>;
+
 class TypeDefinition {
  public:
   TypeDefinition(const TypeIR *type_ir,
@@ -840,7 +917,6 @@ class ModuleIR {
     return odr_list_map_;
   }
 
-
   bool AddLinkableMessage(const LinkableMessageIR &);
 
   void AddFunction(FunctionIR &&function);
@@ -889,7 +965,6 @@ class ModuleIR {
     odr_list_map_[key].emplace_back(value);
   }
 
-
  private:
   bool IsLinkableMessageInExportedHeaders(
       const LinkableMessageIR *linkable_message) const;
@@ -899,6 +974,10 @@ class ModuleIR {
   // File path to the compilation unit (*.sdump)
   std::string compilation_unit_path_;
 
+  // Each kind of element is stored in its own map keyed by its id. An element
+  // stays at the same address until it is erased, so type_graph_ and
+  // odr_list_map_ point to the elements, and the linker moves the elements out
+  // of the maps one at a time.
   AbiElementMap<FunctionIR> functions_;
   AbiElementMap<GlobalVarIR> global_variables_;
   AbiElementMap<RecordTypeIR> record_types_;
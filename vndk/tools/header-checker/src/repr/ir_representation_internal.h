@@ -66,6 +66,31 @@ inline std::string GetODRListMapKey(const FunctionTypeIR *function_type_ir) {
   return function_type_ir->GetLinkerSetKey();
 }
 
+// Sets the key if the type is a RecordTypeIR, an EnumTypeIR, or a
+// FunctionTypeIR. The other types are not in the ODR list map.
+inline bool GetODRListMapKey(const TypeIR *type_ir, std::string *key) {
+  struct KeyGetter {
+    std::string *key_;
+
+    bool operator()(const RecordTypeIR &type) const {
+      *key_ = GetODRListMapKey(&type);
+      return true;
+    }
+    bool operator()(const EnumTypeIR &type) const {
+      *key_ = GetODRListMapKey(&type);
+      return true;
+    }
+    bool operator()(const FunctionTypeIR &type) const {
+      *key_ = GetODRListMapKey(&type);
+      return true;
+    }
+    bool operator()(const TypeIR &) const {
+      return false;
+    }
+  };
+  return VisitType(*type_ir, KeyGetter{key});
+}
+
 // The map that is being updated maps special_key -> Type / Function/ GlobVar
 // This special key is needed to distinguish what is being referenced.
 template <typename T>
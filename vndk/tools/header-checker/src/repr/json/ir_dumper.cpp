@@ -26,7 +26,6 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include <cstdlib>
-#include <fstream>
 #include <sstream>
 #include <string>
 
@@ -283,80 +282,98 @@ JsonObject IRToJsonConverter::ConvertRvalueReferenceTypeIR(
   return rvalue_reference_type;
 }
 
-bool JsonIRDumper::AddLinkableMessageIR(const LinkableMessageIR *lm) {
-  std::string key;
-  JsonObject converted;
+bool IRToJsonConverter::ConvertLinkableMessageIR(const LinkableMessageIR *lm,
+                                                 std::string *key,
+                                                 JsonObject *converted) {
   // No RTTI
   switch (lm->GetKind()) {
   case RecordTypeKind:
-    key = "record_types";
-    converted = ConvertRecordTypeIR(static_cast<const RecordTypeIR *>(lm));
+    *key = "record_types";
+    *converted = ConvertRecordTypeIR(static_cast<const RecordTypeIR *>(lm));
     break;
   case EnumTypeKind:
-    key = "enum_types";
-    converted = ConvertEnumTypeIR(static_cast<const EnumTypeIR *>(lm));
+    *key = "enum_types";
+    *converted = ConvertEnumTypeIR(static_cast<const EnumTypeIR *>(lm));
     break;
   case PointerTypeKind:
-    key = "pointer_types";
-    converted = ConvertPointerTypeIR(static_cast<const PointerTypeIR *>(lm));
+    *key = "pointer_types";
+    *converted = ConvertPointerTypeIR(static_cast<const PointerTypeIR *>(lm));
     break;
   case QualifiedTypeKind:
-    key = "qualified_types";
-    converted =
+    *key = "qualified_types";
+    *converted =
         ConvertQualifiedTypeIR(static_cast<const QualifiedTypeIR *>(lm));
     break;
   case ArrayTypeKind:
-    key = "array_types";
-    converted = ConvertArrayTypeIR(static_cast<const ArrayTypeIR *>(lm));
+    *key = "array_types";
+    *converted = ConvertArrayTypeIR(static_cast<const ArrayTypeIR *>(lm));
     break;
   case LvalueReferenceTypeKind:
-    key = "lvalue_reference_types";
-    converted = ConvertLvalueReferenceTypeIR(
+    *key = "lvalue_reference_types";
+    *converted = ConvertLvalueReferenceTypeIR(
         static_cast<const LvalueReferenceTypeIR *>(lm));
     break;
   case RvalueReferenceTypeKind:
-    key = "rvalue_reference_types";
-    converted = ConvertRvalueReferenceTypeIR(
+    *key = "rvalue_reference_types";
+    *converted = ConvertRvalueReferenceTypeIR(
         static_cast<const RvalueReferenceTypeIR *>(lm));
     break;
   case BuiltinTypeKind:
-    key = "builtin_types";
-    converted = ConvertBuiltinTypeIR(static_cast<const BuiltinTypeIR *>(lm));
+    *key = "builtin_types";
+    *converted = ConvertBuiltinTypeIR(static_cast<const BuiltinTypeIR *>(lm));
     break;
   case FunctionTypeKind:
-    key = "function_types";
-    converted = ConvertFunctionTypeIR(static_cast<const FunctionTypeIR *>(lm));
+    *key = "function_types";
+    *converted = ConvertFunctionTypeIR(static_cast<const FunctionTypeIR *>(lm));
     break;
   case GlobalVarKind:
-    key = "global_vars";
-    converted = ConvertGlobalVarIR(static_cast<const GlobalVarIR *>(lm));
+    *key = "global_vars";
+    *converted = ConvertGlobalVarIR(static_cast<const GlobalVarIR *>(lm));
     break;
   case FunctionKind:
-    key = "functions";
-    converted = ConvertFunctionIR(static_cast<const FunctionIR *>(lm));
+    *key = "functions";
+    *converted = ConvertFunctionIR(static_cast<const FunctionIR *>(lm));
     break;
   default:
     return false;
   }
-  translation_unit_[key].append(converted);
   return true;
 }
 
-bool JsonIRDumper::AddElfSymbolMessageIR(const ElfSymbolIR *elf_symbol_ir) {
+bool JsonIRDumper::AddLinkableMessageIR(const LinkableMessageIR *lm) {
   std::string key;
+  JsonObject converted;
+  if (!ConvertLinkableMessageIR(lm, &key, &converted)) {
+    return false;
+  }
+  translation_unit_[key].append(converted);
+  return true;
+}
+
+bool IRToJsonConverter::ConvertElfSymbolIR(const ElfSymbolIR *elf_symbol_ir,
+                                           std::string *key,
+                                           JsonObject *converted) {
   switch (elf_symbol_ir->GetKind()) {
   case ElfSymbolIR::ElfFunctionKind:
-    key = "elf_functions";
+    *key = "elf_functions";
     break;
   case ElfSymbolIR::ElfObjectKind:
-    key = "elf_objects";
+    *key = "elf_objects";
     break;
   default:
     return false;
   }
+  converted->Set("name", elf_symbol_ir->GetName());
+  AddElfSymbolBinding(*converted, elf_symbol_ir->GetBinding());
+  return true;
+}
+
+bool JsonIRDumper::AddElfSymbolMessageIR(const ElfSymbolIR *elf_symbol_ir) {
+  std::string key;
   JsonObject elf_symbol;
-  elf_symbol.Set("name", elf_symbol_ir->GetName());
-  AddElfSymbolBinding(elf_symbol, elf_symbol_ir->GetBinding());
+  if (!ConvertElfSymbolIR(elf_symbol_ir, &key, &elf_symbol)) {
+    return false;
+  }
   translation_unit_[key].append(elf_symbol);
   return true;
 }
@@ -367,9 +384,8 @@ static std::string DumpJson(const JsonObject &obj) {
   return Json::writeString(factory, obj);
 }
 
-static void WriteTailTrimmedLinesToFile(const std::string &path,
-                                        const std::string &output_string) {
-  std::ofstream output_file(path);
+static void WriteTailTrimmedLines(std::ostream &output_file,
+                                  const std::string &output_string) {
   size_t line_start = 0;
   while (line_start < output_string.size()) {
     size_t trailing_space_start = line_start;
@@ -391,13 +407,118 @@ static void WriteTailTrimmedLinesToFile(const std::string &path,
   }
 }
 
+// Formats an element as Dump() writes it in an array, i.e., trimmed and
+// indented by two levels. The first line is not indented and the last line does
+// not end with a line break.
+static std::string FormatArrayElement(const JsonObject &obj) {
+  std::ostringstream trimmed;
+  WriteTailTrimmedLines(trimmed, DumpJson(obj));
+  std::string element;
+  for (char c : trimmed.str()) {
+    if (!element.empty() && element.back() == '\n') {
+      element += "  ";
+    }
+    element += c;
+  }
+  if (!element.empty()) {
+    element.pop_back();
+  }
+  return element;
+}
+
 bool JsonIRDumper::Dump(const ModuleIR &module) {
+  if (index_) {
+    return DumpModuleWithIndex(module);
+  }
   DumpModule(module);
   std::string output_string = DumpJson(translation_unit_);
-  WriteTailTrimmedLinesToFile(dump_path_, output_string);
+  utils::OutputFileStream output_file(dump_path_, compression_);
+  if (!output_file.IsOpen()) {
+    llvm::errs() << "Failed to open " << dump_path_ << "\n";
+    return false;
+  }
+  WriteTailTrimmedLines(output_file, output_string);
+  return output_file.Close();
+}
+
+bool JsonIRDumper::BeginStream() {
+  streamed_arrays_.clear();
+  for (auto &&item : translation_unit_.getMemberNames()) {
+    streamed_arrays_[item];
+  }
+  return true;
+}
+
+uint64_t JsonIRDumper::AppendToStreamedArray(const std::string &key,
+                                             const std::string &element) {
+  std::string &array = streamed_arrays_[key];
+  if (!array.empty()) {
+    array += ",\n";
+  }
+  array += "  ";
+  uint64_t offset = array.size();
+  array += element;
+  return offset;
+}
+
+bool JsonIRDumper::StreamLinkableMessage(const LinkableMessageIR &lm) {
+  std::string key;
+  JsonObject converted;
+  if (!ConvertLinkableMessageIR(&lm, &key, &converted)) {
+    return false;
+  }
+  std::string element = FormatArrayElement(converted);
+  uint64_t offset = AppendToStreamedArray(key, element);
+  if (index_) {
+    index_->AddLinkableMessage(key, lm, offset, element.size());
+  }
   return true;
 }
 
+bool JsonIRDumper::StreamElfSymbol(const ElfSymbolIR &elf_symbol) {
+  std::string key;
+  JsonObject converted;
+  if (!ConvertElfSymbolIR(&elf_symbol, &key, &converted)) {
+    return false;
+  }
+  std::string element = FormatArrayElement(converted);
+  uint64_t offset = AppendToStreamedArray(key, element);
+  if (index_) {
+    index_->AddElfSymbol(key, elf_symbol, offset, element.size());
+  }
+  return true;
+}
+
+bool JsonIRDumper::EndStream() {
+  utils::OutputFileStream output_file(dump_path_, compression_);
+  // The output is identical to Dump(). The offsets in the index are relative
+  // to the arrays until the position of each array is known.
+  uint64_t offset = 0;
+  auto &&write = [&](const std::string &text) {
+    output_file << text;
+    offset += text.size();
+  };
+  write("{\n");
+  bool is_first = true;
+  for (auto &&item : streamed_arrays_) {
+    write(std::string(is_first ? "" : ",\n") + " \"" + item.first + "\" :");
+    is_first = false;
+    if (item.second.empty()) {
+      write(" []");
+      continue;
+    }
+    write("\n [\n");
+    if (index_) {
+      index_->RelocateEntries(item.first, offset);
+    }
+    write(item.second);
+    write("\n ]");
+  }
+  write("\n}\n");
+  streamed_arrays_.clear();
+  return output_file.Close();
+}
+
 JsonIRDumper::JsonIRDumper(const std::string &dump_path)
     : IRDumper(dump_path), translation_unit_() {
   const std::string keys[] = {
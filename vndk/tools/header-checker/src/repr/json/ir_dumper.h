@@ -20,6 +20,9 @@
 #include "repr/ir_representation.h"
 #include "repr/json/converter.h"
 
+#include <map>
+#include <string>
+
 
 namespace header_checker {
 namespace repr {
@@ -74,6 +77,14 @@ class IRToJsonConverter {
 
   static JsonObject ConvertRvalueReferenceTypeIR(
       const RvalueReferenceTypeIR *rvalue_reference_typep);
+
+  // Sets `key` to the name of the array the element belongs to.
+  static bool ConvertLinkableMessageIR(const LinkableMessageIR *lm,
+                                       std::string *key,
+                                       JsonObject *converted);
+
+  static bool ConvertElfSymbolIR(const ElfSymbolIR *elf_symbol_ir,
+                                 std::string *key, JsonObject *converted);
 };
 
 class JsonIRDumper : public IRDumper, public IRToJsonConverter {
@@ -84,13 +95,30 @@ class JsonIRDumper : public IRDumper, public IRToJsonConverter {
 
   bool Dump(const ModuleIR &module) override;
 
+  bool BeginStream() override;
+
+  bool StreamLinkableMessage(const LinkableMessageIR &lm) override;
+
+  bool StreamElfSymbol(const ElfSymbolIR &elf_symbol) override;
+
+  bool EndStream() override;
+
  private:
+  // Appends the element to its array and returns the offset in the array.
+  uint64_t AppendToStreamedArray(const std::string &key,
+                                 const std::string &element);
+
   bool AddLinkableMessageIR(const LinkableMessageIR *) override;
 
   bool AddElfSymbolMessageIR(const ElfSymbolIR *) override;
 
  private:
   JsonObject translation_unit_;
+
+  // A JSON object cannot be written before all of its arrays are complete.
+  // In streaming mode, the elements are serialized as soon as they are added
+  // and kept as text until EndStream().
+  std::map<std::string, std::string> streamed_arrays_;
 };
 
 
@@ -23,12 +23,18 @@
 #include <json/reader.h>
 #include <json/writer.h>
 
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <cstdlib>
-#include <fstream>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 
 namespace header_checker {
@@ -152,44 +158,308 @@ GetElfSymbolBinding(const JsonObjectRef &elf_symbol) {
                    "Failed to convert JSON to ElfSymbolBinding");
 }
 
-bool JsonIRReader::ReadDumpImpl(const std::string &dump_file) {
-  Json::Value tu_json;
-  Json::CharReaderBuilder builder;
-  builder["collectComments"] = false;
-  std::ifstream input(dump_file);
+// The elements of a top-level array are converted into a container of their
+// own, which may be done on a worker thread, and spliced into the ModuleIR in
+// the order of the sections.
+class JsonSection {
+ public:
+  virtual ~JsonSection() {}
+
+  virtual const char *GetKey() const = 0;
+
+  virtual void Convert(const JsonObjectRef &tu) = 0;
+
+  virtual void Splice(ModuleIR *module) = 0;
+};
+
+
+namespace {
+
+
+template <typename T>
+class JsonSectionImpl : public JsonSection {
+ public:
+  JsonSectionImpl(const char *key, T (*convert)(const JsonObjectRef &),
+                  void (ModuleIR::*add)(T &&))
+      : key_(key), convert_(convert), add_(add) {}
 
-  std::string errorMessage;
-  if (!Json::parseFromStream(builder, input, &tu_json, &errorMessage)) {
-    llvm::errs() << "Failed to parse JSON: " << errorMessage << "\n";
+  const char *GetKey() const override {
+    return key_;
+  }
+
+  void Convert(const JsonObjectRef &tu) override {
+    for (auto &&element : tu.GetObjects(key_)) {
+      elements_.emplace_back(convert_(element));
+    }
+  }
+
+  void Splice(ModuleIR *module) override {
+    for (auto &&element : elements_) {
+      (module->*add_)(std::move(element));
+    }
+    elements_.clear();
+  }
+
+ private:
+  const char *key_;
+  T (*convert_)(const JsonObjectRef &);
+  void (ModuleIR::*add_)(T &&);
+  std::vector<T> elements_;
+};
+
+
+template <typename T>
+std::unique_ptr<JsonSection> CreateSection(
+    const char *key, T (*convert)(const JsonObjectRef &),
+    void (ModuleIR::*add)(T &&)) {
+  return std::make_unique<JsonSectionImpl<T>>(key, convert, add);
+}
+
+
+}  // namespace
+
+
+// Smaller dumps are parsed on the calling thread even if a thread pool is set.
+static const size_t kMinParallelReadSize = 1 << 20;
+
+static size_t SkipWhitespace(const std::string &text, size_t pos) {
+  while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                               text[pos] == '\r' || text[pos] == '\t')) {
+    pos++;
+  }
+  return pos;
+}
+
+// Returns the position after the string starting at pos, or npos.
+static size_t SkipString(const std::string &text, size_t pos) {
+  for (pos++; pos < text.size(); pos++) {
+    if (text[pos] == '\\') {
+      pos++;
+    } else if (text[pos] == '"') {
+      return pos + 1;
+    }
+  }
+  return std::string::npos;
+}
+
+// Returns the position after the value starting at pos, or npos. The value is
+// not validated, which is left to the JSON parser.
+static size_t SkipValue(const std::string &text, size_t pos) {
+  int depth = 0;
+  while (pos < text.size()) {
+    char c = text[pos];
+    if (c == '"') {
+      pos = SkipString(text, pos);
+      if (pos == std::string::npos) {
+        return pos;
+      }
+    } else {
+      if (c == '[' || c == '{') {
+        depth++;
+      } else if (c == ']' || c == '}') {
+        depth--;
+      } else if (depth == 0 && (c == ',' || c == ' ' || c == '\n' ||
+                                c == '\r' || c == '\t')) {
+        return pos;
+      } else if (c == '/') {
+        // Comments are not supported.
+        return std::string::npos;
+      }
+      pos++;
+    }
+    if (depth == 0) {
+      return pos;
+    }
+    if (depth < 0) {
+      return std::string::npos;
+    }
+  }
+  return std::string::npos;
+}
+
+// Locates the members of the top-level object without parsing the values.
+// Returns false if the text is not a simple object, in which case the caller
+// falls back to parsing the whole text.
+static bool SplitTopLevelMembers(
+    const std::string &text,
+    std::map<std::string, llvm::StringRef> *members) {
+  size_t pos = SkipWhitespace(text, 0);
+  if (pos >= text.size() || text[pos] != '{') {
     return false;
   }
-  bool ok = true;
-  JsonObjectRef tu(tu_json, ok);
-  if (!ok) {
-    llvm::errs() << "Translation unit is not an object\n";
+  pos = SkipWhitespace(text, pos + 1);
+  if (pos < text.size() && text[pos] == '}') {
+    return SkipWhitespace(text, pos + 1) == text.size();
+  }
+  while (pos < text.size()) {
+    if (text[pos] != '"') {
+      return false;
+    }
+    size_t key_end = SkipString(text, pos);
+    if (key_end == std::string::npos) {
+      return false;
+    }
+    std::string key = text.substr(pos + 1, key_end - pos - 2);
+    if (key.find('\\') != std::string::npos) {
+      return false;
+    }
+    pos = SkipWhitespace(text, key_end);
+    if (pos >= text.size() || text[pos] != ':') {
+      return false;
+    }
+    size_t value_begin = SkipWhitespace(text, pos + 1);
+    size_t value_end = SkipValue(text, value_begin);
+    if (value_end == std::string::npos) {
+      return false;
+    }
+    (*members)[key] =
+        llvm::StringRef(text).slice(value_begin, value_end);
+    pos = SkipWhitespace(text, value_end);
+    if (pos < text.size() && text[pos] == '}') {
+      return SkipWhitespace(text, pos + 1) == text.size();
+    }
+    if (pos >= text.size() || text[pos] != ',') {
+      return false;
+    }
+    pos = SkipWhitespace(text, pos + 1);
+  }
+  return false;
+}
+
+static bool ParseJson(const Json::CharReaderBuilder &builder,
+                      llvm::StringRef text, Json::Value *value) {
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  std::string error_message;
+  if (!reader->parse(text.data(), text.data() + text.size(), value,
+                     &error_message)) {
+    llvm::errs() << "Failed to parse JSON: " << error_message << "\n";
     return false;
   }
+  return true;
+}
 
-  ReadFunctions(tu);
-  ReadGlobalVariables(tu);
-  ReadEnumTypes(tu);
-  ReadRecordTypes(tu);
-  ReadFunctionTypes(tu);
-  ReadArrayTypes(tu);
-  ReadPointerTypes(tu);
-  ReadQualifiedTypes(tu);
-  ReadBuiltinTypes(tu);
-  ReadLvalueReferenceTypes(tu);
-  ReadRvalueReferenceTypes(tu);
-  ReadElfFunctions(tu);
-  ReadElfObjects(tu);
+std::vector<std::unique_ptr<JsonSection>> JsonIRReader::CreateSections() {
+  std::vector<std::unique_ptr<JsonSection>> sections;
+  sections.emplace_back(CreateSection(
+      "functions", &FunctionJsonToIR, &ModuleIR::AddFunction));
+  sections.emplace_back(CreateSection(
+      "global_vars", &GlobalVarJsonToIR, &ModuleIR::AddGlobalVariable));
+  sections.emplace_back(CreateSection(
+      "enum_types", &EnumTypeJsonToIR, &ModuleIR::AddEnumType));
+  sections.emplace_back(CreateSection(
+      "record_types", &RecordTypeJsonToIR, &ModuleIR::AddRecordType));
+  sections.emplace_back(CreateSection(
+      "function_types", &FunctionTypeJsonToIR, &ModuleIR::AddFunctionType));
+  sections.emplace_back(CreateSection(
+      "array_types", &ArrayTypeJsonToIR, &ModuleIR::AddArrayType));
+  sections.emplace_back(CreateSection(
+      "pointer_types", &PointerTypeJsonToIR, &ModuleIR::AddPointerType));
+  sections.emplace_back(CreateSection(
+      "qualified_types", &QualifiedTypeJsonToIR, &ModuleIR::AddQualifiedType));
+  sections.emplace_back(CreateSection(
+      "builtin_types", &BuiltinTypeJsonToIR, &ModuleIR::AddBuiltinType));
+  sections.emplace_back(CreateSection(
+      "lvalue_reference_types", &LvalueReferenceTypeJsonToIR,
+      &ModuleIR::AddLvalueReferenceType));
+  sections.emplace_back(CreateSection(
+      "rvalue_reference_types", &RvalueReferenceTypeJsonToIR,
+      &ModuleIR::AddRvalueReferenceType));
+  sections.emplace_back(CreateSection(
+      "elf_functions", &ElfFunctionJsonToIR, &ModuleIR::AddElfFunction));
+  sections.emplace_back(CreateSection(
+      "elf_objects", &ElfObjectJsonToIR, &ModuleIR::AddElfObject));
+  return sections;
+}
+
+bool JsonIRReader::ReadDumpImpl(std::istream &input) {
+  std::string text((std::istreambuf_iterator<char>(input)),
+                   std::istreambuf_iterator<char>());
+  Json::CharReaderBuilder builder;
+  builder["collectComments"] = false;
+  std::vector<std::unique_ptr<JsonSection>> sections = CreateSections();
+
+  std::map<std::string, llvm::StringRef> members;
+  bool ok = true;
+  if (thread_pool_ && text.size() >= kMinParallelReadSize &&
+      SplitTopLevelMembers(text, &members)) {
+    // Each section is parsed and converted into its own container. The pool
+    // may be shared, so only the tasks of this dump are waited for.
+    std::vector<char> section_ok(sections.size(), true);
+    std::vector<std::shared_future<void>> tasks;
+    for (size_t i = 0; i < sections.size(); i++) {
+      auto it = members.find(sections[i]->GetKey());
+      if (it == members.end()) {
+        continue;
+      }
+      tasks.emplace_back(thread_pool_->async([&, i, it]() {
+        Json::Value section_json(Json::objectValue);
+        Json::Value &array = section_json[it->first];
+        if (!ParseJson(builder, it->second, &array)) {
+          section_ok[i] = false;
+          return;
+        }
+        bool converted = true;
+        sections[i]->Convert(JsonObjectRef(section_json, converted));
+        section_ok[i] = converted;
+      }));
+    }
+    for (auto &&task : tasks) {
+      task.wait();
+    }
+    for (char section_ok_i : section_ok) {
+      ok = ok && section_ok_i;
+    }
+  } else {
+    Json::Value tu_json;
+    if (!ParseJson(builder, text, &tu_json)) {
+      return false;
+    }
+    JsonObjectRef tu(tu_json, ok);
+    if (!ok) {
+      llvm::errs() << "Translation unit is not an object\n";
+      return false;
+    }
+    for (auto &&section : sections) {
+      section->Convert(tu);
+    }
+  }
   if (!ok) {
     llvm::errs() << "Failed to convert JSON to IR\n";
     return false;
   }
+
+  for (auto &&section : sections) {
+    section->Splice(module_.get());
+  }
   return true;
 }
 
+std::string JsonIRReader::AssembleDump(
+    llvm::StringRef dump, const std::vector<const AbiIndexEntry *> &entries) {
+  // Each element is a JSON value in its array.
+  std::map<llvm::StringRef, std::vector<llvm::StringRef>> arrays;
+  for (auto &&entry : entries) {
+    arrays[entry->key_].emplace_back(
+        dump.substr(entry->offset_, entry->length_));
+  }
+  std::string result = "{";
+  for (auto &&array : arrays) {
+    if (result.size() > 1) {
+      result += ",";
+    }
+    result += "\n\"" + array.first.str() + "\": [\n";
+    for (auto &&element : array.second) {
+      if (&element != &array.second.front()) {
+        result += ",\n";
+      }
+      result += element.str();
+    }
+    result += "\n]";
+  }
+  result += "\n}\n";
+  return result;
+}
+
 void JsonIRReader::ReadTemplateInfo(const JsonObjectRef &type_decl,
                                     TemplatedArtifactIR *template_ir) {
   TemplateInfoIR template_info_ir;
@@ -307,116 +577,74 @@ EnumTypeIR JsonIRReader::EnumTypeJsonToIR(const JsonObjectRef &enum_type) {
   return enum_type_ir;
 }
 
-void JsonIRReader::ReadGlobalVariables(const JsonObjectRef &tu) {
-  for (auto &&global_variable : tu.GetObjects("global_vars")) {
-    GlobalVarIR global_variable_ir;
-    global_variable_ir.SetName(global_variable.GetString("name"));
-    global_variable_ir.SetAccess(GetAccess(global_variable));
-    global_variable_ir.SetSourceFile(global_variable.GetString("source_file"));
-    global_variable_ir.SetReferencedType(
-        global_variable.GetString("referenced_type"));
-    global_variable_ir.SetLinkerSetKey(
-        global_variable.GetString("linker_set_key"));
-    module_->AddGlobalVariable(std::move(global_variable_ir));
-  }
+GlobalVarIR
+JsonIRReader::GlobalVarJsonToIR(const JsonObjectRef &global_variable) {
+  GlobalVarIR global_variable_ir;
+  global_variable_ir.SetName(global_variable.GetString("name"));
+  global_variable_ir.SetAccess(GetAccess(global_variable));
+  global_variable_ir.SetSourceFile(global_variable.GetString("source_file"));
+  global_variable_ir.SetReferencedType(
+      global_variable.GetString("referenced_type"));
+  global_variable_ir.SetLinkerSetKey(
+      global_variable.GetString("linker_set_key"));
+  return global_variable_ir;
 }
 
-void JsonIRReader::ReadPointerTypes(const JsonObjectRef &tu) {
-  for (auto &&pointer_type : tu.GetObjects("pointer_types")) {
-    PointerTypeIR pointer_type_ir;
-    ReadTypeInfo(pointer_type, &pointer_type_ir);
-    module_->AddPointerType(std::move(pointer_type_ir));
-  }
+PointerTypeIR
+JsonIRReader::PointerTypeJsonToIR(const JsonObjectRef &pointer_type) {
+  PointerTypeIR pointer_type_ir;
+  ReadTypeInfo(pointer_type, &pointer_type_ir);
+  return pointer_type_ir;
 }
 
-void JsonIRReader::ReadBuiltinTypes(const JsonObjectRef &tu) {
-  for (auto &&builtin_type : tu.GetObjects("builtin_types")) {
-    BuiltinTypeIR builtin_type_ir;
-    ReadTypeInfo(builtin_type, &builtin_type_ir);
-    builtin_type_ir.SetSignedness(builtin_type.GetBool("is_unsigned"));
-    builtin_type_ir.SetIntegralType(builtin_type.GetBool("is_integral"));
-    module_->AddBuiltinType(std::move(builtin_type_ir));
-  }
+BuiltinTypeIR
+JsonIRReader::BuiltinTypeJsonToIR(const JsonObjectRef &builtin_type) {
+  BuiltinTypeIR builtin_type_ir;
+  ReadTypeInfo(builtin_type, &builtin_type_ir);
+  builtin_type_ir.SetSignedness(builtin_type.GetBool("is_unsigned"));
+  builtin_type_ir.SetIntegralType(builtin_type.GetBool("is_integral"));
+  return builtin_type_ir;
 }
 
-void JsonIRReader::ReadQualifiedTypes(const JsonObjectRef &tu) {
-  for (auto &&qualified_type : tu.GetObjects("qualified_types")) {
-    QualifiedTypeIR qualified_type_ir;
-    ReadTypeInfo(qualified_type, &qualified_type_ir);
-    qualified_type_ir.SetConstness(qualified_type.GetBool("is_const"));
-    qualified_type_ir.SetVolatility(qualified_type.GetBool("is_volatile"));
-    qualified_type_ir.SetRestrictedness(
-        qualified_type.GetBool("is_restricted"));
-    module_->AddQualifiedType(std::move(qualified_type_ir));
-  }
+QualifiedTypeIR
+JsonIRReader::QualifiedTypeJsonToIR(const JsonObjectRef &qualified_type) {
+  QualifiedTypeIR qualified_type_ir;
+  ReadTypeInfo(qualified_type, &qualified_type_ir);
+  qualified_type_ir.SetConstness(qualified_type.GetBool("is_const"));
+  qualified_type_ir.SetVolatility(qualified_type.GetBool("is_volatile"));
+  qualified_type_ir.SetRestrictedness(qualified_type.GetBool("is_restricted"));
+  return qualified_type_ir;
 }
 
-void JsonIRReader::ReadArrayTypes(const JsonObjectRef &tu) {
-  for (auto &&array_type : tu.GetObjects("array_types")) {
-    ArrayTypeIR array_type_ir;
-    ReadTypeInfo(array_type, &array_type_ir);
-    module_->AddArrayType(std::move(array_type_ir));
-  }
+ArrayTypeIR JsonIRReader::ArrayTypeJsonToIR(const JsonObjectRef &array_type) {
+  ArrayTypeIR array_type_ir;
+  ReadTypeInfo(array_type, &array_type_ir);
+  return array_type_ir;
 }
 
-void JsonIRReader::ReadLvalueReferenceTypes(const JsonObjectRef &tu) {
-  for (auto &&lvalue_reference_type : tu.GetObjects("lvalue_reference_types")) {
-    LvalueReferenceTypeIR lvalue_reference_type_ir;
-    ReadTypeInfo(lvalue_reference_type, &lvalue_reference_type_ir);
-    module_->AddLvalueReferenceType(std::move(lvalue_reference_type_ir));
-  }
+LvalueReferenceTypeIR JsonIRReader::LvalueReferenceTypeJsonToIR(
+    const JsonObjectRef &lvalue_reference_type) {
+  LvalueReferenceTypeIR lvalue_reference_type_ir;
+  ReadTypeInfo(lvalue_reference_type, &lvalue_reference_type_ir);
+  return lvalue_reference_type_ir;
 }
 
-void JsonIRReader::ReadRvalueReferenceTypes(const JsonObjectRef &tu) {
-  for (auto &&rvalue_reference_type : tu.GetObjects("rvalue_reference_types")) {
-    RvalueReferenceTypeIR rvalue_reference_type_ir;
-    ReadTypeInfo(rvalue_reference_type, &rvalue_reference_type_ir);
-    module_->AddRvalueReferenceType(std::move(rvalue_reference_type_ir));
-  }
+RvalueReferenceTypeIR JsonIRReader::RvalueReferenceTypeJsonToIR(
+    const JsonObjectRef &rvalue_reference_type) {
+  RvalueReferenceTypeIR rvalue_reference_type_ir;
+  ReadTypeInfo(rvalue_reference_type, &rvalue_reference_type_ir);
+  return rvalue_reference_type_ir;
 }
 
-void JsonIRReader::ReadFunctions(const JsonObjectRef &tu) {
-  for (auto &&function : tu.GetObjects("functions")) {
-    FunctionIR function_ir = FunctionJsonToIR(function);
-    module_->AddFunction(std::move(function_ir));
-  }
+ElfFunctionIR
+JsonIRReader::ElfFunctionJsonToIR(const JsonObjectRef &elf_function) {
+  return ElfFunctionIR(elf_function.GetString("name"),
+                       GetElfSymbolBinding(elf_function));
 }
 
-void JsonIRReader::ReadRecordTypes(const JsonObjectRef &tu) {
-  for (auto &&record_type : tu.GetObjects("record_types")) {
-    RecordTypeIR record_type_ir = RecordTypeJsonToIR(record_type);
-    module_->AddRecordType(std::move(record_type_ir));
-  }
-}
-
-void JsonIRReader::ReadFunctionTypes(const JsonObjectRef &tu) {
-  for (auto &&function_type : tu.GetObjects("function_types")) {
-    FunctionTypeIR function_type_ir = FunctionTypeJsonToIR(function_type);
-    module_->AddFunctionType(std::move(function_type_ir));
-  }
-}
-
-void JsonIRReader::ReadEnumTypes(const JsonObjectRef &tu) {
-  for (auto &&enum_type : tu.GetObjects("enum_types")) {
-    EnumTypeIR enum_type_ir = EnumTypeJsonToIR(enum_type);
-    module_->AddEnumType(std::move(enum_type_ir));
-  }
-}
-
-void JsonIRReader::ReadElfFunctions(const JsonObjectRef &tu) {
-  for (auto &&elf_function : tu.GetObjects("elf_functions")) {
-    ElfFunctionIR elf_function_ir(elf_function.GetString("name"),
-                                  GetElfSymbolBinding(elf_function));
-    module_->AddElfFunction(std::move(elf_function_ir));
-  }
-}
-
-void JsonIRReader::ReadElfObjects(const JsonObjectRef &tu) {
-  for (auto &&elf_object : tu.GetObjects("elf_objects")) {
-    ElfObjectIR elf_object_ir(elf_object.GetString("name"),
-                              GetElfSymbolBinding(elf_object));
-    module_->AddElfObject(std::move(elf_object_ir));
-  }
+ElfObjectIR JsonIRReader::ElfObjectJsonToIR(const JsonObjectRef &elf_object) {
+  return ElfObjectIR(elf_object.GetString("name"),
+                     GetElfSymbolBinding(elf_object));
 }
 
 std::unique_ptr<IRReader> CreateJsonIRReader(
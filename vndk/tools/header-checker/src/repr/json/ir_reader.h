@@ -21,12 +21,16 @@
 
 #include <json/value.h>
 
+#include <memory>
+#include <vector>
+
 
 namespace header_checker {
 namespace repr {
 
 
 template <typename T> class JsonArrayRef;
+class JsonSection;
 
 // This class loads values from a read-only JSON object.
 class JsonObjectRef {
@@ -117,33 +121,14 @@ class JsonIRReader : public IRReader {
       : IRReader(exported_headers) {}
 
  private:
-  bool ReadDumpImpl(const std::string &dump_file) override;
-
-  void ReadFunctions(const JsonObjectRef &tu);
-
-  void ReadGlobalVariables(const JsonObjectRef &tu);
-
-  void ReadEnumTypes(const JsonObjectRef &tu);
-
-  void ReadRecordTypes(const JsonObjectRef &tu);
-
-  void ReadFunctionTypes(const JsonObjectRef &tu);
-
-  void ReadPointerTypes(const JsonObjectRef &tu);
-
-  void ReadBuiltinTypes(const JsonObjectRef &tu);
-
-  void ReadQualifiedTypes(const JsonObjectRef &tu);
-
-  void ReadArrayTypes(const JsonObjectRef &tu);
-
-  void ReadLvalueReferenceTypes(const JsonObjectRef &tu);
+  bool ReadDumpImpl(std::istream &input) override;
 
-  void ReadRvalueReferenceTypes(const JsonObjectRef &tu);
+  std::string AssembleDump(
+      llvm::StringRef dump,
+      const std::vector<const AbiIndexEntry *> &entries) override;
 
-  void ReadElfFunctions(const JsonObjectRef &tu);
-
-  void ReadElfObjects(const JsonObjectRef &tu);
+  // Returns the converters of the top-level arrays in the order of reading.
+  static std::vector<std::unique_ptr<JsonSection>> CreateSections();
 
   static void ReadTemplateInfo(const JsonObjectRef &type_decl,
                                TemplatedArtifactIR *template_ir);
@@ -173,6 +158,27 @@ class JsonIRReader : public IRReader {
   static RecordTypeIR RecordTypeJsonToIR(const JsonObjectRef &record_type);
 
   static EnumTypeIR EnumTypeJsonToIR(const JsonObjectRef &enum_type);
+
+  static GlobalVarIR GlobalVarJsonToIR(const JsonObjectRef &global_variable);
+
+  static PointerTypeIR PointerTypeJsonToIR(const JsonObjectRef &pointer_type);
+
+  static BuiltinTypeIR BuiltinTypeJsonToIR(const JsonObjectRef &builtin_type);
+
+  static QualifiedTypeIR
+  QualifiedTypeJsonToIR(const JsonObjectRef &qualified_type);
+
+  static ArrayTypeIR ArrayTypeJsonToIR(const JsonObjectRef &array_type);
+
+  static LvalueReferenceTypeIR
+  LvalueReferenceTypeJsonToIR(const JsonObjectRef &lvalue_reference_type);
+
+  static RvalueReferenceTypeIR
+  RvalueReferenceTypeJsonToIR(const JsonObjectRef &rvalue_reference_type);
+
+  static ElfFunctionIR ElfFunctionJsonToIR(const JsonObjectRef &elf_function);
+
+  static ElfObjectIR ElfObjectJsonToIR(const JsonObjectRef &elf_object);
 };
 
 
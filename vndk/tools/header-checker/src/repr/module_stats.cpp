@@ -0,0 +1,386 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "repr/module_stats.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include <sys/resource.h>
+
+
+namespace header_checker {
+namespace repr {
+
+
+// The estimates assume 64-bit pointers. A std::map node has the color and
+// three pointers in addition to the value. A std::unordered_map node has the
+// next pointer and the cached hash code, and a std::list node has two
+// pointers.
+static const uint64_t kMapNodeOverhead = 32;
+static const uint64_t kUnorderedMapNodeOverhead = 16;
+static const uint64_t kListNodeOverhead = 16;
+
+
+// Returns 0 if the string is stored in the std::string object.
+static uint64_t GetHeapBytes(const std::string &str) {
+  const char *data = str.data();
+  const char *object = reinterpret_cast<const char *>(&str);
+  if (data >= object && data < object + sizeof(str)) {
+    return 0;
+  }
+  return str.capacity() + 1;
+}
+
+static uint64_t GetHeapBytes(const ParamIR &param) {
+  return GetHeapBytes(param.GetReferencedType());
+}
+
+static uint64_t GetHeapBytes(const TemplateElementIR &element) {
+  return GetHeapBytes(element.GetReferencedType());
+}
+
+static uint64_t GetHeapBytes(const CXXBaseSpecifierIR &base) {
+  return GetHeapBytes(base.GetReferencedType());
+}
+
+static uint64_t GetHeapBytes(const RecordFieldIR &field) {
+  return GetHeapBytes(field.GetName()) +
+         GetHeapBytes(field.GetReferencedType());
+}
+
+static uint64_t GetHeapBytes(const VTableComponentIR &component) {
+  return GetHeapBytes(component.GetName());
+}
+
+static uint64_t GetHeapBytes(const EnumFieldIR &field) {
+  return GetHeapBytes(field.GetName());
+}
+
+template <typename T>
+static uint64_t GetHeapBytes(const std::vector<T> &elements) {
+  uint64_t bytes = elements.capacity() * sizeof(T);
+  for (auto &&element : elements) {
+    bytes += GetHeapBytes(element);
+  }
+  return bytes;
+}
+
+static uint64_t GetLinkableMessageHeapBytes(const LinkableMessageIR &lm) {
+  return GetHeapBytes(lm.GetLinkerSetKey()) +
+         GetHeapBytes(lm.GetSourceFile());
+}
+
+static uint64_t GetTypeHeapBytes(const TypeIR &type) {
+  return GetLinkableMessageHeapBytes(type) + GetHeapBytes(type.GetName()) +
+         GetHeapBytes(type.GetSelfType()) +
+         GetHeapBytes(type.GetReferencedType());
+}
+
+static uint64_t GetHeapBytes(const LinkableMessageIR &lm) {
+  struct HeapBytesCounter {
+    uint64_t operator()(const RecordTypeIR &type) const {
+      return GetTypeHeapBytes(type) + GetHeapBytes(type.GetFields()) +
+             GetHeapBytes(type.GetVTableLayout().GetVTableComponents()) +
+             GetHeapBytes(type.GetBases()) +
+             GetHeapBytes(type.GetTemplateElements());
+    }
+    uint64_t operator()(const EnumTypeIR &type) const {
+      return GetTypeHeapBytes(type) + GetHeapBytes(type.GetUnderlyingType()) +
+             GetHeapBytes(type.GetFields());
+    }
+    uint64_t operator()(const FunctionTypeIR &type) const {
+      return GetTypeHeapBytes(type) + GetHeapBytes(type.GetReturnType()) +
+             GetHeapBytes(type.GetParameters());
+    }
+    uint64_t operator()(const TypeIR &type) const {
+      return GetTypeHeapBytes(type);
+    }
+    uint64_t operator()(const FunctionIR &function) const {
+      return GetLinkableMessageHeapBytes(function) +
+             GetHeapBytes(function.GetName()) +
+             GetHeapBytes(function.GetReturnType()) +
+             GetHeapBytes(function.GetParameters()) +
+             GetHeapBytes(function.GetTemplateElements());
+    }
+    uint64_t operator()(const GlobalVarIR &global_var) const {
+      return GetLinkableMessageHeapBytes(global_var) +
+             GetHeapBytes(global_var.GetName()) +
+             GetHeapBytes(global_var.GetReferencedType());
+    }
+  };
+  return VisitLinkableMessage(lm, HeapBytesCounter());
+}
+
+static uint64_t GetHeapBytes(const ElfSymbolIR &elf_symbol) {
+  // GetName() returns a copy, which is as long as the original.
+  return GetHeapBytes(elf_symbol.GetName());
+}
+
+// The type graph refers to the types in the other maps.
+static uint64_t GetHeapBytes(const TypeIR *) {
+  return 0;
+}
+
+template <typename T>
+static AbiElementMapStats GetMapStats(const char *name,
+                                      const AbiElementMap<T> &map) {
+  AbiElementMapStats stats;
+  stats.name_ = name;
+  stats.count_ = map.size();
+  stats.node_bytes_ =
+      map.size() *
+      (kMapNodeOverhead + sizeof(typename AbiElementMap<T>::value_type));
+  for (auto &&item : map) {
+    stats.key_bytes_ += GetHeapBytes(item.first);
+    stats.child_bytes_ += GetHeapBytes(item.second);
+  }
+  return stats;
+}
+
+
+uint64_t ModuleStats::GetTotalBytes() const {
+  uint64_t bytes = 0;
+  for (auto &&map : maps_) {
+    bytes += map.GetTotalBytes();
+  }
+  return bytes;
+}
+
+
+ModuleStats CollectModuleStats(const std::string &name,
+                               const ModuleIR &module) {
+  ModuleStats stats;
+  stats.name_ = name;
+  stats.maps_ = {
+      GetMapStats("functions", module.GetFunctions()),
+      GetMapStats("global_variables", module.GetGlobalVariables()),
+      GetMapStats("record_types", module.GetRecordTypes()),
+      GetMapStats("function_types", module.GetFunctionTypes()),
+      GetMapStats("enum_types", module.GetEnumTypes()),
+      GetMapStats("pointer_types", module.GetPointerTypes()),
+      GetMapStats("lvalue_reference_types",
+                  module.GetLvalueReferenceTypes()),
+      GetMapStats("rvalue_reference_types",
+                  module.GetRvalueReferenceTypes()),
+      GetMapStats("array_types", module.GetArrayTypes()),
+      GetMapStats("builtin_types", module.GetBuiltinTypes()),
+      GetMapStats("qualified_types", module.GetQualifiedTypes()),
+      GetMapStats("elf_functions", module.GetElfFunctions()),
+      GetMapStats("elf_objects", module.GetElfObjects()),
+      GetMapStats("type_graph", module.GetTypeGraph()),
+  };
+
+  // The definitions in the lists point to the types in the other maps.
+  const auto &odr_list_map = module.GetODRListMap();
+  AbiElementMapStats odr_stats;
+  odr_stats.name_ = "odr_list_map";
+  odr_stats.count_ = odr_list_map.size();
+  odr_stats.node_bytes_ =
+      odr_list_map.size() *
+          (kUnorderedMapNodeOverhead +
+           sizeof(AbiElementUnorderedMap<std::list<TypeDefinition>>::
+                      value_type)) +
+      odr_list_map.bucket_count() * sizeof(void *);
+  for (auto &&item : odr_list_map) {
+    const uint64_t chain_length = item.second.size();
+    odr_stats.key_bytes_ += GetHeapBytes(item.first);
+    odr_stats.child_bytes_ +=
+        chain_length * (kListNodeOverhead + sizeof(TypeDefinition));
+    stats.num_odr_definitions_ += chain_length;
+    if (chain_length > 1) {
+      stats.num_odr_violations_++;
+    }
+    stats.max_odr_chain_length_ =
+        std::max(stats.max_odr_chain_length_, chain_length);
+    stats.odr_chain_lengths_[chain_length]++;
+  }
+  stats.num_odr_keys_ = odr_list_map.size();
+  stats.maps_.emplace_back(std::move(odr_stats));
+  return stats;
+}
+
+
+struct PhaseStats {
+  std::string name_;
+  uint64_t peak_rss_bytes_;
+};
+
+
+static bool stats_enabled;
+static bool stats_json;
+static std::string stats_path;
+static std::vector<PhaseStats> phases;
+static std::vector<ModuleStats> modules;
+
+
+static uint64_t GetPeakRssBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+
+void InitStats(bool enabled, bool json, const std::string &stats_file) {
+  stats_json = json;
+  stats_path = stats_file;
+  stats_enabled = enabled || stats_json || !stats_path.empty();
+}
+
+bool IsStatsEnabled() {
+  return stats_enabled;
+}
+
+void AddStatsPhase(const std::string &name) {
+  if (!IsStatsEnabled()) {
+    return;
+  }
+  phases.push_back({name, GetPeakRssBytes()});
+}
+
+void AddStatsModule(const std::string &name, const ModuleIR &module) {
+  if (!IsStatsEnabled()) {
+    return;
+  }
+  modules.emplace_back(CollectModuleStats(name, module));
+}
+
+static std::string FormatBytes(uint64_t bytes) {
+  return llvm::formatv("{0:F1} MiB", bytes / (1024.0 * 1024.0)).str();
+}
+
+static void PrintStats(llvm::raw_ostream &out) {
+  for (auto &&module : modules) {
+    out << "Module " << module.name_ << ":\n";
+    out << llvm::formatv("  {0,-24}{1,10}{2,14}{3,14}{4,14}\n", "map",
+                         "count", "key bytes", "node bytes", "child bytes");
+    for (auto &&map : module.maps_) {
+      out << llvm::formatv("  {0,-24}{1,10}{2,14}{3,14}{4,14}\n", map.name_,
+                           map.count_, map.key_bytes_, map.node_bytes_,
+                           map.child_bytes_);
+    }
+    out << "  Estimated total: " << FormatBytes(module.GetTotalBytes())
+        << "\n";
+    out << "  ODR list: " << module.num_odr_keys_ << " keys, "
+        << module.num_odr_definitions_ << " definitions, "
+        << module.num_odr_violations_ << " ODR violations, max chain length "
+        << module.max_odr_chain_length_ << "\n";
+  }
+  for (auto &&phase : phases) {
+    out << "Peak RSS after " << phase.name_ << ": "
+        << FormatBytes(phase.peak_rss_bytes_) << "\n";
+  }
+}
+
+static llvm::json::Value StatsToJson() {
+  llvm::json::Array json_modules;
+  for (auto &&module : modules) {
+    llvm::json::Array json_maps;
+    for (auto &&map : module.maps_) {
+      json_maps.push_back(llvm::json::Object{
+          {"name", map.name_},
+          {"count", static_cast<int64_t>(map.count_)},
+          {"key_bytes", static_cast<int64_t>(map.key_bytes_)},
+          {"node_bytes", static_cast<int64_t>(map.node_bytes_)},
+          {"child_bytes", static_cast<int64_t>(map.child_bytes_)},
+      });
+    }
+    llvm::json::Object chain_lengths;
+    for (auto &&item : module.odr_chain_lengths_) {
+      chain_lengths[std::to_string(item.first)] =
+          static_cast<int64_t>(item.second);
+    }
+    json_modules.push_back(llvm::json::Object{
+        {"name", module.name_},
+        {"maps", std::move(json_maps)},
+        {"total_bytes", static_cast<int64_t>(module.GetTotalBytes())},
+        {"odr_list",
+         llvm::json::Object{
+             {"keys", static_cast<int64_t>(module.num_odr_keys_)},
+             {"definitions", static_cast<int64_t>(module.num_odr_definitions_)},
+             {"odr_violations",
+              static_cast<int64_t>(module.num_odr_violations_)},
+             {"max_chain_length",
+              static_cast<int64_t>(module.max_odr_chain_length_)},
+             {"chain_lengths", std::move(chain_lengths)},
+         }},
+    });
+  }
+  llvm::json::Array json_phases;
+  for (auto &&phase : phases) {
+    json_phases.push_back(llvm::json::Object{
+        {"name", phase.name_},
+        {"peak_rss_bytes", static_cast<int64_t>(phase.peak_rss_bytes_)},
+    });
+  }
+  return llvm::json::Object{
+      {"modules", std::move(json_modules)},
+      {"phases", std::move(json_phases)},
+  };
+}
+
+bool WriteStats() {
+  if (!IsStatsEnabled()) {
+    return true;
+  }
+  bool ok = true;
+  std::error_code ec;
+  std::unique_ptr<llvm::raw_fd_ostream> file;
+  if (!stats_path.empty()) {
+    file = std::make_unique<llvm::raw_fd_ostream>(stats_path, ec,
+                                                  llvm::sys::fs::OF_Text);
+  }
+  if (ec) {
+    llvm::errs() << "Failed to open \"" << stats_path << "\": "
+                 << ec.message() << "\n";
+    ok = false;
+  } else {
+    llvm::raw_ostream &out = file ? *file : llvm::errs();
+    if (stats_json) {
+      out << llvm::formatv("{0:2}", StatsToJson()) << "\n";
+    } else {
+      PrintStats(out);
+    }
+    if (file) {
+      file->close();
+      if (file->has_error()) {
+        file->clear_error();
+        llvm::errs() << "Failed to write \"" << stats_path << "\"\n";
+        ok = false;
+      }
+    }
+  }
+  // The diff server may collect the statistics for the next request.
+  stats_enabled = false;
+  phases.clear();
+  modules.clear();
+  return ok;
+}
+
+
+}  // namespace repr
+}  // namespace header_checker
@@ -0,0 +1,91 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MODULE_STATS_H_
+#define MODULE_STATS_H_
+
+#include "repr/ir_representation.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace header_checker {
+namespace repr {
+
+
+// The number of elements in a map of ModuleIR and the estimated bytes they
+// occupy. The key bytes and the child bytes are the heap memory owned by the
+// keys and the elements, i.e., the strings that do not fit in std::string and
+// the vectors of fields, parameters, etc. The node bytes are the memory of the
+// map nodes, which contain the std::string keys and the elements.
+struct AbiElementMapStats {
+  std::string name_;
+  uint64_t count_ = 0;
+  uint64_t key_bytes_ = 0;
+  uint64_t node_bytes_ = 0;
+  uint64_t child_bytes_ = 0;
+
+  uint64_t GetTotalBytes() const {
+    return key_bytes_ + node_bytes_ + child_bytes_;
+  }
+};
+
+
+struct ModuleStats {
+  std::string name_;
+  std::vector<AbiElementMapStats> maps_;
+
+  // The number of keys and definitions in odr_list_map_. A key with more than
+  // one definition is an ODR violation.
+  uint64_t num_odr_keys_ = 0;
+  uint64_t num_odr_definitions_ = 0;
+  uint64_t num_odr_violations_ = 0;
+  uint64_t max_odr_chain_length_ = 0;
+  // Maps the number of definitions to the number of keys.
+  std::map<uint64_t, uint64_t> odr_chain_lengths_;
+
+  uint64_t GetTotalBytes() const;
+};
+
+
+ModuleStats CollectModuleStats(const std::string &name,
+                               const ModuleIR &module);
+
+
+// Collects the module statistics and the peak resident set size at the end of
+// each phase. json prints the statistics in JSON format, and stats_file
+// redirects them from stderr. Either of them enables the statistics. The
+// functions do nothing unless InitStats enables the statistics.
+void InitStats(bool enabled, bool json, const std::string &stats_file);
+
+bool IsStatsEnabled();
+
+// Records the peak resident set size of the process at the end of the phase.
+void AddStatsPhase(const std::string &name);
+
+void AddStatsModule(const std::string &name, const ModuleIR &module);
+
+// Prints the statistics and clears them for the next request of the diff
+// server.
+bool WriteStats();
+
+
+}  // namespace repr
+}  // namespace header_checker
+
+
+#endif  // MODULE_STATS_H_
@@ -0,0 +1,101 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "repr/module_stats.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+
+namespace header_checker {
+namespace repr {
+
+
+static RecordTypeIR CreateRecord(const std::string &name, uint64_t size) {
+  RecordTypeIR record;
+  record.SetName(name);
+  record.SetSelfType("_ZTI" + name);
+  record.SetReferencedType("_ZTI" + name);
+  record.SetLinkerSetKey("_ZTI" + name);
+  record.SetSourceFile("include/long_header_file_name.h");
+  record.SetSize(size);
+  record.AddRecordField(RecordFieldIR("field", "_ZTIi", 0,
+                                      AccessSpecifierIR::PublicAccess));
+  return record;
+}
+
+static const AbiElementMapStats *FindMap(const ModuleStats &stats,
+                                         const std::string &name) {
+  for (auto &&map : stats.maps_) {
+    if (map.name_ == name) {
+      return &map;
+    }
+  }
+  return nullptr;
+}
+
+
+TEST(ModuleStatsTest, CollectModuleStats) {
+  ModuleIR module(nullptr);
+  module.SetCompilationUnitPath("a.sdump");
+  module.AddRecordType(CreateRecord("A", 4));
+  module.AddRecordType(CreateRecord("B", 4));
+  module.AddElfFunction(
+      ElfFunctionIR("_Z1fv", ElfSymbolIR::ElfSymbolBinding::Global));
+  // Another definition of B from another translation unit.
+  module.SetCompilationUnitPath("b.sdump");
+  RecordTypeIR odr_record = CreateRecord("B", 8);
+  odr_record.SetSelfType("_ZTI1B#ODR:b.sdump");
+  odr_record.SetReferencedType("_ZTI1B#ODR:b.sdump");
+  module.AddRecordType(std::move(odr_record));
+
+  ModuleStats stats = CollectModuleStats("test", module);
+  EXPECT_EQ("test", stats.name_);
+
+  const AbiElementMapStats *record_types = FindMap(stats, "record_types");
+  ASSERT_NE(nullptr, record_types);
+  EXPECT_EQ(3u, record_types->count_);
+  EXPECT_GT(record_types->node_bytes_, 3 * sizeof(RecordTypeIR));
+  // The source files do not fit in std::string. The field vectors are on the
+  // heap.
+  EXPECT_GT(record_types->child_bytes_, 3 * sizeof(RecordFieldIR));
+
+  const AbiElementMapStats *elf_functions = FindMap(stats, "elf_functions");
+  ASSERT_NE(nullptr, elf_functions);
+  EXPECT_EQ(1u, elf_functions->count_);
+  EXPECT_EQ(0u, elf_functions->key_bytes_);
+
+  const AbiElementMapStats *type_graph = FindMap(stats, "type_graph");
+  ASSERT_NE(nullptr, type_graph);
+  EXPECT_EQ(3u, type_graph->count_);
+  EXPECT_EQ(0u, type_graph->child_bytes_);
+
+  EXPECT_EQ(2u, stats.num_odr_keys_);
+  EXPECT_EQ(3u, stats.num_odr_definitions_);
+  EXPECT_EQ(1u, stats.num_odr_violations_);
+  EXPECT_EQ(2u, stats.max_odr_chain_length_);
+  EXPECT_EQ(1u, stats.odr_chain_lengths_[1]);
+  EXPECT_EQ(1u, stats.odr_chain_lengths_[2]);
+
+  uint64_t total_bytes = 0;
+  for (auto &&map : stats.maps_) {
+    total_bytes += map.GetTotalBytes();
+  }
+  EXPECT_EQ(total_bytes, stats.GetTotalBytes());
+}
+
+
+}  // namespace repr
+}  // namespace header_checker
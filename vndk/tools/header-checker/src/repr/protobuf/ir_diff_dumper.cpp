@@ -22,6 +22,9 @@
 #include <memory>
 #include <string>
 
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
@@ -32,6 +35,33 @@ namespace header_checker {
 namespace repr {
 
 
+ProtobufIRDiffDumper::ProtobufIRDiffDumper(const std::string &dump_path)
+    : IRDiffDumper(dump_path),
+      diff_tu_(new abi_diff::TranslationUnitDiff()),
+      compatibility_status_(CompatibilityStatusIR::Compatible) {
+  int fd;
+  llvm::SmallString<256> temp_path;
+  if (llvm::sys::fs::createUniqueFile(dump_path + ".%%%%%%.tmp", fd,
+                                      temp_path)) {
+    llvm::errs() << "Failed to create temporary file for " << dump_path
+                 << "\n";
+  } else {
+    llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+    temp_path_ = std::string(temp_path);
+    text_output_.open(temp_path_);
+  }
+  // Writing to a stream that failed to open fails, and so does Dump().
+  text_os_.reset(new google::protobuf::io::OstreamOutputStream(&text_output_));
+}
+
+ProtobufIRDiffDumper::~ProtobufIRDiffDumper() {
+  if (!temp_path_.empty()) {
+    text_os_.reset();
+    text_output_.close();
+    llvm::sys::fs::remove(temp_path_);
+  }
+}
+
 void ProtobufIRDiffDumper::AddLibNameIR(const std::string &name) {
   diff_tu_->set_lib_name(name);
 }
@@ -40,43 +70,46 @@ void ProtobufIRDiffDumper::AddArchIR(const std::string &arch) {
   diff_tu_->set_arch(arch);
 }
 
-CompatibilityStatusIR ProtobufIRDiffDumper::GetCompatibilityStatusIR() {
-  if (diff_tu_->functions_removed().size() != 0 ||
-      diff_tu_->global_vars_removed().size() != 0 ||
-      diff_tu_->function_diffs().size() != 0 ||
-      diff_tu_->global_var_diffs().size() != 0 ||
-      diff_tu_->enum_type_diffs().size() != 0 ||
-      diff_tu_->record_type_diffs().size() != 0) {
-    return CompatibilityStatusIR::Incompatible;
-  }
-
+static CompatibilityStatusIR
+GetDiffTUCompatibilityStatus(const abi_diff::TranslationUnitDiff &diff_tu) {
   CompatibilityStatusIR combined_status = CompatibilityStatusIR::Compatible;
-
-  if (diff_tu_->enum_type_extension_diffs().size() != 0 ||
-      diff_tu_->functions_added().size() != 0 ||
-      diff_tu_->global_vars_added().size() != 0) {
+  if (diff_tu.functions_removed().size() != 0 ||
+      diff_tu.global_vars_removed().size() != 0 ||
+      diff_tu.function_diffs().size() != 0 ||
+      diff_tu.global_var_diffs().size() != 0 ||
+      diff_tu.enum_type_diffs().size() != 0 ||
+      diff_tu.record_type_diffs().size() != 0) {
+    combined_status = combined_status | CompatibilityStatusIR::Incompatible;
+  }
+  if (diff_tu.enum_type_extension_diffs().size() != 0 ||
+      diff_tu.functions_added().size() != 0 ||
+      diff_tu.global_vars_added().size() != 0) {
     combined_status = combined_status | CompatibilityStatusIR::Extension;
   }
-
-  if (diff_tu_->unreferenced_enum_type_diffs().size() != 0 ||
-      diff_tu_->unreferenced_enum_types_removed().size() != 0 ||
-      diff_tu_->unreferenced_record_types_removed().size() != 0 ||
-      diff_tu_->unreferenced_record_type_diffs().size() != 0 ||
-      diff_tu_->unreferenced_enum_type_extension_diffs().size() != 0 ||
-      diff_tu_->unreferenced_record_types_added().size() != 0 ||
-      diff_tu_->unreferenced_enum_types_added().size()) {
+  if (diff_tu.unreferenced_enum_type_diffs().size() != 0 ||
+      diff_tu.unreferenced_enum_types_removed().size() != 0 ||
+      diff_tu.unreferenced_record_types_removed().size() != 0 ||
+      diff_tu.unreferenced_record_type_diffs().size() != 0 ||
+      diff_tu.unreferenced_enum_type_extension_diffs().size() != 0 ||
+      diff_tu.unreferenced_record_types_added().size() != 0 ||
+      diff_tu.unreferenced_enum_types_added().size()) {
     combined_status =
         combined_status | CompatibilityStatusIR::UnreferencedChanges;
   }
-
-  if (diff_tu_->removed_elf_functions().size() != 0 ||
-      diff_tu_->removed_elf_objects().size() != 0) {
+  if (diff_tu.removed_elf_functions().size() != 0 ||
+      diff_tu.removed_elf_objects().size() != 0) {
     combined_status = combined_status | CompatibilityStatusIR::ElfIncompatible;
   }
-
   return combined_status;
 }
 
+CompatibilityStatusIR ProtobufIRDiffDumper::GetCompatibilityStatusIR() {
+  if (compatibility_status_ & CompatibilityStatusIR::Incompatible) {
+    return CompatibilityStatusIR::Incompatible;
+  }
+  return compatibility_status_;
+}
+
 void ProtobufIRDiffDumper::AddCompatibilityStatusIR(
     CompatibilityStatusIR status) {
   diff_tu_->set_compatibility_status(CompatibilityStatusIRToProtobuf(status));
@@ -165,7 +198,7 @@ bool ProtobufIRDiffDumper::AddElfFunctionIR(
   }
   *added_elf_function =
       IRToProtobufConverter::ConvertElfFunctionIR(elf_function_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddElfObjectIR(
@@ -187,7 +220,7 @@ bool ProtobufIRDiffDumper::AddElfObjectIR(
   }
   *added_elf_object =
       IRToProtobufConverter::ConvertElfObjectIR(elf_object_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddLoneRecordTypeDiffIR(
@@ -212,7 +245,7 @@ bool ProtobufIRDiffDumper::AddLoneRecordTypeDiffIR(
   }
   *added_record_type =
       IRToProtobufConverter::ConvertRecordTypeIR(record_type_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddLoneFunctionDiffIR(
@@ -230,7 +263,7 @@ bool ProtobufIRDiffDumper::AddLoneFunctionDiffIR(
       return false;
   }
   *added_function = IRToProtobufConverter::ConvertFunctionIR(function_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddLoneEnumTypeDiffIR(
@@ -254,7 +287,7 @@ bool ProtobufIRDiffDumper::AddLoneEnumTypeDiffIR(
     return false;
   }
   *added_enum_type = IRToProtobufConverter::ConvertEnumTypeIR(enum_type_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddLoneGlobalVarDiffIR(
@@ -272,7 +305,7 @@ bool ProtobufIRDiffDumper::AddLoneGlobalVarDiffIR(
       return false;
   }
   *added_global_var = IRToProtobufConverter::ConvertGlobalVarIR(global_var_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddRecordTypeDiffIR(
@@ -296,7 +329,7 @@ bool ProtobufIRDiffDumper::AddRecordTypeDiffIR(
   *added_record_type_diff =
       IRDiffToProtobufConverter::ConvertRecordTypeDiffIR(record_diff_ir);
   added_record_type_diff->set_type_stack(type_stack);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddFunctionDiffIR(
@@ -309,7 +342,7 @@ bool ProtobufIRDiffDumper::AddFunctionDiffIR(
   }
   *added_function_diff =
       IRDiffToProtobufConverter::ConvertFunctionDiffIR(function_diff_ir);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddEnumTypeDiffIR(const EnumTypeDiffIR *enum_diff_ir,
@@ -344,7 +377,7 @@ bool ProtobufIRDiffDumper::AddEnumTypeDiffIR(const EnumTypeDiffIR *enum_diff_ir,
   *added_enum_type_diff =
       IRDiffToProtobufConverter::ConvertEnumTypeDiffIR(enum_diff_ir);
   added_enum_type_diff->set_type_stack(type_stack);
-  return true;
+  return FlushDiffTU();
 }
 
 bool ProtobufIRDiffDumper::AddGlobalVarDiffIR(
@@ -357,15 +390,47 @@ bool ProtobufIRDiffDumper::AddGlobalVarDiffIR(
   }
   *added_global_var_diff =
       IRDiffToProtobufConverter::ConvertGlobalVarDiffIR(global_var_diff_ir);
-  return true;
+  return FlushDiffTU();
+}
+
+// Text format messages can be concatenated, so each diff is written out as
+// soon as it is added and memory usage does not grow with the report.
+bool ProtobufIRDiffDumper::FlushDiffTU() {
+  CompatibilityStatusIR status = GetDiffTUCompatibilityStatus(*diff_tu_);
+  if (status & CompatibilityStatusIR::Incompatible) {
+    incompatible_diff_count_++;
+  }
+  compatibility_status_ = compatibility_status_ | status;
+  bool ok = google::protobuf::TextFormat::Print(*diff_tu_, text_os_.get());
+  diff_tu_->Clear();
+  return ok;
 }
 
 bool ProtobufIRDiffDumper::Dump() {
   GOOGLE_PROTOBUF_VERIFY_VERSION;
   assert(diff_tu_.get() != nullptr);
-  std::ofstream text_output(dump_path_);
-  google::protobuf::io::OstreamOutputStream text_os(&text_output);
-  return google::protobuf::TextFormat::Print(*diff_tu_.get(), &text_os);
+  bool ok = google::protobuf::TextFormat::Print(*diff_tu_, text_os_.get());
+  // Destroying the stream flushes its buffer to text_output_.
+  text_os_.reset();
+  text_output_.close();
+  if (temp_path_.empty()) {
+    return false;
+  }
+  // The caller may exit without destroying this object.
+  if (!ok || text_output_.fail()) {
+    llvm::sys::fs::remove(temp_path_);
+    temp_path_.clear();
+    return false;
+  }
+  if (std::error_code ec = llvm::sys::fs::rename(temp_path_, dump_path_)) {
+    llvm::errs() << "Failed to rename " << temp_path_ << " to " << dump_path_
+                 << ": " << ec.message() << "\n";
+    llvm::sys::fs::remove(temp_path_);
+    temp_path_.clear();
+    return false;
+  }
+  temp_path_.clear();
+  return true;
 }
 
 std::unique_ptr<IRDiffDumper> CreateProtobufIRDiffDumper(
@@ -20,8 +20,12 @@
 #include "repr/ir_representation.h"
 #include "repr/protobuf/abi_diff.h"
 
+#include <fstream>
+#include <memory>
 #include <string>
 
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
 
 namespace header_checker {
 namespace repr {
@@ -29,11 +33,9 @@ namespace repr {
 
 class ProtobufIRDiffDumper : public IRDiffDumper {
  public:
-  ProtobufIRDiffDumper(const std::string &dump_path)
-      : IRDiffDumper(dump_path),
-        diff_tu_(new abi_diff::TranslationUnitDiff()) {}
+  ProtobufIRDiffDumper(const std::string &dump_path);
 
-  ~ProtobufIRDiffDumper() override {}
+  ~ProtobufIRDiffDumper() override;
 
   bool AddDiffMessageIR(const DiffMessageIR *, const std::string &type_stack,
                         DiffKind diff_kind) override;
@@ -82,9 +84,19 @@ class ProtobufIRDiffDumper : public IRDiffDumper {
   bool AddElfFunctionIR(const ElfFunctionIR *elf_function_ir,
                         DiffKind diff_kind);
 
+  bool FlushDiffTU();
+
 
  protected:
+  // diff_tu_ only holds the diffs which have not been written out yet, and
+  // the fields which are written at the end of the report.
   std::unique_ptr<abi_diff::TranslationUnitDiff> diff_tu_;
+  // The report is written to temp_path_ and renamed to dump_path_ by Dump(),
+  // so that a run which fails halfway does not leave a partial report.
+  std::string temp_path_;
+  std::ofstream text_output_;
+  std::unique_ptr<google::protobuf::io::OstreamOutputStream> text_os_;
+  CompatibilityStatusIR compatibility_status_;
 };
 
 
@@ -17,7 +17,6 @@
 #include "repr/protobuf/abi_dump.h"
 #include "repr/protobuf/api.h"
 
-#include <fstream>
 #include <memory>
 
 #include <llvm/Support/raw_ostream.h>
@@ -472,12 +471,79 @@ bool ProtobufIRDumper::AddRvalueReferenceTypeIR(
 }
 
 bool ProtobufIRDumper::Dump(const ModuleIR &module) {
+  if (index_) {
+    return DumpModuleWithIndex(module);
+  }
   GOOGLE_PROTOBUF_VERIFY_VERSION;
   DumpModule(module);
   assert( tu_ptr_.get() != nullptr);
-  std::ofstream text_output(dump_path_);
-  google::protobuf::io::OstreamOutputStream text_os(&text_output);
-  return google::protobuf::TextFormat::Print(*tu_ptr_.get(), &text_os);
+  utils::OutputFileStream text_output(dump_path_, compression_);
+  if (!text_output.IsOpen()) {
+    llvm::errs() << "Failed to open " << dump_path_ << "\n";
+    return false;
+  }
+  bool ok;
+  {
+    google::protobuf::io::OstreamOutputStream text_os(&text_output);
+    ok = google::protobuf::TextFormat::Print(*tu_ptr_.get(), &text_os);
+  }
+  return text_output.Close() && ok;
+}
+
+bool ProtobufIRDumper::BeginStream() {
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+  stream_ = std::make_unique<utils::OutputFileStream>(dump_path_, compression_);
+  if (!stream_->IsOpen()) {
+    llvm::errs() << "Failed to open " << dump_path_ << "\n";
+    return false;
+  }
+  text_os_ =
+      std::make_unique<google::protobuf::io::OstreamOutputStream>(
+          stream_.get());
+  return true;
+}
+
+bool ProtobufIRDumper::StreamLinkableMessage(const LinkableMessageIR &lm) {
+  assert(text_os_ != nullptr);
+  tu_ptr_->Clear();
+  if (!AddLinkableMessageIR(&lm)) {
+    return false;
+  }
+  uint64_t offset = text_os_->ByteCount();
+  if (!google::protobuf::TextFormat::Print(*tu_ptr_, text_os_.get())) {
+    return false;
+  }
+  if (index_) {
+    index_->AddLinkableMessage(GetAbiIndexKey(lm.GetKind()), lm, offset,
+                               text_os_->ByteCount() - offset);
+  }
+  return true;
+}
+
+bool ProtobufIRDumper::StreamElfSymbol(const ElfSymbolIR &elf_symbol) {
+  assert(text_os_ != nullptr);
+  tu_ptr_->Clear();
+  if (!AddElfSymbolMessageIR(&elf_symbol)) {
+    return false;
+  }
+  uint64_t offset = text_os_->ByteCount();
+  if (!google::protobuf::TextFormat::Print(*tu_ptr_, text_os_.get())) {
+    return false;
+  }
+  if (index_) {
+    index_->AddElfSymbol(GetAbiIndexKey(elf_symbol.GetKind()), elf_symbol,
+                         offset, text_os_->ByteCount() - offset);
+  }
+  return true;
+}
+
+bool ProtobufIRDumper::EndStream() {
+  tu_ptr_->Clear();
+  // Flush the buffer of the OstreamOutputStream before closing the file.
+  text_os_.reset();
+  bool ok = stream_->Close();
+  stream_.reset();
+  return ok;
 }
 
 std::unique_ptr<IRDumper> CreateProtobufIRDumper(const std::string &dump_path) {
@@ -19,6 +19,11 @@
 #include "repr/protobuf/abi_dump.h"
 #include "repr/protobuf/converter.h"
 #include "repr/protobuf/ir_dumper.h"
+#include "utils/compressed_file.h"
+
+#include <memory>
+
+#include <google/protobuf/io/zero_copy_stream_impl.h>
 
 
 namespace header_checker {
@@ -64,6 +69,14 @@ class ProtobufIRDumper : public IRDumper, public IRToProtobufConverter {
 
   bool Dump(const ModuleIR &module) override;
 
+  bool BeginStream() override;
+
+  bool StreamLinkableMessage(const LinkableMessageIR &lm) override;
+
+  bool StreamElfSymbol(const ElfSymbolIR &elf_symbol) override;
+
+  bool EndStream() override;
+
 
  private:
   bool AddLinkableMessageIR(const LinkableMessageIR *) override;
@@ -73,6 +86,11 @@ class ProtobufIRDumper : public IRDumper, public IRToProtobufConverter {
 
  private:
   std::unique_ptr<abi_dump::TranslationUnit> tu_ptr_;
+
+  // In streaming mode, tu_ptr_ holds one element at a time. The concatenated
+  // text format messages are parsed as one TranslationUnit.
+  std::unique_ptr<utils::OutputFileStream> stream_;
+  std::unique_ptr<google::protobuf::io::OstreamOutputStream> text_os_;
 };
 
 
@@ -18,8 +18,9 @@
 #include "repr/protobuf/api.h"
 #include "repr/protobuf/converter.h"
 
-#include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <google/protobuf/text_format.h>
 
@@ -39,9 +40,8 @@ void ProtobufIRReader::ReadTypeInfo(
   typep->SetAlignment(type_info.alignment());
 }
 
-bool ProtobufIRReader::ReadDumpImpl(const std::string &dump_file) {
+bool ProtobufIRReader::ReadDumpImpl(std::istream &input) {
   abi_dump::TranslationUnit tu;
-  std::ifstream input(dump_file);
   google::protobuf::io::IstreamInputStream text_is(&input);
 
   if (!google::protobuf::TextFormat::Parse(&text_is, &tu)) {
@@ -269,6 +269,17 @@ void ProtobufIRReader::ReadRvalueReferenceTypes(
   }
 }
 
+std::string ProtobufIRReader::AssembleDump(
+    llvm::StringRef dump, const std::vector<const AbiIndexEntry *> &entries) {
+  // Each element is a repeated field in the text format. The concatenated
+  // fields are parsed as one TranslationUnit.
+  std::string result;
+  for (auto &&entry : entries) {
+    result.append(dump.data() + entry->offset_, entry->length_);
+  }
+  return result;
+}
+
 void ProtobufIRReader::ReadFunctions(const abi_dump::TranslationUnit &tu) {
   for (auto &&function_protobuf : tu.functions()) {
     FunctionIR function_ir = FunctionProtobufToIR(function_protobuf);
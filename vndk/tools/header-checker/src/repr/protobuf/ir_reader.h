@@ -43,7 +43,11 @@ class ProtobufIRReader : public IRReader {
 
 
  private:
-  bool ReadDumpImpl(const std::string &dump_file) override;
+  bool ReadDumpImpl(std::istream &input) override;
+
+  std::string AssembleDump(
+      llvm::StringRef dump,
+      const std::vector<const AbiIndexEntry *> &entries) override;
 
   void ReadFunctions(const abi_dump::TranslationUnit &tu);
 
@@ -0,0 +1,197 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "repr/type_equivalence_cache.h"
+
+#include "utils/hash_utils.h"
+
+#include <cstdint>
+#include <string>
+
+
+namespace header_checker {
+namespace repr {
+
+
+const std::string *TypeFingerprinter::GetFingerprint(
+    const std::string &type_id) {
+  auto cached = fingerprints_.find(type_id);
+  if (cached != fingerprints_.end()) {
+    return cached->second.empty() ? nullptr : &cached->second;
+  }
+  auto type = types_.find(type_id);
+  if (type == types_.end()) {
+    return nullptr;
+  }
+  if (!visiting_.insert(type_id).second) {
+    // The type is part of a cycle. Its fingerprint would depend on itself.
+    return nullptr;
+  }
+  std::string fingerprint;
+  if (!ComputeFingerprint(type->second, &fingerprint)) {
+    fingerprint.clear();
+  }
+  visiting_.erase(type_id);
+  std::string &result = fingerprints_[type_id];
+  result = std::move(fingerprint);
+  return result.empty() ? nullptr : &result;
+}
+
+bool TypeFingerprinter::ComputeFingerprint(const TypeIR *type,
+                                           std::string *fingerprint) {
+  utils::HashBuilder builder;
+  auto add_type = [this, &builder](const std::string &type_id) {
+    const std::string *referenced = GetFingerprint(type_id);
+    if (!referenced) {
+      return false;
+    }
+    builder.Add(*referenced);
+    return true;
+  };
+
+  builder.Add(static_cast<uint64_t>(type->GetKind()));
+  builder.Add(type->GetLinkerSetKey());
+  builder.Add(type->GetName());
+  builder.Add(type->GetSize());
+  builder.Add(static_cast<uint64_t>(type->GetAlignment()));
+
+  switch (type->GetKind()) {
+    case RecordTypeKind: {
+      auto record = static_cast<const RecordTypeIR *>(type);
+      builder.Add(static_cast<uint64_t>(record->GetAccess()));
+      builder.Add(static_cast<uint64_t>(record->IsAnonymous()));
+      builder.Add(static_cast<uint64_t>(record->GetRecordKind()));
+      builder.Add(static_cast<uint64_t>(record->GetFields().size()));
+      for (auto &&field : record->GetFields()) {
+        builder.Add(field.GetName());
+        builder.Add(field.GetOffset());
+        builder.Add(static_cast<uint64_t>(field.GetAccess()));
+        if (!add_type(field.GetReferencedType())) {
+          return false;
+        }
+      }
+      builder.Add(static_cast<uint64_t>(record->GetBases().size()));
+      for (auto &&base : record->GetBases()) {
+        builder.Add(static_cast<uint64_t>(base.IsVirtual()));
+        builder.Add(static_cast<uint64_t>(base.GetAccess()));
+        if (!add_type(base.GetReferencedType())) {
+          return false;
+        }
+      }
+      auto &&components = record->GetVTableLayout().GetVTableComponents();
+      builder.Add(static_cast<uint64_t>(components.size()));
+      for (auto &&component : components) {
+        builder.Add(component.GetName());
+        builder.Add(static_cast<uint64_t>(component.GetKind()));
+        builder.Add(component.GetValue());
+        builder.Add(static_cast<uint64_t>(component.GetIsPure()));
+      }
+      builder.Add(static_cast<uint64_t>(record->GetTemplateElements().size()));
+      for (auto &&element : record->GetTemplateElements()) {
+        if (!add_type(element.GetReferencedType())) {
+          return false;
+        }
+      }
+      break;
+    }
+    case EnumTypeKind: {
+      auto enum_type = static_cast<const EnumTypeIR *>(type);
+      builder.Add(static_cast<uint64_t>(enum_type->GetAccess()));
+      // Enums are compared by the name of the underlying type.
+      auto underlying_type = types_.find(enum_type->GetUnderlyingType());
+      builder.Add(underlying_type != types_.end() ?
+                  underlying_type->second->GetName() :
+                  enum_type->GetUnderlyingType());
+      builder.Add(static_cast<uint64_t>(enum_type->GetFields().size()));
+      for (auto &&field : enum_type->GetFields()) {
+        builder.Add(field.GetName());
+        builder.Add(static_cast<int64_t>(field.GetValue()));
+      }
+      break;
+    }
+    case FunctionTypeKind: {
+      auto function_type = static_cast<const FunctionTypeIR *>(type);
+      if (!add_type(function_type->GetReturnType())) {
+        return false;
+      }
+      builder.Add(static_cast<uint64_t>(function_type->GetParameters().size()));
+      for (auto &&parameter : function_type->GetParameters()) {
+        builder.Add(static_cast<uint64_t>(parameter.GetIsDefault()));
+        builder.Add(static_cast<uint64_t>(parameter.GetIsThisPtr()));
+        if (!add_type(parameter.GetReferencedType())) {
+          return false;
+        }
+      }
+      break;
+    }
+    case QualifiedTypeKind: {
+      auto qualified_type = static_cast<const QualifiedTypeIR *>(type);
+      builder.Add(static_cast<uint64_t>(qualified_type->IsConst()));
+      builder.Add(static_cast<uint64_t>(qualified_type->IsVolatile()));
+      builder.Add(static_cast<uint64_t>(qualified_type->IsRestricted()));
+      if (!add_type(type->GetReferencedType())) {
+        return false;
+      }
+      break;
+    }
+    case BuiltinTypeKind: {
+      auto builtin_type = static_cast<const BuiltinTypeIR *>(type);
+      builder.Add(static_cast<uint64_t>(builtin_type->IsUnsigned()));
+      builder.Add(static_cast<uint64_t>(builtin_type->IsIntegralType()));
+      break;
+    }
+    case PointerTypeKind:
+    case LvalueReferenceTypeKind:
+    case RvalueReferenceTypeKind:
+    case ArrayTypeKind:
+      if (!add_type(type->GetReferencedType())) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+
+  *fingerprint = builder.Finish();
+  return true;
+}
+
+
+bool TypeEquivalenceChecker::IsEquivalent(
+    const std::string &old_type_id, const std::string &new_type_id,
+    std::pair<const std::string *, const std::string *> *fingerprints) {
+  *fingerprints = std::make_pair(nullptr, nullptr);
+  const std::string *old_fingerprint =
+      old_fingerprinter_.GetFingerprint(old_type_id);
+  const std::string *new_fingerprint =
+      old_fingerprint ? new_fingerprinter_.GetFingerprint(new_type_id) :
+                        nullptr;
+  if (!new_fingerprint) {
+    num_misses_++;
+    return false;
+  }
+  // Structurally identical types cannot differ.
+  if (*old_fingerprint == *new_fingerprint ||
+      cache_->IsEquivalent(*old_fingerprint, *new_fingerprint)) {
+    num_hits_++;
+    return true;
+  }
+  num_misses_++;
+  *fingerprints = std::make_pair(old_fingerprint, new_fingerprint);
+  return false;
+}
+
+
+}  // namespace repr
+}  // namespace header_checker
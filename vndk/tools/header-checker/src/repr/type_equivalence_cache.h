@@ -0,0 +1,122 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TYPE_EQUIVALENCE_CACHE_H_
+#define TYPE_EQUIVALENCE_CACHE_H_
+
+#include "repr/ir_representation.h"
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+
+
+namespace header_checker {
+namespace repr {
+
+
+// This class computes structural fingerprints of the types in a type graph.
+// The fingerprint of a type covers everything AbiDiffHelper compares, with the
+// referenced type ids replaced by the fingerprints of the referenced types.
+// Hence, two types with the same fingerprint are equivalent regardless of the
+// architecture or the type ids in the dumps.
+class TypeFingerprinter {
+ public:
+  TypeFingerprinter(const AbiElementMap<const TypeIR *> &types)
+      : types_(types) {}
+
+  // Returns nullptr if the type is not in the type graph, refers to a type
+  // that is not in the type graph, or is part of or refers to a cycle.
+  const std::string *GetFingerprint(const std::string &type_id);
+
+ private:
+  bool ComputeFingerprint(const TypeIR *type, std::string *fingerprint);
+
+ private:
+  const AbiElementMap<const TypeIR *> &types_;
+  // An empty string denotes a type without a fingerprint.
+  AbiElementMap<std::string> fingerprints_;
+  std::set<std::string> visiting_;
+};
+
+
+// This class records pairs of type fingerprints which have been compared
+// without any difference. It can be shared by the diffs of several
+// architectures, so that a type which is laid out identically on them is
+// compared only once.
+class TypeEquivalenceCache {
+ public:
+  bool IsEquivalent(const std::string &old_fingerprint,
+                    const std::string &new_fingerprint) const {
+    return equivalent_pairs_.find(
+        std::make_pair(old_fingerprint, new_fingerprint)) !=
+        equivalent_pairs_.end();
+  }
+
+  void AddEquivalent(const std::string &old_fingerprint,
+                     const std::string &new_fingerprint) {
+    equivalent_pairs_.emplace(old_fingerprint, new_fingerprint);
+  }
+
+ private:
+  std::set<std::pair<std::string, std::string>> equivalent_pairs_;
+};
+
+
+// This class binds a shared TypeEquivalenceCache to the type graphs of one
+// (old, new) dump pair.
+class TypeEquivalenceChecker {
+ public:
+  TypeEquivalenceChecker(const AbiElementMap<const TypeIR *> &old_types,
+                         const AbiElementMap<const TypeIR *> &new_types,
+                         TypeEquivalenceCache *cache)
+      : old_fingerprinter_(old_types), new_fingerprinter_(new_types),
+        cache_(cache) {}
+
+  // Returns true if the types are known to be equivalent. Otherwise, sets
+  // `fingerprints` to the fingerprints to be passed to AddEquivalent() if the
+  // comparison finds no difference, or to (nullptr, nullptr) if the result
+  // must not be cached.
+  bool IsEquivalent(
+      const std::string &old_type_id, const std::string &new_type_id,
+      std::pair<const std::string *, const std::string *> *fingerprints);
+
+  void AddEquivalent(
+      const std::pair<const std::string *, const std::string *> &fingerprints) {
+    cache_->AddEquivalent(*fingerprints.first, *fingerprints.second);
+  }
+
+  uint64_t GetNumHits() const {
+    return num_hits_;
+  }
+
+  uint64_t GetNumMisses() const {
+    return num_misses_;
+  }
+
+ private:
+  TypeFingerprinter old_fingerprinter_;
+  TypeFingerprinter new_fingerprinter_;
+  TypeEquivalenceCache *cache_;
+  uint64_t num_hits_ = 0;
+  uint64_t num_misses_ = 0;
+};
+
+
+}  // namespace repr
+}  // namespace header_checker
+
+
+#endif  // TYPE_EQUIVALENCE_CACHE_H_
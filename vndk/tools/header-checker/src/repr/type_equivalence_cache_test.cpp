@@ -0,0 +1,192 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "repr/type_equivalence_cache.h"
+
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+
+namespace header_checker {
+namespace repr {
+
+
+// The types of one dump. The type ids end with a suffix, so that the dumps of
+// different architectures do not share the ids.
+class TestTypes {
+ public:
+  TestTypes(const std::string &suffix) : suffix_(suffix) {
+    int_type_.SetName("int");
+    int_type_.SetSelfType(GetId("_ZTIi"));
+    int_type_.SetReferencedType(GetId("_ZTIi"));
+    int_type_.SetLinkerSetKey("_ZTIi");
+    int_type_.SetSize(4);
+    int_type_.SetAlignment(4);
+    int_type_.SetIntegralType(true);
+    types_[int_type_.GetSelfType()] = &int_type_;
+  }
+
+  std::string GetId(const std::string &name) const {
+    return name + suffix_;
+  }
+
+  // Adds a struct with an int field at the offset.
+  void AddRecord(const std::string &name, uint64_t field_offset) {
+    record_.SetName(name);
+    record_.SetSelfType(GetId("_ZTI" + name));
+    record_.SetReferencedType(GetId("_ZTI" + name));
+    record_.SetLinkerSetKey("_ZTI" + name);
+    record_.SetRecordKind(RecordTypeIR::struct_kind);
+    record_.SetSize(8);
+    record_.SetAlignment(4);
+    record_.AddRecordField(RecordFieldIR("field", GetId("_ZTIi"),
+                                         field_offset,
+                                         AccessSpecifierIR::PublicAccess));
+    types_[record_.GetSelfType()] = &record_;
+  }
+
+  // Adds a pointer to the referenced type.
+  void AddPointer(const std::string &referenced_type_id) {
+    pointer_.SetName("pointer");
+    pointer_.SetSelfType(GetId("_ZTIP"));
+    pointer_.SetReferencedType(referenced_type_id);
+    pointer_.SetLinkerSetKey("_ZTIP");
+    pointer_.SetSize(8);
+    pointer_.SetAlignment(8);
+    types_[pointer_.GetSelfType()] = &pointer_;
+  }
+
+  const AbiElementMap<const TypeIR *> &GetTypes() const {
+    return types_;
+  }
+
+ private:
+  const std::string suffix_;
+  BuiltinTypeIR int_type_;
+  RecordTypeIR record_;
+  PointerTypeIR pointer_;
+  AbiElementMap<const TypeIR *> types_;
+};
+
+
+TEST(TypeEquivalenceCacheTest, FingerprintIgnoresTypeIds) {
+  TestTypes arm_types("#arm");
+  arm_types.AddRecord("A", 0);
+  TestTypes x86_types("#x86");
+  x86_types.AddRecord("A", 0);
+  TestTypes other_types("#other");
+  other_types.AddRecord("A", 4);
+
+  TypeFingerprinter arm_fingerprinter(arm_types.GetTypes());
+  TypeFingerprinter x86_fingerprinter(x86_types.GetTypes());
+  TypeFingerprinter other_fingerprinter(other_types.GetTypes());
+  const std::string *arm_fingerprint =
+      arm_fingerprinter.GetFingerprint(arm_types.GetId("_ZTIA"));
+  const std::string *x86_fingerprint =
+      x86_fingerprinter.GetFingerprint(x86_types.GetId("_ZTIA"));
+  const std::string *other_fingerprint =
+      other_fingerprinter.GetFingerprint(other_types.GetId("_ZTIA"));
+  ASSERT_NE(nullptr, arm_fingerprint);
+  ASSERT_NE(nullptr, x86_fingerprint);
+  ASSERT_NE(nullptr, other_fingerprint);
+  EXPECT_EQ(*arm_fingerprint, *x86_fingerprint);
+  EXPECT_NE(*arm_fingerprint, *other_fingerprint);
+}
+
+TEST(TypeEquivalenceCacheTest, NoFingerprint) {
+  TestTypes types("");
+  types.AddRecord("A", 0);
+  TypeFingerprinter fingerprinter(types.GetTypes());
+  EXPECT_EQ(nullptr, fingerprinter.GetFingerprint("_ZTIB"));
+
+  TestTypes dangling_types("");
+  dangling_types.AddPointer("_ZTIB");
+  TypeFingerprinter dangling_fingerprinter(dangling_types.GetTypes());
+  EXPECT_EQ(nullptr, dangling_fingerprinter.GetFingerprint("_ZTIP"));
+
+  TestTypes cyclic_types("");
+  cyclic_types.AddPointer("_ZTIP");
+  TypeFingerprinter cyclic_fingerprinter(cyclic_types.GetTypes());
+  EXPECT_EQ(nullptr, cyclic_fingerprinter.GetFingerprint("_ZTIP"));
+}
+
+TEST(TypeEquivalenceCacheTest, ShareResultsAcrossArchitectures) {
+  TypeEquivalenceCache cache;
+  std::pair<const std::string *, const std::string *> fingerprints;
+
+  // The first architecture compares the types and records the result.
+  TestTypes arm_old_types("#arm_old");
+  arm_old_types.AddRecord("A", 0);
+  TestTypes arm_new_types("#arm_new");
+  arm_new_types.AddRecord("B", 0);
+  TypeEquivalenceChecker arm_checker(arm_old_types.GetTypes(),
+                                     arm_new_types.GetTypes(), &cache);
+  EXPECT_FALSE(arm_checker.IsEquivalent(arm_old_types.GetId("_ZTIA"),
+                                        arm_new_types.GetId("_ZTIB"),
+                                        &fingerprints));
+  ASSERT_NE(nullptr, fingerprints.first);
+  ASSERT_NE(nullptr, fingerprints.second);
+  arm_checker.AddEquivalent(fingerprints);
+  EXPECT_EQ(0u, arm_checker.GetNumHits());
+  EXPECT_EQ(1u, arm_checker.GetNumMisses());
+
+  // The second architecture lays out the types identically.
+  TestTypes x86_old_types("#x86_old");
+  x86_old_types.AddRecord("A", 0);
+  TestTypes x86_new_types("#x86_new");
+  x86_new_types.AddRecord("B", 0);
+  TypeEquivalenceChecker x86_checker(x86_old_types.GetTypes(),
+                                     x86_new_types.GetTypes(), &cache);
+  EXPECT_TRUE(x86_checker.IsEquivalent(x86_old_types.GetId("_ZTIA"),
+                                       x86_new_types.GetId("_ZTIB"),
+                                       &fingerprints));
+  EXPECT_EQ(1u, x86_checker.GetNumHits());
+
+  // The third architecture lays out the new type differently.
+  TestTypes mips_old_types("#mips_old");
+  mips_old_types.AddRecord("A", 0);
+  TestTypes mips_new_types("#mips_new");
+  mips_new_types.AddRecord("B", 4);
+  TypeEquivalenceChecker mips_checker(mips_old_types.GetTypes(),
+                                      mips_new_types.GetTypes(), &cache);
+  EXPECT_FALSE(mips_checker.IsEquivalent(mips_old_types.GetId("_ZTIA"),
+                                         mips_new_types.GetId("_ZTIB"),
+                                         &fingerprints));
+  EXPECT_EQ(0u, mips_checker.GetNumHits());
+}
+
+TEST(TypeEquivalenceCacheTest, IdenticalTypes) {
+  TypeEquivalenceCache cache;
+  std::pair<const std::string *, const std::string *> fingerprints;
+  TestTypes old_types("#old");
+  old_types.AddRecord("A", 0);
+  TestTypes new_types("#new");
+  new_types.AddRecord("A", 0);
+  TypeEquivalenceChecker checker(old_types.GetTypes(), new_types.GetTypes(),
+                                 &cache);
+  EXPECT_TRUE(checker.IsEquivalent(old_types.GetId("_ZTIA"),
+                                   new_types.GetId("_ZTIA"), &fingerprints));
+
+  // A type without a fingerprint is never cached.
+  EXPECT_FALSE(checker.IsEquivalent(old_types.GetId("_ZTIA"),
+                                    new_types.GetId("_ZTIC"), &fingerprints));
+  EXPECT_EQ(nullptr, fingerprints.first);
+  EXPECT_EQ(nullptr, fingerprints.second);
+}
+
+
+}  // namespace repr
+}  // namespace header_checker
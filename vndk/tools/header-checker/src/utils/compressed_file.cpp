@@ -0,0 +1,464 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utils/compressed_file.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+#include <zstd.h>
+
+
+namespace header_checker {
+namespace utils {
+
+
+static const size_t kChunkSize = 1 << 16;
+// The number of decompressed chunks that the decompression thread may run
+// ahead of the parser.
+static const size_t kMaxPendingChunks = 4;
+static const int kZstdLevel = 3;
+
+static const unsigned char kGzipMagic[] = {0x1f, 0x8b};
+static const unsigned char kZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+
+CompressionFormat DetectCompressionFormat(const char *data, size_t size) {
+  if (size >= sizeof(kGzipMagic) &&
+      memcmp(data, kGzipMagic, sizeof(kGzipMagic)) == 0) {
+    return CompressionFormat::Gzip;
+  }
+  if (size >= sizeof(kZstdMagic) &&
+      memcmp(data, kZstdMagic, sizeof(kZstdMagic)) == 0) {
+    return CompressionFormat::Zstd;
+  }
+  return CompressionFormat::None;
+}
+
+
+namespace {
+
+
+// A codec converts the data chunk by chunk.
+class Codec {
+ public:
+  virtual ~Codec() {}
+
+  // Consumes the input and appends the output. The last call has finish set
+  // to true. Returns false if the data is invalid or truncated.
+  virtual bool Process(const char *data, size_t size, bool finish,
+                       std::string *out) = 0;
+};
+
+
+class GzipDecoder : public Codec {
+ public:
+  GzipDecoder() {
+    // 16 makes zlib expect the gzip header and trailer.
+    ok_ = (inflateInit2(&stream_, 16 + MAX_WBITS) == Z_OK);
+  }
+
+  ~GzipDecoder() {
+    inflateEnd(&stream_);
+  }
+
+  bool Process(const char *data, size_t size, bool finish,
+               std::string *out) override {
+    if (!ok_) {
+      return false;
+    }
+    char buffer[kChunkSize];
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_.avail_in = size;
+    do {
+      // The file may consist of several gzip members.
+      if (stream_end_ && stream_.avail_in > 0) {
+        inflateReset(&stream_);
+        stream_end_ = false;
+      }
+      stream_.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream_.avail_out = sizeof(buffer);
+      int result = inflate(&stream_, Z_NO_FLUSH);
+      if (result == Z_STREAM_END) {
+        stream_end_ = true;
+      } else if (result == Z_BUF_ERROR) {
+        // No progress is possible until more input is available.
+        break;
+      } else if (result != Z_OK) {
+        return false;
+      }
+      out->append(buffer, sizeof(buffer) - stream_.avail_out);
+    } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+    return !finish || stream_end_;
+  }
+
+ private:
+  z_stream stream_ = {};
+  bool ok_;
+  bool stream_end_ = false;
+};
+
+
+class GzipEncoder : public Codec {
+ public:
+  GzipEncoder() {
+    ok_ = (deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                        16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+  }
+
+  ~GzipEncoder() {
+    deflateEnd(&stream_);
+  }
+
+  bool Process(const char *data, size_t size, bool finish,
+               std::string *out) override {
+    if (!ok_) {
+      return false;
+    }
+    char buffer[kChunkSize];
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_.avail_in = size;
+    int result;
+    do {
+      stream_.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream_.avail_out = sizeof(buffer);
+      result = deflate(&stream_, finish ? Z_FINISH : Z_NO_FLUSH);
+      if (result == Z_STREAM_ERROR) {
+        return false;
+      }
+      out->append(buffer, sizeof(buffer) - stream_.avail_out);
+    } while (finish ? result != Z_STREAM_END : stream_.avail_out == 0);
+    return true;
+  }
+
+ private:
+  z_stream stream_ = {};
+  bool ok_;
+};
+
+
+class ZstdDecoder : public Codec {
+ public:
+  ZstdDecoder() : stream_(ZSTD_createDStream()) {}
+
+  ~ZstdDecoder() {
+    ZSTD_freeDStream(stream_);
+  }
+
+  bool Process(const char *data, size_t size, bool finish,
+               std::string *out) override {
+    if (stream_ == nullptr) {
+      return false;
+    }
+    char buffer[kChunkSize];
+    ZSTD_inBuffer input = {data, size, 0};
+    while (true) {
+      ZSTD_outBuffer output = {buffer, sizeof(buffer), 0};
+      size_t input_pos = input.pos;
+      size_t result = ZSTD_decompressStream(stream_, &output, &input);
+      if (ZSTD_isError(result)) {
+        return false;
+      }
+      // Zero means that a frame has been completely decoded. A call without
+      // progress, e.g., the last call with no input, returns a hint for the
+      // next frame instead, so it does not change the state.
+      if (input.pos != input_pos || output.pos != 0) {
+        frame_end_ = (result == 0);
+      }
+      out->append(buffer, output.pos);
+      if (input.pos == input.size && output.pos < output.size) {
+        break;
+      }
+    }
+    return !finish || frame_end_;
+  }
+
+ private:
+  ZSTD_DStream *stream_;
+  bool frame_end_ = false;
+};
+
+
+class ZstdEncoder : public Codec {
+ public:
+  ZstdEncoder() : stream_(ZSTD_createCStream()) {
+    if (stream_ != nullptr) {
+      ZSTD_CCtx_setParameter(stream_, ZSTD_c_compressionLevel, kZstdLevel);
+    }
+  }
+
+  ~ZstdEncoder() {
+    ZSTD_freeCStream(stream_);
+  }
+
+  bool Process(const char *data, size_t size, bool finish,
+               std::string *out) override {
+    if (stream_ == nullptr) {
+      return false;
+    }
+    char buffer[kChunkSize];
+    ZSTD_inBuffer input = {data, size, 0};
+    size_t remaining;
+    do {
+      ZSTD_outBuffer output = {buffer, sizeof(buffer), 0};
+      remaining = ZSTD_compressStream2(stream_, &output, &input,
+                                       finish ? ZSTD_e_end : ZSTD_e_continue);
+      if (ZSTD_isError(remaining)) {
+        return false;
+      }
+      out->append(buffer, output.pos);
+    } while (finish ? remaining != 0 : input.pos < input.size);
+    return true;
+  }
+
+ private:
+  ZSTD_CStream *stream_;
+};
+
+
+std::unique_ptr<Codec> CreateDecoder(CompressionFormat format) {
+  switch (format) {
+    case CompressionFormat::Gzip:
+      return std::make_unique<GzipDecoder>();
+    case CompressionFormat::Zstd:
+      return std::make_unique<ZstdDecoder>();
+    default:
+      return nullptr;
+  }
+}
+
+std::unique_ptr<Codec> CreateEncoder(CompressionFormat format) {
+  switch (format) {
+    case CompressionFormat::Gzip:
+      return std::make_unique<GzipEncoder>();
+    case CompressionFormat::Zstd:
+      return std::make_unique<ZstdEncoder>();
+    default:
+      return nullptr;
+  }
+}
+
+
+}  // namespace
+
+
+// The decompression thread reads the file and queues the decompressed chunks,
+// which underflow() hands to the parser.
+class DecompressingStreamBuf : public std::streambuf {
+ public:
+  DecompressingStreamBuf(std::filebuf *file, std::unique_ptr<Codec> decoder)
+      : file_(file), decoder_(std::move(decoder)),
+        thread_(&DecompressingStreamBuf::Run, this) {}
+
+  ~DecompressingStreamBuf() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cancelled_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+
+  bool HasError() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+ protected:
+  int_type underflow() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return !chunks_.empty() || done_; });
+    if (chunks_.empty()) {
+      return traits_type::eof();
+    }
+    current_ = std::move(chunks_.front());
+    chunks_.pop_front();
+    lock.unlock();
+    cond_.notify_all();
+    char *begin = &current_[0];
+    setg(begin, begin, begin + current_.size());
+    return traits_type::to_int_type(*begin);
+  }
+
+ private:
+  void Run() {
+    std::vector<char> input(kChunkSize);
+    bool ok = true;
+    bool finish = false;
+    while (ok && !finish) {
+      std::streamsize size = file_->sgetn(input.data(), input.size());
+      finish = (static_cast<size_t>(size) < input.size());
+      std::string output;
+      ok = decoder_->Process(input.data(), size, finish, &output);
+      if (output.empty()) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this] {
+        return chunks_.size() < kMaxPendingChunks || cancelled_;
+      });
+      if (cancelled_) {
+        return;
+      }
+      chunks_.emplace_back(std::move(output));
+      lock.unlock();
+      cond_.notify_all();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = !ok;
+      done_ = true;
+    }
+    cond_.notify_all();
+  }
+
+ private:
+  std::filebuf *file_;
+  std::unique_ptr<Codec> decoder_;
+  std::string current_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::string> chunks_;
+  bool done_ = false;
+  bool error_ = false;
+  bool cancelled_ = false;
+
+  // The thread is started after the other members are initialized.
+  std::thread thread_;
+};
+
+
+// The data is compressed whenever the buffer is full.
+class CompressingStreamBuf : public std::streambuf {
+ public:
+  CompressingStreamBuf(std::filebuf *file, std::unique_ptr<Codec> encoder)
+      : file_(file), encoder_(std::move(encoder)), buffer_(kChunkSize) {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  bool Finish() {
+    return Compress(true);
+  }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (!Compress(false)) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+ private:
+  bool Compress(bool finish) {
+    std::string output;
+    bool ok = encoder_->Process(pbase(), pptr() - pbase(), finish, &output);
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    return ok && file_->sputn(output.data(), output.size()) ==
+                     static_cast<std::streamsize>(output.size());
+  }
+
+ private:
+  std::filebuf *file_;
+  std::unique_ptr<Codec> encoder_;
+  std::vector<char> buffer_;
+};
+
+
+InputFileStream::InputFileStream(const std::string &path)
+    : std::istream(nullptr), file_(std::make_unique<std::filebuf>()) {
+  if (file_->open(path, std::ios::in | std::ios::binary) == nullptr) {
+    setstate(std::ios::failbit);
+    return;
+  }
+  is_open_ = true;
+  char magic[sizeof(kZstdMagic)];
+  std::streamsize size = file_->sgetn(magic, sizeof(magic));
+  file_->pubseekpos(0, std::ios::in);
+  std::unique_ptr<Codec> decoder =
+      CreateDecoder(DetectCompressionFormat(magic, size));
+  if (decoder) {
+    decompressor_ =
+        std::make_unique<DecompressingStreamBuf>(file_.get(),
+                                                 std::move(decoder));
+    rdbuf(decompressor_.get());
+  } else {
+    rdbuf(file_.get());
+  }
+}
+
+InputFileStream::~InputFileStream() {
+  // Stop the decompression thread before the file is closed.
+  decompressor_.reset();
+}
+
+bool InputFileStream::HasError() {
+  return !is_open_ || (decompressor_ && decompressor_->HasError());
+}
+
+
+OutputFileStream::OutputFileStream(const std::string &path,
+                                   CompressionFormat format)
+    : std::ostream(nullptr), file_(std::make_unique<std::filebuf>()) {
+  if (file_->open(path, std::ios::out | std::ios::trunc | std::ios::binary) ==
+      nullptr) {
+    setstate(std::ios::failbit);
+    return;
+  }
+  is_open_ = true;
+  std::unique_ptr<Codec> encoder = CreateEncoder(format);
+  if (encoder) {
+    compressor_ =
+        std::make_unique<CompressingStreamBuf>(file_.get(), std::move(encoder));
+    rdbuf(compressor_.get());
+  } else {
+    rdbuf(file_.get());
+  }
+}
+
+OutputFileStream::~OutputFileStream() {
+  Close();
+}
+
+bool OutputFileStream::Close() {
+  if (!is_open_) {
+    return false;
+  }
+  is_open_ = false;
+  bool ok = !fail();
+  if (compressor_ && !compressor_->Finish()) {
+    ok = false;
+  }
+  if (file_->close() == nullptr) {
+    ok = false;
+  }
+  if (!ok) {
+    setstate(std::ios::failbit);
+  }
+  return ok;
+}
+
+
+}  // namespace utils
+}  // namespace header_checker
@@ -0,0 +1,94 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef COMPRESSED_FILE_H_
+#define COMPRESSED_FILE_H_
+
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+
+namespace header_checker {
+namespace utils {
+
+
+class CompressingStreamBuf;
+class DecompressingStreamBuf;
+
+
+enum class CompressionFormat {
+  None,
+  Gzip,
+  Zstd,
+};
+
+
+// Returns the format of the data that starts with these bytes.
+CompressionFormat DetectCompressionFormat(const char *data, size_t size);
+
+
+// An input stream of a plain, gzip, or zstd file. The format is detected by
+// the magic bytes. A compressed file is decompressed on a separate thread, so
+// that decompression is overlapped with parsing.
+class InputFileStream : public std::istream {
+ public:
+  InputFileStream(const std::string &path);
+
+  ~InputFileStream();
+
+  bool IsOpen() const {
+    return is_open_;
+  }
+
+  // Returns true if the file could not be read or decompressed. A truncated
+  // compressed file is an error.
+  bool HasError();
+
+ private:
+  std::unique_ptr<std::filebuf> file_;
+  std::unique_ptr<DecompressingStreamBuf> decompressor_;
+  bool is_open_ = false;
+};
+
+
+// An output stream that writes a plain, gzip, or zstd file.
+class OutputFileStream : public std::ostream {
+ public:
+  OutputFileStream(const std::string &path, CompressionFormat format);
+
+  ~OutputFileStream();
+
+  bool IsOpen() const {
+    return is_open_;
+  }
+
+  // Finishes the compressed data and closes the file. Returns false if any
+  // write failed.
+  bool Close();
+
+ private:
+  std::unique_ptr<std::filebuf> file_;
+  std::unique_ptr<CompressingStreamBuf> compressor_;
+  bool is_open_ = false;
+};
+
+
+}  // namespace utils
+}  // namespace header_checker
+
+
+#endif  // COMPRESSED_FILE_H_
@@ -0,0 +1,173 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utils/compressed_file.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <gtest/gtest.h>
+
+
+namespace header_checker {
+namespace utils {
+
+
+// The size of the chunks that the decoder reads and writes.
+static const size_t kDecoderChunkSize = 1 << 16;
+
+
+class CompressedFileTest : public ::testing::TestWithParam<CompressionFormat> {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("compressed_file_test",
+                                                    "dump", path_));
+    // Several chunks of compressible data.
+    for (int i = 0; i < 100000; i++) {
+      content_ += "line " + std::to_string(i) + "\n";
+    }
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove(path_);
+  }
+
+  std::string ReadFile() {
+    std::ifstream input(std::string(path_), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(input),
+                       std::istreambuf_iterator<char>());
+  }
+
+  void WriteFile(const std::string &content) {
+    std::ofstream output(std::string(path_), std::ios::binary);
+    output << content;
+  }
+
+  llvm::SmallString<256> path_;
+  std::string content_;
+};
+
+
+TEST_P(CompressedFileTest, RoundTrip) {
+  OutputFileStream output(std::string(path_), GetParam());
+  ASSERT_TRUE(output.IsOpen());
+  output << content_;
+  ASSERT_TRUE(output.Close());
+
+  std::string compressed = ReadFile();
+  EXPECT_EQ(GetParam(),
+            DetectCompressionFormat(compressed.data(), compressed.size()));
+  if (GetParam() != CompressionFormat::None) {
+    EXPECT_LT(compressed.size(), content_.size());
+  }
+
+  InputFileStream input{std::string(path_)};
+  ASSERT_TRUE(input.IsOpen());
+  std::string decompressed((std::istreambuf_iterator<char>(input)),
+                           std::istreambuf_iterator<char>());
+  EXPECT_FALSE(input.HasError());
+  EXPECT_EQ(content_, decompressed);
+}
+
+
+TEST_P(CompressedFileTest, Truncated) {
+  if (GetParam() == CompressionFormat::None) {
+    return;
+  }
+  {
+    OutputFileStream output(std::string(path_), GetParam());
+    output << content_;
+    ASSERT_TRUE(output.Close());
+  }
+  std::string compressed = ReadFile();
+  WriteFile(compressed.substr(0, compressed.size() / 2));
+
+  InputFileStream input{std::string(path_)};
+  std::string decompressed((std::istreambuf_iterator<char>(input)),
+                           std::istreambuf_iterator<char>());
+  EXPECT_TRUE(input.HasError());
+}
+
+
+TEST_P(CompressedFileTest, ChunkAlignedContent) {
+  // The decompressed data fill the output buffers exactly.
+  std::string content(4 * kDecoderChunkSize, 'a');
+  {
+    OutputFileStream output(std::string(path_), GetParam());
+    output << content;
+    ASSERT_TRUE(output.Close());
+  }
+
+  InputFileStream input{std::string(path_)};
+  std::string decompressed((std::istreambuf_iterator<char>(input)),
+                           std::istreambuf_iterator<char>());
+  EXPECT_FALSE(input.HasError());
+  EXPECT_EQ(content, decompressed);
+}
+
+
+TEST_P(CompressedFileTest, ChunkAlignedFileSize) {
+  if (GetParam() != CompressionFormat::Zstd) {
+    return;
+  }
+  {
+    OutputFileStream output(std::string(path_), GetParam());
+    output << content_;
+    ASSERT_TRUE(output.Close());
+  }
+  // Pad the file with a skippable frame, so that the decoder gets an empty
+  // chunk after the last frame.
+  std::string compressed = ReadFile();
+  size_t padding = kDecoderChunkSize - compressed.size() % kDecoderChunkSize;
+  if (padding < 8) {
+    padding += kDecoderChunkSize;
+  }
+  uint32_t frame_size = padding - 8;
+  compressed.append("\x50\x2a\x4d\x18", 4);
+  for (int i = 0; i < 4; i++) {
+    compressed.push_back(static_cast<char>((frame_size >> (8 * i)) & 0xff));
+  }
+  compressed.append(frame_size, '\0');
+  ASSERT_EQ(0u, compressed.size() % kDecoderChunkSize);
+  WriteFile(compressed);
+
+  InputFileStream input{std::string(path_)};
+  std::string decompressed((std::istreambuf_iterator<char>(input)),
+                           std::istreambuf_iterator<char>());
+  EXPECT_FALSE(input.HasError());
+  EXPECT_EQ(content_, decompressed);
+}
+
+
+INSTANTIATE_TEST_SUITE_P(AllFormats, CompressedFileTest,
+                         ::testing::Values(CompressionFormat::None,
+                                           CompressionFormat::Gzip,
+                                           CompressionFormat::Zstd));
+
+
+TEST(InputFileStreamTest, MissingFile) {
+  InputFileStream input("/nonexistent/compressed_file_test.dump");
+  EXPECT_FALSE(input.IsOpen());
+  EXPECT_TRUE(input.HasError());
+  EXPECT_TRUE(input.fail());
+}
+
+
+}  // namespace utils
+}  // namespace header_checker
@@ -0,0 +1,63 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef HASH_UTILS_H_
+#define HASH_UTILS_H_
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MD5.h>
+
+#include <cstdint>
+#include <string>
+
+
+namespace header_checker {
+namespace utils {
+
+
+// This class computes the MD5 of a sequence of strings. Adjacent strings are
+// separated, so that ("ab", "c") and ("a", "bc") differ.
+class HashBuilder {
+ public:
+  void Add(llvm::StringRef str) {
+    hasher_.update(str);
+    hasher_.update(llvm::StringRef("\0", 1));
+  }
+
+  void Add(uint64_t value) {
+    Add(std::to_string(value));
+  }
+
+  void Add(int64_t value) {
+    Add(std::to_string(value));
+  }
+
+  // Returns the hash in hexadecimal.
+  std::string Finish() {
+    llvm::MD5::MD5Result result;
+    hasher_.final(result);
+    return std::string(result.digest());
+  }
+
+ private:
+  llvm::MD5 hasher_;
+};
+
+
+}  // namespace utils
+}  // namespace header_checker
+
+
+#endif  // HASH_UTILS_H_
@@ -32,9 +32,13 @@ std::string GetCwd();
 // don't resolve symbolic links.
 std::string NormalizePath(const std::string &path, const std::string &root_dir);
 
+// Walks the exported header directories in parallel. If cache_path is not
+// empty, the listings of the directories are cached in the file and only the
+// directories whose mtimes changed are listed again.
 std::set<std::string>
 CollectAllExportedHeaders(const std::vector<std::string> &exported_header_dirs,
-                          const std::string &root_dir);
+                          const std::string &root_dir,
+                          const std::string &cache_path = "");
 
 inline std::string FindAndReplace(const std::string &candidate_str,
                                   const std::string &find_str,
@@ -103,6 +107,64 @@ std::vector<std::pair<T, T>> FindCommonElements(
   return common_elements;
 }
 
+// These overloads let the functions below accept maps of elements as well as
+// maps of pointers to elements.
+template <typename T>
+inline const T *GetElementPointer(const T &element) {
+  return &element;
+}
+
+template <typename T>
+inline const T *GetElementPointer(const T *element) {
+  return element;
+}
+
+// Similar to FindRemovedElements, but returns pointers to the elements in
+// old_elements_map instead of copies.
+template <typename T, typename Map>
+std::vector<const T *> FindRemovedElementPointers(
+    const Map &old_elements_map, const Map &new_elements_map) {
+  std::vector<const T *> removed_elements;
+  auto new_element = new_elements_map.begin();
+  for (auto &&old_element : old_elements_map) {
+    while (new_element != new_elements_map.end() &&
+           new_element->first < old_element.first) {
+      new_element++;
+    }
+    if (new_element == new_elements_map.end() ||
+        old_element.first < new_element->first) {
+      removed_elements.emplace_back(GetElementPointer(old_element.second));
+    }
+  }
+  return removed_elements;
+}
+
+// Similar to FindCommonElements, but returns pointers to the elements in the
+// maps instead of copies.
+template <typename T, typename Map>
+std::vector<std::pair<const T *, const T *>> FindCommonElementPointers(
+    const Map &old_elements_map, const Map &new_elements_map) {
+  std::vector<std::pair<const T *, const T *>> common_elements;
+  auto old_element = old_elements_map.begin();
+  auto new_element = new_elements_map.begin();
+  while (old_element != old_elements_map.end() &&
+         new_element != new_elements_map.end()) {
+    if (old_element->first == new_element->first) {
+      common_elements.emplace_back(GetElementPointer(old_element->second),
+                                   GetElementPointer(new_element->second));
+      old_element++;
+      new_element++;
+      continue;
+    }
+    if (old_element->first < new_element->first) {
+      old_element++;
+    } else {
+      new_element++;
+    }
+  }
+  return common_elements;
+}
+
 
 }  // namespace utils
 }  // namespace header_checker
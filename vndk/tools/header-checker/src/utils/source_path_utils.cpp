@@ -14,12 +14,19 @@
 
 #include "utils/header_abi_util.h"
 
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <chrono>
+#include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <tuple>
 #include <vector>
 
 
@@ -61,57 +68,336 @@ std::string NormalizePath(const std::string &path,
   return std::string(norm_path);
 }
 
-static bool CollectExportedHeaderSet(const std::string &dir_name,
-                                     std::set<std::string> *exported_headers,
-                                     const std::string &root_dir) {
+namespace {
+
+
+// The entries of a directory that may be exported headers.
+struct DirectoryListing {
+  int64_t mtime_ = 0;
+  std::vector<std::string> files_;
+  std::vector<std::string> subdirs_;
+};
+
+
+// Maps the absolute paths of the directories to the listings.
+using DirectoryListings = std::map<std::string, DirectoryListing>;
+
+
+static const char kCacheMagic[] = "header-abi-exported-headers-1";
+
+// A listing is not cached if the directory was modified this recently before
+// the walk started, as another modification in the same timestamp granularity
+// would not change the mtime.
+static const int64_t kRacyMtimeNs = 2000000000;
+
+
+}  // namespace
+
+
+static int64_t GetMtimeNs(const llvm::sys::fs::basic_file_status &status) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             status.getLastModificationTime().time_since_epoch())
+      .count();
+}
+
+// The cache is a list of directory listings:
+//   D <tab> <absolute directory path> <tab> <mtime in nanoseconds>
+//   F <tab> <file name>
+//   S <tab> <subdirectory name>
+// A malformed or missing cache is ignored.
+static DirectoryListings ReadDirectoryListings(const std::string &cache_path) {
+  DirectoryListings listings;
+  auto buffer = llvm::MemoryBuffer::getFile(cache_path);
+  if (!buffer) {
+    return listings;
+  }
+  llvm::SmallVector<llvm::StringRef, 0> lines;
+  (*buffer)->getBuffer().split(lines, '\n', -1, false);
+  if (lines.empty() || lines.front() != kCacheMagic ||
+      lines.back() != "end") {
+    return listings;
+  }
+  DirectoryListing *listing = nullptr;
+  for (size_t i = 1; i + 1 < lines.size(); i++) {
+    llvm::StringRef tag, value;
+    std::tie(tag, value) = lines[i].split('\t');
+    if (tag == "D") {
+      llvm::StringRef path, mtime_str;
+      std::tie(path, mtime_str) = value.split('\t');
+      int64_t mtime;
+      if (mtime_str.getAsInteger(10, mtime)) {
+        return DirectoryListings();
+      }
+      listing = &listings[path.str()];
+      listing->mtime_ = mtime;
+    } else if (tag == "F" && listing) {
+      listing->files_.emplace_back(value.str());
+    } else if (tag == "S" && listing) {
+      listing->subdirs_.emplace_back(value.str());
+    } else {
+      return DirectoryListings();
+    }
+  }
+  return listings;
+}
+
+// Writes to a temporary file and renames it, so that the processes sharing the
+// cache never read a partial cache.
+static void WriteDirectoryListings(const std::string &cache_path,
+                                   const DirectoryListings &listings) {
+  int fd;
+  llvm::SmallString<256> tmp_path;
+  if (llvm::sys::fs::createUniqueFile(cache_path + ".tmp-%%%%%%", fd,
+                                      tmp_path)) {
+    llvm::errs() << "Failed to write exported headers cache: " << cache_path
+                 << "\n";
+    return;
+  }
+  {
+    llvm::raw_fd_ostream output(fd, /* shouldClose = */ true);
+    output << kCacheMagic << "\n";
+    for (auto &&entry : listings) {
+      output << "D\t" << entry.first << "\t" << entry.second.mtime_ << "\n";
+      for (auto &&file : entry.second.files_) {
+        output << "F\t" << file << "\n";
+      }
+      for (auto &&subdir : entry.second.subdirs_) {
+        output << "S\t" << subdir << "\n";
+      }
+    }
+    output << "end\n";
+  }
+  if (llvm::sys::fs::rename(tmp_path, cache_path)) {
+    llvm::sys::fs::remove(tmp_path);
+  }
+}
+
+
+namespace {
+
+
+// Walks the exported header directories on a thread pool. Each task lists one
+// directory and adds a task for each subdirectory. The listing of an unchanged
+// directory is taken from the cache, which saves the stat of each file.
+class ExportedHeaderWalker {
+ public:
+  ExportedHeaderWalker(const DirectoryListings &cached_listings)
+      : cached_listings_(cached_listings),
+        thread_pool_(llvm::optimal_concurrency(kMaxWalkerThreads)),
+        start_time_ns_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count()) {}
+
+  void Walk(const std::string &dir) {
+    thread_pool_.async([this, dir] { WalkDirectory(dir, true); });
+  }
+
+  // Returns false if any directory could not be walked.
+  bool Wait() {
+    thread_pool_.wait();
+    return !has_error_;
+  }
+
+  const DirectoryListings &GetListings() const {
+    return listings_;
+  }
+
+  // Returns the listings that were read from the disk and are not racy.
+  const DirectoryListings &GetNewListings() const {
+    return new_listings_;
+  }
+
+ private:
+  void WalkDirectory(const std::string &dir, bool is_exported_dir);
+
+  bool ListDirectory(const std::string &dir, DirectoryListing *listing);
+
+  void AddListing(const std::string &dir, DirectoryListing &&listing,
+                  bool is_new);
+
+ private:
+  const DirectoryListings &cached_listings_;
+
+  // The build runs many dumpers at once, so each of them walks the
+  // directories on a few threads only.
+  static constexpr unsigned kMaxWalkerThreads = 4;
+  llvm::ThreadPool thread_pool_;
+
+  const int64_t start_time_ns_;
+
+  std::mutex mutex_;
+  DirectoryListings listings_;
+  DirectoryListings new_listings_;
+  bool has_error_ = false;
+};
+
+
+}  // namespace
+
+
+void ExportedHeaderWalker::WalkDirectory(const std::string &dir,
+                                         bool is_exported_dir) {
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(dir, status) ||
+      !llvm::sys::fs::is_directory(status)) {
+    // A missing exported directory is ignored.
+    if (!is_exported_dir) {
+      llvm::errs() << "Failed to walk directory: " << dir << "\n";
+      std::lock_guard<std::mutex> lock(mutex_);
+      has_error_ = true;
+    }
+    return;
+  }
+
+  int64_t mtime = GetMtimeNs(status);
+  auto cached_it = cached_listings_.find(dir);
+  if (cached_it != cached_listings_.end() &&
+      cached_it->second.mtime_ == mtime) {
+    AddListing(dir, DirectoryListing(cached_it->second), false);
+    return;
+  }
+
+  DirectoryListing listing;
+  listing.mtime_ = mtime;
+  if (!ListDirectory(dir, &listing)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_error_ = true;
+    return;
+  }
+  AddListing(dir, std::move(listing), mtime + kRacyMtimeNs < start_time_ns_);
+}
+
+bool ExportedHeaderWalker::ListDirectory(const std::string &dir,
+                                         DirectoryListing *listing) {
   std::error_code ec;
-  llvm::sys::fs::recursive_directory_iterator walker(dir_name, ec);
-  // Default construction - end of directory.
-  llvm::sys::fs::recursive_directory_iterator end;
-  for ( ; walker != end; walker.increment(ec)) {
+  llvm::sys::fs::directory_iterator it(dir, ec);
+  llvm::sys::fs::directory_iterator end;
+  for ( ; it != end; it.increment(ec)) {
     if (ec) {
-      llvm::errs() << "Failed to walk directory: " << dir_name << ": "
-                   << ec.message() << "\n";
-      return false;
+      break;
     }
-
-    const std::string &file_path = walker->path();
+    const std::string &file_path = it->path();
 
     llvm::StringRef file_name(llvm::sys::path::filename(file_path));
     // Ignore swap files and hidden files / dirs. Do not recurse into them too.
     // We should also not look at source files. Many projects include source
     // files in their exports.
     if (ShouldSkipFile(file_name)) {
-      walker.no_push();
       continue;
     }
 
-    llvm::ErrorOr<llvm::sys::fs::basic_file_status> status = walker->status();
-    if (!status) {
-      llvm::errs() << "Failed to stat file: " << file_path << "\n";
-      return false;
+    // The type of a symlink is resolved by stat.
+    llvm::sys::fs::file_type type = it->type();
+    if (type == llvm::sys::fs::file_type::symlink_file ||
+        type == llvm::sys::fs::file_type::type_unknown) {
+      llvm::ErrorOr<llvm::sys::fs::basic_file_status> status = it->status();
+      if (!status) {
+        llvm::errs() << "Failed to stat file: " << file_path << "\n";
+        return false;
+      }
+      type = status->type();
     }
 
-    if ((status->type() != llvm::sys::fs::file_type::symlink_file) &&
-        (status->type() != llvm::sys::fs::file_type::regular_file)) {
-      // Ignore non regular files, except symlinks.
-      continue;
+    if (type == llvm::sys::fs::file_type::directory_file) {
+      listing->subdirs_.emplace_back(file_name.str());
+    } else if (type == llvm::sys::fs::file_type::regular_file) {
+      // Ignore non regular files.
+      listing->files_.emplace_back(file_name.str());
     }
-
-    exported_headers->insert(NormalizePath(file_path, root_dir));
+  }
+  if (ec) {
+    llvm::errs() << "Failed to walk directory: " << dir << ": "
+                 << ec.message() << "\n";
+    return false;
   }
   return true;
 }
 
+void ExportedHeaderWalker::AddListing(const std::string &dir,
+                                      DirectoryListing &&listing,
+                                      bool is_new) {
+  std::vector<std::string> subdirs;
+  for (auto &&subdir : listing.subdirs_) {
+    llvm::SmallString<256> subdir_path(dir);
+    llvm::sys::path::append(subdir_path, subdir);
+    subdirs.emplace_back(subdir_path.str());
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (is_new) {
+      new_listings_[dir] = listing;
+    }
+    // Overlapping exported directories are walked once.
+    if (!listings_.emplace(dir, std::move(listing)).second) {
+      return;
+    }
+  }
+  for (auto &&subdir_path : subdirs) {
+    thread_pool_.async(
+        [this, subdir_path] { WalkDirectory(subdir_path, false); });
+  }
+}
+
+static void CollectExportedHeaderSet(const std::string &dir,
+                                     const DirectoryListings &listings,
+                                     std::set<std::string> *exported_headers,
+                                     const std::string &root_dir) {
+  auto it = listings.find(dir);
+  if (it == listings.end()) {
+    return;
+  }
+  for (auto &&file : it->second.files_) {
+    llvm::SmallString<256> file_path(dir);
+    llvm::sys::path::append(file_path, file);
+    exported_headers->insert(NormalizePath(std::string(file_path), root_dir));
+  }
+  for (auto &&subdir : it->second.subdirs_) {
+    llvm::SmallString<256> subdir_path(dir);
+    llvm::sys::path::append(subdir_path, subdir);
+    CollectExportedHeaderSet(std::string(subdir_path), listings,
+                             exported_headers, root_dir);
+  }
+}
+
 std::set<std::string>
 CollectAllExportedHeaders(const std::vector<std::string> &exported_header_dirs,
-                          const std::string &root_dir) {
-  std::set<std::string> exported_headers;
+                          const std::string &root_dir,
+                          const std::string &cache_path) {
+  DirectoryListings cached_listings;
+  if (!cache_path.empty()) {
+    cached_listings = ReadDirectoryListings(cache_path);
+  }
+
+  // The directories are walked by the absolute paths, so that the cache can be
+  // shared by the processes in different working directories.
+  std::vector<std::string> dirs;
   for (auto &&dir : exported_header_dirs) {
-    if (!CollectExportedHeaderSet(dir, &exported_headers, root_dir)) {
-      llvm::errs() << "Couldn't collect exported headers\n";
-      ::exit(1);
+    llvm::SmallString<256> abs_dir(dir);
+    llvm::sys::fs::make_absolute(abs_dir);
+    dirs.emplace_back(abs_dir.str());
+  }
+
+  ExportedHeaderWalker walker(cached_listings);
+  for (auto &&dir : dirs) {
+    walker.Walk(dir);
+  }
+  if (!walker.Wait()) {
+    llvm::errs() << "Couldn't collect exported headers\n";
+    ::exit(1);
+  }
+
+  std::set<std::string> exported_headers;
+  for (auto &&dir : dirs) {
+    CollectExportedHeaderSet(dir, walker.GetListings(), &exported_headers,
+                             root_dir);
+  }
+
+  if (!cache_path.empty() && !walker.GetNewListings().empty()) {
+    // Keep the listings of the other processes' directories.
+    for (auto &&entry : walker.GetNewListings()) {
+      cached_listings[entry.first] = entry.second;
     }
+    WriteDirectoryListings(cache_path, cached_listings);
   }
   return exported_headers;
 }
@@ -14,6 +14,14 @@
 
 #include "utils/header_abi_util.h"
 
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+
+#include <chrono>
+#include <fstream>
+
 #include <gtest/gtest.h>
 
 
@@ -41,5 +49,66 @@ TEST(CollectExportedHeadersTest, NormalizeCwdPaths) {
 }
 
 
+static bool SetMtime(const std::string &path,
+                     std::chrono::system_clock::time_point time) {
+  int fd;
+  if (llvm::sys::fs::openFileForRead(path, fd)) {
+    return false;
+  }
+  std::error_code ec = llvm::sys::fs::setLastAccessAndModificationTime(
+      fd, llvm::sys::toTimePoint(
+              std::chrono::system_clock::to_time_t(time)));
+  llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+  return !ec;
+}
+
+
+TEST(CollectExportedHeadersTest, CollectWithCache) {
+  llvm::SmallString<256> root;
+  ASSERT_FALSE(
+      llvm::sys::fs::createUniqueDirectory("source_path_utils_test", root));
+  const std::string root_dir(root);
+  const std::string include_dir = root_dir + "/include";
+  const std::string cache_path = root_dir + "/cache";
+  ASSERT_FALSE(llvm::sys::fs::create_directories(include_dir + "/sub"));
+  std::ofstream(include_dir + "/a.h");
+  std::ofstream(include_dir + "/a.cpp");
+  std::ofstream(include_dir + "/.hidden.h");
+  std::ofstream(include_dir + "/sub/b.h");
+
+  const std::set<std::string> expected_headers = {"include/a.h",
+                                                  "include/sub/b.h"};
+  EXPECT_EQ(expected_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir));
+  EXPECT_EQ(expected_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir, cache_path));
+  EXPECT_EQ(expected_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir, cache_path));
+
+  // The directories modified just now are not cached.
+  EXPECT_FALSE(llvm::sys::fs::exists(cache_path));
+
+  // The cached listing of sub is used as long as its mtime is unchanged.
+  auto old_time = std::chrono::system_clock::now() - std::chrono::hours(1);
+  ASSERT_TRUE(SetMtime(include_dir, old_time));
+  ASSERT_TRUE(SetMtime(include_dir + "/sub", old_time));
+  EXPECT_EQ(expected_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir, cache_path));
+  EXPECT_TRUE(llvm::sys::fs::exists(cache_path));
+  std::ofstream(include_dir + "/sub/c.h");
+  ASSERT_TRUE(SetMtime(include_dir + "/sub", old_time));
+  EXPECT_EQ(expected_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir, cache_path));
+
+  const std::set<std::string> updated_headers = {
+      "include/a.h", "include/sub/b.h", "include/sub/c.h"};
+  ASSERT_TRUE(SetMtime(include_dir + "/sub", std::chrono::system_clock::now()));
+  EXPECT_EQ(updated_headers,
+            CollectAllExportedHeaders({include_dir}, root_dir, cache_path));
+
+  llvm::sys::fs::remove_directories(root_dir);
+}
+
+
 }  // namespace utils
 }  // namespace header_checker
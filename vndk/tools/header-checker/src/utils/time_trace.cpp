@@ -0,0 +1,164 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utils/time_trace.h"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+
+namespace header_checker {
+namespace utils {
+
+
+static std::string trace_path;
+static unsigned trace_granularity_us;
+static std::string trace_process_name;
+
+static std::mutex counters_mutex;
+static std::map<std::string, uint64_t> counters;
+
+
+void InitTimeTrace(const std::string &path, unsigned granularity_us,
+                   const char *process_name) {
+  if (path.empty()) {
+    return;
+  }
+  trace_path = path;
+  trace_granularity_us = granularity_us;
+  trace_process_name = process_name;
+  llvm::timeTraceProfilerInitialize(trace_granularity_us, trace_process_name);
+}
+
+bool IsTimeTraceEnabled() {
+  return !trace_path.empty();
+}
+
+void AddTimeTraceCounter(const std::string &name, uint64_t value) {
+  if (!IsTimeTraceEnabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(counters_mutex);
+  counters[name] += value;
+}
+
+// llvm::TimeTraceProfiler does not support counters. They are appended to the
+// events it writes.
+static bool AppendCounters(llvm::json::Value *trace) {
+  llvm::json::Object *object = trace->getAsObject();
+  llvm::json::Array *events =
+      object ? object->getArray("traceEvents") : nullptr;
+  if (!events) {
+    return false;
+  }
+  int64_t pid = 0;
+  int64_t end_us = 0;
+  for (auto &&event : *events) {
+    const llvm::json::Object *event_object = event.getAsObject();
+    if (!event_object) {
+      continue;
+    }
+    if (llvm::Optional<int64_t> event_pid = event_object->getInteger("pid")) {
+      pid = *event_pid;
+    }
+    llvm::Optional<int64_t> ts = event_object->getInteger("ts");
+    llvm::Optional<int64_t> dur = event_object->getInteger("dur");
+    if (ts && dur) {
+      end_us = std::max(end_us, *ts + *dur);
+    }
+  }
+  for (auto &&counter : counters) {
+    events->push_back(llvm::json::Object{
+        {"ph", "C"},
+        {"pid", pid},
+        {"tid", 0},
+        {"ts", end_us},
+        {"name", counter.first},
+        {"args",
+         llvm::json::Object{{"value", static_cast<int64_t>(counter.second)}}},
+    });
+  }
+  return true;
+}
+
+bool WriteTimeTrace() {
+  if (!IsTimeTraceEnabled()) {
+    return true;
+  }
+  llvm::SmallString<0> buffer;
+  llvm::raw_svector_ostream buffer_stream(buffer);
+  llvm::timeTraceProfilerWrite(buffer_stream);
+  llvm::timeTraceProfilerCleanup();
+  // The diff server may record another trace for the next request.
+  std::string path = std::move(trace_path);
+  trace_path.clear();
+
+  llvm::Expected<llvm::json::Value> trace = llvm::json::parse(buffer);
+  if (!trace) {
+    llvm::consumeError(trace.takeError());
+    llvm::errs() << "Failed to parse the time trace\n";
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(counters_mutex);
+    bool ok = AppendCounters(&*trace);
+    counters.clear();
+    if (!ok) {
+      llvm::errs() << "Unexpected time trace format\n";
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_Text);
+  if (ec) {
+    llvm::errs() << "Failed to open \"" << path << "\": "
+                 << ec.message() << "\n";
+    return false;
+  }
+  out << *trace;
+  out.close();
+  if (out.has_error()) {
+    out.clear_error();
+    llvm::errs() << "Failed to write \"" << path << "\"\n";
+    return false;
+  }
+  return true;
+}
+
+
+TimeTraceThread::TimeTraceThread()
+    : initialized_(IsTimeTraceEnabled() && !llvm::timeTraceProfilerEnabled()) {
+  if (initialized_) {
+    llvm::timeTraceProfilerInitialize(trace_granularity_us,
+                                      trace_process_name);
+  }
+}
+
+TimeTraceThread::~TimeTraceThread() {
+  if (initialized_) {
+    llvm::timeTraceProfilerFinishThread();
+  }
+}
+
+
+}  // namespace utils
+}  // namespace header_checker
@@ -0,0 +1,62 @@
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TIME_TRACE_H_
+#define TIME_TRACE_H_
+
+#include <llvm/Support/TimeProfiler.h>
+
+#include <cstdint>
+#include <string>
+
+
+namespace header_checker {
+namespace utils {
+
+
+// Starts llvm::TimeTraceProfiler on the calling thread if path is not empty.
+// The spans shorter than granularity_us microseconds are discarded. Use
+// llvm::TimeTraceScope to record a span.
+void InitTimeTrace(const std::string &path, unsigned granularity_us,
+                   const char *process_name);
+
+bool IsTimeTraceEnabled();
+
+// Adds value to the named counter. The counters are written as Chrome trace
+// counter events at the end of the trace.
+void AddTimeTraceCounter(const std::string &name, uint64_t value);
+
+// Writes the spans of all threads and the counters to the path given to
+// InitTimeTrace. This function does nothing if the trace is not enabled.
+bool WriteTimeTrace();
+
+
+// The spans recorded by a thread other than the one calling InitTimeTrace are
+// kept only if the thread creates one of these while recording.
+class TimeTraceThread {
+ public:
+  TimeTraceThread();
+
+  ~TimeTraceThread();
+
+ private:
+  bool initialized_;
+};
+
+
+}  // namespace utils
+}  // namespace header_checker
+
+
+#endif  // TIME_TRACE_H_
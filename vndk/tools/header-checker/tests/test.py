@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import json
 import os
 import shutil
 import subprocess
@@ -11,7 +12,8 @@ import_path = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
 import_path = os.path.abspath(os.path.join(import_path, 'utils'))
 sys.path.insert(1, import_path)
 
-from utils import run_abi_diff, run_header_abi_dumper
+from utils import (AOSP_DIR, BUILTIN_HEADERS_DIR, DEFAULT_CPPFLAGS,
+                   run_abi_diff, run_header_abi_dumper, run_header_abi_linker)
 from module import Module
 
 
@@ -35,6 +37,16 @@ def _read_output_content(dump_path):
         return f.read()
 
 
+def _read_sorted_json_dump(dump_path):
+    """Read a JSON dump and sort the elements of each kind."""
+    with open(dump_path, 'r') as f:
+        dump = json.load(f)
+    return {key: (sorted(json.dumps(element, sort_keys=True)
+                         for element in value)
+                  if isinstance(value, list) else value)
+            for key, value in dump.items()}
+
+
 class HeaderCheckerTest(unittest.TestCase):
     @classmethod
     def setUpClass(cls):
@@ -334,6 +346,37 @@ class HeaderCheckerTest(unittest.TestCase):
             lsdump_old, lsdump_new, "libweak_symbols", "arm64", 0,
             options + ["-allow-adding-removing-weak-symbols"])
 
+    def test_arch_diff_config_file(self):
+        tmp_dir = self.get_tmp_dir()
+        dumps = {}
+        for arch in ('arm', 'arm64'):
+            arch_dir = os.path.join(tmp_dir, arch)
+            os.makedirs(arch_dir)
+            for lib in ('libc_and_cpp', 'libc_and_cpp_with_unused_struct'):
+                dump_name = lib + '.so.lsdump'
+                dumps[(arch, lib)] = os.path.join(arch_dir, dump_name)
+                shutil.copy(os.path.join(REF_DUMP_DIR, arch, dump_name),
+                            dumps[(arch, lib)])
+        # Only the config file of arm enables -check-all-apis.
+        with open(os.path.join(tmp_dir, 'arm', 'config.ini'), 'w') as f:
+            f.write('[global]\ncheck_all_apis = true\n')
+
+        def get_old_and_new_dumps(arch):
+            return (dumps[(arch, 'libc_and_cpp')],
+                    dumps[(arch, 'libc_and_cpp_with_unused_struct')])
+
+        self.run_and_compare_abi_diff(*get_old_and_new_dumps('arm64'), 'test',
+                                      'arm64', 0)
+        self.run_and_compare_abi_diff(*get_old_and_new_dumps('arm'), 'test',
+                                      'arm', 1)
+
+        # Each architecture is diffed with its own config file, as in the
+        # separate runs.
+        arch_diff = ','.join(('arm',) + get_old_and_new_dumps('arm') +
+                             (os.path.join(tmp_dir, 'arm.abidiff'),))
+        self.run_and_compare_abi_diff(*get_old_and_new_dumps('arm64'), 'test',
+                                      'arm64', 1, ['-arch-diff', arch_diff])
+
     def test_linker_shared_object_file_and_version_script(self):
         base_dir = os.path.join(
             SCRIPT_DIR, 'integration', 'version_script_example')
@@ -386,6 +429,488 @@ class HeaderCheckerTest(unittest.TestCase):
         self.prepare_and_absolute_diff_all_archs(
             "libmerge_multi_definitions", "libmerge_multi_definitions")
 
+    def dump_with_abi_fragment_cache(self, source_name, cache_dir):
+        """Dump a source file in the temporary directory in JSON format and
+        return the dump path."""
+        tmp_dir = self.get_tmp_dir()
+        input_path = os.path.join(tmp_dir, source_name)
+        output_path = input_path + '.sdump'
+        flags = ['-output-format', 'Json']
+        if cache_dir:
+            flags += ['-abi-fragment-cache', cache_dir]
+        run_header_abi_dumper(input_path, output_path,
+                              export_include_dirs=[tmp_dir], flags=flags)
+        return output_path
+
+    def test_abi_fragment_cache(self):
+        tmp_dir = self.get_tmp_dir()
+        cache_dir = os.path.join(tmp_dir, 'cache')
+        sources = {
+            'fragment.h': 'struct Fragment { char c; int i; };\n',
+            'a.cpp': '#include "fragment.h"\nvoid a(Fragment *) {}\n',
+            'b.cpp': '#include "fragment.h"\nvoid b(Fragment *) {}\n',
+            'packed.cpp': ('#pragma pack(push, 1)\n'
+                           '#include "fragment.h"\n'
+                           '#pragma pack(pop)\n'
+                           'void packed(Fragment *) {}\n'),
+        }
+        for name, content in sources.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+
+        def read_fragment_list(dump_path):
+            with open(dump_path + '.fragments', 'r') as f:
+                return f.read().split()
+
+        def read_record_sizes(dump_path):
+            with open(dump_path, 'r') as f:
+                return {record['name']: record['size']
+                        for record in json.load(f).get('record_types', [])}
+
+        # The first dump writes the fragment.
+        a_dump = self.dump_with_abi_fragment_cache('a.cpp', cache_dir)
+        a_fragments = read_fragment_list(a_dump)
+        self.assertEqual(len(a_fragments), 1)
+        self.assertEqual(read_record_sizes(a_dump), {})
+        self.assertEqual(read_record_sizes(a_fragments[0]), {'Fragment': 8})
+
+        # The second dump shares the fragment.
+        b_dump = self.dump_with_abi_fragment_cache('b.cpp', cache_dir)
+        self.assertEqual(read_fragment_list(b_dump), a_fragments)
+        self.assertEqual(read_record_sizes(b_dump), {})
+
+        # #pragma pack at the #include directive changes the layout.
+        packed_dump = self.dump_with_abi_fragment_cache('packed.cpp',
+                                                        cache_dir)
+        packed_fragments = read_fragment_list(packed_dump)
+        self.assertEqual(len(packed_fragments), 1)
+        self.assertNotEqual(packed_fragments, a_fragments)
+        self.assertEqual(read_record_sizes(packed_fragments[0]),
+                         {'Fragment': 5})
+
+        # Dumping without the cache removes the list of the previous run.
+        a_dump = self.dump_with_abi_fragment_cache('a.cpp', None)
+        self.assertFalse(os.path.exists(a_dump + '.fragments'))
+        self.assertEqual(read_record_sizes(a_dump), {'Fragment': 8})
+
+    def test_link_abi_fragments(self):
+        tmp_dir = self.get_tmp_dir()
+        cache_dir = os.path.join(tmp_dir, 'cache')
+        files = {
+            'fragment.h': ('enum Kind { KIND_A, KIND_B };\n'
+                           'struct Fragment { Kind kind; int i; };\n'),
+            'a.cpp': '#include "fragment.h"\nvoid a(Fragment *) {}\n',
+            'b.cpp': '#include "fragment.h"\nKind b(const Fragment &);\n'
+                     'Kind b(const Fragment &f) { return f.kind; }\n',
+            'map.txt': ('LIBFRAGMENT {\n'
+                        '  global:\n'
+                        '    _Z1aP8Fragment;\n'
+                        '    _Z1bRK8Fragment;\n'
+                        '  local:\n'
+                        '    *;\n'
+                        '};\n'),
+        }
+        for name, content in files.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+        version_script = os.path.join(tmp_dir, 'map.txt')
+        format_flags = ['-input-format', 'Json', '-output-format', 'Json']
+
+        def dump_and_link(cache_dir, linked_dump, flags):
+            dumps = [self.dump_with_abi_fragment_cache(name, cache_dir)
+                     for name in ('a.cpp', 'b.cpp')]
+            run_header_abi_linker(dumps, linked_dump, version_script,
+                                  'current', 'arm64', format_flags + flags)
+            return dumps
+
+        fragment_linked_dump = os.path.join(tmp_dir, 'fragment.lsdump')
+        dumps = dump_and_link(cache_dir, fragment_linked_dump,
+                              ['-read-abi-fragments'])
+        for dump in dumps:
+            self.assertTrue(os.path.exists(dump + '.fragments'))
+
+        # The linker ignores the lists unless -read-abi-fragments is specified.
+        ignored_linked_dump = os.path.join(tmp_dir, 'ignored.lsdump')
+        run_header_abi_linker(dumps, ignored_linked_dump, version_script,
+                              'current', 'arm64', format_flags)
+
+        linked_dump = os.path.join(tmp_dir, 'linked.lsdump')
+        dump_and_link(None, linked_dump, ['-read-abi-fragments'])
+
+        linked_content = _read_output_content(linked_dump)
+        self.assertIn('"Fragment"', linked_content)
+        self.assertEqual(_read_output_content(fragment_linked_dump),
+                         linked_content)
+        self.assertNotIn('"Fragment"',
+                         _read_output_content(ignored_linked_dump))
+
+    def test_write_index(self):
+        tmp_dir = self.get_tmp_dir()
+        files = {
+            'index.cpp': ('enum Kind { KIND_A, KIND_B };\n'
+                          'struct Indexed { Kind kind; int *p; };\n'
+                          'Indexed global_indexed;\n'
+                          'Kind indexed(const Indexed &i) {\n'
+                          '  return i.kind;\n'
+                          '}\n'),
+            'map.txt': ('LIBINDEX {\n'
+                        '  global:\n'
+                        '    _Z7indexedRK7Indexed;\n'
+                        '    global_indexed;\n'
+                        '  local:\n'
+                        '    *;\n'
+                        '};\n'),
+        }
+        for name, content in files.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+        version_script = os.path.join(tmp_dir, 'map.txt')
+        dumps = [self.dump_with_abi_fragment_cache('index.cpp', None)]
+        format_flags = ['-input-format', 'Json', '-output-format', 'Json']
+
+        linked_dump = os.path.join(tmp_dir, 'linked.lsdump')
+        run_header_abi_linker(dumps, linked_dump, version_script, 'current',
+                              'arm64', format_flags)
+        indexed_dump = os.path.join(tmp_dir, 'indexed.lsdump')
+        run_header_abi_linker(dumps, indexed_dump, version_script, 'current',
+                              'arm64', format_flags + ['-write-index'])
+
+        # The index does not change the dump.
+        self.assertTrue(os.path.exists(indexed_dump + '.index'))
+        self.assertFalse(os.path.exists(linked_dump + '.index'))
+        linked_content = _read_output_content(linked_dump)
+        self.assertIn('"Indexed"', linked_content)
+        self.assertEqual(linked_content, _read_output_content(indexed_dump))
+
+    def test_prune_unreachable(self):
+        tmp_dir = self.get_tmp_dir()
+        files = {
+            'prune.h': ('struct Unused { int i; };\n'
+                        'struct Member { int i; };\n'
+                        'struct Param { Member member; };\n'
+                        'void param(Param *);\n'
+                        'struct VtableMember { int i; };\n'
+                        'class Virtual {\n'
+                        ' public:\n'
+                        '  virtual ~Virtual();\n'
+                        '  VtableMember member;\n'
+                        '};\n'
+                        'struct TypeInfoMember { int i; };\n'
+                        'struct TypeInfo { TypeInfoMember member; };\n'),
+            'prune.cpp': ('#include "prune.h"\n'
+                          'void param(Param *) {}\n'
+                          'Virtual::~Virtual() {}\n'),
+            'map.txt': ('LIBPRUNE {\n'
+                        '  global:\n'
+                        '    _Z5paramP5Param;\n'
+                        '    _ZTV7Virtual; # var\n'
+                        '    _ZTI8TypeInfo; # var\n'
+                        '  local:\n'
+                        '    *;\n'
+                        '};\n'),
+        }
+        for name, content in files.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+        version_script = os.path.join(tmp_dir, 'map.txt')
+        dumps = [self.dump_with_abi_fragment_cache('prune.cpp', None)]
+        format_flags = ['-input-format', 'Json', '-output-format', 'Json']
+
+        linked_dump = os.path.join(tmp_dir, 'linked.lsdump')
+        run_header_abi_linker(dumps, linked_dump, version_script, 'current',
+                              'arm64', format_flags)
+        pruned_dump = os.path.join(tmp_dir, 'pruned.lsdump')
+        run_header_abi_linker(dumps, pruned_dump, version_script, 'current',
+                              'arm64', format_flags + ['-prune-unreachable'])
+
+        linked = _read_sorted_json_dump(linked_dump)
+        pruned = _read_sorted_json_dump(pruned_dump)
+        with open(pruned_dump, 'r') as f:
+            record_names = {record['name']
+                            for record in json.load(f)['record_types']}
+        # The types reachable from the exported vtable and type info are kept.
+        self.assertEqual({'Param', 'Member', 'Virtual', 'VtableMember',
+                          'TypeInfo', 'TypeInfoMember'}, record_names)
+        self.assertIn('"Unused"', _read_output_content(linked_dump))
+        for key, value in linked.items():
+            if key.endswith('_types'):
+                self.assertLessEqual(set(pruned[key]), set(value))
+            else:
+                self.assertEqual(pruned[key], value)
+
+    def test_incremental_dump(self):
+        tmp_dir = self.get_tmp_dir()
+        header_path = os.path.join(tmp_dir, 'incremental.h')
+        input_path = os.path.join(tmp_dir, 'incremental.cpp')
+        output_path = input_path + '.sdump'
+        manifest_path = output_path + '.manifest'
+        with open(header_path, 'w') as f:
+            f.write('struct Incremental { int first; };\n')
+        with open(input_path, 'w') as f:
+            f.write('#include "incremental.h"\n'
+                    'void incremental(Incremental *) {}\n')
+
+        def is_redumped(cflags=[]):
+            """Dump the source file and return whether the dump has been
+            rewritten."""
+            if os.path.exists(output_path):
+                os.utime(output_path, (0, 0))
+            run_header_abi_dumper(input_path, output_path, cflags,
+                                  export_include_dirs=[tmp_dir],
+                                  flags=['-output-format', 'Json',
+                                         '-incremental'])
+            return os.stat(output_path).st_mtime != 0
+
+        self.assertTrue(is_redumped())
+        self.assertTrue(os.path.exists(manifest_path))
+        self.assertFalse(is_redumped())
+
+        # Touching the header does not change its content.
+        os.utime(header_path)
+        self.assertFalse(is_redumped())
+
+        # Editing the included header.
+        with open(header_path, 'w') as f:
+            f.write('struct Incremental { int first; int second; };\n')
+        self.assertTrue(is_redumped())
+        self.assertIn('"second"', _read_output_content(output_path))
+        self.assertFalse(is_redumped())
+
+        # Changing the compiler flags.
+        self.assertTrue(is_redumped(['-DINCREMENTAL']))
+        self.assertFalse(is_redumped(['-DINCREMENTAL']))
+
+        # A truncated manifest.
+        with open(manifest_path, 'r') as f:
+            lines = f.readlines()
+        with open(manifest_path, 'w') as f:
+            f.writelines(lines[:-1])
+        self.assertTrue(is_redumped(['-DINCREMENTAL']))
+        self.assertFalse(is_redumped(['-DINCREMENTAL']))
+
+        # A corrupt manifest.
+        with open(manifest_path, 'w') as f:
+            f.write('corrupt\n')
+        self.assertTrue(is_redumped(['-DINCREMENTAL']))
+        self.assertFalse(is_redumped(['-DINCREMENTAL']))
+
+    def test_prelude_pch(self):
+        tmp_dir = self.get_tmp_dir()
+        include_dir = os.path.join(tmp_dir, 'include')
+        system_dir = os.path.join(tmp_dir, 'system')
+        pch_dir = os.path.join(tmp_dir, 'pch')
+        os.makedirs(include_dir)
+        os.makedirs(system_dir)
+        system_header = os.path.join(system_dir, 'system.h')
+        prelude = os.path.join(tmp_dir, 'prelude.h')
+        header = os.path.join(include_dir, 'api.h')
+        input_path = os.path.join(tmp_dir, 'api.cpp')
+        files = {
+            system_header: 'typedef int SystemInt;\n',
+            prelude: '#include <system.h>\n',
+            header: ('#include <system.h>\n'
+                     'struct Api { SystemInt i; };\n'
+                     'void api(Api *);\n'),
+            input_path: '#include "api.h"\nvoid api(Api *) {}\n',
+        }
+        for path, content in files.items():
+            with open(path, 'w') as f:
+                f.write(content)
+        cflags = ['-isystem', system_dir]
+
+        def dump(name, flags=[]):
+            output_path = os.path.join(tmp_dir, name + '.sdump')
+            run_header_abi_dumper(input_path, output_path, cflags,
+                                  [include_dir],
+                                  ['-output-format', 'Json'] + flags)
+            return _read_output_content(output_path)
+
+        def get_pch_path():
+            pch_paths = [name for name in os.listdir(pch_dir)
+                         if name.endswith('.pch')]
+            self.assertEqual(len(pch_paths), 1)
+            return os.path.join(pch_dir, pch_paths[0])
+
+        prelude_flags = ['-prelude', prelude, '-prelude-pch-dir', pch_dir]
+        self.assertEqual(dump('pch', prelude_flags), dump('plain'))
+        pch_path = get_pch_path()
+        self.assertTrue(os.path.exists(pch_path + '.manifest'))
+
+        # The PCH is reused.
+        os.utime(pch_path, (0, 0))
+        self.assertEqual(dump('pch', prelude_flags), dump('plain'))
+        self.assertEqual(os.stat(pch_path).st_mtime, 0)
+
+        # Editing a header that the prelude includes rebuilds the PCH.
+        with open(system_header, 'w') as f:
+            f.write('typedef long SystemInt;\n')
+        self.assertEqual(dump('pch', prelude_flags), dump('plain'))
+        self.assertEqual(get_pch_path(), pch_path)
+        self.assertNotEqual(os.stat(pch_path).st_mtime, 0)
+        self.assertIn('"long"', _read_output_content(
+            os.path.join(tmp_dir, 'pch.sdump')))
+
+    def test_linked_dump_odr_violation(self):
+        tmp_dir = self.get_tmp_dir()
+        files = {
+            'odr.h': 'struct Odr { ODR_FIELD_TYPE field; };\n',
+            'a.cpp': ('#define ODR_FIELD_TYPE int\n'
+                      '#include "odr.h"\n'
+                      'void a(Odr *) {}\n'),
+            'b.cpp': ('#define ODR_FIELD_TYPE long\n'
+                      '#include "odr.h"\n'
+                      'void b(Odr *) {}\n'),
+            'map.txt': ('LIBODR {\n'
+                        '  global:\n'
+                        '    _Z1aP3Odr;\n'
+                        '    _Z1bP3Odr;\n'
+                        '  local:\n'
+                        '    *;\n'
+                        '};\n'),
+        }
+        for name, content in files.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+        sources = [os.path.join(tmp_dir, name) for name in ('a.cpp', 'b.cpp')]
+        version_script = os.path.join(tmp_dir, 'map.txt')
+        format_flags = ['-output-format', 'Json']
+
+        # The in-memory modules are named after the dumps of the source files.
+        dumps = []
+        for source in sources:
+            dumps.append(source + '.sdump')
+            run_header_abi_dumper(source, dumps[-1], flags=format_flags)
+        linked_dump = os.path.join(tmp_dir, 'linked.lsdump')
+        run_header_abi_linker(dumps, linked_dump, version_script, 'current',
+                              'arm64', ['-input-format', 'Json'] + format_flags)
+
+        fused_dump = os.path.join(tmp_dir, 'fused.lsdump')
+        cmd = ['header-abi-dumper', '-linked-dump', fused_dump,
+               '-v', version_script, '-api', 'current', '-arch', 'arm64']
+        cmd += format_flags + sources + ['--'] + DEFAULT_CPPFLAGS
+        for dir in BUILTIN_HEADERS_DIR:
+            cmd += ['-isystem', dir]
+        subprocess.check_call(cmd, cwd=AOSP_DIR)
+
+        linked_content = _read_output_content(linked_dump)
+        self.assertIn('#ODR:', linked_content)
+        self.assertEqual(_read_output_content(fused_dump), linked_content)
+
+    def test_referencing_types_through_typedefs(self):
+        tmp_dir = self.get_tmp_dir()
+        files = {
+            'typedef.h': ('typedef int *IntPtr;\n'
+                          'typedef const int ConstInt;\n'
+                          'typedef IntPtr IntPtrArray[2];\n'
+                          'typedef int &IntRef;\n'
+                          'void spell(IntPtr, ConstInt *, IntPtrArray *, '
+                          'IntRef);\n'
+                          'void spell_again(IntPtr, const int *, int *(*)[2], '
+                          'int &);\n'),
+            'typedef.cpp': ('#include "typedef.h"\n'
+                            'void spell(IntPtr, ConstInt *, IntPtrArray *, '
+                            'IntRef) {}\n'
+                            'void spell_again(IntPtr, const int *, '
+                            'int *(*)[2], int &) {}\n'),
+            'plain.h': ('void spell(int *, const int *, int *(*)[2], int &);\n'
+                        'void spell_again(int *, const int *, int *(*)[2], '
+                        'int &);\n'),
+            'plain.cpp': ('#include "plain.h"\n'
+                          'void spell(int *, const int *, int *(*)[2], '
+                          'int &) {}\n'
+                          'void spell_again(int *, const int *, int *(*)[2], '
+                          'int &) {}\n'),
+        }
+        for name, content in files.items():
+            with open(os.path.join(tmp_dir, name), 'w') as f:
+                f.write(content)
+
+        def read_type_ids(dump_path):
+            with open(dump_path, 'r') as f:
+                dump = json.load(f)
+            type_ids = {}
+            for kind in ('array_types', 'builtin_types',
+                         'lvalue_reference_types', 'pointer_types',
+                         'qualified_types'):
+                self_types = [element['self_type']
+                              for element in dump.get(kind, [])]
+                # Each type is dumped once however it is spelled.
+                self.assertEqual(len(self_types), len(set(self_types)))
+                type_ids[kind] = sorted(self_types)
+            type_ids['functions'] = sorted(
+                (function['linker_set_key'],
+                 tuple(parameter['referenced_type']
+                       for parameter in function.get('parameters', [])))
+                for function in dump.get('functions', []))
+            return type_ids
+
+        typedef_dump = self.dump_with_abi_fragment_cache('typedef.cpp', None)
+        plain_dump = self.dump_with_abi_fragment_cache('plain.cpp', None)
+        self.assertEqual(read_type_ids(typedef_dump),
+                         read_type_ids(plain_dump))
+
+    def test_stream_output(self):
+        tmp_dir = self.get_tmp_dir()
+        cflags = ['-x', 'c++', '-std=c++11']
+        for name in ('example1.cpp', 'example1.h', 'example2.h',
+                     'example3.h'):
+            input_path = os.path.join(INPUT_DIR, name)
+            dumps = []
+            for flags in ([], ['-stream-output']):
+                dumps.append(os.path.join(tmp_dir,
+                                          name + str(len(dumps)) + '.sdump'))
+                run_header_abi_dumper(input_path, dumps[-1], cflags,
+                                      EXPORTED_HEADER_DIRS,
+                                      ['-output-format', 'Json'] + flags)
+            # The streamed elements are in the order of traversal.
+            self.assertEqual(_read_sorted_json_dump(dumps[0]),
+                             _read_sorted_json_dump(dumps[1]))
+
+    def test_time_trace(self):
+        tmp_dir = self.get_tmp_dir()
+        version_script = os.path.join(tmp_dir, 'map.txt')
+        with open(version_script, 'w') as f:
+            f.write('LIBEXAMPLE {\n  local:\n    *;\n};\n')
+        input_path = os.path.join(INPUT_DIR, 'example1.cpp')
+        cflags = ['-x', 'c++', '-std=c++11']
+
+        def read_trace_event_names(trace_path):
+            with open(trace_path, 'r') as f:
+                return {event['name'] for event in json.load(f)['traceEvents']}
+
+        outputs = []
+        for time_trace in (False, True):
+            prefix = os.path.join(tmp_dir, str(len(outputs)))
+            dumper_flags = []
+            linker_flags = []
+            if time_trace:
+                dumper_flags = ['-time-trace', prefix + '.json',
+                                '-time-trace-granularity', '0']
+                linker_flags = ['-time-trace', prefix + '.link.json',
+                                '-time-trace-granularity', '0']
+            dump = prefix + '.sdump'
+            run_header_abi_dumper(input_path, dump, cflags,
+                                  EXPORTED_HEADER_DIRS, dumper_flags)
+            linked_dump = prefix + '.lsdump'
+            run_header_abi_linker([dump], linked_dump, version_script,
+                                  'current', 'arm64', linker_flags)
+            outputs.append((dump, linked_dump))
+        # The trace does not change the dumps.
+        for dump, trace_dump in zip(*outputs):
+            self.assertEqual(_read_output_content(dump),
+                             _read_output_content(trace_dump))
+        self.assertIn('DumpSourceFile',
+                      read_trace_event_names(os.path.join(tmp_dir, '1.json')))
+        self.assertIn('Link', read_trace_event_names(
+            os.path.join(tmp_dir, '1.link.json')))
+
+        lsdump = os.path.join(REF_DUMP_DIR, 'arm64', 'libc_and_cpp.so.lsdump')
+        diff_trace = os.path.join(tmp_dir, 'diff.json')
+        self.run_and_compare_abi_diff(
+            lsdump, lsdump, 'libc_and_cpp', 'arm64', 0,
+            ['-time-trace', diff_trace, '-time-trace-granularity', '0'])
+        self.assertIn('CompareTUs', read_trace_event_names(diff_trace))
+
     def test_print_resource_dir(self):
         dumper_path = shutil.which("header-abi-dumper")
         self.assertIsNotNone(dumper_path)